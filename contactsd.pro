@@ -13,9 +13,12 @@ pkgconfig.path=$$LIBDIR/pkgconfig
 pkgconfig.files=$${PKGCONFIG_FILE}
 
 systemdservice.path=/usr/lib/systemd/user/
-systemdservice.files=$${PACKAGENAME}.service
+systemdservice.files=$${PACKAGENAME}.service $${PACKAGENAME}-catchup.timer
 
-INSTALLS += pkgconfig systemdservice
+dbusservice.path=/usr/share/dbus-1/services/
+dbusservice.files=com.nokia.contactsd.service org.nemomobile.DevicePresence.service
+
+INSTALLS += pkgconfig systemdservice dbusservice
 
 check.target = check
 check.CONFIG = recursive
@@ -23,8 +23,23 @@
 
 #include "base-plugin.h"
 #include "debug.h"
+#include "task-scheduler.h"
 
+#include <QContactManager>
+#include <QHash>
 #include <QStandardPaths>
+#include <QWeakPointer>
+
+QTCONTACTS_USE_NAMESPACE
+
+namespace {
+
+typedef QHash<QString, QWeakPointer<QContactManager> > ContactManagerPool;
+Q_GLOBAL_STATIC(ContactManagerPool, contactManagerPool)
+
+Q_GLOBAL_STATIC(Contactsd::BasePlugin::SyncTriggerHandler, syncTriggerHandler)
+
+}
 
 namespace Contactsd
 {
@@ -32,6 +47,7 @@ namespace Contactsd
 const QString BasePlugin::metaDataKeyVersion = QString::fromLatin1("version");
 const QString BasePlugin::metaDataKeyName    = QString::fromLatin1("name");
 const QString BasePlugin::metaDataKeyComment = QString::fromLatin1("comment");
+const QString BasePlugin::metaDataKeyDeferredInit = QString::fromLatin1("deferredInit");
 
 
 QDir BasePlugin::cacheDir()
@@ -54,4 +70,46 @@ QString BasePlugin::cacheFileName(const QString &fileName)
     return cacheDir().filePath(fileName);
 }
 
+QSharedPointer<QContactManager> BasePlugin::contactManager(const QString &requestedName,
+                                                           const QMap<QString, QString> &parameters)
+{
+    // Test suites may substitute an instrumented engine for the requested one
+    static const QString overrideName = QString::fromLocal8Bit(qgetenv("CONTACTSD_CONTACT_MANAGER"));
+    const QString &managerName = overrideName.isEmpty() ? requestedName : overrideName;
+
+    // The URI is canonical for the parameter set, whatever the order of insertion
+    const QString managerUri = QContactManager::buildUri(managerName, parameters);
+
+    QSharedPointer<QContactManager> manager = contactManagerPool()->value(managerUri).toStrongRef();
+    if (!manager) {
+        qCDebug(lcContactsd) << "Creating shared contact manager" << managerUri;
+        manager = QSharedPointer<QContactManager>(new QContactManager(managerName, parameters));
+        contactManagerPool()->insert(managerUri, manager);
+    }
+
+    return manager;
+}
+
+TaskScheduler *BasePlugin::scheduler()
+{
+    return TaskScheduler::instance();
+}
+
+bool BasePlugin::triggerSync(const QStringList &accountProviders, SyncPolicy syncPolicy,
+                             DirectionPolicy directionPolicy)
+{
+    const SyncTriggerHandler &handler = *syncTriggerHandler();
+    if (!handler) {
+        return false;
+    }
+
+    handler(accountProviders, syncPolicy, directionPolicy);
+    return true;
+}
+
+void BasePlugin::setSyncTriggerHandler(const SyncTriggerHandler &handler)
+{
+    *syncTriggerHandler() = handler;
+}
+
 } // Contactsd
@@ -29,12 +29,23 @@
 #include <QVariant>
 #include <QStringList>
 #include <QMap>
+#include <QSharedPointer>
 #include <QThreadStorage>
 #include <QDir>
 
+#include <functional>
+
+QT_BEGIN_NAMESPACE
+namespace QtContacts {
+class QContactManager;
+}
+QT_END_NAMESPACE
+
 namespace Contactsd
 {
 
+class TaskScheduler;
+
 class Q_DECL_EXPORT BasePlugin : public QObject
 {
     Q_OBJECT
@@ -43,15 +54,63 @@ public:
     static const QString metaDataKeyVersion;
     static const QString metaDataKeyName;
     static const QString metaDataKeyComment;
+    // Only read from the plugin's JSON metadata: initialise once the daemon is running
+    static const QString metaDataKeyDeferredInit;
     typedef QMap<QString, QVariant> MetaData;
 
+    // As taken by the com.nokia.contactsd triggerSync D-Bus method
+    enum SyncPolicy {
+        ForceSync = 0,      // sync regardless of the profile's always-up-to-date setting
+        UpToDateSync,       // only profiles which are always kept up to date
+        AdaptiveSync        // as UpToDateSync, coalesced with other requests
+    };
+
+    enum DirectionPolicy {
+        AnyDirection = 0,
+        UpsyncDirection     // only profiles which sync to the remote side
+    };
+
+    typedef std::function<void(const QStringList &, SyncPolicy, DirectionPolicy)> SyncTriggerHandler;
+
     virtual ~BasePlugin () {}
     virtual void init() = 0;
-    virtual MetaData metaData() = 0;
+    // Returns the name, version and comment from the plugin's JSON metadata by
+    // default; plugins built without JSON metadata have to reimplement this.
+    virtual MetaData metaData() { return mMetaData; }
+    // Called by the daemon with the plugin's JSON metadata, before init()
+    void setMetaData(const MetaData &metaData) { mMetaData = metaData; }
+
+    // Return true while the plugin has no work in progress, and would catch up with
+    // anything missed while the daemon is not running once it is restarted. The
+    // daemon exits in idle exit mode only if all of its plugins are idle; it is
+    // started again by D-Bus activation or, at the latest, by contactsd-catchup.timer.
+    virtual bool isIdle() const { return false; }
+    // Drop data which can be rebuilt on demand, e.g. lookup caches. Called when the
+    // system is short of memory; the heap is trimmed afterwards.
+    virtual void releaseCaches() {}
 
     static QDir cacheDir();
     static QString cacheFileName(const QString &fileName);
 
+    // Returns the daemon's contact manager for the given name and parameters. Plugins
+    // asking for the same parameter set share one manager, so that its database
+    // connection and change notifications are not duplicated. The manager lives as
+    // long as any plugin holds a reference, and must only be used from the main thread.
+    // CONTACTSD_CONTACT_MANAGER in the environment replaces the manager name, for tests.
+    static QSharedPointer<QtContacts::QContactManager> contactManager(const QString &managerName,
+                                                                      const QMap<QString, QString> &parameters);
+
+    // Returns the daemon's scheduler for long running work, which plugins should
+    // split into time sliced tasks rather than blocking the main loop.
+    static TaskScheduler *scheduler();
+
+    // Asks the daemon to sync the contacts sync profiles of the given account providers.
+    // Returns false if the daemon has not set a handler, e.g. when run by a test.
+    static bool triggerSync(const QStringList &accountProviders, SyncPolicy syncPolicy,
+                            DirectionPolicy directionPolicy);
+    // Set by the daemon for as long as its sync trigger exists
+    static void setSyncTriggerHandler(const SyncTriggerHandler &handler);
+
 Q_SIGNALS:
     // \param service - display name of a service (e.g. Gtalk, MSN)
     // \param account - account id or account path that can uniquely identify an account
@@ -61,6 +120,9 @@ Q_SIGNALS:
     void error(int code, const QString &message);
     // Emitted to inform that import timeout should be extended
     void importAlive();
+
+private:
+    MetaData mMetaData;
 };
 
 } // Contactsd
@@ -0,0 +1,327 @@
+/** This file is part of Contacts daemon
+ **
+ ** Copyright (c) 2026 Jolla Ltd.
+ **
+ ** GNU Lesser General Public License Usage
+ ** This file may be used under the terms of the GNU Lesser General Public License
+ ** version 2.1 as published by the Free Software Foundation and appearing in the
+ ** file LICENSE.LGPL included in the packaging of this file.  Please review the
+ ** following information to ensure the GNU Lesser General Public License version
+ ** 2.1 requirements will be met:
+ ** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+ **/
+
+#include "contact-change-dispatcher.h"
+#include "debug.h"
+
+#include <QContactIdFilter>
+#include <QContactIntersectionFilter>
+#include <QContactManagerEngine>
+#include <QContactUnionFilter>
+#include <QHash>
+#include <QPointer>
+
+QTCONTACTS_USE_NAMESPACE
+
+namespace {
+
+const int FETCH_TIMEOUT = 1000; // ms
+const int FETCH_MAXIMUM_TIMEOUT = 5000; // ms
+
+// If we request too many contact IDs, we will exceed the SQLite bound variable limit;
+// leave room for the variables bound by the rest of the query.
+const int SQLITE_MAX_VARIABLE_NUMBER = 999;
+const int FETCH_BATCH_SIZE = SQLITE_MAX_VARIABLE_NUMBER / 2;
+// Number of fetch requests kept in flight at once
+const int MAX_PARALLEL_FETCHES = 3;
+
+typedef QHash<QContactManager *, QWeakPointer<Contactsd::ContactChangeDispatcher> > DispatcherPool;
+Q_GLOBAL_STATIC(DispatcherPool, dispatcherPool)
+
+}
+
+namespace Contactsd
+{
+
+ContactChangeSubscription::ContactChangeSubscription(const QSharedPointer<ContactChangeDispatcher> &dispatcher,
+                                                     const QList<QContactDetail::DetailType> &detailTypes,
+                                                     const QContactFilter &filter, QObject *parent)
+    : QObject(parent)
+    , mDispatcher(dispatcher)
+    , mDetailTypes(detailTypes)
+    , mFilter(filter)
+{
+    mDispatcher->addSubscription(this);
+}
+
+ContactChangeSubscription::~ContactChangeSubscription()
+{
+    mDispatcher->removeSubscription(this);
+}
+
+QList<QContactDetail::DetailType> ContactChangeSubscription::detailTypes() const
+{
+    return mDetailTypes;
+}
+
+QContactFilter ContactChangeSubscription::filter() const
+{
+    return mFilter;
+}
+
+ContactChangeDispatcher::ContactChangeDispatcher(const QSharedPointer<QContactManager> &manager)
+    : mManager(manager)
+{
+    connect(mManager.data(), &QContactManager::contactsAdded,
+            this, &ContactChangeDispatcher::contactsChanged);
+    connect(mManager.data(), &QContactManager::contactsChanged,
+            this, &ContactChangeDispatcher::contactsChanged);
+    connect(mManager.data(), &QContactManager::contactsRemoved,
+            this, &ContactChangeDispatcher::contactsRemoved);
+
+    mFetchTimer.setInterval(FETCH_TIMEOUT);
+    mFetchTimer.setSingleShot(true);
+    connect(&mFetchTimer, &QTimer::timeout,
+            this, &ContactChangeDispatcher::onFetchTimeout);
+
+    mWaitTimer.invalidate();
+}
+
+ContactChangeDispatcher::~ContactChangeDispatcher()
+{
+    dispatcherPool()->remove(mManager.data());
+    qDeleteAll(mRequests);
+}
+
+ContactChangeSubscription *ContactChangeDispatcher::subscribe(const QSharedPointer<QContactManager> &manager,
+                                                              const QList<QContactDetail::DetailType> &detailTypes,
+                                                              const QContactFilter &filter, QObject *parent)
+{
+    QSharedPointer<ContactChangeDispatcher> dispatcher = dispatcherPool()->value(manager.data()).toStrongRef();
+    if (!dispatcher) {
+        dispatcher = QSharedPointer<ContactChangeDispatcher>(new ContactChangeDispatcher(manager));
+        dispatcherPool()->insert(manager.data(), dispatcher);
+    }
+
+    return new ContactChangeSubscription(dispatcher, detailTypes, filter, parent);
+}
+
+void ContactChangeDispatcher::addSubscription(ContactChangeSubscription *subscription)
+{
+    mSubscriptions.append(subscription);
+}
+
+void ContactChangeDispatcher::removeSubscription(ContactChangeSubscription *subscription)
+{
+    mSubscriptions.removeOne(subscription);
+}
+
+void ContactChangeDispatcher::contactsChanged(const QList<QContactId> &contactIds)
+{
+    if (mSubscriptions.isEmpty()) {
+        return;
+    }
+
+    foreach (const QContactId &id, contactIds) {
+        mPendingContacts.insert(id);
+    }
+
+    // Fetch after not receiving a notification for the defined period, but
+    // don't postpone the fetch indefinitely during a long series of changes
+    if (mWaitTimer.isValid()) {
+        if (mWaitTimer.elapsed() >= FETCH_MAXIMUM_TIMEOUT) {
+            return;
+        }
+    } else {
+        mWaitTimer.start();
+    }
+
+    mFetchTimer.start();
+}
+
+void ContactChangeDispatcher::contactsRemoved(const QList<QContactId> &contactIds)
+{
+    foreach (const QContactId &id, contactIds) {
+        mPendingContacts.remove(id);
+    }
+
+    // Keep ourselves alive, in case the last subscriber unsubscribes while handling the removal
+    const QSharedPointer<ContactChangeDispatcher> self = dispatcherPool()->value(mManager.data()).toStrongRef();
+
+    foreach (const QPointer<ContactChangeSubscription> &subscription, subscriptions()) {
+        if (subscription) {
+            Q_EMIT subscription->contactsRemoved(contactIds);
+        }
+    }
+}
+
+QList<QPointer<ContactChangeSubscription> > ContactChangeDispatcher::subscriptions() const
+{
+    QList<QPointer<ContactChangeSubscription> > rv;
+    foreach (ContactChangeSubscription *subscription, mSubscriptions) {
+        rv.append(subscription);
+    }
+    return rv;
+}
+
+QContactFetchHint ContactChangeDispatcher::fetchHint() const
+{
+    QSet<QContactDetail::DetailType> detailTypes;
+    bool allDetails = false;
+
+    foreach (const ContactChangeSubscription *subscription, mSubscriptions) {
+        if (subscription->detailTypes().isEmpty()) {
+            allDetails = true;
+            break;
+        }
+        foreach (QContactDetail::DetailType type, subscription->detailTypes()) {
+            detailTypes.insert(type);
+        }
+    }
+
+    QContactFetchHint fetchHint;
+    if (!allDetails) {
+        fetchHint.setDetailTypesHint(detailTypes.toList());
+    }
+    fetchHint.setOptimizationHints(QContactFetchHint::NoRelationships
+                                   | QContactFetchHint::NoActionPreferences
+                                   | QContactFetchHint::NoBinaryBlobs);
+    return fetchHint;
+}
+
+QContactFilter ContactChangeDispatcher::subscriptionsFilter() const
+{
+    QContactUnionFilter unionFilter;
+
+    foreach (const ContactChangeSubscription *subscription, mSubscriptions) {
+        const QContactFilter filter = subscription->filter();
+        if (filter.type() == QContactFilter::DefaultFilter) {
+            // Some subscriber wants every changed contact
+            return QContactFilter();
+        }
+        unionFilter.append(filter);
+    }
+
+    if (unionFilter.filters().count() == 1) {
+        return unionFilter.filters().first();
+    }
+    return unionFilter;
+}
+
+void ContactChangeDispatcher::onFetchTimeout()
+{
+    mWaitTimer.invalidate();
+
+    if (mSubscriptions.isEmpty()) {
+        mPendingContacts.clear();
+        return;
+    }
+
+    const QContactFetchHint hint = fetchHint();
+    // Let the backend skip the contacts that no subscriber is interested in
+    const QContactFilter filter = subscriptionsFilter();
+
+    // Keep several batches in flight, so that the subscribers' handling of
+    // one batch overlaps with the backend fetching the next one
+    while (!mPendingContacts.isEmpty() && mRequests.count() < MAX_PARALLEL_FETCHES) {
+        QList<QContactId> contactIds;
+        contactIds.reserve(qMin(mPendingContacts.count(), FETCH_BATCH_SIZE));
+
+        QSet<QContactId>::iterator it = mPendingContacts.begin();
+        while (it != mPendingContacts.end() && contactIds.count() < FETCH_BATCH_SIZE) {
+            contactIds.append(*it);
+            it = mPendingContacts.erase(it);
+        }
+
+        QContactIdFilter idFilter;
+        idFilter.setIds(contactIds);
+
+        QContactFetchRequest *request = new QContactFetchRequest;
+        request->setManager(mManager.data());
+        request->setFetchHint(hint);
+        if (filter.type() == QContactFilter::DefaultFilter) {
+            request->setFilter(idFilter);
+        } else {
+            request->setFilter(idFilter & filter);
+        }
+        connect(request, &QContactAbstractRequest::stateChanged,
+                this, &ContactChangeDispatcher::onRequestStateChanged);
+
+        if (!request->start()) {
+            qCWarning(lcContactsd) << Q_FUNC_INFO << "Unable to start changed contacts fetch request";
+            delete request;
+
+            // Try these contacts again later
+            foreach (const QContactId &id, contactIds) {
+                mPendingContacts.insert(id);
+            }
+            mFetchTimer.start();
+            break;
+        }
+
+        mRequests.append(request);
+        qCDebug(lcContactsd) << "Changed contacts fetch request started for" << contactIds.count()
+                             << "contacts," << mRequests.count() << "in flight";
+    }
+}
+
+void ContactChangeDispatcher::onRequestStateChanged(QContactAbstractRequest::State state)
+{
+    QContactFetchRequest *request = qobject_cast<QContactFetchRequest *>(sender());
+    if (!request || !mRequests.contains(request)) {
+        return;
+    }
+
+    // Keep ourselves alive, in case the last subscriber unsubscribes while handling the changes
+    const QSharedPointer<ContactChangeDispatcher> self = dispatcherPool()->value(mManager.data()).toStrongRef();
+
+    if (state == QContactAbstractRequest::FinishedState) {
+        if (request->error() != QContactManager::NoError) {
+            qCWarning(lcContactsd) << Q_FUNC_INFO << "Error during changed contacts fetch request, code:" << request->error();
+        } else {
+            dispatch(request->contacts());
+        }
+    } else if (state != QContactAbstractRequest::CanceledState) {
+        // Request still in progress
+        return;
+    }
+
+    // Don't delete the request directly, as we're currently handling a signal from it
+    mRequests.removeOne(request);
+    request->deleteLater();
+
+    // Refill the pipeline immediately, rather than waiting for the fetch timer
+    if (!mFetchTimer.isActive()) {
+        onFetchTimeout();
+    }
+}
+
+void ContactChangeDispatcher::dispatch(const QList<QContact> &contacts)
+{
+    // The fetch matched the union of the filters; split the contacts between the subscribers.
+    // Subscribers may unsubscribe while handling the changes
+    foreach (const QPointer<ContactChangeSubscription> &subscription, subscriptions()) {
+        if (!subscription) {
+            continue;
+        }
+
+        const QContactFilter filter = subscription->filter();
+        if (filter.type() == QContactFilter::DefaultFilter) {
+            Q_EMIT subscription->contactsChanged(contacts);
+            continue;
+        }
+
+        QList<QContact> matching;
+        foreach (const QContact &contact, contacts) {
+            if (QContactManagerEngine::testFilter(filter, contact)) {
+                matching.append(contact);
+            }
+        }
+
+        if (!matching.isEmpty()) {
+            Q_EMIT subscription->contactsChanged(matching);
+        }
+    }
+}
+
+} // Contactsd
@@ -0,0 +1,112 @@
+/** This file is part of Contacts daemon
+ **
+ ** Copyright (c) 2026 Jolla Ltd.
+ **
+ ** GNU Lesser General Public License Usage
+ ** This file may be used under the terms of the GNU Lesser General Public License
+ ** version 2.1 as published by the Free Software Foundation and appearing in the
+ ** file LICENSE.LGPL included in the packaging of this file.  Please review the
+ ** following information to ensure the GNU Lesser General Public License version
+ ** 2.1 requirements will be met:
+ ** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+ **/
+
+#ifndef CONTACTSD_CONTACT_CHANGE_DISPATCHER_H
+#define CONTACTSD_CONTACT_CHANGE_DISPATCHER_H
+
+#include <QElapsedTimer>
+#include <QList>
+#include <QObject>
+#include <QPointer>
+#include <QSet>
+#include <QSharedPointer>
+#include <QTimer>
+
+#include <QContact>
+#include <QContactAbstractRequest>
+#include <QContactDetail>
+#include <QContactFetchRequest>
+#include <QContactFilter>
+#include <QContactId>
+#include <QContactManager>
+
+namespace Contactsd
+{
+
+class ContactChangeDispatcher;
+
+// A plugin's interest in contact changes. Added and changed contacts are
+// delivered already fetched, with at least the subscribed detail types, and
+// only if they match the subscription's filter. Removals cannot be matched
+// against the filter, so every subscription is told about all of them.
+class Q_DECL_EXPORT ContactChangeSubscription : public QObject
+{
+    Q_OBJECT
+
+public:
+    ~ContactChangeSubscription();
+
+    QList<QtContacts::QContactDetail::DetailType> detailTypes() const;
+    QtContacts::QContactFilter filter() const;
+
+Q_SIGNALS:
+    void contactsChanged(const QList<QtContacts::QContact> &contacts);
+    void contactsRemoved(const QList<QtContacts::QContactId> &contactIds);
+
+private:
+    friend class ContactChangeDispatcher;
+
+    ContactChangeSubscription(const QSharedPointer<ContactChangeDispatcher> &dispatcher,
+                              const QList<QtContacts::QContactDetail::DetailType> &detailTypes,
+                              const QtContacts::QContactFilter &filter, QObject *parent);
+
+    QSharedPointer<ContactChangeDispatcher> mDispatcher;
+    QList<QtContacts::QContactDetail::DetailType> mDetailTypes;
+    QtContacts::QContactFilter mFilter;
+};
+
+// Receives the change notifications of a contact manager once for the whole
+// daemon, and fetches the added and changed contacts in batches with the
+// union of the details and filters the subscribers are interested in.
+class Q_DECL_EXPORT ContactChangeDispatcher : public QObject
+{
+    Q_OBJECT
+
+public:
+    ~ContactChangeDispatcher();
+
+    // An empty list of detail types subscribes to all details.
+    static ContactChangeSubscription *subscribe(const QSharedPointer<QtContacts::QContactManager> &manager,
+                                                const QList<QtContacts::QContactDetail::DetailType> &detailTypes,
+                                                const QtContacts::QContactFilter &filter,
+                                                QObject *parent = nullptr);
+
+private Q_SLOTS:
+    void contactsChanged(const QList<QtContacts::QContactId> &contactIds);
+    void contactsRemoved(const QList<QtContacts::QContactId> &contactIds);
+    void onFetchTimeout();
+    void onRequestStateChanged(QtContacts::QContactAbstractRequest::State state);
+
+private:
+    friend class ContactChangeSubscription;
+
+    explicit ContactChangeDispatcher(const QSharedPointer<QtContacts::QContactManager> &manager);
+
+    void addSubscription(ContactChangeSubscription *subscription);
+    void removeSubscription(ContactChangeSubscription *subscription);
+    QList<QPointer<ContactChangeSubscription> > subscriptions() const;
+    QtContacts::QContactFetchHint fetchHint() const;
+    QtContacts::QContactFilter subscriptionsFilter() const;
+    void dispatch(const QList<QtContacts::QContact> &contacts);
+
+    QSharedPointer<QtContacts::QContactManager> mManager;
+    QList<ContactChangeSubscription *> mSubscriptions;
+    QSet<QtContacts::QContactId> mPendingContacts;
+    QList<QtContacts::QContactFetchRequest *> mRequests;
+    QTimer mFetchTimer;
+    QElapsedTimer mWaitTimer;
+};
+
+} // Contactsd
+
+#endif // CONTACTSD_CONTACT_CHANGE_DISPATCHER_H
@@ -1,3 +1,94 @@
-#include <QLoggingCategory>
+#include "debug.h"
+
+#include <QDateTime>
+#include <QMutexLocker>
 
 Q_LOGGING_CATEGORY(lcContactsd, "contactsd", QtWarningMsg)
+
+namespace {
+
+// Indexed by Contactsd::LogEvent: %1 is the text, %2 and %3 the numeric arguments
+const char *const eventFormats[] = {
+    "syncAccounts: %2 accounts",
+    "syncAccount: %1",
+    "createAccount: %1",
+    "updateAccount: %1 changes 0x%2",
+    "removeAccount: %1",
+    "syncAccountContacts (roster change): %1",
+    "syncAccountContacts (roster update): %1 added %2 removed %3",
+    "createAccountContacts: %1 %2 contacts",
+    "removeAccountContacts: %1 %2 contacts",
+    "storeContacts: %1 saved %2 removed %3",
+    "exporter trigger: %1 after %2 notifications",
+};
+
+static_assert(sizeof(eventFormats) / sizeof(eventFormats[0]) == Contactsd::EventCount,
+              "Every log event needs a format");
+
+}
+
+namespace Contactsd
+{
+
+EventLog::EventLog()
+    : mRecorded(0)
+    , mStartTime(QDateTime::currentMSecsSinceEpoch())
+{
+    mClock.start();
+}
+
+EventLog *EventLog::instance()
+{
+    static EventLog log;
+    return &log;
+}
+
+void EventLog::record(LogEvent event, const QString &text, qint64 arg1, qint64 arg2)
+{
+    EventLog *self = instance();
+    QMutexLocker locker(&self->mMutex);
+
+    Entry &entry = self->mEntries[self->mRecorded % Capacity];
+    entry.timestamp = self->mClock.elapsed();
+    entry.event = event;
+    entry.arg1 = arg1;
+    entry.arg2 = arg2;
+    entry.text = text;
+    ++self->mRecorded;
+}
+
+QStringList EventLog::events() const
+{
+    QMutexLocker locker(&mMutex);
+
+    QStringList rv;
+    const quint64 first = mRecorded > Capacity ? mRecorded - Capacity : 0;
+    rv.reserve(mRecorded - first);
+
+    for (quint64 i = first; i < mRecorded; ++i) {
+        const Entry &entry = mEntries[i % Capacity];
+        // Markers are replaced literally, as not every format uses all of them
+        const int base = (entry.event == EventUpdateAccount) ? 16 : 10;
+        QString message = QString::fromLatin1(eventFormats[entry.event]);
+        message.replace(QLatin1String("%2"), QString::number(entry.arg1, base));
+        message.replace(QLatin1String("%3"), QString::number(entry.arg2));
+        message.replace(QLatin1String("%1"), entry.text);
+
+        const QDateTime time = QDateTime::fromMSecsSinceEpoch(mStartTime + entry.timestamp);
+        rv.append(time.toString(Qt::ISODateWithMs) + QLatin1Char(' ') + message);
+    }
+
+    return rv;
+}
+
+void EventLog::writeToLog() const
+{
+    const QStringList lines = events();
+
+    qWarning() << "Event log," << lines.count() << "recent events:";
+    foreach (const QString &line, lines) {
+        qWarning().noquote() << line;
+    }
+}
+
+} // Contactsd
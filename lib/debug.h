@@ -20,8 +20,77 @@
 #ifndef CONTACTSD_DEBUG_H
 #define CONTACTSD_DEBUG_H
 
+#include <QElapsedTimer>
 #include <QLoggingCategory>
+#include <QMutex>
+#include <QObject>
+#include <QString>
+#include <QStringList>
 
 Q_DECLARE_LOGGING_CATEGORY(lcContactsd)
 
+namespace Contactsd
+{
+
+// Events recorded on hot paths instead of formatted log output; the
+// arguments each event takes are described in its format in debug.cpp
+enum LogEvent {
+    EventSyncAccounts,
+    EventSyncAccount,
+    EventCreateAccount,
+    EventUpdateAccount,
+    EventRemoveAccount,
+    EventSyncAccountContacts,
+    EventSyncAccountContactsDetailed,
+    EventCreateAccountContacts,
+    EventRemoveAccountContacts,
+    EventStoreContacts,
+    EventExporterTrigger,
+    EventCount
+};
+
+// Keeps the most recent events in a fixed size ring buffer. Recording an
+// event copies its arguments only; they are formatted when the log is
+// read over D-Bus or written to the log on SIGUSR1.
+class Q_DECL_EXPORT EventLog : public QObject
+{
+    Q_OBJECT
+    Q_CLASSINFO("D-Bus Interface", "com.nokia.contactsd")
+
+public:
+    static EventLog *instance();
+
+    static void record(LogEvent event, const QString &text = QString(), qint64 arg1 = 0, qint64 arg2 = 0);
+
+public Q_SLOTS:
+    QStringList events() const;
+    void writeToLog() const;
+
+private:
+    enum { Capacity = 512 };
+
+    struct Entry {
+        qint64 timestamp;
+        LogEvent event;
+        qint64 arg1;
+        qint64 arg2;
+        QString text;
+    };
+
+    EventLog();
+
+    mutable QMutex mMutex;
+    Entry mEntries[Capacity];
+    quint64 mRecorded;
+    qint64 mStartTime;
+    QElapsedTimer mClock;
+};
+
+inline void logEvent(LogEvent event, const QString &text = QString(), qint64 arg1 = 0, qint64 arg2 = 0)
+{
+    EventLog::record(event, text, arg1, arg2);
+}
+
+} // Contactsd
+
 #endif
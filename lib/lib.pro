@@ -1,7 +1,7 @@
 TEMPLATE = lib
 
 QT -= gui
-QT += dbus
+QT += dbus contacts
 TARGET = contactsd
 TARGET = $$qtLibraryTarget($$TARGET)
 TARGETPATH = $$[QT_INSTALL_LIBS]
@@ -11,16 +11,34 @@ INSTALLS += target
 
 VERSIONED_TARGET = $$TARGET-1.0
 
+# The library is versioned apart from the package, as plugins built out of tree
+# link against it. Bump the major version whenever an installed class changes
+# its layout or virtual functions. 2.0: BasePlugin gained isIdle(),
+# releaseCaches() and the metaData() read from the plugin's JSON metadata.
+VERSION = 2.0.0
+
 HEADERS += \
     debug.h \
-    base-plugin.h
+    base-plugin.h \
+    contact-change-dispatcher.h \
+    startup-timeline.h \
+    statistics.h \
+    task-scheduler.h
 
 SOURCES += \
     debug.cpp \
-    base-plugin.cpp
+    base-plugin.cpp \
+    contact-change-dispatcher.cpp \
+    startup-timeline.cpp \
+    statistics.cpp \
+    task-scheduler.cpp
 
 headers.files = \
     BasePlugin base-plugin.h \
-    Debug debug.h
+    ContactChangeDispatcher contact-change-dispatcher.h \
+    Debug debug.h \
+    StartupTimeline startup-timeline.h \
+    Statistics statistics.h \
+    TaskScheduler task-scheduler.h
 
 headers.path = $$INCLUDEDIR/$${VERSIONED_TARGET}/Contactsd
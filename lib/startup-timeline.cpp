@@ -0,0 +1,193 @@
+/** This file is part of Contacts daemon
+ **
+ ** Copyright (c) 2026 Jolla Ltd.
+ **
+ ** GNU Lesser General Public License Usage
+ ** This file may be used under the terms of the GNU Lesser General Public License
+ ** version 2.1 as published by the Free Software Foundation and appearing in the
+ ** file LICENSE.LGPL included in the packaging of this file.  Please review the
+ ** following information to ensure the GNU Lesser General Public License version
+ ** 2.1 requirements will be met:
+ ** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+ **/
+
+#include "startup-timeline.h"
+#include "debug.h"
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutexLocker>
+#include <QThread>
+
+namespace {
+
+const qint64 RECORDING_WINDOW = 5 * 60 * 1000; // ms
+const int MAX_EVENTS = 4096;
+
+// Started when libcontactsd is loaded, which is as close to process start as we get
+struct StartupClock
+{
+    StartupClock() { timer.start(); }
+    QElapsedTimer timer;
+};
+
+StartupClock startupClock;
+
+qint64 timestamp()
+{
+    return startupClock.timer.nsecsElapsed() / 1000;
+}
+
+QString eventKey(const QString &category, const QString &name)
+{
+    return category + QLatin1Char('/') + name;
+}
+
+}
+
+namespace Contactsd
+{
+
+StartupTimeline::StartupTimeline()
+{
+}
+
+StartupTimeline *StartupTimeline::instance()
+{
+    static StartupTimeline timeline;
+    return &timeline;
+}
+
+void StartupTimeline::begin(const QString &category, const QString &name)
+{
+    if (isWithinWindow()) {
+        instance()->record(category, name, false);
+    }
+}
+
+void StartupTimeline::end(const QString &category, const QString &name)
+{
+    if (isWithinWindow()) {
+        instance()->finish(category, name);
+    }
+}
+
+void StartupTimeline::mark(const QString &category, const QString &name)
+{
+    if (isWithinWindow()) {
+        instance()->record(category, name, true);
+    }
+}
+
+bool StartupTimeline::isWithinWindow()
+{
+    return startupClock.timer.elapsed() < RECORDING_WINDOW;
+}
+
+bool StartupTimeline::isRecording() const
+{
+    return isWithinWindow() && mEvents.count() < MAX_EVENTS;
+}
+
+void StartupTimeline::record(const QString &category, const QString &name, bool instant)
+{
+    QMutexLocker locker(&mMutex);
+
+    if (!isRecording()) {
+        return;
+    }
+
+    Event event;
+    event.category = category;
+    event.name = name;
+    event.start = timestamp();
+    event.duration = instant ? 0 : -1;
+    event.thread = reinterpret_cast<quintptr>(QThread::currentThreadId());
+    event.instant = instant;
+
+    if (!instant) {
+        // A phase which is begun again before it ended is recorded from the latest begin
+        mOpenEvents.insert(eventKey(category, name), mEvents.count());
+    }
+    mEvents.append(event);
+}
+
+void StartupTimeline::finish(const QString &category, const QString &name)
+{
+    QMutexLocker locker(&mMutex);
+
+    QHash<QString, int>::iterator it = mOpenEvents.find(eventKey(category, name));
+    if (it == mOpenEvents.end()) {
+        return;
+    }
+
+    Event &event = mEvents[*it];
+    event.duration = timestamp() - event.start;
+    mOpenEvents.erase(it);
+}
+
+QString StartupTimeline::traceEvents() const
+{
+    QMutexLocker locker(&mMutex);
+
+    const qint64 pid = QCoreApplication::applicationPid();
+    QJsonArray events;
+
+    foreach (const Event &event, mEvents) {
+        QJsonObject object;
+        object.insert(QStringLiteral("name"), event.name);
+        object.insert(QStringLiteral("cat"), event.category);
+        object.insert(QStringLiteral("ts"), event.start);
+        object.insert(QStringLiteral("pid"), pid);
+        object.insert(QStringLiteral("tid"), static_cast<qint64>(event.thread));
+
+        if (event.instant) {
+            object.insert(QStringLiteral("ph"), QStringLiteral("i"));
+            object.insert(QStringLiteral("s"), QStringLiteral("p"));
+        } else if (event.duration >= 0) {
+            object.insert(QStringLiteral("ph"), QStringLiteral("X"));
+            object.insert(QStringLiteral("dur"), event.duration);
+        } else {
+            // Still in progress
+            object.insert(QStringLiteral("ph"), QStringLiteral("B"));
+        }
+
+        events.append(object);
+    }
+
+    QJsonObject trace;
+    trace.insert(QStringLiteral("traceEvents"), events);
+    trace.insert(QStringLiteral("displayTimeUnit"), QStringLiteral("ms"));
+
+    return QString::fromUtf8(QJsonDocument(trace).toJson(QJsonDocument::Compact));
+}
+
+bool StartupTimeline::dumpTrace(const QString &fileName) const
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qCWarning(lcContactsd) << "Unable to write startup trace to" << fileName << ":" << file.errorString();
+        return false;
+    }
+
+    file.write(traceEvents().toUtf8());
+    qCDebug(lcContactsd) << "Wrote startup trace to" << fileName;
+    return true;
+}
+
+StartupTimeline::Scope::Scope(const QString &category, const QString &name)
+    : mCategory(category)
+    , mName(name)
+{
+    StartupTimeline::begin(mCategory, mName);
+}
+
+StartupTimeline::Scope::~Scope()
+{
+    StartupTimeline::end(mCategory, mName);
+}
+
+} // Contactsd
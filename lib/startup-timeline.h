@@ -0,0 +1,90 @@
+/** This file is part of Contacts daemon
+ **
+ ** Copyright (c) 2026 Jolla Ltd.
+ **
+ ** GNU Lesser General Public License Usage
+ ** This file may be used under the terms of the GNU Lesser General Public License
+ ** version 2.1 as published by the Free Software Foundation and appearing in the
+ ** file LICENSE.LGPL included in the packaging of this file.  Please review the
+ ** following information to ensure the GNU Lesser General Public License version
+ ** 2.1 requirements will be met:
+ ** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+ **/
+
+#ifndef CONTACTSD_STARTUP_TIMELINE_H
+#define CONTACTSD_STARTUP_TIMELINE_H
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QObject>
+#include <QString>
+
+namespace Contactsd
+{
+
+// Records the phases of daemon and plugin startup, e.g.
+//
+//     StartupTimeline::begin(QStringLiteral("telepathy"), QStringLiteral("account manager"));
+//     ...
+//     StartupTimeline::end(QStringLiteral("telepathy"), QStringLiteral("account manager"));
+//
+// Phases are recorded only for the first minutes after the daemon started.
+// Later calls return after a clock read, so they are cheap on paths which also
+// run later on; a phase still open by then is left in progress.
+// The timeline can be fetched over D-Bus in the Chrome trace event format.
+class Q_DECL_EXPORT StartupTimeline : public QObject
+{
+    Q_OBJECT
+    Q_CLASSINFO("D-Bus Interface", "com.nokia.contactsd")
+
+public:
+    static StartupTimeline *instance();
+
+    static void begin(const QString &category, const QString &name);
+    static void end(const QString &category, const QString &name);
+    static void mark(const QString &category, const QString &name);
+
+    class Scope
+    {
+    public:
+        Scope(const QString &category, const QString &name);
+        ~Scope();
+
+    private:
+        QString mCategory;
+        QString mName;
+    };
+
+    // Not a slot: the daemon writes only to the path it was configured with
+    bool dumpTrace(const QString &fileName) const;
+
+public Q_SLOTS:
+    QString traceEvents() const;
+
+private:
+    struct Event {
+        QString category;
+        QString name;
+        qint64 start;
+        qint64 duration;
+        quint64 thread;
+        bool instant;
+    };
+
+    StartupTimeline();
+
+    static bool isWithinWindow();
+    bool isRecording() const;
+    void record(const QString &category, const QString &name, bool instant);
+    void finish(const QString &category, const QString &name);
+
+    mutable QMutex mMutex;
+    QList<Event> mEvents;
+    QHash<QString, int> mOpenEvents;
+};
+
+} // Contactsd
+
+#endif // CONTACTSD_STARTUP_TIMELINE_H
@@ -0,0 +1,164 @@
+/** This file is part of Contacts daemon
+ **
+ ** Copyright (c) 2026 Jolla Ltd.
+ **
+ ** GNU Lesser General Public License Usage
+ ** This file may be used under the terms of the GNU Lesser General Public License
+ ** version 2.1 as published by the Free Software Foundation and appearing in the
+ ** file LICENSE.LGPL included in the packaging of this file.  Please review the
+ ** following information to ensure the GNU Lesser General Public License version
+ ** 2.1 requirements will be met:
+ ** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+ **/
+
+#include "statistics.h"
+#include "debug.h"
+
+#include <QMutexLocker>
+#include <QVariantList>
+
+namespace {
+
+// Bucket n holds samples up to 2^n; the last bucket holds everything larger
+const int BUCKET_COUNT = 21;
+
+int bucketIndex(qint64 value)
+{
+    int index = 0;
+    while (index < BUCKET_COUNT - 1 && value > (Q_INT64_C(1) << index)) {
+        ++index;
+    }
+    return index;
+}
+
+}
+
+namespace Contactsd
+{
+
+Statistics::Statistics()
+{
+    mSinceReset.start();
+}
+
+Statistics *Statistics::instance()
+{
+    static Statistics statistics;
+    return &statistics;
+}
+
+void Statistics::increment(const QString &name, qint64 amount)
+{
+    Statistics *self = instance();
+    QMutexLocker locker(&self->mMutex);
+
+    self->mCounters[name] += amount;
+}
+
+void Statistics::setGauge(const QString &name, qint64 value)
+{
+    Statistics *self = instance();
+    QMutexLocker locker(&self->mMutex);
+
+    QHash<QString, Gauge>::iterator it = self->mGauges.find(name);
+    if (it == self->mGauges.end()) {
+        Gauge gauge = { value, value };
+        self->mGauges.insert(name, gauge);
+    } else {
+        it->value = value;
+        it->peak = qMax(it->peak, value);
+    }
+}
+
+void Statistics::record(const QString &name, qint64 value)
+{
+    Statistics *self = instance();
+    QMutexLocker locker(&self->mMutex);
+
+    QHash<QString, Histogram>::iterator it = self->mHistograms.find(name);
+    if (it == self->mHistograms.end()) {
+        Histogram histogram = { 0, 0, value, value, QVector<qint64>(BUCKET_COUNT, 0) };
+        it = self->mHistograms.insert(name, histogram);
+    }
+
+    ++it->count;
+    it->sum += value;
+    it->min = qMin(it->min, value);
+    it->max = qMax(it->max, value);
+    ++it->buckets[bucketIndex(value)];
+}
+
+QVariantMap Statistics::snapshot() const
+{
+    QMutexLocker locker(&mMutex);
+
+    QVariantMap counters;
+    for (QHash<QString, qint64>::const_iterator it = mCounters.constBegin(); it != mCounters.constEnd(); ++it) {
+        counters.insert(it.key(), static_cast<qlonglong>(it.value()));
+    }
+
+    QVariantMap gauges;
+    for (QHash<QString, Gauge>::const_iterator it = mGauges.constBegin(); it != mGauges.constEnd(); ++it) {
+        QVariantMap gauge;
+        gauge.insert(QStringLiteral("value"), static_cast<qlonglong>(it->value));
+        gauge.insert(QStringLiteral("peak"), static_cast<qlonglong>(it->peak));
+        gauges.insert(it.key(), gauge);
+    }
+
+    QVariantMap histograms;
+    for (QHash<QString, Histogram>::const_iterator it = mHistograms.constBegin(); it != mHistograms.constEnd(); ++it) {
+        // Trailing empty buckets are left out; bucket n holds samples up to 2^n
+        int used = BUCKET_COUNT;
+        while (used > 0 && it->buckets.at(used - 1) == 0) {
+            --used;
+        }
+
+        QVariantList buckets;
+        for (int i = 0; i < used; ++i) {
+            buckets.append(static_cast<qlonglong>(it->buckets.at(i)));
+        }
+
+        QVariantMap histogram;
+        histogram.insert(QStringLiteral("count"), static_cast<qlonglong>(it->count));
+        histogram.insert(QStringLiteral("sum"), static_cast<qlonglong>(it->sum));
+        histogram.insert(QStringLiteral("min"), static_cast<qlonglong>(it->min));
+        histogram.insert(QStringLiteral("max"), static_cast<qlonglong>(it->max));
+        histogram.insert(QStringLiteral("buckets"), buckets);
+        histograms.insert(it.key(), histogram);
+    }
+
+    QVariantMap rv;
+    rv.insert(QStringLiteral("intervalMs"), static_cast<qlonglong>(mSinceReset.elapsed()));
+    rv.insert(QStringLiteral("counters"), counters);
+    rv.insert(QStringLiteral("gauges"), gauges);
+    rv.insert(QStringLiteral("histograms"), histograms);
+    return rv;
+}
+
+void Statistics::reset()
+{
+    QMutexLocker locker(&mMutex);
+
+    // Gauges describe current state, so only their peaks start over
+    mCounters.clear();
+    mHistograms.clear();
+    for (QHash<QString, Gauge>::iterator it = mGauges.begin(); it != mGauges.end(); ++it) {
+        it->peak = it->value;
+    }
+    mSinceReset.restart();
+
+    qCDebug(lcContactsd) << "Statistics reset";
+}
+
+Statistics::Timer::Timer(const QString &name)
+    : mName(name)
+{
+    mTimer.start();
+}
+
+Statistics::Timer::~Timer()
+{
+    Statistics::record(mName, mTimer.elapsed());
+}
+
+} // Contactsd
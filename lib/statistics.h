@@ -0,0 +1,92 @@
+/** This file is part of Contacts daemon
+ **
+ ** Copyright (c) 2026 Jolla Ltd.
+ **
+ ** GNU Lesser General Public License Usage
+ ** This file may be used under the terms of the GNU Lesser General Public License
+ ** version 2.1 as published by the Free Software Foundation and appearing in the
+ ** file LICENSE.LGPL included in the packaging of this file.  Please review the
+ ** following information to ensure the GNU Lesser General Public License version
+ ** 2.1 requirements will be met:
+ ** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+ **/
+
+#ifndef CONTACTSD_STATISTICS_H
+#define CONTACTSD_STATISTICS_H
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QMutex>
+#include <QObject>
+#include <QString>
+#include <QVariantMap>
+#include <QVector>
+
+namespace Contactsd
+{
+
+// Runtime statistics of the daemon and its plugins, e.g.
+//
+//     Statistics::increment(QStringLiteral("exporter.contactsExported"), count);
+//     Statistics::setGauge(QStringLiteral("telepathy.updateQueueDepth"), queue.count());
+//     Statistics::record(QStringLiteral("sim.importDuration"), timer.elapsed());
+//
+// Counters accumulate, gauges hold the latest value and the highest value
+// seen, and histograms keep the distribution of recorded samples in
+// power-of-two buckets. Names are created on first use, conventionally
+// prefixed with the plugin name. The statistics can be fetched and reset
+// over D-Bus.
+class Q_DECL_EXPORT Statistics : public QObject
+{
+    Q_OBJECT
+    Q_CLASSINFO("D-Bus Interface", "com.nokia.contactsd")
+
+public:
+    static Statistics *instance();
+
+    static void increment(const QString &name, qint64 amount = 1);
+    static void setGauge(const QString &name, qint64 value);
+    static void record(const QString &name, qint64 value);
+
+    // Records the lifetime of the scope into a histogram, in milliseconds
+    class Timer
+    {
+    public:
+        explicit Timer(const QString &name);
+        ~Timer();
+
+    private:
+        QString mName;
+        QElapsedTimer mTimer;
+    };
+
+public Q_SLOTS:
+    QVariantMap snapshot() const;
+    void reset();
+
+private:
+    struct Gauge {
+        qint64 value;
+        qint64 peak;
+    };
+
+    struct Histogram {
+        qint64 count;
+        qint64 sum;
+        qint64 min;
+        qint64 max;
+        QVector<qint64> buckets;
+    };
+
+    Statistics();
+
+    mutable QMutex mMutex;
+    QHash<QString, qint64> mCounters;
+    QHash<QString, Gauge> mGauges;
+    QHash<QString, Histogram> mHistograms;
+    QElapsedTimer mSinceReset;
+};
+
+} // Contactsd
+
+#endif // CONTACTSD_STATISTICS_H
@@ -0,0 +1,202 @@
+/** This file is part of Contacts daemon
+ **
+ ** Copyright (c) 2026 Jolla Ltd.
+ **
+ ** GNU Lesser General Public License Usage
+ ** This file may be used under the terms of the GNU Lesser General Public License
+ ** version 2.1 as published by the Free Software Foundation and appearing in the
+ ** file LICENSE.LGPL included in the packaging of this file.  Please review the
+ ** following information to ensure the GNU Lesser General Public License version
+ ** 2.1 requirements will be met:
+ ** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+ **/
+
+#include "task-scheduler.h"
+#include "debug.h"
+#include "statistics.h"
+
+namespace {
+
+// A task not run for this many slices is run ahead of higher priority tasks
+const quint64 STARVATION_LIMIT = 8;
+
+}
+
+namespace Contactsd
+{
+
+const int TaskScheduler::DefaultTimeSlice;
+
+TaskScheduler::TaskScheduler()
+    : mSliceCount(0)
+    , mNextTaskId(1)
+{
+    mSliceTimer.setInterval(0);
+    mSliceTimer.setSingleShot(true);
+    connect(&mSliceTimer, &QTimer::timeout,
+            this, &TaskScheduler::runSlice);
+}
+
+TaskScheduler::~TaskScheduler()
+{
+    for (int priority = HighPriority; priority <= LowPriority; ++priority) {
+        qDeleteAll(mQueues[priority]);
+    }
+}
+
+TaskScheduler *TaskScheduler::instance()
+{
+    static TaskScheduler scheduler;
+    return &scheduler;
+}
+
+int TaskScheduler::schedule(QObject *context, const QString &name, const Step &step,
+                            Priority priority, int timeSlice)
+{
+    Task *task = new Task;
+    task->id = mNextTaskId++;
+    task->name = name;
+    task->context = context;
+    task->step = step;
+    task->priority = priority;
+    task->timeSlice = qMax(1, timeSlice);
+    task->lastSlice = mSliceCount;
+    task->scheduled.start();
+    task->firstSliceLatency = -1;
+    task->runTime = 0;
+    task->longestSlice = 0;
+    task->slices = 0;
+
+    mQueues[priority].append(task);
+
+    if (!mSliceTimer.isActive()) {
+        mSliceTimer.start();
+    }
+
+    qCDebug(lcContactsd) << "Scheduled task" << task->id << name << "with priority" << priority;
+    return task->id;
+}
+
+void TaskScheduler::cancel(int taskId)
+{
+    for (int priority = HighPriority; priority <= LowPriority; ++priority) {
+        QList<Task *> &queue(mQueues[priority]);
+        for (int i = 0; i < queue.count(); ++i) {
+            if (queue.at(i)->id == taskId) {
+                Task *task = queue.takeAt(i);
+                qCDebug(lcContactsd) << "Canceled task" << task->id << task->name << "after" << task->slices << "slices";
+                delete task;
+                return;
+            }
+        }
+    }
+}
+
+bool TaskScheduler::isScheduled(int taskId) const
+{
+    for (int priority = HighPriority; priority <= LowPriority; ++priority) {
+        foreach (const Task *task, mQueues[priority]) {
+            if (task->id == taskId) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+TaskScheduler::Task *TaskScheduler::nextTask() const
+{
+    // Run a starved task first, lowest priority first, as it has waited longest
+    for (int priority = LowPriority; priority > HighPriority; --priority) {
+        if (!mQueues[priority].isEmpty()) {
+            Task *task = mQueues[priority].first();
+            if (mSliceCount - task->lastSlice > STARVATION_LIMIT) {
+                return task;
+            }
+        }
+    }
+
+    for (int priority = HighPriority; priority <= LowPriority; ++priority) {
+        if (!mQueues[priority].isEmpty()) {
+            return mQueues[priority].first();
+        }
+    }
+
+    return 0;
+}
+
+void TaskScheduler::runSlice()
+{
+    Task *task = nextTask();
+    if (!task) {
+        return;
+    }
+
+    ++mSliceCount;
+
+    // Take the task off its queue while it runs, as its step may schedule or cancel tasks
+    mQueues[task->priority].removeOne(task);
+
+    bool finished = true;
+    if (task->context) {
+        if (task->firstSliceLatency < 0) {
+            task->firstSliceLatency = task->scheduled.elapsed();
+        }
+
+        QElapsedTimer slice;
+        slice.start();
+
+        do {
+            finished = task->step();
+        } while (!finished && task->context && slice.elapsed() < task->timeSlice);
+
+        const qint64 elapsed = slice.elapsed();
+        Statistics::record(QStringLiteral("scheduler.sliceDuration"), elapsed);
+        task->runTime += elapsed;
+        task->longestSlice = qMax(task->longestSlice, elapsed);
+        task->lastSlice = mSliceCount;
+        ++task->slices;
+
+        if (elapsed > 2 * task->timeSlice) {
+            qCDebug(lcContactsd) << "Task" << task->id << task->name << "overran its time slice:"
+                                 << elapsed << "ms of" << task->timeSlice << "ms";
+        }
+    }
+
+    if (finished || !task->context) {
+        finishTask(task);
+    } else {
+        // Round-robin between the tasks of the same priority
+        mQueues[task->priority].append(task);
+    }
+
+    for (int priority = HighPriority; priority <= LowPriority; ++priority) {
+        if (!mQueues[priority].isEmpty()) {
+            mSliceTimer.start();
+            break;
+        }
+    }
+}
+
+void TaskScheduler::finishTask(Task *task)
+{
+    if (task->context) {
+        qCDebug(lcContactsd) << "Task" << task->id << task->name << "finished:"
+                             << task->slices << "slices,"
+                             << "first slice after" << task->firstSliceLatency << "ms,"
+                             << "run" << task->runTime << "ms,"
+                             << "longest slice" << task->longestSlice << "ms,"
+                             << "total" << task->scheduled.elapsed() << "ms";
+        Statistics::record(QStringLiteral("scheduler.firstSliceLatency"), task->firstSliceLatency);
+        Statistics::increment(QStringLiteral("scheduler.tasksFinished"));
+    } else {
+        qCDebug(lcContactsd) << "Dropped task" << task->id << task->name << "as its context was destroyed";
+    }
+
+    const int taskId = task->id;
+    delete task;
+
+    Q_EMIT taskFinished(taskId);
+}
+
+} // Contactsd
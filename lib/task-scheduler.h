@@ -0,0 +1,98 @@
+/** This file is part of Contacts daemon
+ **
+ ** Copyright (c) 2026 Jolla Ltd.
+ **
+ ** GNU Lesser General Public License Usage
+ ** This file may be used under the terms of the GNU Lesser General Public License
+ ** version 2.1 as published by the Free Software Foundation and appearing in the
+ ** file LICENSE.LGPL included in the packaging of this file.  Please review the
+ ** following information to ensure the GNU Lesser General Public License version
+ ** 2.1 requirements will be met:
+ ** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+ **/
+
+#ifndef CONTACTSD_TASK_SCHEDULER_H
+#define CONTACTSD_TASK_SCHEDULER_H
+
+#include <QElapsedTimer>
+#include <QList>
+#include <QObject>
+#include <QPointer>
+#include <QString>
+#include <QTimer>
+
+#include <functional>
+
+namespace Contactsd
+{
+
+// Runs long operations of the plugins in the main thread, a time slice at a
+// time, so that D-Bus requests and notifications are handled in between.
+//
+// A task is a step function doing a bounded amount of work per call, and
+// returning true once the task is complete. The step is called repeatedly
+// until the task's time slice is used up; then the scheduler returns to the
+// main loop and continues with the next task. Higher priority tasks run first,
+// but a task which has waited for too many slices is run regardless.
+class Q_DECL_EXPORT TaskScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Priority {
+        HighPriority = 0,
+        NormalPriority,
+        LowPriority
+    };
+
+    typedef std::function<bool()> Step;
+
+    static const int DefaultTimeSlice = 20; // ms
+
+    static TaskScheduler *instance();
+
+    // The task is dropped if the context object is destroyed before it completes.
+    int schedule(QObject *context, const QString &name, const Step &step,
+                 Priority priority = NormalPriority, int timeSlice = DefaultTimeSlice);
+    void cancel(int taskId);
+    bool isScheduled(int taskId) const;
+
+Q_SIGNALS:
+    void taskFinished(int taskId);
+
+private Q_SLOTS:
+    void runSlice();
+
+private:
+    struct Task {
+        int id;
+        QString name;
+        QPointer<QObject> context;
+        Step step;
+        Priority priority;
+        int timeSlice;
+        quint64 lastSlice;
+
+        // Latency metrics
+        QElapsedTimer scheduled;
+        qint64 firstSliceLatency;
+        qint64 runTime;
+        qint64 longestSlice;
+        int slices;
+    };
+
+    TaskScheduler();
+    ~TaskScheduler();
+
+    Task *nextTask() const;
+    void finishTask(Task *task);
+
+    QList<Task *> mQueues[LowPriority + 1];
+    QTimer mSliceTimer;
+    quint64 mSliceCount;
+    int mNextTaskId;
+};
+
+} // Contactsd
+
+#endif // CONTACTSD_TASK_SCHEDULER_H
@@ -46,6 +46,8 @@ SOURCES  = cdbirthdaycalendar.cpp \
     cdbirthdaycontroller.cpp \
     cdbirthdayplugin.cpp
 
+OTHER_FILES += birthday.json
+
 TARGET = birthdayplugin
 target.path = $$LIBDIR/contactsd-1.0/plugins
 
@@ -39,6 +39,7 @@
 
 #include "cdbirthdaycalendar.h"
 #include "debug.h"
+#include "startup-timeline.h"
 
 using namespace ML10N;
 
@@ -47,12 +48,23 @@ static const QLatin1String calNotebookId("b1376da7-5555-1111-2222-227549c4e570")
 static const QLatin1String calNotebookColor("#e00080"); // Pink
 static const QString calIdExtension = QLatin1String("com.nokia.birthday/");
 
+static const int SAVE_TIMEOUT = 1000; // ms
+static const int SAVE_MAXIMUM_TIMEOUT = 5000; // ms
+
 
 CDBirthdayCalendar::CDBirthdayCalendar(SyncMode syncMode, QObject *parent)
     : QObject(parent)
     , mCalendar(nullptr)
     , mStorage(nullptr)
+    , mEventIndexLoaded(false)
+    , mDirty(false)
 {
+    mSaveTimer.setInterval(SAVE_TIMEOUT);
+    mSaveTimer.setSingleShot(true);
+    connect(&mSaveTimer, &QTimer::timeout,
+            this, &CDBirthdayCalendar::onSaveTimeout);
+    mSaveWaitTimer.invalidate();
+
     mCalendar = mKCal::ExtendedCalendar::Ptr(new mKCal::ExtendedCalendar(QTimeZone::systemTimeZone()));
     mStorage = mKCal::ExtendedCalendar::defaultStorage(mCalendar);
 
@@ -68,6 +80,7 @@ CDBirthdayCalendar::CDBirthdayCalendar(SyncMode syncMode, QObject *parent)
 
     MLocale::setDefault(*locale);
 
+    Contactsd::StartupTimeline::Scope scope(QStringLiteral("birthday"), QStringLiteral("open calendar"));
     mStorage->open();
 
     mKCal::Notebook::Ptr notebook = mStorage->notebook(calNotebookId);
@@ -90,11 +103,15 @@ CDBirthdayCalendar::CDBirthdayCalendar(SyncMode syncMode, QObject *parent)
             break;
         }
     }
+
+    loadEventIndex();
 }
 
 CDBirthdayCalendar::~CDBirthdayCalendar()
 {
     if (mStorage) {
+        // Flush any changes still waiting for the save timer
+        save();
         mStorage->close();
     }
 
@@ -118,26 +135,49 @@ mKCal::Notebook::Ptr CDBirthdayCalendar::createNotebook()
                                                     0));
 }
 
-QHash<QContactId, CalendarBirthday> CDBirthdayCalendar::birthdays()
+void CDBirthdayCalendar::loadEventIndex()
 {
+    mEvents.clear();
+
+    // Load the whole notebook once, so that later lookups don't need a storage query per event
     if (!mStorage->loadNotebookIncidences(calNotebookId)) {
         qCWarning(lcContactsd) << Q_FUNC_INFO << "Failed to load all incidences";
-        return QHash<QContactId, CalendarBirthday>();
+        mEventIndexLoaded = false;
+        return;
     }
 
-    QHash<QContactId, CalendarBirthday> result;
-
     foreach (const KCalendarCore::Event::Ptr event, mCalendar->events()) {
         const QString eventUid = event->uid();
         const QContactId contactId = localContactId(eventUid);
 
         if (!contactId.isNull()) {
-            result.insert(contactId, CalendarBirthday(event->dtStart().date(), event->summary()));
+            mEvents.insert(contactId, event);
         } else {
             qCWarning(lcContactsd) << Q_FUNC_INFO << "Birthday event with a bad uid: " << eventUid;
         }
     }
 
+    mEventIndexLoaded = true;
+    qCDebug(lcContactsd) << "Loaded" << mEvents.count() << "birthday events";
+}
+
+QHash<QContactId, CalendarBirthday> CDBirthdayCalendar::birthdays()
+{
+    if (!mEventIndexLoaded) {
+        loadEventIndex();
+        if (!mEventIndexLoaded) {
+            return QHash<QContactId, CalendarBirthday>();
+        }
+    }
+
+    QHash<QContactId, CalendarBirthday> result;
+    result.reserve(mEvents.count());
+
+    QHash<QContactId, KCalendarCore::Event::Ptr>::const_iterator it = mEvents.constBegin();
+    for ( ; it != mEvents.constEnd(); ++it) {
+        result.insert(it.key(), CalendarBirthday((*it)->dtStart().date(), (*it)->summary()));
+    }
+
     return result;
 }
 
@@ -200,6 +240,8 @@ void CDBirthdayCalendar::updateBirthday(const QContact &contact)
             qCWarning(lcContactsd) << Q_FUNC_INFO << "Failed to add event to calendar";
             return;
         }
+
+        mEvents.insert(contact.id(), event);
     } else {
         // Update the existing event.
         event->setReadOnly(false);
@@ -273,6 +315,7 @@ void CDBirthdayCalendar::updateBirthday(const QContact &contact)
 
     event->setReadOnly(true);
     event->endUpdates();
+    mDirty = true;
     qCDebug(lcContactsd) << "Updated birthday event in calendar, local ID: " << contact.id();
 }
 
@@ -286,15 +329,52 @@ void CDBirthdayCalendar::deleteBirthday(const QContactId &contactId)
     }
 
     mCalendar->deleteEvent(event);
+    mEvents.remove(contactId);
+    mDirty = true;
 
     qCDebug(lcContactsd) << "Deleted birthday event in calendar, local ID: " << event->uid();
 }
 
 void CDBirthdayCalendar::save()
 {
+    mSaveTimer.stop();
+    mSaveWaitTimer.invalidate();
+
+    if (!mDirty) {
+        return;
+    }
+
     if (!mStorage->save()) {
         qCWarning(lcContactsd) << Q_FUNC_INFO << "Failed to update birthdays in calendar";
     }
+
+    // A failed save is not retried; the next full sync will reconcile the calendar
+    mDirty = false;
+}
+
+void CDBirthdayCalendar::scheduleSave()
+{
+    if (!mDirty) {
+        return;
+    }
+
+    // Only save after not receiving further changes for the defined period,
+    // but use an upper limit so that the changes are not delayed indefinitely.
+    if (mSaveWaitTimer.isValid()) {
+        if (mSaveWaitTimer.elapsed() >= SAVE_MAXIMUM_TIMEOUT) {
+            // Don't prolong the wait any further
+            return;
+        }
+    } else {
+        mSaveWaitTimer.start();
+    }
+
+    mSaveTimer.start();
+}
+
+void CDBirthdayCalendar::onSaveTimeout()
+{
+    save();
 }
 
 CalendarBirthday CDBirthdayCalendar::birthday(const QContactId &contactId)
@@ -330,6 +410,11 @@ QString CDBirthdayCalendar::calendarEventId(const QContactId &contactId)
 
 KCalendarCore::Event::Ptr CDBirthdayCalendar::calendarEvent(const QContactId &contactId)
 {
+    if (mEventIndexLoaded) {
+        // The index holds every event in the notebook, so a miss means there is no event
+        return mEvents.value(contactId);
+    }
+
     const QString eventId = calendarEventId(contactId);
 
     if (eventId.isEmpty()) {
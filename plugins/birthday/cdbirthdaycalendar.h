@@ -27,6 +27,8 @@
 #include <QObject>
 #include <QContact>
 #include <QDate>
+#include <QElapsedTimer>
+#include <QTimer>
 
 #include <extendedstorage.h>
 #include <extendedcalendar.h>
@@ -73,14 +75,18 @@ public:
     //! Deletes \a contact birthday from calendar.
     void deleteBirthday(const QContactId &contactId);
 
-    //! Actually save the events in the calendar database
+    //! Actually save the events in the calendar database, if there are unsaved changes
     void save();
 
+    //! Save the events after a short delay, coalescing changes made in the meantime
+    void scheduleSave();
+
     CalendarBirthday birthday(const QContactId &contactId);
     QHash<QContactId, CalendarBirthday> birthdays();
 
 private:
     mKCal::Notebook::Ptr createNotebook();
+    void loadEventIndex();
 
     static QContactId localContactId(const QString &calendarEventId);
     static QString calendarEventId(const QContactId &contactId);
@@ -89,10 +95,17 @@ private:
 
 private Q_SLOTS:
     void onLocaleChanged();
+    void onSaveTimeout();
 
 private:
     mKCal::ExtendedCalendar::Ptr mCalendar;
     mKCal::ExtendedStorage::Ptr mStorage;
+    // All birthday events of the notebook, loaded once and kept in sync with our own changes
+    QHash<QContactId, KCalendarCore::Event::Ptr> mEvents;
+    bool mEventIndexLoaded;
+    bool mDirty;
+    QTimer mSaveTimer;
+    QElapsedTimer mSaveWaitTimer;
 };
 
 #endif // CDBIRTHDAYCALENDAR_H
@@ -24,15 +24,18 @@
 #include "cdbirthdaycontroller.h"
 #include "cdbirthdaycalendar.h"
 #include "cdbirthdayplugin.h"
+#include "contact-change-dispatcher.h"
 #include "debug.h"
+#include "statistics.h"
+#include "task-scheduler.h"
 
 #include <QDir>
 #include <QFile>
 
 #include <QContactBirthday>
+#include <QContactChangeLogFilter>
 #include <QContactDetailFilter>
 #include <QContactFetchRequest>
-#include <QContactIdFilter>
 #include <QContactDisplayLabel>
 #include <QContactCollectionFilter>
 
@@ -47,7 +50,13 @@ namespace {
 
 // version number for current type of birthday events. Increase number when changing event details.
 const int CURRENT_BIRTHDAY_VERSION = 1;
-const int UPDATE_TIMEOUT = 1000; // ms
+// Fall back to a full sync on dataChanged() if the last one is older than this
+const int FULL_SYNC_INTERVAL = 24 * 60 * 60; // s
+// Number of contacts compared against the calendar per full sync step
+const int SYNC_BATCH_SIZE = 50;
+
+const QString LastSyncKey = QStringLiteral("Birthday/LastSync");
+const QString LastFullSyncKey = QStringLiteral("Birthday/LastFullSync");
 
 template<typename DetailType>
 QContactDetailFilter detailFilter(int field = -1)
@@ -70,46 +79,70 @@ QMap<QString, QString> managerParameters()
 CDBirthdayController::CDBirthdayController(QObject *parent)
     : QObject(parent)
     , mCalendar(stampFileUpToDate() ? CDBirthdayCalendar::KeepOldDB : CDBirthdayCalendar::DropOldDB)
-    , mManager(QStringLiteral("org.nemomobile.contacts.sqlite"), managerParameters())
+    , mManager(Contactsd::BasePlugin::contactManager(QStringLiteral("org.nemomobile.contacts.sqlite"),
+                                                     managerParameters()))
     , mRequest(new QContactFetchRequest)
-    , mSyncMode(Incremental)
+    , mSubscription(nullptr)
+    , mSyncTaskId(0)
+    , mSyncMode(Resync)
     , mUpdateAllPending(false)
+    , mResyncPending(false)
+    , mSyncState(QSettings::IniFormat, QSettings::UserScope,
+                 QLatin1String("Nokia"), QLatin1String("Contactsd"))
 {
-    connect(&mManager, &QContactManager::contactsAdded,
-            this, &CDBirthdayController::contactsChanged);
-    connect(&mManager, &QContactManager::contactsChanged,
+    // Only aggregate contacts are reflected in the calendar
+    QContactCollectionFilter aggregateFilter;
+    aggregateFilter.setCollectionId(QtContactsSqliteExtensions::aggregateCollectionId(mManager->managerUri()));
+
+    mSubscription = ContactChangeDispatcher::subscribe(mManager,
+            QList<QContactDetail::DetailType>() << QContactBirthday::Type << QContactDisplayLabel::Type,
+            aggregateFilter, this);
+    connect(mSubscription, &ContactChangeSubscription::contactsChanged,
             this, &CDBirthdayController::contactsChanged);
-    connect(&mManager, &QContactManager::contactsRemoved,
+    connect(mSubscription, &ContactChangeSubscription::contactsRemoved,
             this, &CDBirthdayController::contactsRemoved);
 
-    connect(&mManager, SIGNAL(dataChanged()), SLOT(updateAllBirthdays()));
-
-    updateAllBirthdays();
+    connect(mManager.data(), &QContactManager::dataChanged,
+            this, &CDBirthdayController::onDataChanged);
 
-    mUpdateTimer.setInterval(UPDATE_TIMEOUT);
-    mUpdateTimer.setSingleShot(true);
-    connect(&mUpdateTimer, &QTimer::timeout,
-            this, &CDBirthdayController::onUpdateQueueTimeout);
+    // The calendar is reconciled fully only if it was dropped or is due a
+    // periodic full sync; otherwise catch up with the changes made since we last ran.
+    onDataChanged();
 }
 
 CDBirthdayController::~CDBirthdayController()
 {
+    if (mSyncTaskId) {
+        BasePlugin::scheduler()->cancel(mSyncTaskId);
+    }
 }
 
-void CDBirthdayController::contactsChanged(const QList<QContactId>& contacts)
+void CDBirthdayController::contactsChanged(const QList<QContact>& contacts)
 {
-    foreach (const QContactId &id, contacts)
-        mUpdatedContacts.insert(id);
+    if (syncInProgress()) {
+        // Don't let a sync in progress overwrite the newer contact data
+        foreach (const QContact &contact, contacts) {
+            mDeferredRemovals.remove(contact.id());
+            mDeferredUpdates.insert(contact.id(), contact);
+        }
+        return;
+    }
 
-    // Just restart the timer - if it doesn't expire, we can afford to wait
-    mUpdateTimer.start();
+    updateBirthdays(contacts);
+    mCalendar.scheduleSave();
 }
 
 void CDBirthdayController::contactsRemoved(const QList<QContactId>& contacts)
 {
-    foreach (const QContactId &id, contacts)
+    foreach (const QContactId &id, contacts) {
+        mDeferredUpdates.remove(id);
+        // A full sync in progress may still hold the removed contact
+        if (mSyncTaskId) {
+            mDeferredRemovals.insert(id);
+        }
         mCalendar.deleteBirthday(id);
-    mCalendar.save();
+    }
+    mCalendar.scheduleSave();
 }
 
 
@@ -151,9 +184,43 @@ QString CDBirthdayController::stampFilePath()
     return BasePlugin::cacheFileName(QLatin1String("calendar.stamp"));
 }
 
+bool CDBirthdayController::fullSyncRequired() const
+{
+    if (!stampFileUpToDate()) {
+        return true;
+    }
+
+    const QDateTime lastSync = mSyncState.value(LastSyncKey).toDateTime();
+    const QDateTime lastFullSync = mSyncState.value(LastFullSyncKey).toDateTime();
+    if (!lastSync.isValid() || !lastFullSync.isValid()) {
+        return true;
+    }
+
+    return lastFullSync.secsTo(QDateTime::currentDateTimeUtc()) >= FULL_SYNC_INTERVAL;
+}
+
+void CDBirthdayController::storeSyncTimestamp(SyncMode mode)
+{
+    // Use the time the fetch started, so that changes made during the fetch are not missed
+    mSyncState.setValue(LastSyncKey, mSyncStarted);
+    if (mode == FullSync) {
+        mSyncState.setValue(LastFullSyncKey, mSyncStarted);
+    }
+    mSyncState.sync();
+}
+
+void CDBirthdayController::onDataChanged()
+{
+    if (fullSyncRequired()) {
+        updateAllBirthdays();
+    } else {
+        resyncBirthdays();
+    }
+}
+
 void CDBirthdayController::updateAllBirthdays()
 {
-    if (mRequest->isActive()) {
+    if (syncInProgress()) {
         mUpdateAllPending = true;
     } else {
         // Fetch every contact with a birthday.
@@ -162,41 +229,58 @@ void CDBirthdayController::updateAllBirthdays()
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
-// Incremental sync logic
+// Resync logic
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 
-void CDBirthdayController::onUpdateQueueTimeout()
+void CDBirthdayController::resyncBirthdays()
 {
-    if (mRequest->isActive()) {
-        // The timer will be restarted by completion of the active request
+    if (syncInProgress()) {
+        mResyncPending = true;
         return;
     }
 
-    QList<QContactId> contactIds(mUpdatedContacts.toList());
+    const QDateTime since = mSyncState.value(LastSyncKey).toDateTime();
 
-    // If we request too many contact IDs, we will exceed the SQLite bound variable limit
-    const int batchSize = 200;
-    if (contactIds.count() > batchSize) {
-        mUpdatedContacts = contactIds.mid(batchSize).toSet();
-        contactIds = contactIds.mid(0, batchSize);
-    } else {
-        mUpdatedContacts.clear();
+    // Fetch only the contacts added or modified since the last sync; whether or
+    // not they still have a birthday, they are compared against the calendar.
+    QContactChangeLogFilter addedFilter(QContactChangeLogFilter::EventAdded);
+    addedFilter.setSince(since);
+    QContactChangeLogFilter changedFilter(QContactChangeLogFilter::EventChanged);
+    changedFilter.setSince(since);
+
+    fetchContacts(addedFilter | changedFilter, Resync);
+}
+
+void CDBirthdayController::removeObsoleteBirthdays()
+{
+    // Removals are not reported by the change log, so find calendar events
+    // whose contact no longer exists or no longer has a birthday
+    QContactCollectionFilter aggregateFilter;
+    aggregateFilter.setCollectionId(QtContactsSqliteExtensions::aggregateCollectionId(mManager->managerUri()));
+
+    const QList<QContactId> birthdayContactIds = mManager->contactIds(detailFilter<QContactBirthday>() & aggregateFilter);
+    if (mManager->error() != QContactManager::NoError) {
+        qCWarning(lcContactsd) << Q_FUNC_INFO << "Unable to fetch birthday contact ids, code:" << mManager->error();
+        return;
     }
 
-    QContactIdFilter fetchFilter;
-    fetchFilter.setIds(contactIds);
+    const QSet<QContactId> currentIds = birthdayContactIds.toSet();
 
-    fetchContacts(fetchFilter, Incremental);
+    foreach (const QContactId &id, mCalendar.birthdays().keys()) {
+        if (!currentIds.contains(id)) {
+            qCDebug(lcContactsd) << "Birthday with contact id" << id << "no longer has a matching contact, trashing it";
+            mCalendar.deleteBirthday(id);
+        }
+    }
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 // Common sync logic
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 
-void CDBirthdayController::fetchContacts(const QContactFilter &filter, SyncMode mode)
+void CDBirthdayController::prepareFetchRequest(QContactFetchRequest *request, const QContactFilter &filter)
 {
-    // Set up the fetch request object
-    mRequest->setManager(&mManager);
+    request->setManager(mManager.data());
 
     QContactFetchHint fetchHint;
     fetchHint.setDetailTypesHint(QList<QContactDetail::DetailType>()
@@ -204,21 +288,31 @@ void CDBirthdayController::fetchContacts(const QContactFilter &filter, SyncMode
     fetchHint.setOptimizationHints(QContactFetchHint::NoRelationships
                                    | QContactFetchHint::NoActionPreferences
                                    | QContactFetchHint::NoBinaryBlobs);
-    mRequest->setFetchHint(fetchHint);
+    request->setFetchHint(fetchHint);
 
     // Only fetch aggregate contacts
     QContactCollectionFilter aggregateFilter;
-    aggregateFilter.setCollectionId(QtContactsSqliteExtensions::aggregateCollectionId(mManager.managerUri()));
-    mRequest->setFilter(filter & aggregateFilter);
+    aggregateFilter.setCollectionId(QtContactsSqliteExtensions::aggregateCollectionId(mManager->managerUri()));
+    request->setFilter(filter & aggregateFilter);
+}
+
+void CDBirthdayController::fetchContacts(const QContactFilter &filter, SyncMode mode)
+{
+    // Set up the fetch request object
+    prepareFetchRequest(mRequest.data(), filter);
 
     connect(mRequest.data(), SIGNAL(stateChanged(QContactAbstractRequest::State)),
             SLOT(onRequestStateChanged(QContactAbstractRequest::State)));
 
+    const QDateTime started = QDateTime::currentDateTimeUtc();
+
     if (!mRequest->start()) {
         qCWarning(lcContactsd) << Q_FUNC_INFO << "Unable to start birthday contact fetch request";
     } else {
         qCDebug(lcContactsd) << "Birthday contacts fetch request started";
         mSyncMode = mode;
+        mSyncStarted = started;
+        mSyncTimer.start();
     }
 }
 
@@ -231,12 +325,12 @@ void CDBirthdayController::onRequestStateChanged(QContactAbstractRequest::State
             qCWarning(lcContactsd) << Q_FUNC_INFO << "Error during birthday contact fetch request, code:" << mRequest->error();
         } else {
             if (mSyncMode == FullSync) {
+                // Completes in the scheduled sync task
                 syncBirthdays(mRequest->contacts());
-
-                // Create the stamp file only after a successful full sync.
-                createStampFile();
             } else {
                 updateBirthdays(mRequest->contacts());
+                removeObsoleteBirthdays();
+                storeSyncTimestamp(Resync);
             }
         }
 
@@ -251,17 +345,51 @@ void CDBirthdayController::onRequestStateChanged(QContactAbstractRequest::State
         return;
     }
 
-    // Save the calendar in any case (success or not), since this "save" call
-    // also applies for the deleteBirthday() calls in processNotificationQueues()
-    mCalendar.save();
+    if (!mSyncTaskId) {
+        finishSync();
+    }
+}
+
+bool CDBirthdayController::isIdle() const
+{
+    return !syncInProgress();
+}
+
+bool CDBirthdayController::syncInProgress() const
+{
+    return mRequest->isActive() || mSyncTaskId != 0;
+}
+
+void CDBirthdayController::finishSync()
+{
+    if (mSyncTimer.isValid()) {
+        Statistics::record(mSyncMode == FullSync ? QStringLiteral("birthday.fullSyncDuration")
+                                                 : QStringLiteral("birthday.resyncDuration"),
+                           mSyncTimer.elapsed());
+        mSyncTimer.invalidate();
+    }
+
+    if (!mDeferredUpdates.isEmpty()) {
+        updateBirthdays(mDeferredUpdates.values());
+        mDeferredUpdates.clear();
+    }
+    foreach (const QContactId &id, mDeferredRemovals) {
+        mCalendar.deleteBirthday(id);
+    }
+    mDeferredRemovals.clear();
+
+    // Save the calendar in any case (success or not); the calendar skips the
+    // save if nothing was changed, and coalesces it with any pending deletions
+    mCalendar.scheduleSave();
 
     if (mUpdateAllPending) {
-        // We need to update all birthdays
+        // We need to update all birthdays, which also covers any pending resync
         mUpdateAllPending = false;
+        mResyncPending = false;
         updateAllBirthdays();
-    } else if (!mUpdatedContacts.isEmpty() && !mUpdateTimer.isActive()) {
-        // If some updated contacts weren't requested, we need to go again
-        mUpdateTimer.start();
+    } else if (mResyncPending) {
+        mResyncPending = false;
+        resyncBirthdays();
     }
 }
 
@@ -295,43 +423,71 @@ void CDBirthdayController::updateBirthdays(const QList<QContact> &changedBirthda
 
 void CDBirthdayController::syncBirthdays(const QList<QContact> &birthdayContacts)
 {
-    QHash<QContactId, CalendarBirthday> oldBirthdays = mCalendar.birthdays();
+    struct SyncState {
+        QList<QContact> contacts;
+        QHash<QContactId, CalendarBirthday> oldBirthdays;
+        int index;
+    };
+
+    QSharedPointer<SyncState> state(new SyncState);
+    state->contacts = birthdayContacts;
+    state->oldBirthdays = mCalendar.birthdays();
+    state->index = 0;
+
+    // Thousands of contacts can take long enough to compare that the daemon would
+    // stop responding, so the comparison runs in batches between other events.
+    mSyncTaskId = BasePlugin::scheduler()->schedule(this, QStringLiteral("birthday full sync"), [this, state]() {
+        const int end = qMin(state->index + SYNC_BATCH_SIZE, state->contacts.count());
+
+        // Check all birthdays from the contacts if the stored calendar item is up-to-date
+        for ( ; state->index < end; ++state->index) {
+            const QContact &contact(state->contacts.at(state->index));
+            const QString contactDisplayLabel = contact.detail<QContactDisplayLabel>().label();
+            if (contactDisplayLabel.isEmpty()) {
+                qCDebug(lcContactsd) << "Contact: " << contact << " has no displayLabel, so not syncing to calendar";
+                continue;
+            }
 
-    // Check all birthdays from the contacts if the stored calendar item is up-to-date
-    foreach (const QContact &contact, birthdayContacts) {
-        const QString contactDisplayLabel = contact.detail<QContactDisplayLabel>().label();
-        if (contactDisplayLabel.isEmpty()) {
-            qCDebug(lcContactsd) << "Contact: " << contact << " has no displayLabel, so not syncing to calendar";
-            continue;
-        }
+            QHash<QContactId, CalendarBirthday>::Iterator it = state->oldBirthdays.find(contact.id());
 
-        QHash<QContactId, CalendarBirthday>::Iterator it = oldBirthdays.find(contact.id());
+            if (state->oldBirthdays.end() != it) {
+                const QContactBirthday contactBirthday = contact.detail<QContactBirthday>();
+                const CalendarBirthday &calendarBirthday = *it;
 
-        if (oldBirthdays.end() != it) {
-            const QContactBirthday contactBirthday = contact.detail<QContactBirthday>();
-            const CalendarBirthday &calendarBirthday = *it;
+                // Display label or birthdate was changed on the contact, so update the calendar.
+                if ((contactDisplayLabel != calendarBirthday.summary()) ||
+                    (contactBirthday.date() != calendarBirthday.date())) {
+                    qCDebug(lcContactsd) << "Contact with calendar birthday: " << contactBirthday.date()
+                            << " and calendar displayLabel: " << calendarBirthday.summary()
+                            << " changed details to: " << contact << ", so update the calendar event";
 
-            // Display label or birthdate was changed on the contact, so update the calendar.
-            if ((contactDisplayLabel != calendarBirthday.summary()) ||
-                (contactBirthday.date() != calendarBirthday.date())) {
-                qCDebug(lcContactsd) << "Contact with calendar birthday: " << contactBirthday.date()
-                        << " and calendar displayLabel: " << calendarBirthday.summary()
-                        << " changed details to: " << contact << ", so update the calendar event";
+                    mCalendar.updateBirthday(contact);
+                }
 
+                // Birthday exists, so not a garbage one
+                state->oldBirthdays.erase(it);
+            } else {
+                // Create new birthday
                 mCalendar.updateBirthday(contact);
             }
+        }
 
-            // Birthday exists, so not a garbage one
-            oldBirthdays.erase(it);
-        } else {
-            // Create new birthday
-            mCalendar.updateBirthday(contact);
+        if (state->index < state->contacts.count()) {
+            return false;
         }
-    }
 
-    // Remaining old birthdays in the calendar db do not did not match any contact, so remove them.
-    foreach (const QContactId &id, oldBirthdays.keys()) {
-        qCDebug(lcContactsd) << "Birthday with contact id" << id << "no longer has a matching contact, trashing it";
-        mCalendar.deleteBirthday(id);
-    }
+        // Remaining old birthdays in the calendar db do not did not match any contact, so remove them.
+        foreach (const QContactId &id, state->oldBirthdays.keys()) {
+            qCDebug(lcContactsd) << "Birthday with contact id" << id << "no longer has a matching contact, trashing it";
+            mCalendar.deleteBirthday(id);
+        }
+
+        // Create the stamp file only after a successful full sync.
+        createStampFile();
+        storeSyncTimestamp(FullSync);
+
+        mSyncTaskId = 0;
+        finishSync();
+        return true;
+    }, TaskScheduler::LowPriority);
 }
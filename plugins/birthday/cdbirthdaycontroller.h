@@ -26,9 +26,12 @@
 
 #include "cdbirthdaycalendar.h"
 
+#include <QDateTime>
+#include <QElapsedTimer>
 #include <QSet>
+#include <QSettings>
 #include <QObject>
-#include <QTimer>
+#include <QHash>
 
 #include <QContact>
 #include <QContactAbstractRequest>
@@ -37,6 +40,10 @@
 
 class CDBirthdayCalendar;
 
+namespace Contactsd {
+class ContactChangeSubscription;
+}
+
 QTCONTACTS_USE_NAMESPACE
 
 class CDBirthdayController : public QObject
@@ -44,7 +51,7 @@ class CDBirthdayController : public QObject
     Q_OBJECT
 
     enum SyncMode {
-        Incremental,
+        Resync,
         FullSync
     };
 
@@ -52,31 +59,49 @@ public:
     explicit CDBirthdayController(QObject *parent = 0);
     ~CDBirthdayController();
 
+    bool isIdle() const;
+
 private Q_SLOTS:
-    void contactsChanged(const QList<QContactId> &contacts);
+    void contactsChanged(const QList<QContact> &contacts);
     void contactsRemoved(const QList<QContactId> &contacts);
 
     void onRequestStateChanged(QContactAbstractRequest::State newState);
     void updateAllBirthdays();
-    void onUpdateQueueTimeout();
+    void resyncBirthdays();
+    void onDataChanged();
 
 private:
     static void createStampFile();
     static QString stampFilePath();
     static bool stampFileUpToDate();
 
+    bool fullSyncRequired() const;
+    void storeSyncTimestamp(SyncMode mode);
+
+    void prepareFetchRequest(QContactFetchRequest *request, const QContactFilter &filter);
     void fetchContacts(const QContactFilter &filter, SyncMode mode);
     void updateBirthdays(const QList<QContact> &changedBirthdays);
     void syncBirthdays(const QList<QContact> &birthdayContacts);
+    void removeObsoleteBirthdays();
+    bool syncInProgress() const;
+    void finishSync();
 
 private:
     CDBirthdayCalendar mCalendar;
-    QContactManager mManager;
+    QSharedPointer<QContactManager> mManager;
     QScopedPointer<QContactFetchRequest> mRequest;
-    QSet<QContactId> mUpdatedContacts;
-    QTimer mUpdateTimer;
+    Contactsd::ContactChangeSubscription *mSubscription;
+    // Changes received during a sync are applied once it has finished
+    QHash<QContactId, QContact> mDeferredUpdates;
+    QSet<QContactId> mDeferredRemovals;
+    // Full sync running on the plugin task scheduler, or zero
+    int mSyncTaskId;
     SyncMode mSyncMode;
     bool mUpdateAllPending;
+    bool mResyncPending;
+    QSettings mSyncState;
+    QDateTime mSyncStarted;
+    QElapsedTimer mSyncTimer;
 };
 
 #endif // CDBIRTHDAYCONTROLLER_H
@@ -44,11 +44,8 @@ void CDBirthdayPlugin::init()
     mController = new CDBirthdayController(this);
 }
 
-CDBirthdayPlugin::MetaData CDBirthdayPlugin::metaData()
+bool CDBirthdayPlugin::isIdle() const
 {
-    MetaData data;
-    data[metaDataKeyName]    = QVariant(QLatin1String("birthday"));
-    data[metaDataKeyVersion] = QVariant(QLatin1String("0.1"));
-    data[metaDataKeyComment] = QVariant(QLatin1String("contactsd birthday plugin"));
-    return data;
+    // Changes made while the daemon is not running are found in the contacts change log
+    return !mController || mController->isIdle();
 }
@@ -36,14 +36,14 @@ class CDBirthdayController;
 class CDBirthdayPlugin : public Contactsd::BasePlugin
 {
     Q_OBJECT
-    Q_PLUGIN_METADATA(IID "org.nemomobile.contactsd.birthday")
+    Q_PLUGIN_METADATA(IID "org.nemomobile.contactsd.birthday" FILE "birthday.json")
 
 public:
     CDBirthdayPlugin();
     ~CDBirthdayPlugin();
 
     void init();
-    MetaData metaData();
+    bool isIdle() const;
 
 private:
     CDBirthdayController *mController;
@@ -20,6 +20,8 @@ SOURCES  = \
     cdcalendarcontroller.cpp \
     cdcalendarplugin.cpp
 
+OTHER_FILES += calendar.json
+
 TARGET = calendarplugin
 target.path = $$LIBDIR/contactsd-1.0/plugins
 
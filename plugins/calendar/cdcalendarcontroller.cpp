@@ -24,40 +24,12 @@ using namespace Accounts;
 namespace {
 // Anonymous namespace
 
-/*!
-    \brief Enable/disable all mKCal notebooks related to the account id
-
-    Sets the \a enabled status for all notebooks associated with the given
-    account \a id.
-*/
 const QByteArray VISIBILITY_CHANGED_FLAG("hidden_by_account");
 
-void updateNotebooks(AccountId id, bool enabled)
-{
-    mKCal::ExtendedCalendar::Ptr calendar = mKCal::ExtendedCalendar::Ptr(
-                new mKCal::ExtendedCalendar(QTimeZone::systemTimeZone()));
-    mKCal::ExtendedStorage::Ptr storage = calendar->defaultStorage(calendar);
-    storage->open();
+const QString APPLIED_STATE_GROUP(QStringLiteral("CalendarAccounts"));
 
-    const mKCal::Notebook::List notebooks = storage->notebooks();
-    for (const mKCal::Notebook::Ptr &notebook : notebooks) {
-        const QString accountStr = notebook->account();
-        bool ok = false;
-        AccountId accountInt = accountStr.toULong(&ok);
-        if (ok && accountInt == id) {
-            bool visible = notebook->isVisible();
-            if (!enabled && visible) {
-                notebook->setIsVisible(false);
-                notebook->setCustomProperty(VISIBILITY_CHANGED_FLAG, QString::fromLatin1("true"));
-                storage->updateNotebook(notebook);
-            } else if (enabled && !visible && !notebook->customProperty(VISIBILITY_CHANGED_FLAG).isEmpty()) {
-                notebook->setIsVisible(true);
-                notebook->setCustomProperty(VISIBILITY_CHANGED_FLAG, QString());
-                storage->updateNotebook(notebook);
-            }
-        }
-    }
-}
+// Enabled events tend to arrive in bursts when an account's services are toggled
+const int UPDATE_TIMEOUT = 500; // ms
 
 } // Anonymous namespace
 
@@ -96,7 +68,16 @@ Manager * CDCalendarController::SetupManager(const QString &service,
 */
 CDCalendarController::CDCalendarController(QObject *parent)
     : QObject(parent)
+    , m_notebookIndexValid(false)
+    , m_appliedState(QSettings::IniFormat, QSettings::UserScope,
+                     QStringLiteral("Nokia"), QStringLiteral("Contactsd"))
+    , m_catchingUp(false)
 {
+    m_updateTimer.setInterval(UPDATE_TIMEOUT);
+    m_updateTimer.setSingleShot(true);
+    connect(&m_updateTimer, &QTimer::timeout,
+            this, &CDCalendarController::updateNotebooks);
+
     // Managers are needed following the specific service types we're interested
     // in. Without a type, libaccounts-glib won't send any signals (if we do set
     // a type, it sends us signals for all account types!).
@@ -104,10 +85,182 @@ CDCalendarController::CDCalendarController(QObject *parent)
                                     &CDCalendarController::enabledEventCalDav);
     m_manager_sync = SetupManager(QStringLiteral("sync"),
                                   &CDCalendarController::enabledEventSync);
+
+    // Catch up with accounts changed while the daemon was not running
+    m_catchingUp = true;
+    const AccountIdList calDavAccounts = m_manager_caldav->accountList();
+    for (AccountId id : calDavAccounts) {
+        enabledEventCalDav(id);
+    }
+    const AccountIdList syncAccounts = m_manager_sync->accountList();
+    for (AccountId id : syncAccounts) {
+        enabledEventSync(id);
+    }
+    m_catchingUp = false;
+
+    // Forget the state of removed accounts, their ids may be reused
+    m_appliedState.beginGroup(APPLIED_STATE_GROUP);
+    const QStringList keys = m_appliedState.childKeys();
+    for (const QString &key : keys) {
+        const AccountId id = key.toUInt();
+        if (!calDavAccounts.contains(id) && !syncAccounts.contains(id)) {
+            m_appliedState.remove(key);
+        }
+    }
+    m_appliedState.endGroup();
 }
 
 CDCalendarController::~CDCalendarController()
 {
+    // Apply any changes still waiting for the update timer
+    if (!m_pendingUpdates.isEmpty()) {
+        updateNotebooks();
+    }
+
+    if (m_storage) {
+        m_storage->unregisterObserver(this);
+        m_storage->close();
+    }
+}
+
+/*!
+    \brief Returns true when no notebook update is waiting to be applied
+*/
+bool CDCalendarController::isIdle() const
+{
+    return m_pendingUpdates.isEmpty() && !m_updateTimer.isActive();
+}
+
+/*!
+    \brief Opens the mKCal storage, if not already open
+
+    The storage is kept open for the lifetime of the plugin, so that
+    consecutive account changes don't each re-open the database.
+*/
+bool CDCalendarController::openStorage()
+{
+    if (m_storage) {
+        return true;
+    }
+
+    m_calendar = mKCal::ExtendedCalendar::Ptr(new mKCal::ExtendedCalendar(QTimeZone::systemTimeZone()));
+    m_storage = mKCal::ExtendedCalendar::defaultStorage(m_calendar);
+    if (!m_storage->open()) {
+        qWarning() << "Unable to open calendar storage";
+        m_storage.clear();
+        m_calendar.clear();
+        return false;
+    }
+
+    m_storage->registerObserver(this);
+    m_notebookIndexValid = false;
+    return true;
+}
+
+/*!
+    \brief Indexes the mKCal notebooks by the account id they belong to
+*/
+void CDCalendarController::buildNotebookIndex()
+{
+    m_accountNotebooks.clear();
+
+    const mKCal::Notebook::List notebooks = m_storage->notebooks();
+    for (const mKCal::Notebook::Ptr &notebook : notebooks) {
+        bool ok = false;
+        AccountId accountId = notebook->account().toULong(&ok);
+        if (ok) {
+            m_accountNotebooks.insert(accountId, notebook->uid());
+        }
+    }
+
+    m_notebookIndexValid = true;
+}
+
+void CDCalendarController::storageModified(mKCal::ExtendedStorage *storage, const QString &info)
+{
+    Q_UNUSED(storage)
+    Q_UNUSED(info)
+
+    // Notebooks may have been added or removed by another process
+    m_notebookIndexValid = false;
+}
+
+void CDCalendarController::storageProgress(mKCal::ExtendedStorage *storage, const QString &info)
+{
+    Q_UNUSED(storage)
+    Q_UNUSED(info)
+}
+
+void CDCalendarController::storageFinished(mKCal::ExtendedStorage *storage, bool error, const QString &info)
+{
+    Q_UNUSED(storage)
+    Q_UNUSED(error)
+    Q_UNUSED(info)
+}
+
+/*!
+    \brief Queues the enabled state of an account's notebooks for update
+
+    Only the latest state for each account is applied, once no further
+    events have arrived for a short period. While catching up on start,
+    accounts already in the last applied state are skipped.
+*/
+void CDCalendarController::scheduleNotebookUpdate(AccountId id, bool enabled)
+{
+    if (m_catchingUp) {
+        const QVariant applied = m_appliedState.value(APPLIED_STATE_GROUP + QLatin1Char('/') + QString::number(id));
+        if (applied.isValid() && applied.toBool() == enabled) {
+            return;
+        }
+    }
+
+    m_pendingUpdates.insert(id, enabled);
+    m_updateTimer.start();
+}
+
+/*!
+    \brief Enable/disable all mKCal notebooks related to the pending account ids
+
+    Sets the enabled status for all notebooks associated with each account
+    with a pending update.
+*/
+void CDCalendarController::updateNotebooks()
+{
+    const QHash<AccountId, bool> updates = m_pendingUpdates;
+    m_pendingUpdates.clear();
+
+    if (updates.isEmpty() || !openStorage()) {
+        return;
+    }
+
+    if (!m_notebookIndexValid) {
+        buildNotebookIndex();
+    }
+
+    for (QHash<AccountId, bool>::const_iterator it = updates.constBegin(); it != updates.constEnd(); ++it) {
+        const bool enabled = it.value();
+
+        const QList<QString> notebookUids = m_accountNotebooks.values(it.key());
+        for (const QString &notebookUid : notebookUids) {
+            mKCal::Notebook::Ptr notebook = m_storage->notebook(notebookUid);
+            if (!notebook) {
+                continue;
+            }
+
+            bool visible = notebook->isVisible();
+            if (!enabled && visible) {
+                notebook->setIsVisible(false);
+                notebook->setCustomProperty(VISIBILITY_CHANGED_FLAG, QString::fromLatin1("true"));
+                m_storage->updateNotebook(notebook);
+            } else if (enabled && !visible && !notebook->customProperty(VISIBILITY_CHANGED_FLAG).isEmpty()) {
+                notebook->setIsVisible(true);
+                notebook->setCustomProperty(VISIBILITY_CHANGED_FLAG, QString());
+                m_storage->updateNotebook(notebook);
+            }
+        }
+
+        m_appliedState.setValue(APPLIED_STATE_GROUP + QLatin1Char('/') + QString::number(it.key()), enabled);
+    }
 }
 
 /*!
@@ -148,7 +301,7 @@ void CDCalendarController::enabledEventCalDav(AccountId id)
     }
 
     // Update the mKCal notebook with the result
-    updateNotebooks(id, enabled);
+    scheduleNotebookUpdate(id, enabled);
 }
 
 /*!
@@ -197,5 +350,5 @@ void CDCalendarController::enabledEventSync(AccountId id)
     }
 
     // Update the mKCal notebook with the result
-    updateNotebooks(id, enabled);
+    scheduleNotebookUpdate(id, enabled);
 }
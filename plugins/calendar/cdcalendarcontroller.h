@@ -16,10 +16,15 @@
 #define CDCALENDARCONTROLLER_H
 
 #include <QObject>
+#include <QHash>
+#include <QMultiHash>
+#include <QSettings>
+#include <QTimer>
 #include <Accounts/Manager>
+#include <extendedcalendar.h>
 #include <extendedstorage.h>
 
-class CDCalendarController : public QObject
+class CDCalendarController : public QObject, public mKCal::ExtendedStorageObserver
 {
     Q_OBJECT
 
@@ -27,17 +32,43 @@ public:
     explicit CDCalendarController(QObject *parent = 0);
     ~CDCalendarController();
 
+    bool isIdle() const;
+
 public Q_SLOTS:
     void enabledEventCalDav(Accounts::AccountId id);
     void enabledEventSync(Accounts::AccountId id);
 
+private Q_SLOTS:
+    void updateNotebooks();
+
 private:
     Accounts::Manager * SetupManager(const QString &service,
                                      void (CDCalendarController::*enabledEvent)(Accounts::AccountId id));
+    void scheduleNotebookUpdate(Accounts::AccountId id, bool enabled);
+    bool openStorage();
+    void buildNotebookIndex();
+
+    // mKCal::ExtendedStorageObserver
+    void storageModified(mKCal::ExtendedStorage *storage, const QString &info);
+    void storageProgress(mKCal::ExtendedStorage *storage, const QString &info);
+    void storageFinished(mKCal::ExtendedStorage *storage, bool error, const QString &info);
 
 private:
     Accounts::Manager *m_manager_caldav;
     Accounts::Manager *m_manager_sync;
+
+    mKCal::ExtendedCalendar::Ptr m_calendar;
+    mKCal::ExtendedStorage::Ptr m_storage;
+    QMultiHash<Accounts::AccountId, QString> m_accountNotebooks;
+    bool m_notebookIndexValid;
+
+    QHash<Accounts::AccountId, bool> m_pendingUpdates;
+    QTimer m_updateTimer;
+
+    // The enabled state last applied to each account's notebooks, so that catching
+    // up on start only touches the storage for accounts changed in the meantime
+    QSettings m_appliedState;
+    bool m_catchingUp;
 };
 
 #endif // CDCALENDARCONTROLLER_H
@@ -34,11 +34,8 @@ void CDCalendarPlugin::init()
     mController = new CDCalendarController(this);
 }
 
-CDCalendarPlugin::MetaData CDCalendarPlugin::metaData()
+bool CDCalendarPlugin::isIdle() const
 {
-    MetaData data;
-    data[metaDataKeyName]    = QVariant(QLatin1String("Calendar"));
-    data[metaDataKeyVersion] = QVariant(QLatin1String("0.1"));
-    data[metaDataKeyComment] = QVariant(QLatin1String("contactsd Calendar plugin"));
-    return data;
+    // Account changes missed meanwhile are applied when the daemon next starts
+    return !mController || mController->isIdle();
 }
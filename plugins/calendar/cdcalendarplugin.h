@@ -27,14 +27,14 @@ class CDCalendarController;
 class CDCalendarPlugin : public Contactsd::BasePlugin
 {
     Q_OBJECT
-    Q_PLUGIN_METADATA(IID "org.nemomobile.contactsd.Calendar")
+    Q_PLUGIN_METADATA(IID "org.nemomobile.contactsd.Calendar" FILE "calendar.json")
 
 public:
     CDCalendarPlugin();
     ~CDCalendarPlugin();
 
     void init();
-    MetaData metaData();
+    bool isIdle() const;
 
 private:
     CDCalendarController *mController;
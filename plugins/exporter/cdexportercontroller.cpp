@@ -13,22 +13,25 @@
  **/
 
 #include "cdexportercontroller.h"
+#include "base-plugin.h"
+#include "debug.h"
+#include "statistics.h"
+#include "task-scheduler.h"
 
 #include <contactmanagerengine.h>
 #include <qtcontacts-extensions_manager_impl.h>
 
 #include <QContactCollection>
 
-#include <Accounts/Account>
 #include <Accounts/Manager>
 
 #include <QDebug>
-#include <QDBusConnection>
-#include <QDBusMessage>
-#include <QDBusPendingCall>
 
 namespace {
 
+const int TRIGGER_TIMEOUT = 1000; // ms
+const int TRIGGER_MAXIMUM_TIMEOUT = 5000; // ms
+
 QMap<QString, QString> privilegedManagerParameters()
 {
     QMap<QString, QString> rv;
@@ -45,16 +48,55 @@ QString managerName()
 
 CDExporterController::CDExporterController(QObject *parent)
     : QObject(parent)
-    , m_privilegedManager(managerName(), privilegedManagerParameters())
+    , m_privilegedManager(Contactsd::BasePlugin::contactManager(managerName(), privilegedManagerParameters()))
 {
     QtContactsSqliteExtensions::ContactManagerEngine *engine
-            = QtContactsSqliteExtensions::contactManagerEngine(m_privilegedManager);
+            = QtContactsSqliteExtensions::contactManagerEngine(*m_privilegedManager);
     connect(engine, &QtContactsSqliteExtensions::ContactManagerEngine::collectionContactsChanged,
             this, &CDExporterController::collectionContactsChanged);
+
+    // The account metadata of a collection may change, or its id be reused after removal
+    connect(m_privilegedManager.data(), &QContactManager::collectionsChanged,
+            this, &CDExporterController::collectionsChanged);
+    connect(m_privilegedManager.data(), &QContactManager::collectionsRemoved,
+            this, &CDExporterController::collectionsChanged);
+    connect(m_privilegedManager.data(), &QContactManager::collectionsAdded,
+            this, &CDExporterController::collectionsChanged);
+    connect(m_privilegedManager.data(), &QContactManager::dataChanged,
+            this, [this]() { m_collectionAccounts.clear(); });
+
+    m_triggerTimer.setInterval(TRIGGER_TIMEOUT);
+    m_triggerTimer.setSingleShot(true);
+    connect(&m_triggerTimer, &QTimer::timeout,
+            this, &CDExporterController::triggerSync);
+
+    m_waitTimer.invalidate();
+
+    scheduleCatchUp();
 }
 
 CDExporterController::~CDExporterController()
 {
+    // The daemon destroys its plugins before the sync trigger, which starts any
+    // sync still pending when it is destroyed in turn
+    if (m_triggerTimer.isActive()) {
+        triggerSync();
+    }
+}
+
+bool CDExporterController::isIdle() const
+{
+    return !m_catchUpTaskId && !m_triggerTimer.isActive() && m_pendingProviders.isEmpty();
+}
+
+void CDExporterController::releaseCaches()
+{
+    qCDebug(lcContactsd) << "Releasing" << m_collectionAccounts.count() << "cached collection accounts";
+
+    // The account manager keeps every account looked up so far; it is created again on demand
+    m_collectionAccounts.clear();
+    delete m_manager;
+    m_manager = nullptr;
 }
 
 void CDExporterController::collectionContactsChanged(const QList<QContactCollectionId> &collectionIds)
@@ -62,35 +104,174 @@ void CDExporterController::collectionContactsChanged(const QList<QContactCollect
     // If the collection originates from an account (e.g. an address book synced from a remote cloud
     // account) then sync those changes upstream to that account.
 
-    QStringList accountProviders;
+    bool added = false;
     for (const QContactCollectionId &collectionId : collectionIds) {
-        const QContactCollection collection = m_privilegedManager.collection(collectionId);
-        const Accounts::AccountId accountId = collection.extendedMetaData(COLLECTION_EXTENDEDMETADATA_KEY_ACCOUNTID).toInt();
-        if (accountId > 0) {
-            if (!m_manager) {
-                m_manager = new Accounts::Manager(this);
+        const CollectionAccount account = collectionAccount(collectionId);
+        if (!account.providerName.isEmpty()) {
+            m_pendingProviders.insert(account.providerName);
+            added = true;
+        }
+    }
+
+    if (!added) {
+        return;
+    }
+
+    ++m_notificationCount;
+    Contactsd::Statistics::increment(QStringLiteral("exporter.notifications"));
+    if (m_triggerTimer.isActive()) {
+        // This notification is merged into the already pending trigger
+        ++m_suppressedTriggerCount;
+        Contactsd::Statistics::increment(QStringLiteral("exporter.suppressedTriggers"));
+    }
+
+    // Only trigger the sync after not receiving a change notification for the defined period,
+    // but do not postpone it indefinitely during a long series of changes.
+    if (m_waitTimer.isValid()) {
+        if (m_waitTimer.elapsed() >= TRIGGER_MAXIMUM_TIMEOUT) {
+            return;
+        }
+    } else {
+        m_waitTimer.start();
+    }
+
+    m_triggerTimer.start();
+}
+
+void CDExporterController::scheduleCatchUp()
+{
+    // Local changes made while the daemon was not running are not notified to us, but
+    // the change flags of their contacts remain set until a sync adapter has exported
+    // them; trigger an upsync for every account collection which still has any.
+    struct CatchUpState {
+        QList<QContactCollection> collections;
+        int index = -1;
+    };
+    QSharedPointer<CatchUpState> state(new CatchUpState);
+
+    m_catchUpTaskId = Contactsd::BasePlugin::scheduler()->schedule(this, QStringLiteral("exporter catch-up"), [this, state]() {
+        if (state->index < 0) {
+            state->collections = m_privilegedManager->collections();
+            state->index = 0;
+            return false;
+        }
+
+        if (state->index < state->collections.count()) {
+            const QContactCollection &collection(state->collections.at(state->index++));
+            if (collection.extendedMetaData(COLLECTION_EXTENDEDMETADATA_KEY_ACCOUNTID).toInt() <= 0) {
+                return false;
             }
-            Accounts::Account *account = m_manager->account(accountId);
-            if (account) {
-                accountProviders.append(account->providerName());
-            } else {
-                qWarning() << "CDExport: got change notification for contact collection" << collectionId
-                           << "matching account id" << accountId << "but cannot find matching account!";
+
+            // The unmodified contacts are not needed, so they are not fetched
+            QList<QContact> addedContacts;
+            QList<QContact> modifiedContacts;
+            QList<QContact> deletedContacts;
+            QContactManager::Error error = QContactManager::NoError;
+            QtContactsSqliteExtensions::ContactManagerEngine *engine
+                    = QtContactsSqliteExtensions::contactManagerEngine(*m_privilegedManager);
+            if (!engine->fetchContactChanges(collection.id(), &addedContacts, &modifiedContacts,
+                                             &deletedContacts, nullptr, &error)) {
+                qCWarning(lcContactsd) << "CDExport: unable to fetch changes of collection" << collection.id() << error;
+            } else if (!addedContacts.isEmpty() || !modifiedContacts.isEmpty() || !deletedContacts.isEmpty()) {
+                const CollectionAccount account = collectionAccount(collection.id());
+                if (!account.providerName.isEmpty()) {
+                    m_pendingProviders.insert(account.providerName);
+                }
             }
+            return false;
+        }
+
+        m_catchUpTaskId = 0;
+        if (!m_pendingProviders.isEmpty()) {
+            qCDebug(lcContactsd) << "CDExport: catching up with changes made while not running";
+            triggerSync();
+        }
+        return true;
+    }, Contactsd::TaskScheduler::LowPriority);
+}
+
+void CDExporterController::collectionsChanged(const QList<QContactCollectionId> &collectionIds)
+{
+    for (const QContactCollectionId &collectionId : collectionIds) {
+        m_collectionAccounts.remove(collectionId);
+    }
+}
+
+void CDExporterController::accountRemoved(Accounts::AccountId accountId)
+{
+    QHash<QContactCollectionId, CollectionAccount>::iterator it = m_collectionAccounts.begin();
+    while (it != m_collectionAccounts.end()) {
+        if (it->accountId == accountId) {
+            it = m_collectionAccounts.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+CDExporterController::CollectionAccount CDExporterController::collectionAccount(const QContactCollectionId &collectionId)
+{
+    QHash<QContactCollectionId, CollectionAccount>::const_iterator it = m_collectionAccounts.constFind(collectionId);
+    if (it != m_collectionAccounts.constEnd()) {
+        return *it;
+    }
+
+    CollectionAccount account;
+    const QContactCollection collection = m_privilegedManager->collection(collectionId);
+    account.accountId = collection.extendedMetaData(COLLECTION_EXTENDEDMETADATA_KEY_ACCOUNTID).toInt();
+    if (account.accountId > 0) {
+        account.providerName = providerName(account.accountId, collectionId);
+        if (account.providerName.isEmpty()) {
+            // Don't cache a failed lookup, the account may not be visible to us yet
+            return account;
         }
     }
 
-    if (!accountProviders.isEmpty()) {
-        qWarning() << "CDExport: triggering contacts remote sync:" << accountProviders;
-        QDBusMessage message = QDBusMessage::createMethodCall(
-                QStringLiteral("com.nokia.contactsd"),
-                QStringLiteral("/SyncTrigger"),
-                QStringLiteral("com.nokia.contactsd"),
-                QStringLiteral("triggerSync"));
-        message.setArguments(QVariantList()
-                << QVariant::fromValue<QStringList>(accountProviders)
-                << QVariant::fromValue<qint32>(1)   // only if AlwaysUpToDate set in profile
-                << QVariant::fromValue<qint32>(1)); // only if Upsync or TwoWay direction
-        QDBusConnection::sessionBus().asyncCall(message);
+    m_collectionAccounts.insert(collectionId, account);
+    return account;
+}
+
+QString CDExporterController::providerName(Accounts::AccountId accountId, const QContactCollectionId &collectionId)
+{
+    if (!m_manager) {
+        m_manager = new Accounts::Manager(this);
+        connect(m_manager, &Accounts::Manager::accountRemoved,
+                this, &CDExporterController::accountRemoved);
+    }
+
+    Accounts::Account *account = m_manager->account(accountId);
+    if (!account) {
+        qWarning() << "CDExport: got change notification for contact collection" << collectionId
+                   << "matching account id" << accountId << "but cannot find matching account!";
+        return QString();
+    }
+
+    return account->providerName();
+}
+
+void CDExporterController::triggerSync()
+{
+    m_triggerTimer.stop();
+    m_waitTimer.invalidate();
+
+    if (m_pendingProviders.isEmpty()) {
+        return;
+    }
+
+    const QStringList accountProviders = m_pendingProviders.values();
+    m_pendingProviders.clear();
+    ++m_triggerCount;
+    Contactsd::Statistics::increment(QStringLiteral("exporter.triggers"));
+
+    Contactsd::logEvent(Contactsd::EventExporterTrigger, accountProviders.join(QLatin1Char(',')), m_notificationCount);
+    qCDebug(lcContactsd) << "CDExport: triggering contacts remote sync:" << accountProviders
+                         << "notifications:" << m_notificationCount
+                         << "triggers:" << m_triggerCount
+                         << "suppressed:" << m_suppressedTriggerCount;
+
+    // Only profiles with AlwaysUpToDate set and an Upsync or TwoWay direction, coalesced
+    if (!Contactsd::BasePlugin::triggerSync(accountProviders, Contactsd::BasePlugin::AdaptiveSync,
+                                            Contactsd::BasePlugin::UpsyncDirection)) {
+        qCWarning(lcContactsd) << "CDExport: no sync trigger to notify of changes in:" << accountProviders;
     }
 }
@@ -15,10 +15,16 @@
 #ifndef CDEXPORTERCONTROLLER_H
 #define CDEXPORTERCONTROLLER_H
 
+#include <QElapsedTimer>
+#include <QHash>
 #include <QObject>
+#include <QSet>
+#include <QTimer>
 
 #include <QContactManager>
 
+#include <Accounts/Account>
+
 namespace Accounts {
     class Manager;
 }
@@ -33,11 +39,38 @@ public:
     explicit CDExporterController(QObject *parent = nullptr);
     ~CDExporterController();
 
+    bool isIdle() const;
+    void releaseCaches();
+
 private:
+    struct CollectionAccount {
+        Accounts::AccountId accountId = 0;
+        QString providerName;
+    };
+
     void collectionContactsChanged(const QList<QContactCollectionId> &collectionIds);
+    void collectionsChanged(const QList<QContactCollectionId> &collectionIds);
+    void accountRemoved(Accounts::AccountId accountId);
+    void triggerSync();
+    void scheduleCatchUp();
+
+    CollectionAccount collectionAccount(const QContactCollectionId &collectionId);
+    QString providerName(Accounts::AccountId accountId, const QContactCollectionId &collectionId);
 
-    QContactManager m_privilegedManager;
+    QSharedPointer<QContactManager> m_privilegedManager;
     Accounts::Manager *m_manager = nullptr;
+
+    // Collections which are not account-backed are cached with a zero account id
+    QHash<QContactCollectionId, CollectionAccount> m_collectionAccounts;
+
+    QSet<QString> m_pendingProviders;
+    QTimer m_triggerTimer;
+    QElapsedTimer m_waitTimer;
+    int m_catchUpTaskId = 0;
+
+    quint64 m_notificationCount = 0;
+    quint64 m_triggerCount = 0;
+    quint64 m_suppressedTriggerCount = 0;
 };
 
 #endif // CDEXPORTERCONTROLLER_H
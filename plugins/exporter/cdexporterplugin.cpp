@@ -35,11 +35,16 @@ void CDExporterPlugin::init()
     mController = new CDExporterController(this);
 }
 
-CDExporterPlugin::MetaData CDExporterPlugin::metaData()
+bool CDExporterPlugin::isIdle() const
 {
-    MetaData data;
-    data[metaDataKeyName]    = QVariant(QLatin1String("exporter"));
-    data[metaDataKeyVersion] = QVariant(QLatin1String("0.1"));
-    data[metaDataKeyComment] = QVariant(QLatin1String("contactsd exporter plugin"));
-    return data;
+    // Changes made while the daemon is not running are found from the contacts'
+    // change flags when it is started again
+    return !mController || mController->isIdle();
+}
+
+void CDExporterPlugin::releaseCaches()
+{
+    if (mController) {
+        mController->releaseCaches();
+    }
 }
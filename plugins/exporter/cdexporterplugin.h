@@ -28,14 +28,15 @@ class CDExporterController;
 class CDExporterPlugin : public Contactsd::BasePlugin
 {
     Q_OBJECT
-    Q_PLUGIN_METADATA(IID "org.nemomobile.contactsd.exporter")
+    Q_PLUGIN_METADATA(IID "org.nemomobile.contactsd.exporter" FILE "exporter.json")
 
 public:
     CDExporterPlugin();
     ~CDExporterPlugin();
 
     void init();
-    MetaData metaData();
+    bool isIdle() const;
+    void releaseCaches();
 
 private:
     CDExporterController *mController;
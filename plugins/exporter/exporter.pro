@@ -23,6 +23,8 @@ SOURCES  = \
     cdexportercontroller.cpp \
     cdexporterplugin.cpp
 
+OTHER_FILES += exporter.json
+
 TARGET = exporterplugin
 target.path = $$LIBDIR/contactsd-1.0/plugins
 
@@ -15,6 +15,9 @@
 #include "cdsimcontroller.h"
 #include "cdsimplugin.h"
 #include "debug.h"
+#include "startup-timeline.h"
+#include "statistics.h"
+#include "task-scheduler.h"
 
 #include <qtcontacts-extensions.h>
 #include <qtcontacts-extensions_manager_impl.h>
@@ -47,12 +50,16 @@ QMap<QString, QString> contactManagerParameters()
 
 }
 
+const int CDSimModemData::StoreBatchSize;
+
 CDSimModemData::CDSimModemData(CDSimController *controller, const QString &modemPath)
     : QObject(controller)
     , m_modemPath(modemPath)
     , m_voicemailConf(0)
+    , m_contactReader(0)
     , m_ready(false)
     , m_retries(0)
+    , m_storeTaskId(0)
 {
     connect(&m_simManager, SIGNAL(presenceChanged(bool)), SLOT(simStateChanged()));
     connect(&m_simManager, SIGNAL(cardIdentifierChanged(QString)), SLOT(simStateChanged()));
@@ -66,8 +73,7 @@ CDSimModemData::CDSimModemData(CDSimController *controller, const QString &modem
     connect(&m_phonebook, &QOfonoPhonebook::validChanged,
             this, &CDSimModemData::phonebookValidChanged);
 
-    connect(&m_contactReader, &QVersitReader::stateChanged,
-            this, &CDSimModemData::readerStateChanged);
+    resetContactReader();
 
     connect(&m_messageWaiting, SIGNAL(voicemailMailboxNumberChanged(QString)), SLOT(voicemailConfigurationChanged()));
 
@@ -83,6 +89,9 @@ CDSimModemData::CDSimModemData(CDSimController *controller, const QString &modem
 
 CDSimModemData::~CDSimModemData()
 {
+    if (m_storeTaskId) {
+        BasePlugin::scheduler()->cancel(m_storeTaskId);
+    }
     delete m_voicemailConf;
 }
 
@@ -168,7 +177,8 @@ void CDSimModemData::timerEvent(QTimerEvent *event)
 
 CDSimController::CDSimController(QObject *parent, bool active)
     : QObject(parent)
-    , m_manager(QStringLiteral("org.nemomobile.contacts.sqlite"), contactManagerParameters())
+    , m_manager(BasePlugin::contactManager(QStringLiteral("org.nemomobile.contacts.sqlite"),
+                                           contactManagerParameters()))
     , m_transientImport(true)
     , m_busy(false)
     , m_active(active)
@@ -193,7 +203,7 @@ static QContactFilter deactivatedFilter()
 
 QContactManager &CDSimController::contactManager()
 {
-    return m_manager;
+    return *m_manager;
 }
 
 QContactCollection CDSimController::contactCollection(const QString &modemPath) const
@@ -261,12 +271,43 @@ bool CDSimController::busy() const
     return m_busy;
 }
 
+bool CDSimController::isIdle() const
+{
+    // Waiting for modems to become ready, or to retry an import
+    if (m_busy || m_readyTimer.isActive()) {
+        return false;
+    }
+
+    QMap<QString, CDSimModemData *>::const_iterator mit = m_modems.constBegin(), mend = m_modems.constEnd();
+    for ( ; mit != mend; ++mit) {
+        if ((*mit)->m_retryTimer.isActive()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void CDSimController::releaseCaches()
+{
+    // The parsed phonebook is only needed while an import is being stored
+    QMap<QString, CDSimModemData *>::const_iterator mit = m_modems.constBegin(), mend = m_modems.constEnd();
+    for ( ; mit != mend; ++mit) {
+        CDSimModemData *modem = *mit;
+        if (!modem->m_phonebook.importing() && modem->m_contactReader->state() != QVersitReader::ActiveState
+                && !modem->m_storeTaskId) {
+            modem->m_simContacts = QList<QContact>();
+            modem->resetContactReader();
+        }
+    }
+}
+
 void CDSimController::updateBusy()
 {
     bool busy = false;
     QMap<QString, CDSimModemData *>::const_iterator mit = m_modems.constBegin(), mend = m_modems.constEnd();
     for ( ; !busy && mit != mend; ++mit) {
-        busy |= ((*mit)->m_phonebook.importing() || (*mit)->m_contactReader.state() == QVersitReader::ActiveState);
+        busy |= ((*mit)->m_phonebook.importing() || (*mit)->m_contactReader->state() == QVersitReader::ActiveState
+                 || (*mit)->m_storeTaskId != 0);
     }
 
     if (m_busy != busy) {
@@ -297,6 +338,8 @@ void CDSimModemData::performTransientImport()
 
     if (m_phonebook.isValid() && controller()->m_transientImport) {
         // Read all contacts from the SIM
+        StartupTimeline::begin(QStringLiteral("sim"), QStringLiteral("import ") + m_simManager.modemPath());
+        m_importTimer.start();
         m_phonebook.beginImport();
     } else {
         m_simContacts.clear();
@@ -352,10 +395,11 @@ void CDSimModemData::phonebookValidChanged(bool)
 
 void CDSimModemData::vcardDataAvailable(const QString &vcardData)
 {
-    // Create contact records from the SIM VCard data
+    // Create contact records from the SIM VCard data; a store still pending is superseded
+    cancelSimContactChanges();
     m_simContacts.clear();
-    m_contactReader.setData(vcardData.toUtf8());
-    m_contactReader.startReading();
+    m_contactReader->setData(vcardData.toUtf8());
+    m_contactReader->startReading();
     updateBusy();
 
     m_retries = 0;
@@ -364,6 +408,9 @@ void CDSimModemData::vcardDataAvailable(const QString &vcardData)
 void CDSimModemData::vcardReadFailed()
 {
     qWarning() << "Unable to read VCard data from SIM:" << m_phonebook.modemPath();
+    StartupTimeline::end(QStringLiteral("sim"), QStringLiteral("import ") + m_simManager.modemPath());
+    Statistics::increment(QStringLiteral("sim.importFailures"));
+    m_importTimer.invalidate();
     updateBusy();
 
     const int maxRetries = 5;
@@ -381,7 +428,7 @@ void CDSimModemData::readerStateChanged(QVersitReader::State state)
     if (state != QVersitReader::FinishedState)
         return;
 
-    QList<QVersitDocument> results = m_contactReader.results();
+    QList<QVersitDocument> results = m_contactReader->results();
 
     if (results.isEmpty()) {
         m_simContacts.clear();
@@ -395,14 +442,29 @@ void CDSimModemData::readerStateChanged(QVersitReader::State state)
         } else {
             // import or remove contacts from local storage as necessary.
             ensureSimContactsPresent();
+            return;
         }
     }
 
+    finishImport();
+}
+
+void CDSimModemData::finishImport()
+{
+    StartupTimeline::end(QStringLiteral("sim"), QStringLiteral("import ") + m_simManager.modemPath());
+    if (m_importTimer.isValid()) {
+        // From the phonebook request until the contacts are stored
+        Statistics::record(QStringLiteral("sim.importDuration"), m_importTimer.elapsed());
+        m_importTimer.invalidate();
+    }
+    Statistics::setGauge(QStringLiteral("sim.contacts"), m_simContacts.count());
     updateBusy();
 }
 
 void CDSimModemData::deactivateAllSimContacts()
 {
+    cancelSimContactChanges();
+
     const QList<QContact> contacts = fetchContacts();
     if (contacts.size()) {
         QList<QContact> deactivatedContacts;
@@ -421,6 +483,8 @@ void CDSimModemData::deactivateAllSimContacts()
 
 void CDSimModemData::removeAllSimContacts()
 {
+    cancelSimContactChanges();
+
     if (m_collection.id().isNull()) {
         return;
     }
@@ -441,6 +505,48 @@ void CDSimModemData::removeAllSimContacts()
 void CDSimModemData::ensureSimContactsPresent()
 {
     // Ensure all contacts from the SIM are present in the store
+    cancelSimContactChanges();
+
+    struct StoreState {
+        QList<QContact> importContacts;
+        QList<QContactId> obsoleteIds;
+        bool prepared;
+    };
+
+    QSharedPointer<StoreState> state(new StoreState);
+    state->prepared = false;
+
+    // Storing a full SIM at boot would keep the daemon from answering D-Bus for
+    // seconds, so the changes are stored in batches between other events
+    m_storeTaskId = BasePlugin::scheduler()->schedule(this, QStringLiteral("sim store ") + m_modemPath, [this, state]() {
+        if (!state->prepared) {
+            prepareSimContactChanges(&state->importContacts, &state->obsoleteIds);
+            state->prepared = true;
+            return false;
+        }
+
+        if (!storeSimContactChanges(&state->importContacts, &state->obsoleteIds, StoreBatchSize)) {
+            return false;
+        }
+
+        m_storeTaskId = 0;
+        finishImport();
+        return true;
+    });
+    updateBusy();
+}
+
+void CDSimModemData::cancelSimContactChanges()
+{
+    if (m_storeTaskId) {
+        BasePlugin::scheduler()->cancel(m_storeTaskId);
+        m_storeTaskId = 0;
+        updateBusy();
+    }
+}
+
+void CDSimModemData::prepareSimContactChanges(QList<QContact> *importContacts, QList<QContactId> *obsoleteIds)
+{
     QContactFetchHint hint;
     hint.setDetailTypesHint(QList<QContactDetail::DetailType>()
                             << QContactNickname::Type << QContactPhoneNumber::Type);
@@ -507,7 +613,6 @@ void CDSimModemData::ensureSimContactsPresent()
         }
     }
 
-    QList<QContact> importContacts;
     foreach (QContact simContact, coalescedSimContacts) {
         // SIM imports have their name in the display label
         QContactDisplayLabel displayLabel = simContact.detail<QContactDisplayLabel>();
@@ -575,7 +680,7 @@ void CDSimModemData::ensureSimContactsPresent()
 
             if (modified) {
                 // Add the modified contact to the import set
-                importContacts.append(dbContact);
+                importContacts->append(dbContact);
             }
             existingContacts.erase(it);
         } else {
@@ -588,28 +693,38 @@ void CDSimModemData::ensureSimContactsPresent()
             simContact.saveDetail(&nickname);
             simContact.removeDetail(&displayLabel);
 
-            importContacts.append(simContact);
+            importContacts->append(simContact);
         }
     }
 
-    if (!importContacts.isEmpty()) {
+    // Any imported contacts remaining are no longer on the SIM
+    foreach (const QContact &contact, existingContacts.values()) {
+        obsoleteIds->append(contact.id());
+    }
+}
+
+bool CDSimModemData::storeSimContactChanges(QList<QContact> *importContacts, QList<QContactId> *obsoleteIds, int batchSize)
+{
+    // Stores up to batchSize contacts, taking them from the lists; returns true once all are stored
+    if (!importContacts->isEmpty()) {
         // Import any contacts which were modified or are not currently present
-        if (!manager().saveContacts(&importContacts)) {
+        QList<QContact> batch = importContacts->mid(0, batchSize);
+        importContacts->erase(importContacts->begin(), importContacts->begin() + batch.count());
+        if (!manager().saveContacts(&batch)) {
             qWarning() << "Error while saving imported sim contacts";
         }
+        return importContacts->isEmpty() && obsoleteIds->isEmpty();
     }
 
-    if (!existingContacts.isEmpty()) {
+    if (!obsoleteIds->isEmpty()) {
         // Remove any imported contacts no longer on the SIM
-        QList<QContactId> obsoleteIds;
-        foreach (const QContact &contact, existingContacts.values()) {
-            obsoleteIds.append(contact.id());
-        }
-
-        if (!manager().removeContacts(obsoleteIds)) {
+        if (!manager().removeContacts(*obsoleteIds)) {
             qWarning() << "Error while removing obsolete sim contacts";
         }
+        obsoleteIds->clear();
     }
+
+    return true;
 }
 
 void CDSimModemData::voicemailConfigurationChanged()
@@ -745,6 +860,15 @@ void CDSimController::removeObsoleteSimCollections()
     }
 }
 
+void CDSimModemData::resetContactReader()
+{
+    // The reader holds on to the parsed documents until it is destroyed
+    delete m_contactReader;
+    m_contactReader = new QVersitReader(this);
+    connect(m_contactReader, &QVersitReader::stateChanged,
+            this, &CDSimModemData::readerStateChanged);
+}
+
 void CDSimModemData::initCollection()
 {
     const int modemIndex = controller()->modemIndex(m_modemPath);
@@ -49,6 +49,8 @@ public:
     int modemIndex(const QString &modemPath) const;
 
     bool busy() const;
+    bool isIdle() const;
+    void releaseCaches();
 
 Q_SIGNALS:
     void busyChanged(bool);
@@ -67,7 +69,7 @@ private:
     friend class CDSimModemData;
     friend class TestSimPlugin;
 
-    QContactManager m_manager;
+    QSharedPointer<QContactManager> m_manager;
     bool m_transientImport;
     bool m_busy;
     bool m_active;
@@ -114,12 +116,20 @@ public Q_SLOTS:
     void phonebookValidChanged(bool valid);
 
 public:
+    // Contacts saved per step of the store task
+    static const int StoreBatchSize = 50;
+
     void deactivateAllSimContacts();
     void removeAllSimContacts();
     void ensureSimContactsPresent();
+    void cancelSimContactChanges();
+    void prepareSimContactChanges(QList<QContact> *importContacts, QList<QContactId> *obsoleteIds);
+    bool storeSimContactChanges(QList<QContact> *importContacts, QList<QContactId> *obsoleteIds, int batchSize);
+    void finishImport();
     void updateVoicemailConfiguration();
     void performTransientImport();
     void initCollection();
+    void resetContactReader();
 
     void timerEvent(QTimerEvent *event);
 
@@ -129,12 +139,14 @@ public:
     QOfonoMessageWaiting m_messageWaiting;
     QOfonoExtSimInfo m_simInfo;
     MDConfItem *m_voicemailConf;
-    QVersitReader m_contactReader;
+    QVersitReader *m_contactReader;
     QList<QContact> m_simContacts;
     QContactCollection m_collection;
     QBasicTimer m_retryTimer;
+    QElapsedTimer m_importTimer;
     bool m_ready;
     int m_retries;
+    int m_storeTaskId;
 };
 
 #endif // CDSIMCONTROLLER_H
@@ -44,11 +44,15 @@ void CDSimPlugin::init()
             mController, &CDSimController::setModemPaths);
 }
 
-CDSimPlugin::MetaData CDSimPlugin::metaData()
+bool CDSimPlugin::isIdle() const
 {
-    MetaData data;
-    data[metaDataKeyName]    = QVariant(QLatin1String("sim"));
-    data[metaDataKeyVersion] = QVariant(QLatin1String("0.1"));
-    data[metaDataKeyComment] = QVariant(QLatin1String("contactsd sim plugin"));
-    return data;
+    // The SIM phonebooks are imported again when the daemon next starts
+    return !mController || mController->isIdle();
+}
+
+void CDSimPlugin::releaseCaches()
+{
+    if (mController) {
+        mController->releaseCaches();
+    }
 }
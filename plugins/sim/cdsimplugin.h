@@ -28,14 +28,15 @@ class CDSimController;
 class CDSimPlugin : public Contactsd::BasePlugin
 {
     Q_OBJECT
-    Q_PLUGIN_METADATA(IID "org.nemomobile.contactsd.sim")
+    Q_PLUGIN_METADATA(IID "org.nemomobile.contactsd.sim" FILE "sim.json")
 
 public:
     CDSimPlugin();
     ~CDSimPlugin();
 
     void init();
-    MetaData metaData();
+    bool isIdle() const;
+    void releaseCaches();
 
 private:
     CDSimController *mController;
@@ -20,6 +20,8 @@ SOURCES  = \
     cdsimcontroller.cpp \
     cdsimplugin.cpp
 
+OTHER_FILES += sim.json
+
 TARGET = simplugin
 target.path = $$LIBDIR/contactsd-1.0/plugins
 
@@ -43,7 +43,8 @@ CDTpAccount::CDTpAccount(const Tp::AccountPtr &account, const QStringList &toAvo
       mReady(false),
       mHasRoster(false),
       mNewAccount(newAccount),
-      mImporting(false)
+      mImporting(false),
+      mRosterCacheReleased(false)
 {
     // connect all signals we care about, so we can signal that the account
     // changed accordingly
@@ -91,7 +92,10 @@ CDTpAccount::~CDTpAccount()
         makeRosterCache();
     }
 
-    CDTpAccountCacheWriter(this).run();
+    // A released cache is still on disk
+    if (!mRosterCacheReleased) {
+        CDTpAccountCacheWriter(this).run();
+    }
 }
 
 QList<CDTpContactPtr> CDTpAccount::contacts() const
@@ -106,8 +110,14 @@ QList<CDTpContactPtr> CDTpAccount::contacts() const
     return contacts;
 }
 
-QHash<QString, CDTpContact::Changes> CDTpAccount::rosterChanges() const
+QHash<QString, CDTpContact::Changes> CDTpAccount::rosterChanges()
 {
+    if (mRosterCacheReleased) {
+        // Released while online; the roster is still compared with the cache on disk
+        CDTpAccountCacheLoader(this).run();
+        mRosterCacheReleased = false;
+    }
+
     QHash<QString, CDTpContact::Changes> changes;
 
     QSet<QString> cachedAddresses = mRosterCache.keys().toSet();
@@ -177,6 +187,7 @@ void CDTpAccount::onAccountStateChanged()
     if (!isEnabled()) {
         setConnection(Tp::ConnectionPtr());
         mRosterCache.clear();
+        mRosterCacheReleased = false;
         CDTpAccountCacheWriter(this).run();
     } else {
         // Since contacts got removed when we disabled the account, we need
@@ -293,6 +304,12 @@ void CDTpAccount::setContactManager(const Tp::ContactManagerPtr &contactManager)
     qCDebug(lcContactsd) << "Account" << mAccount->objectPath() << "- received the roster";
 
     mHasRoster = true;
+    if (mRosterCacheReleased) {
+        // Changes in the roster are found against the cache
+        CDTpAccountCacheLoader(this).run();
+        mRosterCacheReleased = false;
+    }
+
     connect(contactManager.data(), &Tp::ContactManager::allKnownContactsChanged,
             this, &CDTpAccount::onAllKnownContactsChanged);
 
@@ -325,6 +342,22 @@ void CDTpAccount::setRosterCache(const QHash<QString, CDTpContact::Info> &cache)
     mRosterCache = cache;
 }
 
+void CDTpAccount::releaseRosterCache()
+{
+    // The cache only changes on disconnection, so it waits on disk until the
+    // roster is received, or until roster changes are next reported against it
+    if (mRosterCacheReleased || mRosterCache.isEmpty()) {
+        return;
+    }
+
+    qCDebug(lcContactsd) << "Releasing roster cache of" << mRosterCache.count() << "contacts for account"
+                         << mAccount->objectPath();
+
+    CDTpAccountCacheWriter(this).run();
+    mRosterCache = QHash<QString, CDTpContact::Info>();
+    mRosterCacheReleased = true;
+}
+
 void CDTpAccount::onAllKnownContactsChanged(const Tp::Contacts &contactsAdded,
                                             const Tp::Contacts &contactsRemoved,
                                             const Tp::Channel::GroupMemberChangeDetails &)
@@ -420,6 +453,7 @@ void CDTpAccount::maybeRequestExtraInfo(Tp::ContactPtr contact)
 void CDTpAccount::makeRosterCache()
 {
     mRosterCache.clear();
+    mRosterCacheReleased = false;
 
     Q_FOREACH (const CDTpContactPtr &ptr, mContacts) {
         mRosterCache.insert(ptr->contact()->id(), ptr->info());
@@ -436,6 +470,17 @@ QVariantMap CDTpAccount::storageInfo() const
     return mStorageInfo;
 }
 
+void CDTpAccount::setAvatarPath(const QString &path)
+{
+    if (path.isEmpty()) {
+        return;
+    }
+
+    // Report the path even if it is unchanged, the avatar may have been reset meanwhile
+    mAvatarPath = path;
+    Q_EMIT changed(CDTpAccountPtr(this), AvatarPath);
+}
+
 void CDTpAccount::onRequestedStorageSpecificInformation(Tp::PendingOperation *op)
 {
     if (!op->isValid()) {
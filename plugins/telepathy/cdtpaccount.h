@@ -48,7 +48,8 @@ public:
         Avatar       = (1 << 3),
         Enabled      = (1 << 4),
         StorageInfo  = (1 << 5),
-        All          = (1 << 6) -1
+        AvatarPath   = (1 << 6),
+        All          = (1 << 7) -1
     };
     Q_DECLARE_FLAGS(Changes, Change)
 
@@ -59,7 +60,7 @@ public:
 
     Tp::AccountPtr account() const { return mAccount; }
     QList<CDTpContactPtr> contacts() const;
-    QHash<QString, CDTpContact::Changes> rosterChanges() const;
+    QHash<QString, CDTpContact::Changes> rosterChanges();
     CDTpContactPtr contact(const QString &id) const;
     bool hasRoster() const { return mHasRoster; };
     bool isNewAccount() const { return mNewAccount; };
@@ -70,11 +71,16 @@ public:
     void emitSyncEnded(int contactsAdded, int contactsRemoved);
     QHash<QString, CDTpContact::Info> rosterCache() const;
     void setRosterCache(const QHash<QString, CDTpContact::Info> &rosterCache);
+    void releaseRosterCache();
 
     bool isReady() const { return mReady; }
 
     QVariantMap storageInfo() const;
 
+    // Path of the stored copy of the account avatar, set once it is written
+    QString avatarPath() const { return mAvatarPath; }
+    void setAvatarPath(const QString &path);
+
 Q_SIGNALS:
     void changed(CDTpAccountPtr accountWrapper, CDTpAccount::Changes changes);
     void rosterChanged(CDTpAccountPtr accountWrapper);
@@ -115,6 +121,7 @@ private:
     Tp::ConnectionPtr mCurrentConnection;
     Tp::Client::AccountInterfaceStorageInterface *mAccountStorage;
     QVariantMap mStorageInfo;
+    QString mAvatarPath;
     QHash<QString, CDTpContactPtr> mContacts;
     QHash<QString, CDTpContact::Info> mRosterCache;
     QStringList mContactsToAvoid;
@@ -123,6 +130,7 @@ private:
     bool mHasRoster;
     bool mNewAccount;
     bool mImporting;
+    bool mRosterCacheReleased;
 };
 
 Q_DECLARE_OPERATORS_FOR_FLAGS(CDTpAccount::Changes)
@@ -26,6 +26,7 @@
 #include "cdtpaccountcache.h"
 
 #include <debug.h>
+#include <statistics.h>
 
 using namespace Contactsd;
 
@@ -54,6 +55,7 @@ void CDTpAccountCacheLoader::run()
     QByteArray cacheData = cacheFile.readAll();
     cacheFile.close();
 
+    Statistics::Timer loadTimer(QStringLiteral("telepathy.rosterCacheLoadDuration"));
     QDataStream stream(cacheData);
 
     if (stream.atEnd()) {
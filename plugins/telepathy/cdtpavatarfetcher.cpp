@@ -0,0 +1,321 @@
+/** This file is part of Contacts daemon
+ **
+ ** Copyright (c) 2026 Jolla Ltd.
+ **
+ ** GNU Lesser General Public License Usage
+ ** This file may be used under the terms of the GNU Lesser General Public License
+ ** version 2.1 as published by the Free Software Foundation and appearing in the
+ ** file LICENSE.LGPL included in the packaging of this file.  Please review the
+ ** following information to ensure the GNU Lesser General Public License version
+ ** 2.1 requirements will be met:
+ ** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+ **/
+
+#include "cdtpavatarfetcher.h"
+
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QNetworkAccessManager>
+#include <QNetworkRequest>
+#include <QSaveFile>
+
+#include "cdtpavatarupdate.h"
+#include "cdtpplugin.h"
+#include "debug.h"
+#include "statistics.h"
+
+using namespace Contactsd;
+
+namespace {
+
+const quint32 ValidatorsVersion = 1;
+const int ValidatorsWriteDelay = 5000;
+// An image validated this recently is used without asking the server again
+const int RevalidationInterval = 10 * 60;
+
+QString validatorsFileName()
+{
+    return CDTpPlugin::cacheFileName(QStringLiteral("avatars/validators"));
+}
+
+template<typename Request>
+bool removeRequest(QList<Request> &queue, const QString &key)
+{
+    for (int i = 0; i < queue.count(); ++i) {
+        if (queue.at(i).key == key) {
+            queue.removeAt(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+}
+
+QDataStream &operator<<(QDataStream &stream, const CDTpAvatarFetcher::Validators &validators)
+{
+    return stream << validators.eTag << validators.lastModified << validators.path << validators.validated;
+}
+
+QDataStream &operator>>(QDataStream &stream, CDTpAvatarFetcher::Validators &validators)
+{
+    return stream >> validators.eTag >> validators.lastModified >> validators.path >> validators.validated;
+}
+
+CDTpAvatarFetcher::CDTpAvatarFetcher(QNetworkAccessManager *network, CDTpAvatarStore *avatarStore, QObject *parent)
+    : QObject(parent)
+    , mNetwork(network)
+    , mAvatarStore(avatarStore)
+    , mMaxRequestsPerHost(DefaultMaxRequestsPerHost)
+    , mSequence(0)
+{
+    mValidatorsTimer.setInterval(ValidatorsWriteDelay);
+    mValidatorsTimer.setSingleShot(true);
+    connect(&mValidatorsTimer, &QTimer::timeout, this, &CDTpAvatarFetcher::writeValidators);
+
+    loadValidators();
+}
+
+CDTpAvatarFetcher::~CDTpAvatarFetcher()
+{
+    if (mValidatorsTimer.isActive()) {
+        writeValidators();
+    }
+}
+
+void CDTpAvatarFetcher::setMaxRequestsPerHost(int count)
+{
+    mMaxRequestsPerHost = qMax(1, count);
+
+    foreach (const QString &hostName, mHosts.keys()) {
+        startRequests(hostName);
+    }
+}
+
+void CDTpAvatarFetcher::fetch(const QString &key, const QUrl &url, bool priority, QObject *context,
+                              const CDTpAvatarStore::StoredCallback &callback)
+{
+    dequeue(key);
+
+    Request request;
+    request.key = key;
+    request.url = url;
+    request.sequence = ++mSequence;
+    request.context = context;
+    request.callback = callback;
+    mLatest.insert(key, request.sequence);
+
+    // Skip the network altogether for an image that was just validated
+    const QHash<QString, Validators>::const_iterator it = mValidators.constFind(url.toString());
+    if (it != mValidators.constEnd()
+            && it->validated.isValid()
+            && it->validated.secsTo(QDateTime::currentDateTimeUtc()) < RevalidationInterval
+            && QFile::exists(it->path)) {
+        Statistics::increment(QStringLiteral("telepathy.avatarFetcher.fresh"));
+        const QString path = it->path;
+        QTimer::singleShot(0, this, [this, request, path]() {
+            if (mLatest.value(request.key) == request.sequence) {
+                mLatest.remove(request.key);
+                if (request.context) {
+                    request.callback(path);
+                }
+            }
+        });
+        return;
+    }
+
+    const QString hostName = url.host();
+    Host &host = mHosts[hostName];
+    if (priority) {
+        host.priority.append(request);
+    } else {
+        host.background.append(request);
+    }
+
+    startRequests(hostName);
+}
+
+void CDTpAvatarFetcher::cancel(const QString &key)
+{
+    // A request already running is left to complete, but not delivered
+    dequeue(key);
+    mLatest.remove(key);
+}
+
+void CDTpAvatarFetcher::dequeue(const QString &key)
+{
+    for (QHash<QString, Host>::iterator it = mHosts.begin(); it != mHosts.end(); ++it) {
+        if (removeRequest(it->priority, key) || removeRequest(it->background, key)) {
+            return;
+        }
+    }
+}
+
+void CDTpAvatarFetcher::startRequests(const QString &hostName)
+{
+    QHash<QString, Host>::iterator it = mHosts.find(hostName);
+    if (it == mHosts.end()) {
+        return;
+    }
+
+    while (it->active < mMaxRequestsPerHost) {
+        QList<Request> &queue = it->priority.isEmpty() ? it->background : it->priority;
+        if (queue.isEmpty()) {
+            break;
+        }
+
+        const Request request = queue.takeFirst();
+        if (mLatest.value(request.key) != request.sequence) {
+            continue;
+        }
+
+        ++it->active;
+        start(request);
+    }
+
+    if (it->active == 0) {
+        mHosts.erase(it);
+    }
+}
+
+void CDTpAvatarFetcher::start(const Request &request)
+{
+    QNetworkRequest networkRequest(request.url);
+
+    QString cachedPath;
+    const QHash<QString, Validators>::const_iterator it = mValidators.constFind(request.url.toString());
+    if (it != mValidators.constEnd() && QFile::exists(it->path)) {
+        cachedPath = it->path;
+        if (!it->eTag.isEmpty()) {
+            networkRequest.setRawHeader("If-None-Match", it->eTag);
+        }
+        if (!it->lastModified.isEmpty()) {
+            networkRequest.setRawHeader("If-Modified-Since", it->lastModified);
+        }
+    }
+
+    qCDebug(lcContactsd) << "Fetching avatar" << request.url << (cachedPath.isEmpty() ? "" : "(revalidating)");
+    Statistics::increment(QStringLiteral("telepathy.avatarFetcher.requests"));
+
+    CDTpAvatarUpdate *update = new CDTpAvatarUpdate(mNetwork->get(networkRequest), mAvatarStore,
+                                                    request.key, cachedPath, this);
+    mActive.insert(update, request);
+
+    // The update finishes from the event loop at the earliest
+    connect(update, &CDTpAvatarUpdate::finished, this,
+            [this, update](const QString &avatarPath, const QByteArray &eTag, const QByteArray &lastModified) {
+        updateFinished(update, avatarPath, eTag, lastModified);
+    });
+}
+
+void CDTpAvatarFetcher::updateFinished(CDTpAvatarUpdate *update, const QString &avatarPath,
+                                       const QByteArray &eTag, const QByteArray &lastModified)
+{
+    const QHash<CDTpAvatarUpdate *, Request>::iterator activeIt = mActive.find(update);
+    if (activeIt == mActive.end()) {
+        return;
+    }
+
+    const Request request = *activeIt;
+    mActive.erase(activeIt);
+
+    const QString urlString = request.url.toString();
+    if (!avatarPath.isEmpty()) {
+        Validators &validators = mValidators[urlString];
+        const bool unchanged = (validators.path == avatarPath);
+        if (unchanged) {
+            Statistics::increment(QStringLiteral("telepathy.avatarFetcher.unchanged"));
+        }
+        // A 304 response need not repeat the validators of the image
+        if (!unchanged || !eTag.isEmpty()) {
+            validators.eTag = eTag;
+        }
+        if (!unchanged || !lastModified.isEmpty()) {
+            validators.lastModified = lastModified;
+        }
+        validators.path = avatarPath;
+        validators.validated = QDateTime::currentDateTimeUtc();
+        scheduleValidatorsWrite();
+    } else {
+        Statistics::increment(QStringLiteral("telepathy.avatarFetcher.failures"));
+    }
+
+    if (mLatest.value(request.key) == request.sequence) {
+        mLatest.remove(request.key);
+        if (request.context) {
+            request.callback(avatarPath);
+        }
+    }
+
+    const QString hostName = request.url.host();
+    QHash<QString, Host>::iterator hostIt = mHosts.find(hostName);
+    if (hostIt != mHosts.end()) {
+        --hostIt->active;
+        startRequests(hostName);
+    }
+}
+
+void CDTpAvatarFetcher::loadValidators()
+{
+    QFile file(validatorsFileName());
+    if (!file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+
+    QDataStream stream(&file);
+
+    quint32 version = 0;
+    stream >> version;
+    if (version == ValidatorsVersion) {
+        stream >> mValidators;
+    }
+
+    if (version != ValidatorsVersion || stream.status() != QDataStream::Ok) {
+        // Losing them only costs a download of each image
+        qCWarning(lcContactsd) << "Ignoring invalid avatar validators" << file.fileName();
+        mValidators.clear();
+    }
+}
+
+void CDTpAvatarFetcher::scheduleValidatorsWrite()
+{
+    if (!mValidatorsTimer.isActive()) {
+        mValidatorsTimer.start();
+    }
+}
+
+void CDTpAvatarFetcher::writeValidators()
+{
+    mValidatorsTimer.stop();
+
+    // Forget the images collected from the store meanwhile
+    for (QHash<QString, Validators>::iterator it = mValidators.begin(); it != mValidators.end(); ) {
+        if (QFile::exists(it->path)) {
+            ++it;
+        } else {
+            it = mValidators.erase(it);
+        }
+    }
+
+    const QString fileName = validatorsFileName();
+    if (!QDir::root().mkpath(QFileInfo(fileName).absolutePath())) {
+        qCWarning(lcContactsd) << "Unable to create avatar directory for" << fileName;
+        return;
+    }
+
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qCWarning(lcContactsd) << "Could not open file" << fileName << "for writing:" << file.errorString();
+        return;
+    }
+
+    QDataStream stream(&file);
+    stream << ValidatorsVersion;
+    stream << mValidators;
+
+    if (!file.commit()) {
+        qCWarning(lcContactsd) << "Could not write avatar validators:" << file.errorString();
+    }
+}
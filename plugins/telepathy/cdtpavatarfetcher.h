@@ -0,0 +1,108 @@
+/** This file is part of Contacts daemon
+ **
+ ** Copyright (c) 2026 Jolla Ltd.
+ **
+ ** GNU Lesser General Public License Usage
+ ** This file may be used under the terms of the GNU Lesser General Public License
+ ** version 2.1 as published by the Free Software Foundation and appearing in the
+ ** file LICENSE.LGPL included in the packaging of this file.  Please review the
+ ** following information to ensure the GNU Lesser General Public License version
+ ** 2.1 requirements will be met:
+ ** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+ **/
+
+#ifndef CDTPAVATARFETCHER_H
+#define CDTPAVATARFETCHER_H
+
+#include <QByteArray>
+#include <QDateTime>
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QPointer>
+#include <QString>
+#include <QTimer>
+#include <QUrl>
+
+#include "cdtpavatarstore.h"
+
+class QNetworkAccessManager;
+class CDTpAvatarUpdate;
+
+// Fetches avatar images published on the web into the avatar store.
+//
+// Requests are queued per host and no more than maxRequestsPerHost() of them
+// run at a time against any one host; priority requests are started ahead of
+// the others. The ETag and Last-Modified validators of each image are kept,
+// so that an image already in the store is revalidated with a conditional
+// request rather than downloaded again.
+class CDTpAvatarFetcher : public QObject
+{
+    Q_OBJECT
+
+public:
+    static const int DefaultMaxRequestsPerHost = 2;
+
+    CDTpAvatarFetcher(QNetworkAccessManager *network, CDTpAvatarStore *avatarStore, QObject *parent = 0);
+    ~CDTpAvatarFetcher();
+
+    int maxRequestsPerHost() const { return mMaxRequestsPerHost; }
+    void setMaxRequestsPerHost(int count);
+
+    // Fetches url for key, replacing any request for key still waiting. The
+    // callback is invoked with the path of the stored image, or with an empty
+    // path if it could not be fetched; it is not invoked once context has been
+    // destroyed, nor for a request that has been replaced or cancelled.
+    void fetch(const QString &key, const QUrl &url, bool priority, QObject *context,
+               const CDTpAvatarStore::StoredCallback &callback);
+    void cancel(const QString &key);
+
+private Q_SLOTS:
+    void writeValidators();
+
+private:
+    struct Request {
+        QString key;
+        QUrl url;
+        uint sequence;
+        QPointer<QObject> context;
+        CDTpAvatarStore::StoredCallback callback;
+    };
+
+    struct Host {
+        Host() : active(0) {}
+        int active;
+        QList<Request> priority;
+        QList<Request> background;
+    };
+
+    struct Validators {
+        QByteArray eTag;
+        QByteArray lastModified;
+        QString path;
+        QDateTime validated;
+    };
+
+    void dequeue(const QString &key);
+    void startRequests(const QString &hostName);
+    void start(const Request &request);
+    void updateFinished(CDTpAvatarUpdate *update, const QString &avatarPath,
+                        const QByteArray &eTag, const QByteArray &lastModified);
+    void loadValidators();
+    void scheduleValidatorsWrite();
+
+    friend QDataStream &operator<<(QDataStream &stream, const Validators &validators);
+    friend QDataStream &operator>>(QDataStream &stream, Validators &validators);
+
+    QNetworkAccessManager *mNetwork;
+    QPointer<CDTpAvatarStore> mAvatarStore;
+    int mMaxRequestsPerHost;
+    uint mSequence;
+    QHash<QString, Host> mHosts;
+    QHash<QString, uint> mLatest;                   // key -> sequence of the request to deliver
+    QHash<CDTpAvatarUpdate *, Request> mActive;
+    QHash<QString, Validators> mValidators;         // url -> validators of the stored image
+    QTimer mValidatorsTimer;
+};
+
+#endif // CDTPAVATARFETCHER_H
@@ -0,0 +1,485 @@
+/** This file is part of Contacts daemon
+ **
+ ** Copyright (c) 2026 Jolla Ltd.
+ **
+ ** GNU Lesser General Public License Usage
+ ** This file may be used under the terms of the GNU Lesser General Public License
+ ** version 2.1 as published by the Free Software Foundation and appearing in the
+ ** file LICENSE.LGPL included in the packaging of this file.  Please review the
+ ** following information to ensure the GNU Lesser General Public License version
+ ** 2.1 requirements will be met:
+ ** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+ **/
+
+#include "cdtpavatarstore.h"
+
+#include <QBuffer>
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QTemporaryFile>
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "cdtpavatarwriter.h"
+#include "cdtpplugin.h"
+#include "debug.h"
+#include "statistics.h"
+
+using namespace Contactsd;
+
+namespace {
+
+const quint32 IndexVersion = 1;
+const int IndexWriteDelay = 1000;
+const int GarbageStartupDelay = 5 * 60 * 1000;
+const int GarbageDelay = 60 * 1000;
+const int GarbageStepSize = 32;
+
+const QString IndexFileName = QStringLiteral("index");
+const QString LegacyOwnerPrefix = QStringLiteral("legacy:");
+
+bool isBlobName(const QString &name)
+{
+    // Hex encoded SHA1
+    if (name.length() != 40) {
+        return false;
+    }
+    for (int i = 0; i < name.length(); ++i) {
+        const QChar c = name.at(i);
+        if (!((c >= QLatin1Char('0') && c <= QLatin1Char('9')) || (c >= QLatin1Char('a') && c <= QLatin1Char('f')))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+}
+
+CDTpAvatarStore::CDTpAvatarStore(QObject *parent)
+    : QObject(parent)
+    , mDir(CDTpPlugin::cacheFileName(QStringLiteral("avatars/store")))
+    , mPath(mDir.absolutePath())
+    , mWriter(new CDTpAvatarWriter(this, this))
+    , mSequence(0)
+    , mLiveBytes(0)
+    , mLiveBlobs(0)
+{
+    mIndexTimer.setInterval(IndexWriteDelay);
+    mIndexTimer.setSingleShot(true);
+    connect(&mIndexTimer, &QTimer::timeout, this, &CDTpAvatarStore::writeIndex);
+
+    mGarbageTimer.setSingleShot(true);
+    connect(&mGarbageTimer, &QTimer::timeout, this, &CDTpAvatarStore::collectGarbage);
+
+    mStepTimer.setInterval(0);
+    connect(&mStepTimer, &QTimer::timeout, this, &CDTpAvatarStore::collectGarbageStep);
+
+    connect(mWriter, &CDTpAvatarWriter::written, this, &CDTpAvatarStore::onWritten, Qt::QueuedConnection);
+    mWriter->start(QThread::LowPriority);
+
+    loadIndex();
+
+    // Leave the disk alone while the rosters are synchronized
+    scheduleGarbageCollection(GarbageStartupDelay);
+}
+
+CDTpAvatarStore::~CDTpAvatarStore()
+{
+    mWriter->stop();
+
+    if (mIndexTimer.isActive()) {
+        writeIndex();
+    }
+}
+
+QString CDTpAvatarStore::directory() const
+{
+    return mDir.absolutePath();
+}
+
+QString CDTpAvatarStore::blobPath(const QString &hash) const
+{
+    return mPath + QLatin1Char('/') + hash;
+}
+
+QString CDTpAvatarStore::blobHash(const QString &path) const
+{
+    const QFileInfo info(path);
+    if (info.absolutePath() != mDir.absolutePath() || !isBlobName(info.fileName())) {
+        return QString();
+    }
+    return info.fileName();
+}
+
+QString CDTpAvatarStore::store(const QByteArray &data)
+{
+    return writeBlob(data);
+}
+
+QString CDTpAvatarStore::writeBlob(const QByteArray &data)
+{
+    if (data.isEmpty()) {
+        return QString();
+    }
+
+    const QString hash = QString::fromLatin1(QCryptographicHash::hash(data, QCryptographicHash::Sha1).toHex());
+    const QString path = blobPath(hash);
+
+    // Protect the blob from a collection pass until it has had a chance to be referenced
+    {
+        QMutexLocker locker(&mBlobMutex);
+        mFreshBlobs.insert(hash);
+    }
+
+    const QFileInfo existing(path);
+    if (existing.exists() && existing.size() == data.size()) {
+        Statistics::increment(QStringLiteral("telepathy.avatarStore.bytesDeduplicated"), data.size());
+        return path;
+    }
+
+    if (!QDir::root().mkpath(mPath)) {
+        qCWarning(lcContactsd) << "Unable to create avatar store directory:" << mPath;
+        return QString();
+    }
+
+    QSaveFile blob(path);
+    if (!blob.open(QIODevice::WriteOnly) || blob.write(data) != data.size() || !blob.commit()) {
+        qCWarning(lcContactsd) << "Unable to write avatar" << path << ":" << blob.errorString();
+        return QString();
+    }
+
+    Statistics::increment(QStringLiteral("telepathy.avatarStore.bytesStored"), data.size());
+    return path;
+}
+
+void CDTpAvatarStore::storeLater(const QString &key, const QByteArray &data, QObject *context,
+                                 const StoredCallback &callback)
+{
+    supersede(key);
+
+    PendingWrite pending;
+    pending.sequence = ++mSequence;
+    pending.context = context;
+    pending.callback = callback;
+    mPendingWrites.insert(key, pending);
+
+    // Replace a write still waiting for room in the writer queue
+    for (int i = 0; i < mDeferredWrites.count(); ++i) {
+        DeferredWrite &deferred = mDeferredWrites[i];
+        if (deferred.key == key) {
+            deferred.sequence = pending.sequence;
+            deferred.data = data;
+            return;
+        }
+    }
+
+    if (!mDeferredWrites.isEmpty() || !mWriter->enqueue(key, pending.sequence, data)) {
+        // The writer is behind; hand this one over as the queue drains
+        Statistics::increment(QStringLiteral("telepathy.avatarWriter.deferred"));
+        DeferredWrite deferred;
+        deferred.key = key;
+        deferred.sequence = pending.sequence;
+        deferred.data = data;
+        mDeferredWrites.append(deferred);
+        Statistics::setGauge(QStringLiteral("telepathy.avatarWriter.deferredDepth"), mDeferredWrites.count());
+    }
+}
+
+void CDTpAvatarStore::cancel(const QString &key)
+{
+    if (mWriter->dequeue(key)) {
+        enqueueDeferred();
+    } else {
+        for (int i = 0; i < mDeferredWrites.count(); ++i) {
+            if (mDeferredWrites.at(i).key == key) {
+                mDeferredWrites.removeAt(i);
+                Statistics::setGauge(QStringLiteral("telepathy.avatarWriter.deferredDepth"), mDeferredWrites.count());
+                break;
+            }
+        }
+    }
+    supersede(key);
+}
+
+void CDTpAvatarStore::enqueueDeferred()
+{
+    while (!mDeferredWrites.isEmpty()) {
+        const DeferredWrite &deferred = mDeferredWrites.first();
+        if (!mWriter->enqueue(deferred.key, deferred.sequence, deferred.data)) {
+            break;
+        }
+        mDeferredWrites.removeFirst();
+    }
+    Statistics::setGauge(QStringLiteral("telepathy.avatarWriter.deferredDepth"), mDeferredWrites.count());
+}
+
+void CDTpAvatarStore::supersede(const QString &key)
+{
+    QHash<QString, PendingWrite>::iterator it = mPendingWrites.find(key);
+    if (it == mPendingWrites.end()) {
+        return;
+    }
+
+    const PendingWrite pending = *it;
+    mPendingWrites.erase(it);
+
+    if (pending.context) {
+        pending.callback(QString());
+    }
+}
+
+void CDTpAvatarStore::onWritten(const QString &key, uint sequence, const QString &path)
+{
+    // The writer has made room in its queue
+    if (!mDeferredWrites.isEmpty()) {
+        enqueueDeferred();
+    }
+
+    QHash<QString, PendingWrite>::iterator it = mPendingWrites.find(key);
+    if (it == mPendingWrites.end() || it->sequence != sequence) {
+        // Superseded; the callback has been invoked already
+        return;
+    }
+
+    const PendingWrite pending = *it;
+    mPendingWrites.erase(it);
+
+    if (pending.context) {
+        pending.callback(path);
+    }
+}
+
+void CDTpAvatarStore::reference(const QString &owner, const QString &path)
+{
+    const QString hash = blobHash(path);
+    const QString previous = mOwners.value(owner);
+    if (hash == previous) {
+        return;
+    }
+
+    if (hash.isEmpty()) {
+        mOwners.remove(owner);
+    } else {
+        mOwners.insert(owner, hash);
+        ++mReferences[hash];
+    }
+
+    if (!previous.isEmpty()) {
+        dereference(previous);
+    }
+
+    scheduleIndexWrite();
+}
+
+void CDTpAvatarStore::release(const QString &owner)
+{
+    reference(owner, QString());
+}
+
+void CDTpAvatarStore::releaseAll(const QString &prefix)
+{
+    QStringList owners;
+    for (QHash<QString, QString>::const_iterator it = mOwners.constBegin(); it != mOwners.constEnd(); ++it) {
+        if (it.key().startsWith(prefix)) {
+            owners.append(it.key());
+        }
+    }
+
+    foreach (const QString &owner, owners) {
+        release(owner);
+    }
+}
+
+void CDTpAvatarStore::dereference(const QString &hash)
+{
+    QHash<QString, int>::iterator it = mReferences.find(hash);
+    if (it == mReferences.end()) {
+        return;
+    }
+
+    if (--(*it) <= 0) {
+        mReferences.erase(it);
+        scheduleGarbageCollection(GarbageDelay);
+    }
+}
+
+void CDTpAvatarStore::loadIndex()
+{
+    bool valid = false;
+
+    QFile file(mDir.absoluteFilePath(IndexFileName));
+    if (file.open(QIODevice::ReadOnly)) {
+        QDataStream stream(&file);
+
+        quint32 version = 0;
+        stream >> version;
+        if (version == IndexVersion) {
+            stream >> mOwners;
+            valid = (stream.status() == QDataStream::Ok);
+        }
+
+        if (!valid) {
+            qCWarning(lcContactsd) << "Ignoring invalid avatar store index" << file.fileName();
+            mOwners.clear();
+        }
+    }
+
+    for (QHash<QString, QString>::const_iterator it = mOwners.constBegin(); it != mOwners.constEnd(); ++it) {
+        ++mReferences[it.value()];
+    }
+
+    if (!valid) {
+        // Without a usable index there is no telling which blobs are still in use,
+        // so the existing ones are kept for good under placeholder owners
+        QDirIterator it(mDir.absolutePath(), QDir::Files);
+        while (it.hasNext()) {
+            it.next();
+            const QString hash = it.fileName();
+            if (isBlobName(hash)) {
+                mOwners.insert(LegacyOwnerPrefix + hash, hash);
+                ++mReferences[hash];
+            }
+        }
+
+        scheduleIndexWrite();
+    }
+}
+
+void CDTpAvatarStore::scheduleIndexWrite()
+{
+    if (!mIndexTimer.isActive()) {
+        mIndexTimer.start();
+    }
+}
+
+void CDTpAvatarStore::writeIndex()
+{
+    mIndexTimer.stop();
+
+    const QString indexFileName = mDir.absoluteFilePath(IndexFileName);
+
+    if (!mDir.exists() && !QDir::root().mkpath(mDir.absolutePath())) {
+        qCWarning(lcContactsd) << "Unable to create avatar store directory:" << mDir.path();
+        return;
+    }
+
+    QByteArray data;
+    QBuffer buffer(&data);
+    buffer.open(QIODevice::WriteOnly);
+
+    QDataStream stream(&buffer);
+    stream << IndexVersion;
+    stream << mOwners;
+    buffer.close();
+
+    // The index must never be lost, or referenced blobs could be collected
+    QTemporaryFile tempFile(indexFileName);
+    tempFile.setAutoRemove(false);
+
+    if (!tempFile.open()) {
+        qCWarning(lcContactsd) << "Could not open file" << tempFile.fileName()
+                               << "for writing:" << tempFile.errorString();
+        tempFile.setAutoRemove(true);
+        return;
+    }
+
+    if (tempFile.write(data) != data.size()
+            || !tempFile.flush()
+            || (::fsync(tempFile.handle()) != 0)
+            || (tempFile.close(), false)) {
+        qCWarning(lcContactsd) << "Could not write avatar store index:" << tempFile.errorString();
+        tempFile.setAutoRemove(true);
+        return;
+    }
+
+    if (::rename(tempFile.fileName().toLocal8Bit(), indexFileName.toLocal8Bit()) != 0) {
+        qCWarning(lcContactsd) << "Could not write avatar store index:" << strerror(errno);
+        tempFile.setAutoRemove(true);
+        return;
+    }
+}
+
+void CDTpAvatarStore::scheduleGarbageCollection(int delay)
+{
+    if (!mGarbageTimer.isActive()) {
+        mGarbageTimer.start(delay);
+    }
+}
+
+void CDTpAvatarStore::collectGarbage()
+{
+    if (mGarbageIterator) {
+        // Blobs released during a pass may have been visited already
+        scheduleGarbageCollection(GarbageDelay);
+        return;
+    }
+
+    if (!mDir.exists()) {
+        return;
+    }
+
+    qCDebug(lcContactsd) << "Collecting unreferenced avatars in" << mDir.path();
+
+    {
+        QMutexLocker locker(&mBlobMutex);
+        mPreviousBlobs = mFreshBlobs;
+        mFreshBlobs.clear();
+    }
+    mLiveBytes = 0;
+    mLiveBlobs = 0;
+
+    mGarbageIterator.reset(new QDirIterator(mDir.absolutePath(), QDir::Files));
+    mStepTimer.start();
+}
+
+void CDTpAvatarStore::collectGarbageStep()
+{
+    qint64 reclaimed = 0;
+
+    for (int i = 0; i < GarbageStepSize && mGarbageIterator->hasNext(); ++i) {
+        mGarbageIterator->next();
+
+        const QString hash = mGarbageIterator->fileName();
+        if (!isBlobName(hash)) {
+            continue;
+        }
+
+        // The writer thread must not find the blob in place while it is being removed
+        QMutexLocker locker(&mBlobMutex);
+
+        const qint64 size = mGarbageIterator->fileInfo().size();
+        if (mReferences.contains(hash) || mFreshBlobs.contains(hash) || mPreviousBlobs.contains(hash)) {
+            mLiveBytes += size;
+            ++mLiveBlobs;
+        } else if (QFile::remove(mGarbageIterator->filePath())) {
+            reclaimed += size;
+        } else {
+            qCWarning(lcContactsd) << "Unable to remove unreferenced avatar" << mGarbageIterator->filePath();
+        }
+    }
+
+    if (reclaimed > 0) {
+        Statistics::increment(QStringLiteral("telepathy.avatarStore.bytesReclaimed"), reclaimed);
+    }
+
+    if (!mGarbageIterator->hasNext()) {
+        mStepTimer.stop();
+        mGarbageIterator.reset();
+        {
+            QMutexLocker locker(&mBlobMutex);
+            mPreviousBlobs.clear();
+        }
+
+        Statistics::setGauge(QStringLiteral("telepathy.avatarStore.blobs"), mLiveBlobs);
+        Statistics::setGauge(QStringLiteral("telepathy.avatarStore.bytes"), mLiveBytes);
+        qCDebug(lcContactsd) << "Avatar store holds" << mLiveBlobs << "blobs," << mLiveBytes << "bytes";
+    }
+}
@@ -0,0 +1,129 @@
+/** This file is part of Contacts daemon
+ **
+ ** Copyright (c) 2026 Jolla Ltd.
+ **
+ ** GNU Lesser General Public License Usage
+ ** This file may be used under the terms of the GNU Lesser General Public License
+ ** version 2.1 as published by the Free Software Foundation and appearing in the
+ ** file LICENSE.LGPL included in the packaging of this file.  Please review the
+ ** following information to ensure the GNU Lesser General Public License version
+ ** 2.1 requirements will be met:
+ ** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+ **/
+
+#ifndef CDTPAVATARSTORE_H
+#define CDTPAVATARSTORE_H
+
+#include <QByteArray>
+#include <QDir>
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QObject>
+#include <QPointer>
+#include <QScopedPointer>
+#include <QSet>
+#include <QString>
+#include <QTimer>
+
+#include <functional>
+
+class QDirIterator;
+class CDTpAvatarWriter;
+
+// Content addressed storage for the avatar images written by the plugin.
+//
+// Each blob is named by the SHA1 of its data, so identical avatars are stored
+// once and existing blobs are never rewritten. Owners, such as the self
+// contact of an account or an IM contact, reference the blob their avatar
+// detail points at; the references are persisted in an index next to the
+// blobs. Blobs left without references are removed by a garbage collection
+// pass that runs in small steps from the event loop.
+//
+// Blobs are normally written by a CDTpAvatarWriter thread; the path is
+// posted back to the main thread once the blob is in place. Writes beyond the
+// writer's queue depth wait on the main thread, without blocking it, until
+// the writer has made room.
+class CDTpAvatarStore : public QObject
+{
+    Q_OBJECT
+
+public:
+    typedef std::function<void (const QString &path)> StoredCallback;
+
+    explicit CDTpAvatarStore(QObject *parent = 0);
+    ~CDTpAvatarStore();
+
+    // Returns the path of the blob holding data, writing it if it does not exist
+    QString store(const QByteArray &data);
+
+    // Stores data from the writer thread. The callback is invoked on the main
+    // thread with the path of the blob, or with an empty path if the write
+    // failed or was superseded by a later one with the same key; it is not
+    // invoked once context has been destroyed.
+    void storeLater(const QString &key, const QByteArray &data, QObject *context, const StoredCallback &callback);
+    void cancel(const QString &key);
+
+    // Thread safe part of store()
+    QString writeBlob(const QByteArray &data);
+
+    // Points owner at the blob at path, releasing the blob it referenced before.
+    // A path outside the store only releases the previous reference.
+    void reference(const QString &owner, const QString &path);
+    void release(const QString &owner);
+    // Releases the references of every owner whose name starts with prefix
+    void releaseAll(const QString &prefix);
+
+    QString directory() const;
+
+public Q_SLOTS:
+    void collectGarbage();
+
+private Q_SLOTS:
+    void collectGarbageStep();
+    void writeIndex();
+    void onWritten(const QString &key, uint sequence, const QString &path);
+
+private:
+    QString blobPath(const QString &hash) const;
+    QString blobHash(const QString &path) const;
+    void dereference(const QString &hash);
+    void loadIndex();
+    void scheduleIndexWrite();
+    void scheduleGarbageCollection(int delay);
+
+    struct PendingWrite {
+        uint sequence;
+        QPointer<QObject> context;
+        StoredCallback callback;
+    };
+
+    struct DeferredWrite {
+        QString key;
+        uint sequence;
+        QByteArray data;
+    };
+
+    void supersede(const QString &key);
+    void enqueueDeferred();
+
+    const QDir mDir;
+    const QString mPath;
+    CDTpAvatarWriter *mWriter;
+    QHash<QString, PendingWrite> mPendingWrites;
+    QList<DeferredWrite> mDeferredWrites;   // waiting for room in the writer queue
+    uint mSequence;
+    QMutex mBlobMutex;                      // guards the fresh blobs, which the writer adds to
+    QHash<QString, QString> mOwners;        // owner -> blob hash
+    QHash<QString, int> mReferences;        // blob hash -> number of owners
+    QSet<QString> mFreshBlobs;              // written since the current collection started
+    QSet<QString> mPreviousBlobs;           // written before that, during the previous one
+    QTimer mIndexTimer;
+    QTimer mGarbageTimer;
+    QTimer mStepTimer;
+    QScopedPointer<QDirIterator> mGarbageIterator;
+    qint64 mLiveBytes;
+    int mLiveBlobs;
+};
+
+#endif // CDTPAVATARSTORE_H
@@ -24,7 +24,7 @@
 
 
 #include "cdtpavatarupdate.h"
-#include "cdtpplugin.h"
+#include "cdtpavatarstore.h"
 #include "debug.h"
 
 using namespace Contactsd;
@@ -32,23 +32,25 @@ using namespace Contactsd;
 const QString CDTpAvatarUpdate::Large = QLatin1String("large");
 const QString CDTpAvatarUpdate::Square = QLatin1String("square");
 
-void CDTpAvatarUpdate::updateContact(CDTpContact *contactWrapper, QNetworkReply *networkReply,
-                                     const QString &filename, const QString &avatarType)
-{
-    (void) new CDTpAvatarUpdate(networkReply, contactWrapper, filename, avatarType);
-}
-
 CDTpAvatarUpdate::CDTpAvatarUpdate(QNetworkReply *networkReply,
-                                   CDTpContact *contactWrapper,
-                                   const QString &filename,
-                                   const QString &avatarType)
-    : QObject()
+                                   CDTpAvatarStore *avatarStore,
+                                   const QString &key,
+                                   const QString &cachedPath,
+                                   QObject *parent)
+    : QObject(parent)
     , mNetworkReply(0)
-    , mContactWrapper(contactWrapper)
-    , mFilename(filename)
-    , mAvatarType(avatarType)
+    , mAvatarStore(avatarStore)
+    , mKey(key)
+    , mCachedPath(cachedPath)
+    , mWritePending(false)
+    , mFinished(false)
 {
-    setNetworkReply(networkReply);
+    if (networkReply) {
+        setNetworkReply(networkReply);
+    } else {
+        // Never finish before the caller has had a chance to connect
+        QMetaObject::invokeMethod(this, "onRequestDone", Qt::QueuedConnection);
+    }
 }
 
 void CDTpAvatarUpdate::setNetworkReply(QNetworkReply *networkReply)
@@ -65,11 +67,12 @@ void CDTpAvatarUpdate::setNetworkReply(QNetworkReply *networkReply)
             connect(mNetworkReply, SIGNAL(finished()), this, SLOT(onRequestDone()));
             connect(mNetworkReply, SIGNAL(error(QNetworkReply::NetworkError)), this, SLOT(onRequestDone()));
         } else {
-            onRequestDone();
+            // An offline network access manager returns replies that have finished already
+            QMetaObject::invokeMethod(this, "onRequestDone", Qt::QueuedConnection);
         }
-    } else {
+    } else if (!mWritePending) {
         // This operation is complete
-        this->deleteLater();
+        finish(QString());
     }
 }
 
@@ -77,88 +80,62 @@ void CDTpAvatarUpdate::onRequestDone()
 {
     QNetworkReply *newReply = nullptr;
 
-    if (mNetworkReply && mNetworkReply->error() == QNetworkReply::NoError) {
-        newReply = updateContactAvatar();
+    if (mNetworkReply) {
+        if (mNetworkReply->error() == QNetworkReply::NoError) {
+            newReply = updateAvatar();
+        } else {
+            qCDebug(lcContactsd) << "Unable to fetch avatar" << mNetworkReply->url() << mNetworkReply->errorString();
+        }
     }
 
     setNetworkReply(newReply);
 }
 
-QString CDTpAvatarUpdate::writeAvatarFile(QFile &avatarFile, const QDir &cacheDir)
+QNetworkReply *CDTpAvatarUpdate::updateAvatar()
 {
-    if (!cacheDir.exists() && !QDir::root().mkpath(cacheDir.absolutePath())) {
-        qCWarning(lcContactsd) << "Could not create large avatar cache dir:" << cacheDir.path();
-        return QString();
+    const QUrl redirectionTarget = mNetworkReply->attribute(QNetworkRequest::RedirectionTargetAttribute).toUrl();
+    if (!redirectionTarget.isEmpty()) {
+        // Keep the conditional headers of the original request
+        QNetworkRequest request(mNetworkReply->request());
+        request.setUrl(mNetworkReply->url().resolved(redirectionTarget));
+        return mNetworkReply->manager()->get(request);
     }
 
-    QTemporaryFile tempFile(cacheDir.absoluteFilePath(QLatin1String("pinkpony")));
-    const QByteArray data = mNetworkReply->readAll();
-
-    if (tempFile.open() && data.count() == tempFile.write(data)) {
-        tempFile.close();
-
-        if (avatarFile.exists()) {
-            avatarFile.remove();
-        }
+    const QByteArray eTag = mNetworkReply->rawHeader("ETag");
+    const QByteArray lastModified = mNetworkReply->rawHeader("Last-Modified");
 
-        if (tempFile.rename(avatarFile.fileName())) {
-            tempFile.setAutoRemove(false);
-            return avatarFile.fileName();
-        }
+    if (mNetworkReply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() == 304) {
+        finish(mCachedPath, eTag, lastModified);
+        return nullptr;
     }
 
-    return QString();
-}
-
-static bool acceptFileSize(qint64 actualFileSize, qint64 expectedFileSize)
-{
-    if (expectedFileSize > 0) {
-        return (actualFileSize == expectedFileSize);
+    if (mAvatarStore.isNull()) {
+        return nullptr;
     }
 
-    return actualFileSize > 0;
-}
-
-QNetworkReply *CDTpAvatarUpdate::updateContactAvatar()
-{
-    // Build filename from the image URL's SHA1 hash.
-    const QUrl redirectionTarget = mNetworkReply->attribute(QNetworkRequest::RedirectionTargetAttribute).toUrl();
-    const QString avatarUrl = (!redirectionTarget.isEmpty() ? mNetworkReply->url().resolved(redirectionTarget)
-                                                            : mNetworkReply->url()).toString();
-
-    QString filename(mFilename);
-    if (filename.isEmpty()) {
-        QByteArray avatarHash = QCryptographicHash::hash(avatarUrl.toUtf8(), QCryptographicHash::Sha1);
-        filename = QString::fromLatin1(avatarHash.toHex());
+    const QByteArray data = mNetworkReply->readAll();
+    if (data.isEmpty()) {
+        return nullptr;
     }
 
-    const QDir cacheDir(CDTpPlugin::cacheFileName(QLatin1String("avatars")));
-    QFile avatarFile(cacheDir.absoluteFilePath(filename));
+    // The store names the file by its content, and keeps the existing file if the image is unchanged
+    mWritePending = true;
+    mAvatarStore->storeLater(mKey, data, this, [this, eTag, lastModified](const QString &avatarPath) {
+        mWritePending = false;
+        finish(avatarPath, eTag, lastModified);
+    });
 
-    // Check for existing avatar file and its size to see if we need to fetch from network.
-    const qint64 contentLength = mNetworkReply->header(QNetworkRequest::ContentLengthHeader).toLongLong();
-
-    QString avatarPath;
-    if (avatarFile.exists() && acceptFileSize(avatarFile.size(), contentLength)) {
-        // Seems we can reuse the existing avatar file.
-        avatarPath = avatarFile.fileName();
-    } else {
-        if (!redirectionTarget.isEmpty()) {
-            return mNetworkReply->manager()->get(QNetworkRequest(redirectionTarget));
-        }
-
-        avatarPath = writeAvatarFile(avatarFile, cacheDir);
-    }
+    // No further network requests
+    return nullptr;
+}
 
-    // Update the contact if a new avatar is available.
-    if (!avatarPath.isEmpty() && !mContactWrapper.isNull()) {
-        if (mAvatarType == Square) {
-            mContactWrapper->setSquareAvatarPath(avatarPath);
-        } else if (mAvatarType == Large) {
-            mContactWrapper->setLargeAvatarPath(avatarPath);
-        }
+void CDTpAvatarUpdate::finish(const QString &avatarPath, const QByteArray &eTag, const QByteArray &lastModified)
+{
+    if (mFinished) {
+        return;
     }
 
-    // No further work to do
-    return nullptr;
+    mFinished = true;
+    Q_EMIT finished(avatarPath, eTag, lastModified);
+    deleteLater();
 }
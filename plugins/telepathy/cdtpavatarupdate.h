@@ -26,12 +26,16 @@
 #ifndef CDTPAVATARREQUEST_H
 #define CDTPAVATARREQUEST_H
 
-#include <QDir>
+#include <QByteArray>
+#include <QPointer>
 #include <QString>
 #include <QNetworkReply>
 
-#include "cdtpcontact.h"
+class CDTpAvatarStore;
 
+// Downloads one avatar image into the avatar store, following redirects.
+// A conditional request answered with 304 Not Modified yields the cached
+// path it was made for. The object deletes itself once finished.
 class CDTpAvatarUpdate : public QObject
 {
     Q_OBJECT
@@ -40,24 +44,30 @@ public:
     static const QString Large;
     static const QString Square;
 
-    static void updateContact(CDTpContact *contactWrapper, QNetworkReply *networkReply, const QString &filename,
-                              const QString &avatarType = Large);
+    CDTpAvatarUpdate(QNetworkReply *networkReply, CDTpAvatarStore *avatarStore, const QString &key,
+                     const QString &cachedPath = QString(), QObject *parent = 0);
+
+Q_SIGNALS:
+    // avatarPath is empty if no avatar could be fetched; the validators are
+    // those reported by the server, if any
+    void finished(const QString &avatarPath, const QByteArray &eTag, const QByteArray &lastModified);
 
 private slots:
     void onRequestDone();
 
 private:
-    CDTpAvatarUpdate(QNetworkReply *networkReply, CDTpContact *contactWrapper, const QString &filename, const QString &avatarType);
-
     void setNetworkReply(QNetworkReply *networkReply);
-    QString writeAvatarFile(QFile &avatarFile, const QDir &cacheDir);
-    QNetworkReply *updateContactAvatar();
+    QNetworkReply *updateAvatar();
+    void finish(const QString &avatarPath, const QByteArray &eTag = QByteArray(),
+                const QByteArray &lastModified = QByteArray());
 
 private:
     QPointer<QNetworkReply> mNetworkReply;
-    QPointer<CDTpContact> mContactWrapper;
-    const QString mFilename;
-    const QString mAvatarType;
+    QPointer<CDTpAvatarStore> mAvatarStore;
+    const QString mKey;
+    const QString mCachedPath;
+    bool mWritePending;
+    bool mFinished;
 };
 
 #endif // CDTPAVATARREQUEST_H
@@ -0,0 +1,120 @@
+/** This file is part of Contacts daemon
+ **
+ ** Copyright (c) 2026 Jolla Ltd.
+ **
+ ** GNU Lesser General Public License Usage
+ ** This file may be used under the terms of the GNU Lesser General Public License
+ ** version 2.1 as published by the Free Software Foundation and appearing in the
+ ** file LICENSE.LGPL included in the packaging of this file.  Please review the
+ ** following information to ensure the GNU Lesser General Public License version
+ ** 2.1 requirements will be met:
+ ** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+ **/
+
+#include "cdtpavatarwriter.h"
+
+#include <QMutexLocker>
+
+#include "cdtpavatarstore.h"
+#include "debug.h"
+#include "statistics.h"
+
+using namespace Contactsd;
+
+CDTpAvatarWriter::CDTpAvatarWriter(CDTpAvatarStore *store, QObject *parent)
+    : QThread(parent)
+    , mStore(store)
+    , mStopping(false)
+{
+}
+
+CDTpAvatarWriter::~CDTpAvatarWriter()
+{
+    stop();
+}
+
+bool CDTpAvatarWriter::enqueue(const QString &key, uint sequence, const QByteArray &data)
+{
+    QMutexLocker locker(&mMutex);
+
+    Job *job = 0;
+    for (int i = 0; i < mQueue.count(); ++i) {
+        if (mQueue.at(i).key == key) {
+            job = &mQueue[i];
+            Statistics::increment(QStringLiteral("telepathy.avatarWriter.coalesced"));
+            break;
+        }
+    }
+
+    if (!job) {
+        if (mQueue.count() >= MaxQueueDepth) {
+            return false;
+        }
+        mQueue.append(Job());
+        job = &mQueue.last();
+        job->key = key;
+        job->queued.start();
+    }
+
+    job->sequence = sequence;
+    job->data = data;
+
+    Statistics::setGauge(QStringLiteral("telepathy.avatarWriter.queueDepth"), mQueue.count());
+    mCondition.wakeOne();
+    return true;
+}
+
+bool CDTpAvatarWriter::dequeue(const QString &key)
+{
+    QMutexLocker locker(&mMutex);
+
+    for (int i = 0; i < mQueue.count(); ++i) {
+        if (mQueue.at(i).key == key) {
+            mQueue.removeAt(i);
+            Statistics::setGauge(QStringLiteral("telepathy.avatarWriter.queueDepth"), mQueue.count());
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void CDTpAvatarWriter::stop()
+{
+    {
+        QMutexLocker locker(&mMutex);
+        mStopping = true;
+        if (!mQueue.isEmpty()) {
+            qCDebug(lcContactsd) << "Dropping" << mQueue.count() << "queued avatar writes";
+            mQueue.clear();
+        }
+        mCondition.wakeOne();
+    }
+
+    wait();
+}
+
+void CDTpAvatarWriter::run()
+{
+    QMutexLocker locker(&mMutex);
+
+    while (true) {
+        while (mQueue.isEmpty() && !mStopping) {
+            mCondition.wait(&mMutex);
+        }
+        if (mStopping) {
+            break;
+        }
+
+        const Job job = mQueue.takeFirst();
+        Statistics::setGauge(QStringLiteral("telepathy.avatarWriter.queueDepth"), mQueue.count());
+
+        locker.unlock();
+
+        const QString path = mStore->writeBlob(job.data);
+        Statistics::record(QStringLiteral("telepathy.avatarWriter.latency"), job.queued.elapsed());
+        Q_EMIT written(job.key, job.sequence, path);
+
+        locker.relock();
+    }
+}
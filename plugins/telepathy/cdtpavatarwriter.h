@@ -0,0 +1,72 @@
+/** This file is part of Contacts daemon
+ **
+ ** Copyright (c) 2026 Jolla Ltd.
+ **
+ ** GNU Lesser General Public License Usage
+ ** This file may be used under the terms of the GNU Lesser General Public License
+ ** version 2.1 as published by the Free Software Foundation and appearing in the
+ ** file LICENSE.LGPL included in the packaging of this file.  Please review the
+ ** following information to ensure the GNU Lesser General Public License version
+ ** 2.1 requirements will be met:
+ ** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+ **/
+
+#ifndef CDTPAVATARWRITER_H
+#define CDTPAVATARWRITER_H
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QList>
+#include <QMutex>
+#include <QString>
+#include <QThread>
+#include <QWaitCondition>
+
+class CDTpAvatarStore;
+
+// Hashes avatar data and writes it into the avatar store from a thread of its
+// own, so that large avatars on slow storage do not hold up Telepathy and
+// D-Bus processing. Queued writes are identified by a key; a write replaces
+// any queued one with the same key, and no more than MaxQueueDepth writes
+// wait at a time.
+class CDTpAvatarWriter : public QThread
+{
+    Q_OBJECT
+
+public:
+    static const int MaxQueueDepth = 16;
+
+    explicit CDTpAvatarWriter(CDTpAvatarStore *store, QObject *parent = 0);
+    ~CDTpAvatarWriter();
+
+    // Returns false if the queue is full
+    bool enqueue(const QString &key, uint sequence, const QByteArray &data);
+    // Returns true if a queued write was dropped before it started
+    bool dequeue(const QString &key);
+
+    // Finishes the write in progress and drops the rest
+    void stop();
+
+Q_SIGNALS:
+    // Emitted from the writer thread; path is empty if the write failed
+    void written(const QString &key, uint sequence, const QString &path);
+
+protected:
+    void run();
+
+private:
+    struct Job {
+        QString key;
+        uint sequence;
+        QByteArray data;
+        QElapsedTimer queued;
+    };
+
+    CDTpAvatarStore *mStore;
+    QMutex mMutex;
+    QWaitCondition mCondition;
+    QList<Job> mQueue;
+    bool mStopping;
+};
+
+#endif // CDTPAVATARWRITER_H
@@ -108,6 +108,23 @@ CDTpContact::Info::Info(const CDTpContact *contact)
     d->isVisible = contact->isVisible();
 }
 
+CDTpContact::Info::Info(const QString &alias, const Tp::Presence &presence, Capabilities capabilities,
+                        const QString &avatarPath, const Tp::ContactInfoFieldList &infoFields)
+    : d(new CDTpContact::InfoData)
+{
+    d->alias = alias;
+    d->presence = presence;
+    d->capabilities = capabilities;
+    d->avatarPath = avatarPath;
+    d->subscriptionState = Tp::Contact::PresenceStateYes;
+    d->publishState = Tp::Contact::PresenceStateYes;
+    d->infoFields = infoFields;
+    d->isSubscriptionStateKnown = true;
+    d->isPublishStateKnown = true;
+    d->isContactInfoKnown = true;
+    d->isVisible = true;
+}
+
 CDTpContact::Info::Info(const CDTpContact::Info &other)
     : d(other.d)
 {
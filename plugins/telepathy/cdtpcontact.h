@@ -78,6 +78,9 @@ public:
     public:
         Info();
         Info(const CDTpContact *contact);
+        // For tests and benchmarks, which have no telepathy contact
+        Info(const QString &alias, const Tp::Presence &presence, Capabilities capabilities,
+             const QString &avatarPath, const Tp::ContactInfoFieldList &infoFields);
 
         Info(const Info &other);
         Info& operator=(const Info &other);
@@ -34,6 +34,7 @@
 #include "buddymanagementadaptor.h"
 #include "cdtpcontroller.h"
 #include "debug.h"
+#include "startup-timeline.h"
 
 const QLatin1String DBusObjectPath("/telepathy");
 static const QString offlineRemovals = QString::fromLatin1("OfflineRemovals");
@@ -70,6 +71,7 @@ CDTpController::CDTpController(QObject *parent)
             channelFactory, contactFactory);
 
     // Wait for AM to become ready
+    Contactsd::StartupTimeline::begin(QStringLiteral("telepathy"), QStringLiteral("account manager ready"));
     connect(mAM->becomeReady(Tp::AccountManager::FeatureCore), &Tp::PendingReady::finished,
             this, &CDTpController::onAccountManagerReady);
 
@@ -83,8 +85,34 @@ CDTpController::~CDTpController()
     QDBusConnection::sessionBus().unregisterObject(DBusObjectPath);
 }
 
+bool CDTpController::isIdle() const
+{
+    // Rosters of enabled accounts are followed while they are online, so the daemon
+    // stays resident; accounts added meanwhile are synced on the next start.
+    if (!mAccountSet || mStorage.isImporting()) {
+        return false;
+    }
+
+    Q_FOREACH (const CDTpAccountPtr &accountWrapper, mAccounts) {
+        if (accountWrapper->isEnabled()) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void CDTpController::releaseCaches()
+{
+    Q_FOREACH (const CDTpAccountPtr &accountWrapper, mAccounts) {
+        accountWrapper->releaseRosterCache();
+    }
+}
+
 void CDTpController::onAccountManagerReady(Tp::PendingOperation *op)
 {
+    Contactsd::StartupTimeline::end(QStringLiteral("telepathy"), QStringLiteral("account manager ready"));
+
     if (op->isError()) {
         qCDebug(lcContactsd) << "Could not make account manager ready:" << op->errorName()
                              << "-" << op->errorMessage();
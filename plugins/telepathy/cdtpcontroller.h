@@ -44,6 +44,9 @@ public:
     CDTpController(QObject *parent = 0);
     ~CDTpController();
 
+    bool isIdle() const;
+    void releaseCaches();
+
 Q_SIGNALS:
     void importStarted(const QString &service, const QString &account);
     void importEnded(const QString &service, const QString &account, int contactsAdded, int contactsRemoved, int contactsMerged);
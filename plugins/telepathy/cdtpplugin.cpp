@@ -59,11 +59,14 @@ void CDTpPlugin::init()
             this, &CDTpPlugin::error);
 }
 
-CDTpPlugin::MetaData CDTpPlugin::metaData()
+bool CDTpPlugin::isIdle() const
 {
-    MetaData data;
-    data[metaDataKeyName]    = QVariant(QString::fromLatin1("telepathy"));
-    data[metaDataKeyVersion] = QVariant(QString::fromLatin1("0.2"));
-    data[metaDataKeyComment] = QVariant(QString::fromLatin1("contactsd telepathy plugin"));
-    return data;
+    return mController && mController->isIdle();
+}
+
+void CDTpPlugin::releaseCaches()
+{
+    if (mController) {
+        mController->releaseCaches();
+    }
 }
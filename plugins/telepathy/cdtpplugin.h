@@ -36,14 +36,15 @@ class CDTpController;
 class CDTpPlugin : public Contactsd::BasePlugin
 {
     Q_OBJECT
-    Q_PLUGIN_METADATA(IID "org.nemomobile.contactsd.telepathy")
+    Q_PLUGIN_METADATA(IID "org.nemomobile.contactsd.telepathy" FILE "telepathy.json")
 
 public:
     CDTpPlugin();
     ~CDTpPlugin();
 
     void init();
-    MetaData metaData();
+    bool isIdle() const;
+    void releaseCaches();
 
 private:
     CDTpController *mController;
@@ -50,6 +50,7 @@
 #include <QContactBirthday>
 #include <QContactDisplayLabel>
 #include <QContactEmailAddress>
+#include <QContactFavorite>
 #include <QContactGender>
 #include <QContactGlobalPresence>
 #include <QContactName>
@@ -63,10 +64,15 @@
 #include <QContactUrl>
 
 #include "cdtpstorage.h"
+#include "cdtpstoragehelpers.h"
+#include "cdtpavatarstore.h"
 #include "cdtpavatarupdate.h"
 #include "cdtpplugin.h"
 #include "cdtpdevicepresence.h"
 #include "debug.h"
+#include "startup-timeline.h"
+#include "statistics.h"
+#include "task-scheduler.h"
 
 #include <QElapsedTimer>
 
@@ -101,53 +107,6 @@ QString asString(bool f)
     return QLatin1String(f ? "true" : "false");
 }
 
-QString asString(const Tp::ContactInfoField &field, int i)
-{
-    if (i >= field.fieldValue.count()) {
-        return QLatin1String("");
-    }
-
-    return field.fieldValue[i];
-}
-
-QStringList asStringList(const Tp::ContactInfoField &field, int i)
-{
-    QStringList rv;
-
-    while (i < field.fieldValue.count()) {
-        rv.append(field.fieldValue[i].trimmed());
-        ++i;
-    }
-
-    return rv;
-}
-
-QString asString(CDTpContact::Info::Capability c)
-{
-    switch (c) {
-    case CDTpContact::Info::TextChats:
-        return QLatin1String("TextChats");
-    case CDTpContact::Info::StreamedMediaCalls:
-        return QLatin1String("StreamedMediaCalls");
-    case CDTpContact::Info::StreamedMediaAudioCalls:
-        return QLatin1String("StreamedMediaAudioCalls");
-    case CDTpContact::Info::StreamedMediaAudioVideoCalls:
-        return QLatin1String("StreamedMediaAudioVideoCalls");
-    case CDTpContact::Info::UpgradingStreamMediaCalls:
-        return QLatin1String("UpgradingStreamMediaCalls");
-    case CDTpContact::Info::FileTransfers:
-        return QLatin1String("FileTransfers");
-    case CDTpContact::Info::StreamTubes:
-        return QLatin1String("StreamTubes");
-    case CDTpContact::Info::DBusTubes:
-        return QLatin1String("DBusTubes");
-    default:
-        break;
-    }
-
-    return QString();
-}
-
 QString asString(CDTpAccount::Changes changes)
 {
     QStringList rv;
@@ -157,6 +116,7 @@ QString asString(CDTpAccount::Changes changes)
     if (changes & CDTpAccount::Avatar) { rv.append(QLatin1String("Avatar")); }
     if (changes & CDTpAccount::Enabled) { rv.append(QLatin1String("Enabled")); }
     if (changes & CDTpAccount::StorageInfo) { rv.append(QLatin1String("StorageInfo")); }
+    if (changes & CDTpAccount::AvatarPath) { rv.append(QLatin1String("AvatarPath")); }
     return rv.join(QLatin1Char(':'));
 }
 
@@ -187,8 +147,9 @@ QMap<QString, QString> managerParameters()
 
 QContactManager *manager()
 {
-    static QContactManager manager(QStringLiteral("org.nemomobile.contacts.sqlite"), managerParameters());
-    return &manager;
+    static const QSharedPointer<QContactManager> manager(
+            BasePlugin::contactManager(QStringLiteral("org.nemomobile.contacts.sqlite"), managerParameters()));
+    return manager.data();
 }
 
 template<typename T>
@@ -261,14 +222,17 @@ QContactCollectionId telepathyCollectionId(int accountId)
     return QContactCollectionId();
 }
 
-QContactCollectionId telepathyCollectionId(const QString &accountPath)
+int telepathyAccountId(const QString &accountPath)
 {
     const int i = accountPath.lastIndexOf(QLatin1Char('_'));
-    if (i >= 0) {
-        int accountId = accountPath.mid(i + 1).toInt();
-        if (accountId > 0) {
-            return telepathyCollectionId(accountId);
-        }
+    return i >= 0 ? qMax(accountPath.mid(i + 1).toInt(), 0) : 0;
+}
+
+QContactCollectionId telepathyCollectionId(const QString &accountPath)
+{
+    const int accountId = telepathyAccountId(accountPath);
+    if (accountId > 0) {
+        return telepathyCollectionId(accountId);
     }
 
     qCWarning(lcContactsd) << "telepathy accountPath does not contain valid account id:" << accountPath;
@@ -489,102 +453,6 @@ bool storeContact(QContact &contact, const QString &location, CDTpContact::Chang
     return true;
 }
 
-QChar::Script nameScript(const QString &name)
-{
-    QChar::Script script(QChar::Script_Unknown);
-
-    if (!name.isEmpty()) {
-        QString::const_iterator it = name.begin(), end = name.end();
-        for ( ; it != end; ++it) {
-            const QChar::Category charCategory((*it).category());
-            if (charCategory >= QChar::Letter_Uppercase && charCategory <= QChar::Letter_Other) {
-                const QChar::Script charScript((*it).script());
-                if (script == QChar::Script_Unknown) {
-                    script = charScript;
-                } else if (charScript != script) {
-                    return QChar::Script_Unknown;
-                }
-            }
-        }
-    }
-
-    return script;
-}
-
-QChar::Script nameScript(const QString &firstName, const QString &lastName)
-{
-    if (firstName.isEmpty()) {
-        return nameScript(lastName);
-    } else if (lastName.isEmpty()) {
-        return nameScript(firstName);
-    }
-
-    QChar::Script firstScript(nameScript(firstName));
-    if (firstScript != QChar::Script_Unknown) {
-        QChar::Script lastScript(nameScript(lastName));
-        if (lastScript == firstScript) {
-            return lastScript;
-        }
-    }
-
-    return QChar::Script_Unknown;
-}
-
-bool nameScriptImpliesFamilyFirst(const QString &firstName, const QString &lastName)
-{
-    switch (nameScript(firstName, lastName)) {
-    // These scripts are used by cultures that conform to the family-name-first naming convention:
-    case QChar::Script_Han:
-    case QChar::Script_Lao:
-    case QChar::Script_Hangul:
-    case QChar::Script_Khmer:
-    case QChar::Script_Mongolian:
-    case QChar::Script_Hiragana:
-    case QChar::Script_Katakana:
-    case QChar::Script_Bopomofo:
-    case QChar::Script_Yi:
-        return true;
-    default:
-        return false;
-    }
-}
-
-bool needsSpaceBetweenNames(const QString &first, const QString &second)
-{
-    if (first.isEmpty() || second.isEmpty()) {
-        return false;
-    }
-    return first[first.length()-1].script() != QChar::Script_Han
-            || second[0].script() != QChar::Script_Han;
-}
-
-QString generateDisplayLabel(const QContactName &nameDetail, CDTpStorage::DisplayLabelOrder order)
-{
-    // Simplified version of the SeasideCache displayLabel generator
-    QString rv;
-
-    QString nameStr1(nameDetail.firstName());
-    QString nameStr2(nameDetail.lastName());
-
-    const bool familyNameFirst(order == CDTpStorage::LastNameFirst || nameScriptImpliesFamilyFirst(nameStr1, nameStr2));
-    if (familyNameFirst) {
-        nameStr1 = nameDetail.lastName();
-        nameStr2 = nameDetail.firstName();
-    }
-
-    if (!nameStr1.isEmpty())
-        rv.append(nameStr1);
-
-    if (!nameStr2.isEmpty()) {
-        if (needsSpaceBetweenNames(nameStr1, nameStr2)) {
-            rv.append(QLatin1Char(' '));
-        }
-        rv.append(nameStr2);
-    }
-
-    return rv;
-}
-
 void reportSelfDetails(CDTpDevicePresence *devicePresence, const QContact &contact, CDTpStorage::DisplayLabelOrder order)
 {
     const QContactName nameDetail(contact.detail<QContactName>());
@@ -654,6 +522,9 @@ void appendContactChange(CDTpStorage::ContactChangeSet *saveSet, const QContact
 
 void updateContacts(const QString &location, CDTpStorage::ContactChangeSet *saveSet, QList<QContactId> *removeList)
 {
+    Statistics::Timer flushTimer(QStringLiteral("telepathy.flushDuration"));
+    int savedCount = 0;
+
     if (saveSet && !saveSet->isEmpty()) {
         // Each element of the save set is a list of contacts with the same set of changes
         CDTpStorage::ContactChangeSet::iterator sit = saveSet->begin(), send = saveSet->end();
@@ -706,6 +577,7 @@ void updateContacts(const QString &location, CDTpStorage::ContactChangeSet *save
                     } while (true);
                 }
                 qCDebug(lcContactsd) << "Updated" << saveList->count() << "batched contacts - elapsed:" << t.elapsed() << detailList;
+                savedCount += saveList->count();
             }
         }
     }
@@ -721,7 +593,15 @@ void updateContacts(const QString &location, CDTpStorage::ContactChangeSet *save
             }
         }
         qCDebug(lcContactsd) << "Removed" << removeList->count() << "individual contacts - elapsed:" << t.elapsed();
+        Statistics::increment(QStringLiteral("telepathy.contactsRemoved"), removeList->count());
+    }
+
+    if (savedCount || (removeList && !removeList->isEmpty())) {
+        logEvent(EventStoreContacts, location, savedCount, removeList ? removeList->count() : 0);
     }
+
+    Statistics::increment(QStringLiteral("telepathy.contactsSaved"), savedCount);
+    Statistics::record(QStringLiteral("telepathy.contactsSavedPerFlush"), savedCount);
 }
 
 QList<QContactId> findContactIdsForAccount(const QString &accountPath)
@@ -851,11 +731,7 @@ QString imAccount(CDTpContactPtr contactWrapper)
     return imAccount(contactWrapper->accountWrapper());
 }
 
-QString imAddress(const QString &accountPath, const QString &contactId = QString())
-{
-    static const QString tmpl = QString::fromLatin1("%1!%2");
-    return tmpl.arg(accountPath, contactId.isEmpty() ? QLatin1String("self") : contactId);
-}
+using ::imAddress;
 
 QString imAddress(Tp::AccountPtr account, const QString &contactId = QString())
 {
@@ -872,6 +748,12 @@ QString imAddress(CDTpContactPtr contactWrapper)
     return imAddress(contactWrapper->accountWrapper(), contactWrapper->contact()->id());
 }
 
+QString squareAvatarOwner(const QString &contactAddress)
+{
+    // The large avatar of a contact is referenced by its address
+    return contactAddress + QLatin1String("#square");
+}
+
 QString imPresence(const QString &accountPath, const QString &contactId = QString())
 {
     static const QString tmpl = QString::fromLatin1("%1!%2!presence");
@@ -917,92 +799,78 @@ QContactPresence::PresenceState qContactPresenceState(Tp::ConnectionPresenceType
     return QContactPresence::PresenceUnknown;
 }
 
-bool isOnlinePresence(Tp::ConnectionPresenceType presenceType, Tp::AccountPtr account)
+QUrl socialAvatarUrl(Tp::ContactPtr contact, const QString &avatarType)
 {
-    switch (presenceType) {
-    // Why??
-    case Tp::ConnectionPresenceTypeOffline:
-        return account->protocolName() == QLatin1String("skype");
+    // Images published in the contact info as vCard PHOTO URIs, the square one tagged as such
+    const QString squareParameter(QLatin1String("type=") + CDTpAvatarUpdate::Square);
 
-    case Tp::ConnectionPresenceTypeUnset:
-    case Tp::ConnectionPresenceTypeUnknown:
-    case Tp::ConnectionPresenceTypeError:
-        return false;
-
-    default:
-        break;
-    }
-
-    return true;
-}
-
-QStringList currentCapabilites(const Tp::CapabilitiesBase &capabilities,
-                               Tp::ConnectionPresenceType presenceType,
-                               Tp::AccountPtr account)
-{
-    QStringList current;
-
-    if (capabilities.textChats()) {
-        current << asString(CDTpContact::Info::TextChats);
-    }
-
-    if (isOnlinePresence(presenceType, account)) {
-        if (capabilities.streamedMediaCalls()) {
-            current << asString(CDTpContact::Info::StreamedMediaCalls);
-        }
-        if (capabilities.streamedMediaAudioCalls()) {
-            current << asString(CDTpContact::Info::StreamedMediaAudioCalls);
+    foreach (const Tp::ContactInfoField &field, contact->infoFields().allFields()) {
+        if (field.fieldName != QLatin1String("photo") || field.fieldValue.isEmpty()) {
+            continue;
         }
-        if (capabilities.streamedMediaVideoCalls()) {
-            current << asString(CDTpContact::Info::StreamedMediaAudioVideoCalls);
+
+        bool square = false;
+        foreach (const QString &param, field.parameters) {
+            if (param.compare(squareParameter, Qt::CaseInsensitive) == 0) {
+                square = true;
+            }
         }
-        if (capabilities.upgradingStreamedMediaCalls()) {
-            current << asString(CDTpContact::Info::UpgradingStreamMediaCalls);
+        if (square != (avatarType == CDTpAvatarUpdate::Square)) {
+            continue;
         }
-        if (capabilities.fileTransfers()) {
-            current << asString(CDTpContact::Info::FileTransfers);
+
+        const QUrl url(field.fieldValue.first());
+        if (url.scheme() == QLatin1String("http") || url.scheme() == QLatin1String("https")) {
+            return url;
         }
     }
 
-    return current;
+    return QUrl();
 }
 
-QString saveAccountAvatar(CDTpAccountPtr accountWrapper)
+void updateSocialAvatars(CDTpAvatarFetcher &avatarFetcher, const QContact &existing, CDTpContactPtr contactWrapper)
 {
-    const Tp::Avatar &avatar = accountWrapper->account()->avatar();
-
-    if (avatar.avatarData.isEmpty()) {
-        return QString();
+    if (!contactWrapper->contact()->isContactInfoKnown()) {
+        // Keep the avatars restored from the roster cache until the info arrives
+        return;
     }
 
-    const QString avatarDirPath(CDTpPlugin::cacheFileName(QString::fromLatin1("avatars/account")));
+    const QString contactAddress(imAddress(contactWrapper));
 
-    QDir storageDir(avatarDirPath);
-    if (!storageDir.exists() && !storageDir.mkpath(QString::fromLatin1("."))) {
-        qWarning() << "Unable to create contacts avatar storage directory:" << storageDir.path();
-        return QString();
-    }
+    // Contacts shown in the roster and favourites are fetched ahead of the others
+    const bool priority = contactWrapper->isVisible() || existing.detail<QContactFavorite>().isFavorite();
 
-    QString filename = QString::fromLatin1(QCryptographicHash::hash(avatar.avatarData, QCryptographicHash::Md5).toHex());
-    filename = avatarDirPath + QDir::separator() + filename + QString::fromLatin1(".jpg");
+    CDTpContact *wrapper = contactWrapper.data();
 
-    QFile avatarFile(filename);
-    if (!avatarFile.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
-        qCWarning(lcContactsd) << "Unable to save account avatar: error opening avatar file" << filename << "for writing";
-        return QString();
-    }
+    foreach (const QString &avatarType, QStringList() << CDTpAvatarUpdate::Large << CDTpAvatarUpdate::Square) {
+        const bool large = (avatarType == CDTpAvatarUpdate::Large);
+        const QString key(contactAddress + QLatin1Char('#') + avatarType);
+        const QUrl url(socialAvatarUrl(contactWrapper->contact(), avatarType));
 
-    avatarFile.write(avatar.avatarData);
-    avatarFile.close();
+        if (url.isEmpty()) {
+            avatarFetcher.cancel(key);
 
-    return filename;
-}
+            // The image is no longer published
+            if (large && !wrapper->largeAvatarPath().isEmpty()) {
+                wrapper->setLargeAvatarPath(QString());
+            } else if (!large && !wrapper->squareAvatarPath().isEmpty()) {
+                wrapper->setSquareAvatarPath(QString());
+            }
+            continue;
+        }
 
-void updateSocialAvatars(QNetworkAccessManager &network, CDTpContactPtr contactWrapper)
-{
-    Q_UNUSED(network)
-    Q_UNUSED(contactWrapper)
-    // TODO: do we need this for anything?
+        avatarFetcher.fetch(key, url, priority, wrapper, [wrapper, large](const QString &avatarPath) {
+            if (avatarPath.isEmpty()) {
+                return;
+            }
+
+            if (large && avatarPath != wrapper->largeAvatarPath()) {
+                wrapper->setLargeAvatarPath(avatarPath);
+            } else if (!large && avatarPath != wrapper->squareAvatarPath()) {
+                wrapper->setSquareAvatarPath(avatarPath);
+            }
+        });
+    }
 }
 
 bool onlineAccountEnabled(const QContactOnlineAccount &qcoa)
@@ -1024,8 +892,8 @@ void reportAccountPresence(CDTpDevicePresence *devicePresence, const QContactOnl
                                 qcoa.value<QString>(QContactOnlineAccount__FieldEnabled) == asString(true));
 }
 
-CDTpContact::Changes updateAccountDetails(CDTpDevicePresence *devicePresence, QContact &self,
-                                          QContactOnlineAccount &qcoa, QContactPresence &presence,
+CDTpContact::Changes updateAccountDetails(CDTpDevicePresence *devicePresence, CDTpAvatarStore &avatarStore,
+                                          QContact &self, QContactOnlineAccount &qcoa, QContactPresence &presence,
                                           CDTpAccountPtr accountWrapper,
                                           CDTpAccount::Changes changes)
 {
@@ -1075,11 +943,13 @@ CDTpContact::Changes updateAccountDetails(CDTpDevicePresence *devicePresence, QC
         }
     }
     if (changes & CDTpAccount::Avatar) {
-        const QString avatarPath(saveAccountAvatar(accountWrapper));
+        const QString owner(imAddress(accountWrapper));
+        const QByteArray avatarData(account->avatar().avatarData);
 
-        QContactAvatar avatar(findAvatarForAccount(self, qcoa));
+        if (avatarData.isEmpty()) {
+            avatarStore.cancel(owner);
 
-        if (avatarPath.isEmpty()) {
+            QContactAvatar avatar(findAvatarForAccount(self, qcoa));
             if (!avatar.isEmpty()) {
                 if (!self.removeDetail(&avatar)) {
                     qCWarning(lcContactsd) << SRC_LOC << "Unable to remove avatar for account:" << accountPath;
@@ -1087,7 +957,23 @@ CDTpContact::Changes updateAccountDetails(CDTpDevicePresence *devicePresence, QC
 
                 selfChanges |= CDTpContact::Avatar;
             }
+
+            avatarStore.release(owner);
         } else {
+            // The detail is updated when the account reports the stored path
+            CDTpAccount *wrapper = accountWrapper.data();
+            avatarStore.storeLater(owner, avatarData, wrapper, [wrapper](const QString &path) {
+                wrapper->setAvatarPath(path);
+            });
+        }
+    }
+    if (changes & CDTpAccount::AvatarPath) {
+        const QString avatarPath(accountWrapper->avatarPath());
+
+        // Ignore a path reported for an avatar that has been reset since
+        if (!avatarPath.isEmpty() && !account->avatar().avatarData.isEmpty()) {
+            QContactAvatar avatar(findAvatarForAccount(self, qcoa));
+
             QUrl avatarUrl(QUrl::fromLocalFile(avatarPath));
             if (avatarUrl != avatar.imageUrl()) {
                 avatar.setImageUrl(avatarUrl);
@@ -1099,6 +985,8 @@ CDTpContact::Changes updateAccountDetails(CDTpDevicePresence *devicePresence, QC
 
                 selfChanges |= CDTpContact::Avatar;
             }
+
+            avatarStore.reference(imAddress(accountWrapper), avatarPath);
         }
     }
 
@@ -1151,67 +1039,6 @@ void deleteContactDetails(QContact &existing)
 
 typedef QHash<QString, int> Dictionary;
 
-Dictionary initPhoneTypes()
-{
-    Dictionary types;
-
-    types.insert(QLatin1String("bbsl"), QContactPhoneNumber::SubTypeBulletinBoardSystem);
-    types.insert(QLatin1String("car"), QContactPhoneNumber::SubTypeCar);
-    types.insert(QLatin1String("cell"), QContactPhoneNumber::SubTypeMobile);
-    types.insert(QLatin1String("fax"), QContactPhoneNumber::SubTypeFax);
-    types.insert(QLatin1String("modem"), QContactPhoneNumber::SubTypeModem);
-    types.insert(QLatin1String("pager"), QContactPhoneNumber::SubTypePager);
-    types.insert(QLatin1String("video"), QContactPhoneNumber::SubTypeVideo);
-    types.insert(QLatin1String("voice"), QContactPhoneNumber::SubTypeVoice);
-    // Not sure about these types:
-    types.insert(QLatin1String("isdn"), QContactPhoneNumber::SubTypeLandline);
-    types.insert(QLatin1String("pcs"), QContactPhoneNumber::SubTypeLandline);
-
-    return types;
-}
-
-const Dictionary &phoneTypes()
-{
-    static Dictionary types(initPhoneTypes());
-    return types;
-}
-
-Dictionary initAddressTypes()
-{
-    Dictionary types;
-
-    types.insert(QLatin1String("dom"), QContactAddress::SubTypeDomestic);
-    types.insert(QLatin1String("intl"), QContactAddress::SubTypeInternational);
-    types.insert(QLatin1String("parcel"), QContactAddress::SubTypeParcel);
-    types.insert(QLatin1String("postal"), QContactAddress::SubTypePostal);
-
-    return types;
-}
-
-const Dictionary &addressTypes()
-{
-    static Dictionary types(initAddressTypes());
-    return types;
-}
-
-Dictionary initGenderTypes()
-{
-    Dictionary types;
-
-    types.insert(QLatin1String("f"), QContactGender::GenderFemale);
-    types.insert(QLatin1String("female"), QContactGender::GenderFemale);
-    types.insert(QLatin1String("m"), QContactGender::GenderMale);
-    types.insert(QLatin1String("male"), QContactGender::GenderMale);
-
-    return types;
-}
-
-const Dictionary &genderTypes()
-{
-    static Dictionary types(initGenderTypes());
-    return types;
-}
-
 Dictionary initProtocolTypes()
 {
     Dictionary types;
@@ -1240,20 +1067,6 @@ QContactOnlineAccount::Protocol protocolType(const QString &protocol)
     return QContactOnlineAccount::ProtocolUnknown;
 }
 
-template<typename F1, typename F2>
-void replaceNameDetail(F1 getter, F2 setter, QContactName *nameDetail, const QString &value)
-{
-    if (!value.isEmpty()) {
-        (nameDetail->*setter)(value);
-    } else {
-        // If there is an existing value, remove it
-        QString existing((nameDetail->*getter)());
-        if (!existing.isEmpty()) {
-            (nameDetail->*setter)(value);
-        }
-    }
-}
-
 template<typename T, typename F>
 bool detailListsDiffer(const QList<T> &lhs, const QList<T> &rhs, F detailsDiffer)
 {
@@ -1339,8 +1152,9 @@ bool replaceDetails(QContact &contact, T &detail, const QString &address, const
     return replaceDetails(contact, QList<T>() << detail, address, location);
 }
 
-CDTpContact::Changes updateContactDetails(QNetworkAccessManager &network, QContact &existing,
-                                          CDTpContactPtr contactWrapper, CDTpContact::Changes changes)
+CDTpContact::Changes updateContactDetails(CDTpAvatarFetcher &avatarFetcher, CDTpAvatarStore &avatarStore,
+                                          QContact &existing, CDTpContactPtr contactWrapper,
+                                          CDTpContact::Changes changes)
 {
     const QString contactAddress(imAddress(contactWrapper));
     qCDebug(lcContactsd) << "Update contact" << contactAddress;
@@ -1424,236 +1238,17 @@ CDTpContact::Changes updateContactDetails(QNetworkAccessManager &network, QConta
     if (changes & CDTpContact::Information) {
         if (contactWrapper->isInformationKnown()) {
             // Extract the current information state from the info fields
-            QList<QContactAddress> newAddresses;
-            QContactBirthday newBirthday;
-            QList<QContactEmailAddress> newEmailAddresses;
-            QContactGender newGender;
-            QContactName newName;
-            QList<QContactNickname> newNicknames;
-            QList<QContactNote> newNotes;
-            QList<QContactOrganization> newOrganizations;
-            QList<QContactPhoneNumber> newPhoneNumbers;
-            QList<QContactUrl> newUrls;
-
-            Tp::ContactInfoFieldList listContactInfo = contact->infoFields().allFields();
-            if (listContactInfo.count() != 0) {
-                const int defaultContext(QContactDetail::ContextOther);
-                const int homeContext(QContactDetail::ContextHome);
-                const int workContext(QContactDetail::ContextWork);
-
-                QContactOrganization organizationDetail;
-                QContactName nameDetail;
-                QString formattedName;
-                bool structuredName = false;
-
-                // Add any information reported by telepathy
-                foreach (const Tp::ContactInfoField &field, listContactInfo) {
-                    if (field.fieldValue.count() == 0) {
-                        continue;
-                    }
-
-                    // Extract field types
-                    QStringList subTypes;
-                    int detailContext = -1;
-                    const int invalidContext = -1;
-
-                    foreach (const QString &param, field.parameters) {
-                        if (!param.startsWith(QLatin1String("type="))) {
-                            continue;
-                        }
-                        const QString type = param.mid(5);
-                        if (type == QLatin1String("home")) {
-                            detailContext = homeContext;
-                        } else if (type == QLatin1String("work")) {
-                            detailContext = workContext;
-                        } else if (!subTypes.contains(type)){
-                            subTypes << type;
-                        }
-                    }
-
-                    if (field.fieldName == QLatin1String("tel")) {
-                        QList<int> selectedTypes;
-                        foreach (const QString &type, subTypes) {
-                            Dictionary::const_iterator it = phoneTypes().find(type.toLower());
-                            if (it != phoneTypes().constEnd()) {
-                                selectedTypes.append(*it);
-                            }
-                        }
-                        if (selectedTypes.isEmpty()) {
-                            // Assume landline
-                            selectedTypes.append(QContactPhoneNumber::SubTypeLandline);
-                        }
-
-                        QContactPhoneNumber phoneNumberDetail;
-                        phoneNumberDetail.setContexts(detailContext == invalidContext ? defaultContext : detailContext);
-                        phoneNumberDetail.setNumber(asString(field, 0).trimmed());
-                        phoneNumberDetail.setSubTypes(selectedTypes);
-
-                        newPhoneNumbers.append(phoneNumberDetail);
-                    } else if (field.fieldName == QLatin1String("adr")) {
-                        QList<int> selectedTypes;
-                        foreach (const QString &type, subTypes) {
-                            Dictionary::const_iterator it = addressTypes().find(type.toLower());
-                            if (it != addressTypes().constEnd()) {
-                                selectedTypes.append(*it);
-                            }
-                        }
-
-                        // QContactAddress does not support extended street address, so combine the fields
-                        QStringList streetParts;
-                        for (int i = 1; i <= 2; ++i) {
-                            QString part(asString(field, i).trimmed());
-                            if (!part.isEmpty()) {
-                                streetParts.append(part);
-                            }
-                        }
-
-                        QContactAddress addressDetail;
-                        if (detailContext != invalidContext) {
-                            addressDetail.setContexts(detailContext);
-                        }
-                        if (selectedTypes.isEmpty()) {
-                            addressDetail.setSubTypes(selectedTypes);
-                        }
-                        addressDetail.setPostOfficeBox(asString(field, 0).trimmed());
-                        addressDetail.setStreet(streetParts.join(QString::fromLatin1("\n")));
-                        addressDetail.setLocality(asString(field, 3).trimmed());
-                        addressDetail.setRegion(asString(field, 4).trimmed());
-                        addressDetail.setPostcode(asString(field, 5).trimmed());
-                        addressDetail.setCountry(asString(field, 6).trimmed());
-
-                        newAddresses.append(addressDetail);
-                    } else if (field.fieldName == QLatin1String("email")) {
-                        QContactEmailAddress emailDetail;
-                        if (detailContext != invalidContext) {
-                            emailDetail.setContexts(detailContext);
-                        }
-                        emailDetail.setEmailAddress(asString(field, 0).trimmed());
-
-                        newEmailAddresses.append(emailDetail);
-                    } else if (field.fieldName == QLatin1String("url")) {
-                        QContactUrl urlDetail;
-                        if (detailContext != invalidContext) {
-                            urlDetail.setContexts(detailContext);
-                        }
-                        urlDetail.setUrl(asString(field, 0).trimmed());
-
-                        newUrls.append(urlDetail);
-                    } else if (field.fieldName == QLatin1String("title")) {
-                        organizationDetail.setTitle(asString(field, 0).trimmed());
-                        if (detailContext != invalidContext) {
-                            organizationDetail.setContexts(detailContext);
-                        }
-                    } else if (field.fieldName == QLatin1String("role")) {
-                        organizationDetail.setRole(asString(field, 0).trimmed());
-                        if (detailContext != invalidContext) {
-                            organizationDetail.setContexts(detailContext);
-                        }
-                    } else if (field.fieldName == QLatin1String("org")) {
-                        organizationDetail.setName(asString(field, 0).trimmed());
-                        organizationDetail.setDepartment(asStringList(field, 1));
-                        if (detailContext != invalidContext) {
-                            organizationDetail.setContexts(detailContext);
-                        }
-
-                        newOrganizations.append(organizationDetail);
-
-                        // Clear out the stored details
-                        organizationDetail = QContactOrganization();
-                    } else if (field.fieldName == QLatin1String("n")) {
-                        if (detailContext != invalidContext) {
-                            nameDetail.setContexts(detailContext);
-                        }
-
-                        replaceNameDetail(&QContactName::lastName, &QContactName::setLastName, &nameDetail, asString(field, 0).trimmed());
-                        replaceNameDetail(&QContactName::firstName, &QContactName::setFirstName, &nameDetail, asString(field, 1).trimmed());
-                        replaceNameDetail(&QContactName::middleName, &QContactName::setMiddleName, &nameDetail, asString(field, 2).trimmed());
-                        replaceNameDetail(&QContactName::prefix, &QContactName::setPrefix, &nameDetail, asString(field, 3).trimmed());
-                        replaceNameDetail(&QContactName::suffix, &QContactName::setSuffix, &nameDetail, asString(field, 4).trimmed());
-
-                        structuredName = true;
-                    } else if (field.fieldName == QLatin1String("fn")) {
-                        const QString fn(asString(field, 0).trimmed());
-                        if (!fn.isEmpty()) {
-                            if (detailContext != invalidContext) {
-                                nameDetail.setContexts(detailContext);
-                            }
-                            formattedName = fn;
-                        }
-                    } else if (field.fieldName == QLatin1String("nickname")) {
-                        const QString nickname(asString(field, 0).trimmed());
-                        if (!nickname.isEmpty()) {
-                            QContactNickname nicknameDetail;
-                            nicknameDetail.setNickname(nickname);
-                            if (detailContext != invalidContext) {
-                                nicknameDetail.setContexts(detailContext);
-                            }
-
-                            newNicknames.append(nicknameDetail);
-
-                            // Use the nickname as the customLabel if we have no 'fn' data
-                            if (formattedName.isEmpty()) {
-                                formattedName = nickname;
-                            }
-                        }
-                    } else if (field.fieldName == QLatin1String("note")
-                               || field.fieldName == QLatin1String("desc")) {
-                        QContactNote noteDetail;
-                        if (detailContext != invalidContext) {
-                            noteDetail.setContexts(detailContext);
-                        }
-                        noteDetail.setNote(asString(field, 0).trimmed());
-
-                        newNotes.append(noteDetail);
-                    } else if (field.fieldName == QLatin1String("bday")) {
-                        // FIXME: support more date format for compatibility
-                        const QString dateText(asString(field, 0));
-
-                        QDate date = QDate::fromString(dateText, QLatin1String("yyyy-MM-dd"));
-                        if (!date.isValid()) {
-                            date = QDate::fromString(dateText, QLatin1String("yyyyMMdd"));
-                        }
-                        if (!date.isValid()) {
-                            date = QDate::fromString(dateText, Qt::ISODate);
-                        }
-
-                        if (date.isValid()) {
-                            QContactBirthday birthdayDetail;
-                            birthdayDetail.setDate(date);
-
-                            newBirthday = birthdayDetail;
-                        } else {
-                            qCDebug(lcContactsd) << "Unsupported bday format:" << field.fieldValue[0];
-                        }
-                    } else if (field.fieldName == QLatin1String("x-gender")) {
-                        const QString type(field.fieldValue.at(0));
-
-                        Dictionary::const_iterator it = genderTypes().find(type.toLower());
-                        if (it != addressTypes().constEnd()) {
-                            QContactGender genderDetail;
-                            genderDetail.setGender(static_cast<QContactGender::GenderType>(*it));
-
-                            newGender = genderDetail;
-                        } else {
-                            qCDebug(lcContactsd) << "Unsupported gender type:" << type;
-                        }
-                    } else {
-                        qCDebug(lcContactsd) << "Unsupported contact info field" << field.fieldName;
-                    }
-                }
-
-                if (structuredName || !formattedName.isEmpty()) {
-                    if (!structuredName) {
-                        SeasideCache::decomposeDisplayLabel(formattedName, &nameDetail);
-                    }
-
-                    if (!formattedName.isEmpty()) {
-                        nameDetail.setValue(QContactName::FieldCustomLabel, formattedName);
-                    }
-
-                    newName = nameDetail;
-                }
-            }
+            ContactInfoDetails info(contactInfoDetails(contact->infoFields().allFields()));
+            QList<QContactAddress> &newAddresses(info.addresses);
+            QContactBirthday &newBirthday(info.birthday);
+            QList<QContactEmailAddress> &newEmailAddresses(info.emailAddresses);
+            QContactGender &newGender(info.gender);
+            QContactName &newName(info.name);
+            QList<QContactNickname> &newNicknames(info.nicknames);
+            QList<QContactNote> &newNotes(info.notes);
+            QList<QContactOrganization> &newOrganizations(info.organizations);
+            QList<QContactPhoneNumber> &newPhoneNumbers(info.phoneNumbers);
+            QList<QContactUrl> &newUrls(info.urls);
 
             // For all detail types, test if there has been any change
             bool changed = false;
@@ -1830,10 +1425,14 @@ CDTpContact::Changes updateContactDetails(QNetworkAccessManager &network, QConta
                 contactChanges |= CDTpContact::Avatar;
             }
         }
+
+        // Only avatars fetched by the plugin live in the store; the others are in the Tp cache
+        avatarStore.reference(contactAddress, avatarPath);
+        avatarStore.reference(squareAvatarOwner(contactAddress), contactWrapper->squareAvatarPath());
     }
 
-    if (changes & CDTpContact::DefaultAvatar) {
-        updateSocialAvatars(network, contactWrapper);
+    if (changes & (CDTpContact::DefaultAvatar | CDTpContact::Information)) {
+        updateSocialAvatars(avatarFetcher, existing, contactWrapper);
     }
     /* What is this about?
     if (changes & CDTpContact::Authorization) {
@@ -1848,23 +1447,21 @@ CDTpContact::Changes updateContactDetails(QNetworkAccessManager &network, QConta
     return contactChanges;
 }
 
-template<typename T, typename R>
-QList<R> forEachItem(const QList<T> &list, R (*f)(const T&))
+void removeTelepathyCollection(const QContactCollectionId &collectionId, int accountId)
 {
-    QList<R> rv;
-    rv.reserve(list.count());
+    // Delete the collection and its contacts.
+    QtContactsSqliteExtensions::ContactManagerEngine *cme = QtContactsSqliteExtensions::contactManagerEngine(*manager());
+    QContactManager::Error error = QContactManager::NoError;
 
-    foreach (const T &item, list) {
-        const R& r = f(item);
-        rv.append(r);
+    if (!cme->storeChanges(nullptr,
+                           nullptr,
+                           QList<QContactCollectionId>() << collectionId,
+                           QtContactsSqliteExtensions::ContactManagerEngine::PreserveLocalChanges,
+                           true,
+                           &error)) {
+        qCWarning(lcContactsd) << SRC_LOC << "Unable to remove linked contacts for account:" << accountId
+                  << "error:" << error;
     }
-
-    return rv;
-}
-
-QString extractAccountPath(const CDTpAccountPtr &accountWrapper)
-{
-    return imAccount(accountWrapper);
 }
 
 void addIconPath(QContactOnlineAccount &qcoa, Tp::AccountPtr account)
@@ -1882,6 +1479,7 @@ void addIconPath(QContactOnlineAccount &qcoa, Tp::AccountPtr account)
 
 CDTpStorage::CDTpStorage(QObject *parent)
     : QObject(parent)
+    , mAvatarFetcher(&mNetwork, &mAvatarStore)
     , mDevicePresence(new CDTpDevicePresence)
     , mDisplayLabelOrder(FirstNameFirst)
     , mDisplayLabelOrderConf(QStringLiteral("/org/nemomobile/contacts/display_label_order"))
@@ -1906,6 +1504,9 @@ CDTpStorage::CDTpStorage(QObject *parent)
 
 CDTpStorage::~CDTpStorage()
 {
+    foreach (int taskId, mImportTasks) {
+        BasePlugin::scheduler()->cancel(taskId);
+    }
 }
 
 /* Set generic account properties of a QContactOnlineAccount. Does not set:
@@ -1992,7 +1593,7 @@ void CDTpStorage::addNewAccount(QContact &self, CDTpAccountPtr accountWrapper)
     }
 
     // Store any information from the account
-    CDTpContact::Changes selfChanges = updateAccountDetails(mDevicePresence, self, newAccount,
+    CDTpContact::Changes selfChanges = updateAccountDetails(mDevicePresence, mAvatarStore, self, newAccount,
                                                             presence, accountWrapper, CDTpAccount::All);
 
     storeSelfContact(mDevicePresence, self, SRC_LOC, selfChanges);
@@ -2007,19 +1608,10 @@ void CDTpStorage::removeExistingAccount(QContact &self, QContactOnlineAccount &e
     qCDebug(lcContactsd) << "Remove account for path" << accountPath
             << " and collection id" << telepathyCollectionId(accountPath);
 
-    // Delete the collection and its contacts.
-    QtContactsSqliteExtensions::ContactManagerEngine *cme = QtContactsSqliteExtensions::contactManagerEngine(*manager());
-    QContactManager::Error error = QContactManager::NoError;
+    removeTelepathyCollection(telepathyCollectionId(accountPath), telepathyAccountId(accountPath));
 
-    if (!cme->storeChanges(nullptr,
-                           nullptr,
-                           QList<QContactCollectionId>() << telepathyCollectionId(accountPath),
-                           QtContactsSqliteExtensions::ContactManagerEngine::PreserveLocalChanges,
-                           true,
-                           &error)) {
-        qCWarning(lcContactsd) << SRC_LOC << "Unable to remove linked contacts for account:" << accountPath
-                  << "error:" << error;
-    }
+    // The self contact and every contact of the account are gone
+    mAvatarStore.releaseAll(accountPath + QLatin1Char('!'));
 }
 
 bool CDTpStorage::initializeNewContact(QContact &newContact, CDTpAccountPtr accountWrapper,
@@ -2127,6 +1719,10 @@ void CDTpStorage::updateContactChanges(CDTpContactPtr contactWrapper, CDTpContac
         if (!existing.isEmpty()) {
             removeList->append(existing.id());
         }
+        mAvatarFetcher.cancel(contactAddress + QLatin1Char('#') + CDTpAvatarUpdate::Large);
+        mAvatarFetcher.cancel(contactAddress + QLatin1Char('#') + CDTpAvatarUpdate::Square);
+        mAvatarStore.release(contactAddress);
+        mAvatarStore.release(squareAvatarOwner(contactAddress));
     } else {
         bool needAllChanges = false;
         if (existing.isEmpty()) {
@@ -2137,7 +1733,7 @@ void CDTpStorage::updateContactChanges(CDTpContactPtr contactWrapper, CDTpContac
             needAllChanges = true;
         }
 
-        changes = updateContactDetails(mNetwork, existing, contactWrapper, changes);
+        changes = updateContactDetails(mAvatarFetcher, mAvatarStore, existing, contactWrapper, changes);
         if (needAllChanges) changes = CDTpContact::All;
         appendContactChange(saveSet, existing, changes);
     }
@@ -2210,13 +1806,14 @@ void CDTpStorage::updateAccountChanges(QContact &self, QContactOnlineAccount &qc
         qCWarning(lcContactsd) << SRC_LOC << "Unable to find presence to match account:" << accountPath;
     }
 
-    CDTpContact::Changes selfChanges = updateAccountDetails(mDevicePresence, self, qcoa, presence, accountWrapper, changes);
+    CDTpContact::Changes selfChanges = updateAccountDetails(mDevicePresence, mAvatarStore, self, qcoa, presence, accountWrapper, changes);
 
     if (!storeSelfContact(mDevicePresence, self, SRC_LOC, selfChanges)) {
         qCWarning(lcContactsd) << SRC_LOC << "Unable to save self contact - error:" << manager()->error();
     }
 
-    if (account->isEnabled() && accountWrapper->hasRoster()) {
+    // A stored avatar path only concerns the self contact
+    if (changes != CDTpAccount::AvatarPath && account->isEnabled() && accountWrapper->hasRoster()) {
         QHash<QString, CDTpContact::Changes> allChanges;
 
         // Update all contacts reported in the roster changes of this account
@@ -2350,63 +1947,101 @@ void CDTpStorage::updateAccountChanges(QContact &self, QContactOnlineAccount &qc
 
 void CDTpStorage::syncAccounts(const QList<CDTpAccountPtr> &accounts)
 {
-    qWarning() << "CDTpStorage: syncAccounts:" << accounts.count();
+    logEvent(EventSyncAccounts, QString(), accounts.count());
+    qCDebug(lcContactsd) << "CDTpStorage: syncAccounts:" << accounts.count();
+    StartupTimeline::Scope scope(QStringLiteral("telepathy"), QStringLiteral("syncAccounts"));
 
-    for (CDTpAccountPtr accountWrapper : accounts) {
-        QContact self(selfContact(telepathyCollectionId(imAccount(accountWrapper))));
-        if (self.isEmpty()) {
-            qCWarning(lcContactsd) << SRC_LOC << "Unable to retrieve self contact - error:" << manager()->error();
-            return;
+    // Each account has a collection of its own, holding its own self contact, so
+    // each account is reconciled once against its collection only
+    QHash<int, QContactCollectionId> collectionIds;
+    QList<QPair<QContactCollectionId, int> > obsoleteCollections;
+    const QList<QContactCollection> telepathyCollections = allTelepathyCollections();
+    for (const QContactCollection &collection : telepathyCollections) {
+        const int accountId = collection.extendedMetaData(COLLECTION_EXTENDEDMETADATA_KEY_ACCOUNTID).toInt();
+        if (accountId <= 0) {
+            qCWarning(lcContactsd) << SRC_LOC << "Telepathy collection without account id:" << collection.id();
+            obsoleteCollections.append(qMakePair(collection.id(), accountId));
+        } else if (collectionIds.contains(accountId)) {
+            // Keep the collection telepathyCollectionId() finds for the account
+            qCWarning(lcContactsd) << SRC_LOC << "Duplicate telepathy collection:" << collection.id()
+                                   << "account id:" << accountId;
+            obsoleteCollections.append(qMakePair(collection.id(), accountId));
+        } else {
+            collectionIds.insert(accountId, collection.id());
         }
-        syncAccountsForSelfContact(accounts, self);
     }
-}
 
-void CDTpStorage::syncAccountsForSelfContact(const QList<CDTpAccountPtr> &accounts, QContact &self)
-{
-    // Find the list of paths for the accounts we now have
-    QStringList accountPaths = forEachItem(accounts, extractAccountPath);
+    for (CDTpAccountPtr accountWrapper : accounts) {
+        const QString accountPath(imAccount(accountWrapper));
+        const int accountId = telepathyAccountId(accountPath);
 
-    qWarning() << "CDTpStorage: syncAccountsForSelfContact:" << accountPaths;
+        QContactCollectionId collectionId = collectionIds.take(accountId);
+        if (collectionId.isNull()) {
+            // Creates the collection of a new account
+            collectionId = telepathyCollectionId(accountPath);
+        }
 
-    QSet<int> existingIndices;
-    QSet<QString> removalPaths;
+        syncAccountCollection(accountWrapper, collectionId);
+    }
 
-    foreach (QContactOnlineAccount existingAccount, self.details<QContactOnlineAccount>()) {
-        const QString existingPath(stringValue(existingAccount, QContactOnlineAccount__FieldAccountPath));
-        if (existingPath.isEmpty()) {
-            qCWarning(lcContactsd) << SRC_LOC << "No path for existing account:" << existingPath;
-            continue;
-        }
+    // The remaining collections belong to accounts which no longer exist
+    QHash<int, QContactCollectionId>::const_iterator it = collectionIds.constBegin(), end = collectionIds.constEnd();
+    for ( ; it != end; ++it) {
+        obsoleteCollections.append(qMakePair(it.value(), it.key()));
+    }
 
-        int index = accountPaths.indexOf(existingPath);
-        if (index != -1) {
-            existingIndices.insert(index);
-            updateAccountChanges(self, existingAccount, accounts.at(index), CDTpAccount::All);
-        } else {
-            qCDebug(lcContactsd) << SRC_LOC << "Remove obsolete account:" << existingPath;
+    for (const QPair<QContactCollectionId, int> &collection : obsoleteCollections) {
+        qCDebug(lcContactsd) << SRC_LOC << "Remove obsolete account collection:" << collection.first
+                             << "account id:" << collection.second;
+        removeTelepathyCollection(collection.first, collection.second);
+    }
 
-            // This account is no longer valid
-            removalPaths.insert(existingPath);
-        }
+    // Ensure that listeners are aware of any invalidated accounts
+    QContact globalSelf = manager()->contact(manager()->selfContactId());
+    emitAccountChanges(mDevicePresence, globalSelf, true);
+}
+
+void CDTpStorage::syncAccountCollection(CDTpAccountPtr accountWrapper, const QContactCollectionId &collectionId)
+{
+    const QString accountPath(imAccount(accountWrapper));
+
+    QContact self(selfContact(collectionId));
+    if (self.isEmpty()) {
+        // Only this account is skipped; the others are in collections of their own
+        qCWarning(lcContactsd) << SRC_LOC << "Unable to retrieve self contact for account:" << accountPath
+                               << "error:" << manager()->error();
+        return;
     }
 
-    // Remove invalid accounts
+    logEvent(EventSyncAccount, accountPath);
+    qCDebug(lcContactsd) << "CDTpStorage: syncAccount:" << accountPath;
+
+    bool found = false;
     foreach (QContactOnlineAccount existingAccount, self.details<QContactOnlineAccount>()) {
         const QString existingPath(stringValue(existingAccount, QContactOnlineAccount__FieldAccountPath));
-        if (removalPaths.contains(existingPath)) {
-            removeExistingAccount(self, existingAccount);
+        if (existingPath == accountPath) {
+            found = true;
+            updateAccountChanges(self, existingAccount, accountWrapper, CDTpAccount::All);
+        } else {
+            // Earlier versions stored every account in every self contact; the
+            // other account keeps its own collection, only the copy is dropped
+            qCDebug(lcContactsd) << SRC_LOC << "Remove foreign account:" << existingPath << "from:" << accountPath;
+            const QStringList linkedUris(existingAccount.linkedDetailUris());
+            foreach (QContactPresence presence, self.details<QContactPresence>()) {
+                if (linkedUris.contains(presence.detailUri())) {
+                    self.removeDetail(&presence);
+                }
+            }
+            self.removeDetail(&existingAccount);
         }
     }
 
-    // Add any previously unknown accounts
-    for (int i = 0; i < accounts.length(); ++i) {
-        if (!existingIndices.contains(i)) {
-            addNewAccount(self, accounts.at(i));
-        }
+    if (found) {
+        storeSelfContact(mDevicePresence, self, SRC_LOC, CDTpContact::All);
+    } else {
+        // A previously unknown account
+        addNewAccount(self, accountWrapper);
     }
-
-    storeSelfContact(mDevicePresence, self, SRC_LOC, CDTpContact::All, true);
 }
 
 void CDTpStorage::createAccount(CDTpAccountPtr accountWrapper)
@@ -2419,7 +2054,8 @@ void CDTpStorage::createAccount(CDTpAccountPtr accountWrapper)
 
     const QString accountPath(imAccount(accountWrapper));
 
-    qWarning() << "CDTpStorage: createAccount:" << accountPath;
+    logEvent(EventCreateAccount, accountPath);
+    qCDebug(lcContactsd) << "CDTpStorage: createAccount:" << accountPath;
 
     // Ensure this account does not already exist
     foreach (const QContactOnlineAccount &existingAccount, self.details<QContactOnlineAccount>()) {
@@ -2433,35 +2069,84 @@ void CDTpStorage::createAccount(CDTpAccountPtr accountWrapper)
     // Add any previously unknown accounts
     addNewAccount(self, accountWrapper);
 
-    QList<CDTpContactPtr> tpContacts(accountContacts(accountWrapper));
+    struct ImportState {
+        CDTpAccountPtr accountWrapper;
+        QString accountPath;
+        QList<CDTpContactPtr> tpContacts;
+        QHash<QString, QContact> existingContacts;
+        int index;
+        bool prepared;
+    };
+
+    QSharedPointer<ImportState> state(new ImportState);
+    state->accountWrapper = accountWrapper;
+    state->accountPath = accountPath;
+    state->index = 0;
+    state->prepared = false;
+
+    cancelImport(accountPath);
+    StartupTimeline::begin(QStringLiteral("telepathy"), QStringLiteral("import ") + accountPath);
+
+    // A large roster takes long enough to store that D-Bus requests would go
+    // unanswered, so it is imported in batches between other events
+    const int taskId = BasePlugin::scheduler()->schedule(this, QStringLiteral("telepathy import ") + accountPath, [this, state]() {
+        if (!state->prepared) {
+            state->tpContacts = accountContacts(state->accountWrapper);
+
+            QStringList contactAddresses;
+            foreach (const CDTpContactPtr &contactWrapper, state->tpContacts) {
+                contactAddresses.append(imAddress(state->accountPath, contactWrapper->contact()->id()));
+            }
 
-    QStringList contactAddresses;
-    foreach (const CDTpContactPtr &contactWrapper, tpContacts) {
-        const QString address = imAddress(accountPath, contactWrapper->contact()->id());
-        contactAddresses.append(address);
-    }
+            // Retrieve the existing contacts in a single batch
+            state->existingContacts = findExistingContacts(contactAddresses, telepathyCollectionId(state->accountPath));
+            state->prepared = true;
+            return false;
+        }
 
-    // Retrieve the existing contacts in a single batch
-    QHash<QString, QContact> existingContacts = findExistingContacts(
-                contactAddresses, telepathyCollectionId(imAccount(accountWrapper)));
+        ContactChangeSet saveSet;
+        QList<QContactId> removeList;
 
-    ContactChangeSet saveSet;
-    QList<QContactId> removeList;
+        // Add any contacts already present for this account
+        const int end = qMin(state->index + BATCH_STORE_SIZE, state->tpContacts.count());
+        for ( ; state->index < end; ++state->index) {
+            const CDTpContactPtr &contactWrapper(state->tpContacts.at(state->index));
+            if (contactWrapper->isRemoved()) {
+                // Left the roster since the import started
+                continue;
+            }
 
-    // Add any contacts already present for this account
-    foreach (const CDTpContactPtr &contactWrapper, tpContacts) {
-        const QString address = imAddress(accountPath, contactWrapper->contact()->id());
+            const QString address = imAddress(state->accountPath, contactWrapper->contact()->id());
 
-        QHash<QString, QContact>::Iterator existing = existingContacts.find(address);
-        if (existing == existingContacts.end()) {
-            qCWarning(lcContactsd) << SRC_LOC << "No contact found for address:" << address;
-            existing = existingContacts.insert(address, QContact());
+            QHash<QString, QContact>::Iterator existing = state->existingContacts.find(address);
+            if (existing == state->existingContacts.end()) {
+                qCWarning(lcContactsd) << SRC_LOC << "No contact found for address:" << address;
+                existing = state->existingContacts.insert(address, QContact());
+            }
+
+            updateContactChanges(contactWrapper, CDTpContact::All, *existing, &saveSet, &removeList);
         }
 
-        updateContactChanges(contactWrapper, CDTpContact::All, *existing, &saveSet, &removeList);
-    }
+        updateContacts(SRC_LOC, &saveSet, &removeList);
 
-    updateContacts(SRC_LOC, &saveSet, &removeList);
+        if (state->index < state->tpContacts.count()) {
+            return false;
+        }
+
+        mImportTasks.remove(state->accountPath);
+        StartupTimeline::end(QStringLiteral("telepathy"), QStringLiteral("import ") + state->accountPath);
+        emit accountImported(state->accountWrapper);
+        return true;
+    });
+    mImportTasks.insert(accountPath, taskId);
+}
+
+void CDTpStorage::cancelImport(const QString &accountPath)
+{
+    const int taskId = mImportTasks.take(accountPath);
+    if (taskId) {
+        BasePlugin::scheduler()->cancel(taskId);
+    }
 }
 
 void CDTpStorage::updateAccount(CDTpAccountPtr accountWrapper, CDTpAccount::Changes changes)
@@ -2474,7 +2159,8 @@ void CDTpStorage::updateAccount(CDTpAccountPtr accountWrapper, CDTpAccount::Chan
 
     const QString accountPath(imAccount(accountWrapper));
 
-    qWarning() << "CDTpStorage: updateAccount:" << accountPath << asString(changes);
+    logEvent(EventUpdateAccount, accountPath, changes);
+    qCDebug(lcContactsd) << "CDTpStorage: updateAccount:" << accountPath << asString(changes);
 
     foreach (QContactOnlineAccount existingAccount, self.details<QContactOnlineAccount>()) {
         const QString existingPath(stringValue(existingAccount, QContactOnlineAccount__FieldAccountPath));
@@ -2489,6 +2175,7 @@ void CDTpStorage::updateAccount(CDTpAccountPtr accountWrapper, CDTpAccount::Chan
 
 void CDTpStorage::removeAccount(CDTpAccountPtr accountWrapper)
 {
+    cancelImport(imAccount(accountWrapper));
     cancelQueuedUpdates(accountContacts(accountWrapper));
 
     QContact self(selfContact(telepathyCollectionId(imAccount(accountWrapper))));
@@ -2500,7 +2187,8 @@ void CDTpStorage::removeAccount(CDTpAccountPtr accountWrapper)
 
     const QString accountPath(imAccount(accountWrapper));
 
-    qWarning() << "CDTpStorage: removeAccount:" << accountPath;
+    logEvent(EventRemoveAccount, accountPath);
+    qCDebug(lcContactsd) << "CDTpStorage: removeAccount:" << accountPath;
 
     foreach (QContactOnlineAccount existingAccount, self.details<QContactOnlineAccount>()) {
         const QString existingPath(stringValue(existingAccount, QContactOnlineAccount__FieldAccountPath));
@@ -2526,7 +2214,8 @@ void CDTpStorage::syncAccountContacts(CDTpAccountPtr accountWrapper)
 
     const QString accountPath(imAccount(accountWrapper));
 
-    qWarning() << "CDTpStorage: syncAccountContacts (roster change):" << accountPath;
+    logEvent(EventSyncAccountContacts, accountPath);
+    qCDebug(lcContactsd) << "CDTpStorage: syncAccountContacts (roster change):" << accountPath;
 
     foreach (QContactOnlineAccount existingAccount, self.details<QContactOnlineAccount>()) {
         const QString existingPath(stringValue(existingAccount, QContactOnlineAccount__FieldAccountPath));
@@ -2544,8 +2233,9 @@ void CDTpStorage::syncAccountContactsDetailed(CDTpAccountPtr accountWrapper, con
 {
     const QString accountPath(imAccount(accountWrapper));
 
-    qWarning() << "CDTpStorage: syncAccountContacts (roster update):" << accountPath
-               << contactsAdded.count() << contactsRemoved.count();
+    logEvent(EventSyncAccountContactsDetailed, accountPath, contactsAdded.count(), contactsRemoved.count());
+    qCDebug(lcContactsd) << "CDTpStorage: syncAccountContacts (roster update):" << accountPath
+                         << contactsAdded.count() << contactsRemoved.count();
 
     // Ensure there are no duplicates in the list
     QList<CDTpContactPtr> addedContacts(contactsAdded.toSet().toList());
@@ -2618,7 +2308,8 @@ void CDTpStorage::createAccountContacts(CDTpAccountPtr accountWrapper, const QSt
 
     const QString accountPath(imAccount(accountWrapper));
 
-    qWarning() << "CDTpStorage: createAccountContacts:" << accountPath << imIds.count();
+    logEvent(EventCreateAccountContacts, accountPath, imIds.count());
+    qCDebug(lcContactsd) << "CDTpStorage: createAccountContacts:" << accountPath << imIds.count();
 
     ContactChangeSet saveSet;
 
@@ -2639,11 +2330,14 @@ void CDTpStorage::removeAccountContacts(CDTpAccountPtr accountWrapper, const QSt
 {
     const QString accountPath(imAccount(accountWrapper));
 
-    qWarning() << "CDTpStorage: removeAccountContacts:" << accountPath << contactIds.count();
+    logEvent(EventRemoveAccountContacts, accountPath, contactIds.count());
+    qCDebug(lcContactsd) << "CDTpStorage: removeAccountContacts:" << accountPath << contactIds.count();
 
     QStringList imAddressList;
     foreach (const QString &id, contactIds) {
         imAddressList.append(imAddress(accountPath, id));
+        mAvatarStore.release(imAddressList.last());
+        mAvatarStore.release(squareAvatarOwner(imAddressList.last()));
     }
 
     QList<QContactId> removeIds;
@@ -2666,6 +2360,7 @@ void CDTpStorage::removeAccountContacts(CDTpAccountPtr accountWrapper, const QSt
 void CDTpStorage::updateContact(CDTpContactPtr contactWrapper, CDTpContact::Changes changes)
 {
     mUpdateQueue[contactWrapper] |= changes;
+    Statistics::setGauge(QStringLiteral("telepathy.updateQueueDepth"), mUpdateQueue.count());
 
     // Only update IM contacts after not receiving an update notification for the defined period
     // Also use an upper limit to keep latency within acceptable bounds.
@@ -2683,6 +2378,8 @@ void CDTpStorage::updateContact(CDTpContactPtr contactWrapper, CDTpContact::Chan
 
 void CDTpStorage::onUpdateQueueTimeout()
 {
+    // The latency of an update, from being queued until it is flushed
+    Statistics::record(QStringLiteral("telepathy.updateQueueLatency"), mWaitTimer.elapsed());
     mWaitTimer.invalidate();
 
     qCDebug(lcContactsd) << "Update" << mUpdateQueue.count() << "contacts";
@@ -2702,6 +2399,7 @@ void CDTpStorage::onUpdateQueueTimeout()
     }
 
     mUpdateQueue.clear();
+    Statistics::setGauge(QStringLiteral("telepathy.updateQueueDepth"), 0);
 
     // Retrieve the existing contacts
     QHash<QString, QContact> existingContacts;
@@ -2746,6 +2444,7 @@ void CDTpStorage::cancelQueuedUpdates(const QList<CDTpContactPtr> &contacts)
     foreach (const CDTpContactPtr &contactWrapper, contacts) {
         mUpdateQueue.remove(contactWrapper);
     }
+    Statistics::setGauge(QStringLiteral("telepathy.updateQueueDepth"), mUpdateQueue.count());
 }
 
 void CDTpStorage::reportPresenceStates()
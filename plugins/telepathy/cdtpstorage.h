@@ -38,6 +38,8 @@
 #include <MDConfItem>
 
 #include "cdtpaccount.h"
+#include "cdtpavatarfetcher.h"
+#include "cdtpavatarstore.h"
 #include "cdtpcontact.h"
 
 QTCONTACTS_USE_NAMESPACE
@@ -58,12 +60,16 @@ public:
     CDTpStorage(QObject *parent = 0);
     ~CDTpStorage();
 
+    // True while the roster of a created account is still being imported
+    bool isImporting() const { return !mImportTasks.isEmpty(); }
+
 Q_SIGNALS:
     void error(int code, const QString &message);
+    // The roster of an account passed to createAccount() has been stored
+    void accountImported(CDTpAccountPtr accountWrapper);
 
 public Q_SLOTS:
     void syncAccounts(const QList<CDTpAccountPtr> &accounts);
-    void syncAccountsForSelfContact(const QList<CDTpAccountPtr> &accounts, QContact &self);
     void createAccount(CDTpAccountPtr accountWrapper);
     void updateAccount(CDTpAccountPtr accountWrapper, CDTpAccount::Changes changes);
     void removeAccount(CDTpAccountPtr accountWrapper);
@@ -88,9 +94,11 @@ private Q_SLOTS:
 
 private:
     void cancelQueuedUpdates(const QList<CDTpContactPtr> &contacts);
+    void cancelImport(const QString &accountPath);
 
     void addNewAccount(QContact &self, CDTpAccountPtr accountWrapper);
     void removeExistingAccount(QContact &self, QContactOnlineAccount &existing);
+    void syncAccountCollection(CDTpAccountPtr accountWrapper, const QContactCollectionId &collectionId);
 
     void updateAccountChanges(QContact &self, QContactOnlineAccount &qcoa, CDTpAccountPtr accountWrapper,
                               CDTpAccount::Changes changes);
@@ -105,10 +113,13 @@ private:
 
 private:
     QNetworkAccessManager mNetwork;
+    CDTpAvatarStore mAvatarStore;
+    CDTpAvatarFetcher mAvatarFetcher;
     QHash<CDTpContactPtr, CDTpContact::Changes> mUpdateQueue;
     QTimer mUpdateTimer;
     QElapsedTimer mWaitTimer;
     QMap<QString, CDTpAccount::Changes> m_accountPendingChanges;
+    QHash<QString, int> mImportTasks;              // account path -> roster import task
     CDTpDevicePresence *mDevicePresence;
     DisplayLabelOrder mDisplayLabelOrder;
     MDConfItem mDisplayLabelOrderConf;
@@ -0,0 +1,528 @@
+/** This file is part of Contacts daemon
+ **
+ ** Copyright (c) 2026 Jolla Ltd.
+ **
+ ** GNU Lesser General Public License Usage
+ ** This file may be used under the terms of the GNU Lesser General Public License
+ ** version 2.1 as published by the Free Software Foundation and appearing in the
+ ** file LICENSE.LGPL included in the packaging of this file.  Please review the
+ ** following information to ensure the GNU Lesser General Public License version
+ ** 2.1 requirements will be met:
+ ** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+ **/
+
+#include "cdtpstoragehelpers.h"
+
+#include <QDate>
+#include <QHash>
+
+#include <seasidecache.h>
+
+#include "debug.h"
+
+namespace {
+
+QString asString(const Tp::ContactInfoField &field, int i)
+{
+    if (i >= field.fieldValue.count()) {
+        return QLatin1String("");
+    }
+
+    return field.fieldValue[i];
+}
+
+QStringList asStringList(const Tp::ContactInfoField &field, int i)
+{
+    QStringList rv;
+
+    while (i < field.fieldValue.count()) {
+        rv.append(field.fieldValue[i].trimmed());
+        ++i;
+    }
+
+    return rv;
+}
+
+typedef QHash<QString, int> Dictionary;
+
+Dictionary initPhoneTypes()
+{
+    Dictionary types;
+
+    types.insert(QLatin1String("bbsl"), QContactPhoneNumber::SubTypeBulletinBoardSystem);
+    types.insert(QLatin1String("car"), QContactPhoneNumber::SubTypeCar);
+    types.insert(QLatin1String("cell"), QContactPhoneNumber::SubTypeMobile);
+    types.insert(QLatin1String("fax"), QContactPhoneNumber::SubTypeFax);
+    types.insert(QLatin1String("modem"), QContactPhoneNumber::SubTypeModem);
+    types.insert(QLatin1String("pager"), QContactPhoneNumber::SubTypePager);
+    types.insert(QLatin1String("video"), QContactPhoneNumber::SubTypeVideo);
+    types.insert(QLatin1String("voice"), QContactPhoneNumber::SubTypeVoice);
+    // Not sure about these types:
+    types.insert(QLatin1String("isdn"), QContactPhoneNumber::SubTypeLandline);
+    types.insert(QLatin1String("pcs"), QContactPhoneNumber::SubTypeLandline);
+
+    return types;
+}
+
+const Dictionary &phoneTypes()
+{
+    static Dictionary types(initPhoneTypes());
+    return types;
+}
+
+Dictionary initAddressTypes()
+{
+    Dictionary types;
+
+    types.insert(QLatin1String("dom"), QContactAddress::SubTypeDomestic);
+    types.insert(QLatin1String("intl"), QContactAddress::SubTypeInternational);
+    types.insert(QLatin1String("parcel"), QContactAddress::SubTypeParcel);
+    types.insert(QLatin1String("postal"), QContactAddress::SubTypePostal);
+
+    return types;
+}
+
+const Dictionary &addressTypes()
+{
+    static Dictionary types(initAddressTypes());
+    return types;
+}
+
+Dictionary initGenderTypes()
+{
+    Dictionary types;
+
+    types.insert(QLatin1String("f"), QContactGender::GenderFemale);
+    types.insert(QLatin1String("female"), QContactGender::GenderFemale);
+    types.insert(QLatin1String("m"), QContactGender::GenderMale);
+    types.insert(QLatin1String("male"), QContactGender::GenderMale);
+
+    return types;
+}
+
+const Dictionary &genderTypes()
+{
+    static Dictionary types(initGenderTypes());
+    return types;
+}
+
+template<typename F1, typename F2>
+void replaceNameDetail(F1 getter, F2 setter, QContactName *nameDetail, const QString &value)
+{
+    if (!value.isEmpty()) {
+        (nameDetail->*setter)(value);
+    } else {
+        // If there is an existing value, remove it
+        QString existing((nameDetail->*getter)());
+        if (!existing.isEmpty()) {
+            (nameDetail->*setter)(value);
+        }
+    }
+}
+
+bool nameScriptImpliesFamilyFirst(const QString &firstName, const QString &lastName)
+{
+    switch (nameScript(firstName, lastName)) {
+    // These scripts are used by cultures that conform to the family-name-first naming convention:
+    case QChar::Script_Han:
+    case QChar::Script_Lao:
+    case QChar::Script_Hangul:
+    case QChar::Script_Khmer:
+    case QChar::Script_Mongolian:
+    case QChar::Script_Hiragana:
+    case QChar::Script_Katakana:
+    case QChar::Script_Bopomofo:
+    case QChar::Script_Yi:
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool needsSpaceBetweenNames(const QString &first, const QString &second)
+{
+    if (first.isEmpty() || second.isEmpty()) {
+        return false;
+    }
+    return first[first.length()-1].script() != QChar::Script_Han
+            || second[0].script() != QChar::Script_Han;
+}
+
+bool isOnlinePresence(Tp::ConnectionPresenceType presenceType, Tp::AccountPtr account)
+{
+    switch (presenceType) {
+    // Why??
+    case Tp::ConnectionPresenceTypeOffline:
+        return account->protocolName() == QLatin1String("skype");
+
+    case Tp::ConnectionPresenceTypeUnset:
+    case Tp::ConnectionPresenceTypeUnknown:
+    case Tp::ConnectionPresenceTypeError:
+        return false;
+
+    default:
+        break;
+    }
+
+    return true;
+}
+
+}
+
+QChar::Script nameScript(const QString &name)
+{
+    QChar::Script script(QChar::Script_Unknown);
+
+    if (!name.isEmpty()) {
+        QString::const_iterator it = name.begin(), end = name.end();
+        for ( ; it != end; ++it) {
+            const QChar::Category charCategory((*it).category());
+            if (charCategory >= QChar::Letter_Uppercase && charCategory <= QChar::Letter_Other) {
+                const QChar::Script charScript((*it).script());
+                if (script == QChar::Script_Unknown) {
+                    script = charScript;
+                } else if (charScript != script) {
+                    return QChar::Script_Unknown;
+                }
+            }
+        }
+    }
+
+    return script;
+}
+
+QChar::Script nameScript(const QString &firstName, const QString &lastName)
+{
+    if (firstName.isEmpty()) {
+        return nameScript(lastName);
+    } else if (lastName.isEmpty()) {
+        return nameScript(firstName);
+    }
+
+    QChar::Script firstScript(nameScript(firstName));
+    if (firstScript != QChar::Script_Unknown) {
+        QChar::Script lastScript(nameScript(lastName));
+        if (lastScript == firstScript) {
+            return lastScript;
+        }
+    }
+
+    return QChar::Script_Unknown;
+}
+
+QString generateDisplayLabel(const QContactName &nameDetail, CDTpStorage::DisplayLabelOrder order)
+{
+    // Simplified version of the SeasideCache displayLabel generator
+    QString rv;
+
+    QString nameStr1(nameDetail.firstName());
+    QString nameStr2(nameDetail.lastName());
+
+    const bool familyNameFirst(order == CDTpStorage::LastNameFirst || nameScriptImpliesFamilyFirst(nameStr1, nameStr2));
+    if (familyNameFirst) {
+        nameStr1 = nameDetail.lastName();
+        nameStr2 = nameDetail.firstName();
+    }
+
+    if (!nameStr1.isEmpty())
+        rv.append(nameStr1);
+
+    if (!nameStr2.isEmpty()) {
+        if (needsSpaceBetweenNames(nameStr1, nameStr2)) {
+            rv.append(QLatin1Char(' '));
+        }
+        rv.append(nameStr2);
+    }
+
+    return rv;
+}
+
+QString asString(CDTpContact::Info::Capability c)
+{
+    switch (c) {
+    case CDTpContact::Info::TextChats:
+        return QLatin1String("TextChats");
+    case CDTpContact::Info::StreamedMediaCalls:
+        return QLatin1String("StreamedMediaCalls");
+    case CDTpContact::Info::StreamedMediaAudioCalls:
+        return QLatin1String("StreamedMediaAudioCalls");
+    case CDTpContact::Info::StreamedMediaAudioVideoCalls:
+        return QLatin1String("StreamedMediaAudioVideoCalls");
+    case CDTpContact::Info::UpgradingStreamMediaCalls:
+        return QLatin1String("UpgradingStreamMediaCalls");
+    case CDTpContact::Info::FileTransfers:
+        return QLatin1String("FileTransfers");
+    case CDTpContact::Info::StreamTubes:
+        return QLatin1String("StreamTubes");
+    case CDTpContact::Info::DBusTubes:
+        return QLatin1String("DBusTubes");
+    default:
+        break;
+    }
+
+    return QString();
+}
+
+QStringList currentCapabilites(const Tp::CapabilitiesBase &capabilities,
+                               Tp::ConnectionPresenceType presenceType,
+                               Tp::AccountPtr account)
+{
+    QStringList current;
+
+    if (capabilities.textChats()) {
+        current << asString(CDTpContact::Info::TextChats);
+    }
+
+    if (isOnlinePresence(presenceType, account)) {
+        if (capabilities.streamedMediaCalls()) {
+            current << asString(CDTpContact::Info::StreamedMediaCalls);
+        }
+        if (capabilities.streamedMediaAudioCalls()) {
+            current << asString(CDTpContact::Info::StreamedMediaAudioCalls);
+        }
+        if (capabilities.streamedMediaVideoCalls()) {
+            current << asString(CDTpContact::Info::StreamedMediaAudioVideoCalls);
+        }
+        if (capabilities.upgradingStreamedMediaCalls()) {
+            current << asString(CDTpContact::Info::UpgradingStreamMediaCalls);
+        }
+        if (capabilities.fileTransfers()) {
+            current << asString(CDTpContact::Info::FileTransfers);
+        }
+    }
+
+    return current;
+}
+
+QString imAddress(const QString &accountPath, const QString &contactId)
+{
+    static const QString tmpl = QString::fromLatin1("%1!%2");
+    return tmpl.arg(accountPath, contactId.isEmpty() ? QLatin1String("self") : contactId);
+}
+
+ContactInfoDetails contactInfoDetails(const Tp::ContactInfoFieldList &listContactInfo)
+{
+    ContactInfoDetails info;
+
+    if (listContactInfo.count() != 0) {
+        const int defaultContext(QContactDetail::ContextOther);
+        const int homeContext(QContactDetail::ContextHome);
+        const int workContext(QContactDetail::ContextWork);
+
+        QContactOrganization organizationDetail;
+        QContactName nameDetail;
+        QString formattedName;
+        bool structuredName = false;
+
+        // Add any information reported by telepathy
+        foreach (const Tp::ContactInfoField &field, listContactInfo) {
+            if (field.fieldValue.count() == 0) {
+                continue;
+            }
+
+            // Extract field types
+            QStringList subTypes;
+            int detailContext = -1;
+            const int invalidContext = -1;
+
+            foreach (const QString &param, field.parameters) {
+                if (!param.startsWith(QLatin1String("type="))) {
+                    continue;
+                }
+                const QString type = param.mid(5);
+                if (type == QLatin1String("home")) {
+                    detailContext = homeContext;
+                } else if (type == QLatin1String("work")) {
+                    detailContext = workContext;
+                } else if (!subTypes.contains(type)){
+                    subTypes << type;
+                }
+            }
+
+            if (field.fieldName == QLatin1String("tel")) {
+                QList<int> selectedTypes;
+                foreach (const QString &type, subTypes) {
+                    Dictionary::const_iterator it = phoneTypes().find(type.toLower());
+                    if (it != phoneTypes().constEnd()) {
+                        selectedTypes.append(*it);
+                    }
+                }
+                if (selectedTypes.isEmpty()) {
+                    // Assume landline
+                    selectedTypes.append(QContactPhoneNumber::SubTypeLandline);
+                }
+
+                QContactPhoneNumber phoneNumberDetail;
+                phoneNumberDetail.setContexts(detailContext == invalidContext ? defaultContext : detailContext);
+                phoneNumberDetail.setNumber(asString(field, 0).trimmed());
+                phoneNumberDetail.setSubTypes(selectedTypes);
+
+                info.phoneNumbers.append(phoneNumberDetail);
+            } else if (field.fieldName == QLatin1String("adr")) {
+                QList<int> selectedTypes;
+                foreach (const QString &type, subTypes) {
+                    Dictionary::const_iterator it = addressTypes().find(type.toLower());
+                    if (it != addressTypes().constEnd()) {
+                        selectedTypes.append(*it);
+                    }
+                }
+
+                // QContactAddress does not support extended street address, so combine the fields
+                QStringList streetParts;
+                for (int i = 1; i <= 2; ++i) {
+                    QString part(asString(field, i).trimmed());
+                    if (!part.isEmpty()) {
+                        streetParts.append(part);
+                    }
+                }
+
+                QContactAddress addressDetail;
+                if (detailContext != invalidContext) {
+                    addressDetail.setContexts(detailContext);
+                }
+                if (selectedTypes.isEmpty()) {
+                    addressDetail.setSubTypes(selectedTypes);
+                }
+                addressDetail.setPostOfficeBox(asString(field, 0).trimmed());
+                addressDetail.setStreet(streetParts.join(QString::fromLatin1("\n")));
+                addressDetail.setLocality(asString(field, 3).trimmed());
+                addressDetail.setRegion(asString(field, 4).trimmed());
+                addressDetail.setPostcode(asString(field, 5).trimmed());
+                addressDetail.setCountry(asString(field, 6).trimmed());
+
+                info.addresses.append(addressDetail);
+            } else if (field.fieldName == QLatin1String("email")) {
+                QContactEmailAddress emailDetail;
+                if (detailContext != invalidContext) {
+                    emailDetail.setContexts(detailContext);
+                }
+                emailDetail.setEmailAddress(asString(field, 0).trimmed());
+
+                info.emailAddresses.append(emailDetail);
+            } else if (field.fieldName == QLatin1String("url")) {
+                QContactUrl urlDetail;
+                if (detailContext != invalidContext) {
+                    urlDetail.setContexts(detailContext);
+                }
+                urlDetail.setUrl(asString(field, 0).trimmed());
+
+                info.urls.append(urlDetail);
+            } else if (field.fieldName == QLatin1String("title")) {
+                organizationDetail.setTitle(asString(field, 0).trimmed());
+                if (detailContext != invalidContext) {
+                    organizationDetail.setContexts(detailContext);
+                }
+            } else if (field.fieldName == QLatin1String("role")) {
+                organizationDetail.setRole(asString(field, 0).trimmed());
+                if (detailContext != invalidContext) {
+                    organizationDetail.setContexts(detailContext);
+                }
+            } else if (field.fieldName == QLatin1String("org")) {
+                organizationDetail.setName(asString(field, 0).trimmed());
+                organizationDetail.setDepartment(asStringList(field, 1));
+                if (detailContext != invalidContext) {
+                    organizationDetail.setContexts(detailContext);
+                }
+
+                info.organizations.append(organizationDetail);
+
+                // Clear out the stored details
+                organizationDetail = QContactOrganization();
+            } else if (field.fieldName == QLatin1String("n")) {
+                if (detailContext != invalidContext) {
+                    nameDetail.setContexts(detailContext);
+                }
+
+                replaceNameDetail(&QContactName::lastName, &QContactName::setLastName, &nameDetail, asString(field, 0).trimmed());
+                replaceNameDetail(&QContactName::firstName, &QContactName::setFirstName, &nameDetail, asString(field, 1).trimmed());
+                replaceNameDetail(&QContactName::middleName, &QContactName::setMiddleName, &nameDetail, asString(field, 2).trimmed());
+                replaceNameDetail(&QContactName::prefix, &QContactName::setPrefix, &nameDetail, asString(field, 3).trimmed());
+                replaceNameDetail(&QContactName::suffix, &QContactName::setSuffix, &nameDetail, asString(field, 4).trimmed());
+
+                structuredName = true;
+            } else if (field.fieldName == QLatin1String("fn")) {
+                const QString fn(asString(field, 0).trimmed());
+                if (!fn.isEmpty()) {
+                    if (detailContext != invalidContext) {
+                        nameDetail.setContexts(detailContext);
+                    }
+                    formattedName = fn;
+                }
+            } else if (field.fieldName == QLatin1String("nickname")) {
+                const QString nickname(asString(field, 0).trimmed());
+                if (!nickname.isEmpty()) {
+                    QContactNickname nicknameDetail;
+                    nicknameDetail.setNickname(nickname);
+                    if (detailContext != invalidContext) {
+                        nicknameDetail.setContexts(detailContext);
+                    }
+
+                    info.nicknames.append(nicknameDetail);
+
+                    // Use the nickname as the customLabel if we have no 'fn' data
+                    if (formattedName.isEmpty()) {
+                        formattedName = nickname;
+                    }
+                }
+            } else if (field.fieldName == QLatin1String("note")
+                       || field.fieldName == QLatin1String("desc")) {
+                QContactNote noteDetail;
+                if (detailContext != invalidContext) {
+                    noteDetail.setContexts(detailContext);
+                }
+                noteDetail.setNote(asString(field, 0).trimmed());
+
+                info.notes.append(noteDetail);
+            } else if (field.fieldName == QLatin1String("bday")) {
+                // FIXME: support more date format for compatibility
+                const QString dateText(asString(field, 0));
+
+                QDate date = QDate::fromString(dateText, QLatin1String("yyyy-MM-dd"));
+                if (!date.isValid()) {
+                    date = QDate::fromString(dateText, QLatin1String("yyyyMMdd"));
+                }
+                if (!date.isValid()) {
+                    date = QDate::fromString(dateText, Qt::ISODate);
+                }
+
+                if (date.isValid()) {
+                    QContactBirthday birthdayDetail;
+                    birthdayDetail.setDate(date);
+
+                    info.birthday = birthdayDetail;
+                } else {
+                    qCDebug(lcContactsd) << "Unsupported bday format:" << field.fieldValue[0];
+                }
+            } else if (field.fieldName == QLatin1String("x-gender")) {
+                const QString type(field.fieldValue.at(0));
+
+                Dictionary::const_iterator it = genderTypes().find(type.toLower());
+                if (it != addressTypes().constEnd()) {
+                    QContactGender genderDetail;
+                    genderDetail.setGender(static_cast<QContactGender::GenderType>(*it));
+
+                    info.gender = genderDetail;
+                } else {
+                    qCDebug(lcContactsd) << "Unsupported gender type:" << type;
+                }
+            } else {
+                qCDebug(lcContactsd) << "Unsupported contact info field" << field.fieldName;
+            }
+        }
+
+        if (structuredName || !formattedName.isEmpty()) {
+            if (!structuredName) {
+                SeasideCache::decomposeDisplayLabel(formattedName, &nameDetail);
+            }
+
+            if (!formattedName.isEmpty()) {
+                nameDetail.setValue(QContactName::FieldCustomLabel, formattedName);
+            }
+
+            info.name = nameDetail;
+        }
+    }
+
+    return info;
+}
+
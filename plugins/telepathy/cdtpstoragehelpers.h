@@ -0,0 +1,76 @@
+/** This file is part of Contacts daemon
+ **
+ ** Copyright (c) 2026 Jolla Ltd.
+ **
+ ** GNU Lesser General Public License Usage
+ ** This file may be used under the terms of the GNU Lesser General Public License
+ ** version 2.1 as published by the Free Software Foundation and appearing in the
+ ** file LICENSE.LGPL included in the packaging of this file.  Please review the
+ ** following information to ensure the GNU Lesser General Public License version
+ ** 2.1 requirements will be met:
+ ** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+ **/
+
+#ifndef CDTPSTORAGEHELPERS_H
+#define CDTPSTORAGEHELPERS_H
+
+#include <QChar>
+#include <QList>
+#include <QString>
+#include <QStringList>
+
+#include <QContactAddress>
+#include <QContactBirthday>
+#include <QContactEmailAddress>
+#include <QContactGender>
+#include <QContactName>
+#include <QContactNickname>
+#include <QContactNote>
+#include <QContactOrganization>
+#include <QContactPhoneNumber>
+#include <QContactUrl>
+
+#include <TelepathyQt/Account>
+#include <TelepathyQt/CapabilitiesBase>
+#include <TelepathyQt/Constants>
+#include <TelepathyQt/Types>
+
+#include "cdtpcontact.h"
+#include "cdtpstorage.h"
+
+QTCONTACTS_USE_NAMESPACE
+
+// Conversions used by CDTpStorage which need neither a contacts database nor
+// a telepathy connection, so that they can be benchmarked on their own.
+
+struct ContactInfoDetails
+{
+    QList<QContactAddress> addresses;
+    QContactBirthday birthday;
+    QList<QContactEmailAddress> emailAddresses;
+    QContactGender gender;
+    QContactName name;
+    QList<QContactNickname> nicknames;
+    QList<QContactNote> notes;
+    QList<QContactOrganization> organizations;
+    QList<QContactPhoneNumber> phoneNumbers;
+    QList<QContactUrl> urls;
+};
+
+// Convert the contact info fields reported by telepathy into contact details
+ContactInfoDetails contactInfoDetails(const Tp::ContactInfoFieldList &listContactInfo);
+
+// The script of the letters in the name(s), or Script_Unknown if they are mixed
+QChar::Script nameScript(const QString &name);
+QChar::Script nameScript(const QString &firstName, const QString &lastName);
+QString generateDisplayLabel(const QContactName &nameDetail, CDTpStorage::DisplayLabelOrder order);
+
+QString asString(CDTpContact::Info::Capability c);
+QStringList currentCapabilites(const Tp::CapabilitiesBase &capabilities,
+                               Tp::ConnectionPresenceType presenceType,
+                               Tp::AccountPtr account);
+
+// The address of a contact of the account, or of its self contact without contactId
+QString imAddress(const QString &accountPath, const QString &contactId = QString());
+
+#endif // CDTPSTORAGEHELPERS_H
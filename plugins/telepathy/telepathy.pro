@@ -45,12 +45,16 @@ HEADERS  = cdtpaccount.h \
     cdtpaccountcache.h \
     cdtpaccountcacheloader.h \
     cdtpaccountcachewriter.h \
+    cdtpavatarfetcher.h \
+    cdtpavatarstore.h \
+    cdtpavatarwriter.h \
     types.h \
     cdtpcontact.h \
     cdtpcontroller.h \
     cdtpdevicepresence.h \
     cdtpplugin.h \
     cdtpstorage.h \
+    cdtpstoragehelpers.h \
     buddymanagementadaptor.h \
     devicepresenceadaptor.h \
     cdtpavatarupdate.h
@@ -58,11 +62,15 @@ HEADERS  = cdtpaccount.h \
 SOURCES  = cdtpaccount.cpp \
     cdtpaccountcacheloader.cpp \
     cdtpaccountcachewriter.cpp \
+    cdtpavatarfetcher.cpp \
+    cdtpavatarstore.cpp \
+    cdtpavatarwriter.cpp \
     cdtpcontact.cpp \
     cdtpcontroller.cpp \
     cdtpdevicepresence.cpp \
     cdtpplugin.cpp \
     cdtpstorage.cpp \
+    cdtpstoragehelpers.cpp \
     buddymanagementadaptor.cpp \
     devicepresenceadaptor.cpp \
     cdtpavatarupdate.cpp
@@ -78,5 +86,6 @@ xml.path = $$INCLUDEDIR/$${VERSIONED_PACKAGENAME}
 INSTALLS += target xml
 
 OTHER_FILES += \
+    telepathy.json \
     org.nemomobile.DevicePresenceIf.xml \
     com.nokia.contacts.buddymanagement.xml
@@ -76,6 +76,7 @@ export VERSION=%{version}
 
 mkdir -p %{buildroot}%{_userunitdir}/post-user-session.target.wants
 ln -s ../%{name}.service %{buildroot}%{_userunitdir}/post-user-session.target.wants/
+ln -s ../%{name}-catchup.timer %{buildroot}%{_userunitdir}/post-user-session.target.wants/
 
 mkdir -p %{buildroot}%{_datadir}/mapplauncherd/privileges.d
 install -m 644 -p %{SOURCE1} %{buildroot}%{_datadir}/mapplauncherd/privileges.d
@@ -97,6 +98,10 @@ fi
 %license LGPL_EXCEPTION.txt
 %{_userunitdir}/%{name}.service
 %{_userunitdir}/post-user-session.target.wants/%{name}.service
+%{_userunitdir}/%{name}-catchup.timer
+%{_userunitdir}/post-user-session.target.wants/%{name}-catchup.timer
+%{_datadir}/dbus-1/services/com.nokia.contactsd.service
+%{_datadir}/dbus-1/services/org.nemomobile.DevicePresence.service
 %{_bindir}/%{name}
 %{_libdir}/%{name}-1.0
 %{_datadir}/translations/*.qm
@@ -26,18 +26,28 @@
 #include <QDBusConnection>
 #include <QDBusError>
 #include <QDir>
+#include <QTimer>
 
 #include "contactsd.h"
+#include "base-plugin.h"
 #include "contactsdpluginloader.h"
+#include "memorymonitor.h"
 #include "synctrigger.h"
 #include "debug.h"
+#include "startup-timeline.h"
+#include "statistics.h"
 
 #include <unistd.h>
 #include <errno.h>
 #include <sys/socket.h>
+#include <signal.h>
 
 using namespace Contactsd;
 
+// Plugins keep starting up asynchronously after their init(), e.g. waiting for
+// the account manager, so the trace is written some time after they were loaded
+static const int STARTUP_TRACE_DELAY = 30 * 1000; // ms
+
 /*!
   \class ContactsDaemon
 
@@ -45,11 +55,13 @@ using namespace Contactsd;
 */
 
 /*!
-  \fn void ContactsDaemon::loadPlugins(const QStringList &plugins)
+  \fn void ContactsDaemon::loadPlugins(const QStringList &plugins, bool deferredInit)
 
   Load plugins specified at \a plugins.
 
   \param loadPlugins The names of the plugins to load.
+  \param deferredInit Whether plugins may ask for their initialization to be
+  deferred until the main loop is running.
 */
 
 /*!
@@ -60,14 +72,44 @@ using namespace Contactsd;
   \return A list of plugin names.
 */
 
+/*!
+  \fn void ContactsDaemon::setStartupTracePath(const QString &path)
+
+  Write the startup timeline as a Chrome trace event file to \a path, once
+  the plugins have started up or when the daemon exits, whichever is first.
+*/
+
+/*!
+  \fn void ContactsDaemon::setIdleExitTimeout(int seconds)
+
+  Exit once no import has started or ended for \a seconds, if every plugin
+  is idle; zero keeps the daemon running. The daemon then exits with
+  IdleExitStatus, and is started again on demand through D-Bus activation
+  of its services, or by the catch-up timer so that plugins following
+  changes made elsewhere are not left behind for long. While some plugin is
+  busy or must stay resident, the daemon keeps running with its caches; they
+  are only released under memory pressure.
+*/
+
 int ContactsDaemon::sigFd[2] = {0, 0};
 
 ContactsDaemon::ContactsDaemon(QObject *parent)
     : QObject(parent),
       mDBusConnection(QDBusConnection::sessionBus()),
       mLoader(new ContactsdPluginLoader(&mDBusConnection)),
-      mSyncTrigger(new SyncTrigger(&mDBusConnection))
+      mSyncTrigger(new SyncTrigger(&mDBusConnection)),
+      mMemoryMonitor(new MemoryMonitor(this)),
+      mStartupTraceDumped(false)
 {
+    StartupTimeline::mark(QStringLiteral("contactsd"), QStringLiteral("daemon created"));
+
+    // Plugins trigger syncs in process, which also works while the daemon shuts down
+    BasePlugin::setSyncTriggerHandler([this](const QStringList &accountProviders,
+                                             BasePlugin::SyncPolicy syncPolicy,
+                                             BasePlugin::DirectionPolicy directionPolicy) {
+        mSyncTrigger->triggerSync(accountProviders, syncPolicy, directionPolicy);
+    });
+
     if (!mDBusConnection.isConnected()) {
         qCWarning(lcContactsd) << "Could not connect to DBus:" << mDBusConnection.lastError();
     } else if (!mDBusConnection.registerService(QStringLiteral("com.nokia.contactsd"))) {
@@ -77,8 +119,38 @@ ContactsDaemon::ContactsDaemon(QObject *parent)
         qCWarning(lcContactsd) << "unable to register notification service";
     } else if (!mSyncTrigger->registerTriggerService()) {
         qCWarning(lcContactsd) << "unable to register sync trigger service";
+    } else if (!mDBusConnection.registerObject(QStringLiteral("/StartupTimeline"), StartupTimeline::instance(),
+                                               QDBusConnection::ExportAllSlots)) {
+        qCWarning(lcContactsd) << "Could not register DBus object '/StartupTimeline':" << mDBusConnection.lastError();
+    } else if (!mDBusConnection.registerObject(QStringLiteral("/MemoryPressure"), mMemoryMonitor,
+                                               QDBusConnection::ExportAllSlots)) {
+        qCWarning(lcContactsd) << "Could not register DBus object '/MemoryPressure':" << mDBusConnection.lastError();
+    } else if (!mDBusConnection.registerObject(QStringLiteral("/Statistics"), Statistics::instance(),
+                                               QDBusConnection::ExportAllSlots)) {
+        qCWarning(lcContactsd) << "Could not register DBus object '/Statistics':" << mDBusConnection.lastError();
+    } else if (!mDBusConnection.registerObject(QStringLiteral("/EventLog"), EventLog::instance(),
+                                               QDBusConnection::ExportAllSlots)) {
+        qCWarning(lcContactsd) << "Could not register DBus object '/EventLog':" << mDBusConnection.lastError();
     }
 
+    // Plugins drop their caches before the heap is trimmed
+    connect(mMemoryMonitor, &MemoryMonitor::releaseCachesRequested,
+            mLoader, &ContactsdPluginLoader::releaseCaches);
+    mMemoryMonitor->startPressureMonitor();
+
+    connect(mLoader, &ContactsdPluginLoader::pluginsLoaded,
+            this, &ContactsDaemon::onPluginsLoaded);
+
+    mIdleTimer.setSingleShot(true);
+    connect(&mIdleTimer, &QTimer::timeout,
+            this, &ContactsDaemon::onIdleTimeout);
+    connect(mLoader, &ContactsdPluginLoader::importStarted,
+            this, &ContactsDaemon::restartIdleTimer);
+    connect(mLoader, &ContactsdPluginLoader::importStateChanged,
+            this, &ContactsDaemon::restartIdleTimer);
+    connect(mLoader, &ContactsdPluginLoader::importEnded,
+            this, &ContactsDaemon::restartIdleTimer);
+
     // The UNIX signals call unixSignalHandler(), but that is not called
     // through the main loop. To process signals in the mainloop correctly,
     // we create a socket, and write a byte on one end when the UNIX signal
@@ -95,13 +167,22 @@ ContactsDaemon::ContactsDaemon(QObject *parent)
 
 ContactsDaemon::~ContactsDaemon()
 {
+    dumpStartupTrace();
+
+    mDBusConnection.unregisterObject(QStringLiteral("/EventLog"));
+    mDBusConnection.unregisterObject(QStringLiteral("/Statistics"));
+    mDBusConnection.unregisterObject(QStringLiteral("/MemoryPressure"));
+    mDBusConnection.unregisterObject(QStringLiteral("/StartupTimeline"));
+    // The plugins may still trigger syncs when they are destroyed
     delete mLoader;
+    BasePlugin::setSyncTriggerHandler(BasePlugin::SyncTriggerHandler());
     delete mSyncTrigger;
     mDBusConnection.unregisterService(QLatin1String("com.nokia.contactsd"));
 }
 
-void ContactsDaemon::loadPlugins(const QStringList &plugins)
+void ContactsDaemon::loadPlugins(const QStringList &plugins, bool deferredInit)
 {
+    mLoader->setDeferredInitEnabled(deferredInit);
     mLoader->loadPlugins(plugins);
 }
 
@@ -110,10 +191,62 @@ QStringList ContactsDaemon::loadedPlugins() const
     return mLoader->loadedPlugins();
 }
 
-void ContactsDaemon::unixSignalHandler(int)
+void ContactsDaemon::setStartupTracePath(const QString &path)
+{
+    mStartupTracePath = path;
+}
+
+void ContactsDaemon::setIdleExitTimeout(int seconds)
+{
+    mIdleTimer.setInterval(seconds * 1000);
+}
+
+void ContactsDaemon::onPluginsLoaded()
 {
-    // Write a byte on the socket to activate the socket listener
-    char a = 1;
+    StartupTimeline::mark(QStringLiteral("contactsd"), QStringLiteral("plugins initialized"));
+
+    restartIdleTimer();
+
+    if (!mStartupTracePath.isEmpty()) {
+        QTimer::singleShot(STARTUP_TRACE_DELAY, this, &ContactsDaemon::dumpStartupTrace);
+    }
+}
+
+void ContactsDaemon::dumpStartupTrace()
+{
+    if (mStartupTracePath.isEmpty() || mStartupTraceDumped) {
+        return;
+    }
+
+    mStartupTraceDumped = true;
+    StartupTimeline::instance()->dumpTrace(mStartupTracePath);
+}
+
+void ContactsDaemon::restartIdleTimer()
+{
+    if (mIdleTimer.interval() > 0) {
+        mIdleTimer.start();
+    }
+}
+
+void ContactsDaemon::onIdleTimeout()
+{
+    if (!mLoader->pluginsIdle() || mSyncTrigger->hasPendingSyncs()) {
+        // Releasing the caches here would only have them reloaded in the next period
+        qCDebug(lcContactsd) << "Not idle, staying resident";
+        restartIdleTimer();
+        return;
+    }
+
+    // Roster caches and import state are written as the plugins are destroyed
+    qCDebug(lcContactsd) << "Idle for" << mIdleTimer.interval() / 1000 << "s, exiting";
+    QCoreApplication::exit(IdleExitStatus);
+}
+
+void ContactsDaemon::unixSignalHandler(int signum)
+{
+    // Write the signal number on the socket to activate the socket listener
+    char a = static_cast<char>(signum);
     if (::write(sigFd[0], &a, sizeof(a)) != sizeof(a)) {
         qCWarning(lcContactsd) << "Unable to write to sigFd" << errno;
     }
@@ -125,14 +258,18 @@ void ContactsDaemon::onUnixSignalReceived()
     mSignalNotifier->setEnabled(false);
 
     // Empty the socket buffer
-    char dummy;
-    if (::read(sigFd[1], &dummy, sizeof(dummy)) != sizeof(dummy)) {
+    char signum = 0;
+    if (::read(sigFd[1], &signum, sizeof(signum)) != sizeof(signum)) {
         qCWarning(lcContactsd) << "Unable to complete read from sigFd" << errno;
     }
 
-    qCDebug(lcContactsd) << "Received quit signal";
+    if (signum == SIGUSR1) {
+        EventLog::instance()->writeToLog();
+    } else {
+        qCDebug(lcContactsd) << "Received quit signal";
 
-    QCoreApplication::quit();
+        QCoreApplication::quit();
+    }
 
     // Unmask signals
     mSignalNotifier->setEnabled(true);
@@ -28,9 +28,11 @@
 #include <QSocketNotifier>
 #include <QStringList>
 #include <QDBusConnection>
+#include <QTimer>
 
 class ContactsdPluginLoader;
 namespace Contactsd {
+    class MemoryMonitor;
     class SyncTrigger;
 }
 
@@ -39,18 +41,27 @@ class ContactsDaemon : public QObject
     Q_OBJECT
 
 public:
+    // Exit status after an idle exit, which systemd does not restart the daemon for
+    static const int IdleExitStatus = 75;
+
     ContactsDaemon(QObject *parent = nullptr);
     virtual ~ContactsDaemon();
 
-    void loadPlugins(const QStringList &plugins = QStringList());
+    void loadPlugins(const QStringList &plugins = QStringList(), bool deferredInit = true);
     QStringList loadedPlugins() const;
+    void setStartupTracePath(const QString &path);
+    void setIdleExitTimeout(int seconds);
 
     // UNIX signal handlers
-    static void unixSignalHandler(int /* unused */);
+    static void unixSignalHandler(int signum);
 
 private Q_SLOTS:
     // Qt signal handler
     void onUnixSignalReceived();
+    void onPluginsLoaded();
+    void dumpStartupTrace();
+    void restartIdleTimer();
+    void onIdleTimeout();
 
 private:
     QDBusConnection mDBusConnection;
@@ -58,6 +69,10 @@ private:
     static int sigFd[2];
     QSocketNotifier *mSignalNotifier;
     Contactsd::SyncTrigger *mSyncTrigger;
+    Contactsd::MemoryMonitor *mMemoryMonitor;
+    QString mStartupTracePath;
+    bool mStartupTraceDumped;
+    QTimer mIdleTimer;
 };
 
 #endif // CONTACTSDAEMON_H
@@ -22,6 +22,8 @@
  **/
 
 #include <QDir>
+#include <QElapsedTimer>
+#include <QJsonObject>
 #include <QPluginLoader>
 #include <QString>
 #include <QStringList>
@@ -31,6 +33,7 @@
 #include "contactsdpluginloader.h"
 #include "contactsimportprogressadaptor.h"
 #include "debug.h"
+#include "startup-timeline.h"
 
 using namespace Contactsd;
 
@@ -44,6 +47,8 @@ ContactsdPluginLoader::ContactsdPluginLoader(QDBusConnection *connection)
     , mCheckAliveTimer(nullptr)
     , mDBusConnection(connection)
     , mHaveRegisteredDBus(false)
+    , mDeferredInitEnabled(true)
+    , mDeferredInitScheduled(false)
 {
 }
 
@@ -57,6 +62,29 @@ ContactsdPluginLoader::~ContactsdPluginLoader()
     mPluginStore.clear();
 }
 
+bool ContactsdPluginLoader::pluginsIdle()
+{
+    if (!mDeferredPlugins.isEmpty() || mImportState.hasActiveImports()) {
+        return false;
+    }
+
+    for (PluginStore::const_iterator it = mPluginStore.constBegin(); it != mPluginStore.constEnd(); ++it) {
+        if (!it.value()->isIdle()) {
+            qCDebug(lcContactsd) << "Plugin" << it.key() << "is not idle";
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void ContactsdPluginLoader::releaseCaches()
+{
+    Q_FOREACH (BasePlugin *plugin, mPluginStore) {
+        plugin->releaseCaches();
+    }
+}
+
 void ContactsdPluginLoader::loadPlugins(const QStringList &plugins)
 {
     QStringList pluginsDirs;
@@ -71,6 +99,10 @@ void ContactsdPluginLoader::loadPlugins(const QStringList &plugins)
     Q_FOREACH (const QString &pluginsDir, pluginsDirs) {
         loadPlugins(pluginsDir, plugins);
     }
+
+    if (mDeferredPlugins.isEmpty()) {
+        Q_EMIT pluginsLoaded();
+    }
 }
 
 void ContactsdPluginLoader::loadPlugins(const QString &pluginsDir, const QStringList &plugins)
@@ -82,20 +114,34 @@ void ContactsdPluginLoader::loadPlugins(const QString &pluginsDir, const QString
         QString absFileName = dir.absoluteFilePath(fileName);
         qCDebug(lcContactsd) << "Trying to load plugin" << absFileName;
 
-        // We intentionally leak this object, and never unload the plugin
+        // We intentionally leak the loaded library, and never unload the plugin
         // When you load a plugin, you can't know what happens in the underlying
         // loaded libraries, so unloading a plugin while being sure it will not
-        // have any unwanted side effect is just impossible. For ignored plugins,
-        // we just avoid calling the init() function.
+        // have any unwanted side effect is just impossible. Ignored plugins are
+        // filtered by their JSON metadata, so that they are not loaded at all.
         QPluginLoader loader(absFileName);
 
+        const QJsonObject jsonMetaData = loader.metaData().value(QStringLiteral("MetaData")).toObject();
+        QString pluginName = jsonMetaData.value(BasePlugin::metaDataKeyName).toString();
+
+        if (!pluginName.isEmpty() && !acceptPlugin(absFileName, pluginName, plugins)) {
+            continue;
+        }
+
+        QElapsedTimer timer;
+        timer.start();
+
+        StartupTimeline::begin(QStringLiteral("plugins"), QStringLiteral("load ") + fileName);
         QObject *pluginObject = loader.instance();
+        StartupTimeline::end(QStringLiteral("plugins"), QStringLiteral("load ") + fileName);
 
         if (!pluginObject) {
             qCWarning(lcContactsd) << "Error loading plugin" << absFileName << "- " << loader.errorString();
             continue;
         }
 
+        const qint64 loadTime = timer.elapsed();
+
         BasePlugin *basePlugin = qobject_cast<BasePlugin *>(pluginObject);
 
         if (!basePlugin) {
@@ -103,27 +149,28 @@ void ContactsdPluginLoader::loadPlugins(const QString &pluginsDir, const QString
             continue;
         }
 
-        BasePlugin::MetaData metaData = basePlugin->metaData();
-
-        if (!metaData.contains(BasePlugin::metaDataKeyName)) {
-            qCWarning(lcContactsd) << "Error loading plugin" << absFileName << "- invalid plugin metadata";
-            continue;
+        if (!jsonMetaData.isEmpty()) {
+            basePlugin->setMetaData(jsonMetaData.toVariantMap());
         }
 
-        QString pluginName = metaData[BasePlugin::metaDataKeyName].toString();
+        if (pluginName.isEmpty()) {
+            // Without JSON metadata the plugin has to be instantiated to know its name
+            BasePlugin::MetaData metaData = basePlugin->metaData();
 
-        if (!plugins.isEmpty() && !plugins.contains(pluginName)) {
-            qCWarning(lcContactsd) << "Ignoring plugin" << absFileName;
-            continue;
-        }
+            if (!metaData.contains(BasePlugin::metaDataKeyName)) {
+                qCWarning(lcContactsd) << "Error loading plugin" << absFileName << "- invalid plugin metadata";
+                delete basePlugin;
+                continue;
+            }
 
-        if (mPluginStore.contains(pluginName)) {
-            qCWarning(lcContactsd) << "Ignoring plugin" << absFileName
-                                   << "- plugin with name" << pluginName << "already registered";
-            continue;
+            pluginName = metaData[BasePlugin::metaDataKeyName].toString();
+
+            if (!acceptPlugin(absFileName, pluginName, plugins)) {
+                delete basePlugin;
+                continue;
+            }
         }
 
-        qCDebug(lcContactsd) << "Plugin" << pluginName << "loaded";
         mPluginStore.insert(pluginName, basePlugin);
 
         connect(basePlugin, &BasePlugin::importStarted,
@@ -135,7 +182,76 @@ void ContactsdPluginLoader::loadPlugins(const QString &pluginsDir, const QString
         connect(basePlugin, &BasePlugin::importAlive,
                 this, &ContactsdPluginLoader::onImportAlive);
 
-        basePlugin->init();
+        if (mDeferredInitEnabled && jsonMetaData.value(BasePlugin::metaDataKeyDeferredInit).toBool()) {
+            qCDebug(lcContactsd) << "Plugin" << pluginName << "loaded in" << loadTime << "ms, init deferred";
+            mDeferredPlugins.append(pluginName);
+        } else {
+            qCDebug(lcContactsd) << "Plugin" << pluginName << "loaded in" << loadTime << "ms";
+            initPlugin(pluginName, basePlugin);
+        }
+    }
+
+    // Deferred plugins are initialised once the main loop is running, so that
+    // the D-Bus services are responsive before they start their work
+    if (!mDeferredPlugins.isEmpty() && !mDeferredInitScheduled) {
+        mDeferredInitScheduled = true;
+        QTimer::singleShot(0, this, &ContactsdPluginLoader::initDeferredPlugin);
+    }
+}
+
+void ContactsdPluginLoader::setDeferredInitEnabled(bool enabled)
+{
+    mDeferredInitEnabled = enabled;
+}
+
+bool ContactsdPluginLoader::acceptPlugin(const QString &fileName, const QString &pluginName,
+                                         const QStringList &plugins) const
+{
+    if (!plugins.isEmpty() && !plugins.contains(pluginName)) {
+        qCWarning(lcContactsd) << "Ignoring plugin" << fileName;
+        return false;
+    }
+
+    if (mPluginStore.contains(pluginName)) {
+        qCWarning(lcContactsd) << "Ignoring plugin" << fileName
+                               << "- plugin with name" << pluginName << "already registered";
+        return false;
+    }
+
+    return true;
+}
+
+void ContactsdPluginLoader::initPlugin(const QString &pluginName, BasePlugin *plugin)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    StartupTimeline::Scope scope(QStringLiteral("plugins"), QStringLiteral("init ") + pluginName);
+    plugin->init();
+
+    qCDebug(lcContactsd) << "Plugin" << pluginName << "initialized in" << timer.elapsed() << "ms";
+}
+
+void ContactsdPluginLoader::initDeferredPlugin()
+{
+    mDeferredInitScheduled = false;
+
+    if (mDeferredPlugins.isEmpty()) {
+        return;
+    }
+
+    // One plugin per main loop iteration, to keep serving D-Bus requests in between
+    const QString pluginName = mDeferredPlugins.takeFirst();
+    BasePlugin *plugin = mPluginStore.value(pluginName);
+    if (plugin) {
+        initPlugin(pluginName, plugin);
+    }
+
+    if (!mDeferredPlugins.isEmpty()) {
+        mDeferredInitScheduled = true;
+        QTimer::singleShot(0, this, &ContactsdPluginLoader::initDeferredPlugin);
+    } else {
+        Q_EMIT pluginsLoaded();
     }
 }
 
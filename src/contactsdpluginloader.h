@@ -47,7 +47,10 @@ public:
     void loadPlugins(const QStringList &plugins);
     void loadPlugins(const QString &pluginsDir, const QStringList &plugins);
     QStringList loadedPlugins() const;
+    void setDeferredInitEnabled(bool enabled);
     bool registerNotificationService();
+    bool pluginsIdle();
+    void releaseCaches();
 
 public Q_SLOTS:
     QStringList hasActiveImports();
@@ -68,6 +71,7 @@ private Q_SLOTS:
     void onImportTimeout();
     void onImportAlive();
     void onCheckAliveTimeout();
+    void initDeferredPlugin();
 
 private:
     void startImportTimer();
@@ -75,6 +79,8 @@ private:
     void startCheckAliveTimer();
     void stopCheckAliveTimer();
     QString pluginName(Contactsd::BasePlugin *plugin);
+    bool acceptPlugin(const QString &fileName, const QString &pluginName, const QStringList &plugins) const;
+    void initPlugin(const QString &pluginName, Contactsd::BasePlugin *plugin);
 
     typedef QMap<QString, Contactsd::BasePlugin*> PluginStore;
     PluginStore mPluginStore;
@@ -85,6 +91,11 @@ private:
 
     QDBusConnection *mDBusConnection;
     bool mHaveRegisteredDBus;
+
+    // Plugins whose metadata asks for init() to run after startup, in load order
+    QStringList mDeferredPlugins;
+    bool mDeferredInitEnabled;
+    bool mDeferredInitScheduled;
 };
 
 #endif
@@ -47,6 +47,11 @@ static void usage()
             << "Options:\n"
             << "\n"
             << "  --plugins PLUGINS    Comma separated list of plugins to load\n"
+            << "  --no-deferred-init   Initialize all plugins before entering the main loop\n"
+            << "  --startup-trace FILE Write the startup timeline to FILE in the\n"
+            << "                       Chrome trace event format\n"
+            << "  --idle-exit SECONDS  Exit when idle for SECONDS, to be restarted\n"
+            << "                       on demand through D-Bus activation\n"
             << "  --enable-debug       Enable debug logging\n"
             << "  --version            Output version information and exit\n"
             << "  --help               Display this help and exit\n"
@@ -55,7 +60,7 @@ static void usage()
 
 static void setupUnixSignalHandlers()
 {
-    struct sigaction sigterm, sigint;
+    struct sigaction sigterm, sigint, sigusr1;
 
     sigterm.sa_handler = ContactsDaemon::unixSignalHandler;
     sigemptyset(&sigterm.sa_mask);
@@ -74,6 +79,16 @@ static void setupUnixSignalHandlers()
         qCWarning(lcContactsd) << "Could not setup signal handler for SIGINT";
         return;
     }
+
+    // SIGUSR1 writes the recent event log to the system log
+    sigusr1.sa_handler = ContactsDaemon::unixSignalHandler;
+    sigemptyset(&sigusr1.sa_mask);
+    sigusr1.sa_flags = SA_RESTART;
+
+    if (sigaction(SIGUSR1, &sigusr1, 0) < 0) {
+        qCWarning(lcContactsd) << "Could not setup signal handler for SIGUSR1";
+        return;
+    }
 }
 
 static void categoryFilter(QLoggingCategory *category)
@@ -91,6 +106,9 @@ Q_DECL_EXPORT int main(int argc, char **argv)
     QCoreApplication app(argc, argv);
 
     QStringList plugins;
+    bool deferredInit = true;
+    QString startupTrace = QString::fromLocal8Bit(qgetenv("CONTACTSD_STARTUP_TRACE"));
+    int idleExitTimeout = qgetenv("CONTACTSD_IDLE_EXIT").toInt();
     useDebug = !qgetenv("CONTACTSD_DEBUG").isEmpty();
 
     const QStringList args = app.arguments();
@@ -116,6 +134,25 @@ Q_DECL_EXPORT int main(int argc, char **argv)
             return 0;
         } else if (arg == "--enable-debug") {
             useDebug = true;
+        } else if (arg == "--no-deferred-init") {
+            deferredInit = false;
+        } else if (arg == "--startup-trace") {
+            if (++i == args.count()) {
+                usage();
+                return -1;
+            }
+
+            startupTrace = args.at(i);
+        } else if (arg == "--idle-exit") {
+            bool ok = false;
+            if (++i < args.count()) {
+                idleExitTimeout = args.at(i).toInt(&ok);
+            }
+
+            if (!ok || idleExitTimeout < 0) {
+                usage();
+                return -1;
+            }
         } else {
             qWarning() << "Invalid argument" << arg;
             usage();
@@ -140,7 +177,9 @@ Q_DECL_EXPORT int main(int argc, char **argv)
     app.installTranslator(translator.data());
 
     ContactsDaemon daemon;
-    daemon.loadPlugins(plugins);
+    daemon.setStartupTracePath(startupTrace);
+    daemon.setIdleExitTimeout(idleExitTimeout);
+    daemon.loadPlugins(plugins, deferredInit);
 
     const int rc = app.exec();
 
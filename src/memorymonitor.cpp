@@ -0,0 +1,173 @@
+/** This file is part of Contacts daemon
+ **
+ ** Copyright (c) 2026 Jolla Ltd.
+ **
+ ** GNU Lesser General Public License Usage
+ ** This file may be used under the terms of the GNU Lesser General Public License
+ ** version 2.1 as published by the Free Software Foundation and appearing in the
+ ** file LICENSE.LGPL included in the packaging of this file.  Please review the
+ ** following information to ensure the GNU Lesser General Public License version
+ ** 2.1 requirements will be met:
+ ** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+ **/
+
+#include "memorymonitor.h"
+#include "debug.h"
+#include "statistics.h"
+
+#include <QFile>
+#include <QStringList>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+using namespace Contactsd;
+
+namespace {
+
+// Notify when tasks stall on memory for 150 ms within 2 s; unprivileged triggers
+// need a window which is a multiple of 2 s
+const char PressureTrigger[] = "some 150000 2000000";
+// The trigger fires repeatedly while the pressure lasts; release at most this often
+const int RELEASE_INTERVAL = 30 * 1000; // ms
+
+QStringList pressureFilePaths()
+{
+    QStringList paths;
+
+    // Under systemd our own cgroup is contactsd's service, which only stalls once the
+    // daemon itself is short of memory; watch the enclosing user slice instead, e.g.
+    // /user.slice/user-1000.slice for /user.slice/user-1000.slice/user@1000.service/...
+    QFile cgroups(QStringLiteral("/proc/self/cgroup"));
+    if (cgroups.open(QIODevice::ReadOnly)) {
+        Q_FOREACH (const QByteArray &line, cgroups.readAll().split('\n')) {
+            if (!line.startsWith("0::")) {
+                continue;
+            }
+            QStringList components = QString::fromLocal8Bit(line.mid(3)).split(QLatin1Char('/'), QString::SkipEmptyParts);
+            while (!components.isEmpty()
+                   && !(components.last().startsWith(QStringLiteral("user-"))
+                        && components.last().endsWith(QStringLiteral(".slice")))) {
+                components.removeLast();
+            }
+            if (!components.isEmpty()) {
+                const QString path = QStringLiteral("/sys/fs/cgroup/") + components.join(QLatin1Char('/'))
+                        + QStringLiteral("/memory.pressure");
+                if (QFile::exists(path)) {
+                    paths.append(path);
+                }
+            }
+        }
+    }
+
+    // The system wide pressure, which unprivileged processes may set triggers on
+    paths.append(QStringLiteral("/proc/pressure/memory"));
+    return paths;
+}
+
+}
+
+MemoryMonitor::MemoryMonitor(QObject *parent)
+    : QObject(parent)
+    , mPressureFd(-1)
+    , mPressureNotifier(nullptr)
+{
+    mLastRelease.invalidate();
+}
+
+MemoryMonitor::~MemoryMonitor()
+{
+    delete mPressureNotifier;
+    if (mPressureFd >= 0) {
+        ::close(mPressureFd);
+    }
+}
+
+bool MemoryMonitor::startPressureMonitor()
+{
+    Q_FOREACH (const QString &filePath, pressureFilePaths()) {
+        const QByteArray path = QFile::encodeName(filePath);
+
+        // The slice's pressure file may not be writable for us
+        mPressureFd = ::open(path.constData(), O_RDWR | O_NONBLOCK | O_CLOEXEC);
+        if (mPressureFd < 0) {
+            qCDebug(lcContactsd) << "Memory pressure information not available:" << path << strerror(errno);
+            continue;
+        }
+
+        if (::write(mPressureFd, PressureTrigger, sizeof(PressureTrigger)) < 0) {
+            qCWarning(lcContactsd) << "Unable to set memory pressure trigger on" << path << strerror(errno);
+            ::close(mPressureFd);
+            mPressureFd = -1;
+            continue;
+        }
+
+        // The kernel reports a triggered event as an exceptional condition on the file
+        mPressureNotifier = new QSocketNotifier(mPressureFd, QSocketNotifier::Exception, this);
+        connect(mPressureNotifier, SIGNAL(activated(int)), SLOT(onPressureEvent()));
+
+        qCDebug(lcContactsd) << "Watching memory pressure on" << path;
+        return true;
+    }
+
+    return false;
+}
+
+qint64 MemoryMonitor::residentSetSize()
+{
+    QFile statm(QStringLiteral("/proc/self/statm"));
+    if (!statm.open(QIODevice::ReadOnly)) {
+        return -1;
+    }
+
+    const QList<QByteArray> fields = statm.readAll().split(' ');
+    if (fields.count() < 2) {
+        return -1;
+    }
+
+    return fields.at(1).toLongLong() * (::sysconf(_SC_PAGESIZE) / 1024);
+}
+
+void MemoryMonitor::onPressureEvent()
+{
+    if (mLastRelease.isValid() && mLastRelease.elapsed() < RELEASE_INTERVAL) {
+        return;
+    }
+
+    qCDebug(lcContactsd) << "Memory pressure reported";
+    Statistics::increment(QStringLiteral("memory.pressureReleases"));
+    releaseMemory();
+}
+
+QVariantMap MemoryMonitor::releaseMemory()
+{
+    mLastRelease.start();
+
+    const qint64 before = residentSetSize();
+
+    Q_EMIT releaseCachesRequested();
+
+#ifdef __GLIBC__
+    // Return the memory freed by the plugins to the system
+    ::malloc_trim(0);
+#endif
+
+    const qint64 after = residentSetSize();
+
+    qCDebug(lcContactsd) << "Released memory, resident set" << before << "kB before," << after << "kB after";
+
+    Statistics::increment(QStringLiteral("memory.releases"));
+    Statistics::setGauge(QStringLiteral("memory.residentBeforeReleaseKb"), before);
+    Statistics::setGauge(QStringLiteral("memory.residentAfterReleaseKb"), after);
+
+    QVariantMap result;
+    result.insert(QStringLiteral("residentBefore"), before);
+    result.insert(QStringLiteral("residentAfter"), after);
+    return result;
+}
@@ -0,0 +1,57 @@
+/** This file is part of Contacts daemon
+ **
+ ** Copyright (c) 2026 Jolla Ltd.
+ **
+ ** GNU Lesser General Public License Usage
+ ** This file may be used under the terms of the GNU Lesser General Public License
+ ** version 2.1 as published by the Free Software Foundation and appearing in the
+ ** file LICENSE.LGPL included in the packaging of this file.  Please review the
+ ** following information to ensure the GNU Lesser General Public License version
+ ** 2.1 requirements will be met:
+ ** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+ **/
+
+#ifndef MEMORYMONITOR_H
+#define MEMORYMONITOR_H
+
+#include <QElapsedTimer>
+#include <QObject>
+#include <QSocketNotifier>
+#include <QVariantMap>
+
+namespace Contactsd {
+
+// Releases memory when the system runs short of it, as reported by a pressure
+// stall trigger on the user's slice or the whole system, or when asked to over D-Bus.
+class MemoryMonitor : public QObject
+{
+    Q_OBJECT
+    Q_CLASSINFO("D-Bus Interface", "com.nokia.contactsd")
+
+public:
+    explicit MemoryMonitor(QObject *parent = nullptr);
+    ~MemoryMonitor();
+
+    bool startPressureMonitor();
+
+    static qint64 residentSetSize();
+
+public Q_SLOTS:
+    // Returns the resident set size in kB before and after the release
+    QVariantMap releaseMemory();
+
+Q_SIGNALS:
+    void releaseCachesRequested();
+
+private Q_SLOTS:
+    void onPressureEvent();
+
+private:
+    int mPressureFd;
+    QSocketNotifier *mPressureNotifier;
+    QElapsedTimer mLastRelease;
+};
+
+}
+
+#endif // MEMORYMONITOR_H
@@ -50,6 +50,7 @@ HEADERS += contactsd.h \
     importstate.h \
     contactsimportprogressadaptor.h \
     synctrigger.h \
+    memorymonitor.h \
     base-plugin.h
 
 SOURCES += main.cpp \
@@ -57,7 +58,8 @@ SOURCES += main.cpp \
     contactsdpluginloader.cpp \
     importstate.cpp \
     contactsimportprogressadaptor.cpp \
-    synctrigger.cpp
+    synctrigger.cpp \
+    memorymonitor.cpp
 
 DEFINES += VERSION=\\\"$${VERSION}\\\"
 DEFINES += CONTACTSD_PLUGINS_DIR=\\\"$$LIBDIR/$${VERSIONED_TARGET}/plugins\\\"
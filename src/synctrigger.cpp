@@ -22,6 +22,8 @@
 #include <QDBusConnection>
 #include <QDBusMessage>
 #include <QDBusPendingReply>
+#include <QDir>
+#include <QSettings>
 
 // buteo-syncfw
 #include <ProfileEngineDefs.h>
@@ -29,16 +31,71 @@
 #include <SyncCommonDefs.h>
 #include <ProfileManager.h>
 
+namespace {
+
+const int DEFAULT_MINIMUM_INTERVAL = 10 * 1000; // ms
+const int DEFAULT_MAXIMUM_DELAY = 30 * 1000; // ms
+
+// msyncd keeps the per-account profiles in its cache directory and the templates
+// in the system profile directory; ProfileManager::allSyncProfiles() reads both.
+QStringList defaultProfileDirectories()
+{
+    const QString syncType(Buteo::Profile::TYPE_SYNC);
+    return QStringList()
+            << QDir::cleanPath(Buteo::ProfileManager::DEFAULT_PRIMARY_PROFILE_PATH + QLatin1Char('/') + syncType)
+            << QDir::cleanPath(Buteo::ProfileManager::DEFAULT_SECONDARY_PROFILE_PATH + QLatin1Char('/') + syncType);
+}
+
+// A profile directory which doesn't exist yet is watched through its closest
+// existing ancestor, so that msyncd creating it invalidates the cache.
+QString watchableDirectory(const QString &path)
+{
+    QDir directory(path);
+    while (!directory.exists()) {
+        if (directory.isRoot() || !directory.cdUp()) {
+            return QString();
+        }
+    }
+    return directory.absolutePath();
+}
+
+}
+
 namespace Contactsd {
 
 SyncTrigger::SyncTrigger(QDBusConnection *connection)
     : mDBusConnection(connection)
     , mHaveRegisteredDBus(false)
+    , mProfilesValid(false)
 {
+    QSettings settings(QSettings::IniFormat, QSettings::UserScope,
+                       QStringLiteral("Nokia"), QStringLiteral("Contactsd"));
+    mMinimumInterval = settings.value(QStringLiteral("SyncTrigger/MinimumInterval"),
+                                      DEFAULT_MINIMUM_INTERVAL).toInt();
+    mMaximumDelay = settings.value(QStringLiteral("SyncTrigger/MaximumDelay"),
+                                   DEFAULT_MAXIMUM_DELAY).toInt();
+    mProfileDirectories = settings.value(QStringLiteral("SyncTrigger/ProfileDirectories"),
+                                         defaultProfileDirectories()).toStringList();
+
+    connect(&mProfileWatcher, &QFileSystemWatcher::directoryChanged,
+            this, &SyncTrigger::invalidateProfiles);
+    connect(&mProfileWatcher, &QFileSystemWatcher::fileChanged,
+            this, &SyncTrigger::invalidateProfiles);
+
+    mSegmentTimer.setSingleShot(true);
+    connect(&mSegmentTimer, &QTimer::timeout,
+            this, &SyncTrigger::onSegmentTimeout);
+
+    mClock.start();
 }
 
 SyncTrigger::~SyncTrigger()
 {
+    // Don't drop upsyncs which are still waiting for their segment to close
+    Q_FOREACH (const QString &profileId, mPendingSyncs.keys()) {
+        startSync(profileId);
+    }
+
     if (mHaveRegisteredDBus) {
         mDBusConnection->unregisterObject(QLatin1String("/SyncTrigger"));
     }
@@ -61,7 +118,6 @@ bool SyncTrigger::registerTriggerService()
 
 void SyncTrigger::triggerSync(const QStringList &accountProviders, int syncPolicy, int directionPolicy)
 {
-    // TODO: in the future, handle AdaptivePolicy by coalescing triggered syncs into time segments.
     qCDebug(lcContactsd) << "triggering sync:" << accountProviders << syncPolicy << directionPolicy;
 
     // We trigger sync with a particular Buteo sync profile if:
@@ -71,6 +127,47 @@ void SyncTrigger::triggerSync(const QStringList &accountProviders, int syncPolic
     //  - the profile is a Contacts sync profile
     //  - the profile has two-way directionality (or upsync), or the direction policy permits
     //  - the profile has always-up-to-date set (sync on change), or the sync policy permits
+    // The first, second and fourth criteria are applied when the profiles are loaded.
+    Q_FOREACH (const SyncProfileInfo &profile, syncProfiles()) {
+        const QString &profileId = profile.id;
+
+        bool isTarget = accountProviders.isEmpty();
+        if (!isTarget) {
+            Q_FOREACH (const QString &accountProvider, accountProviders) {
+                if (profileId.toLower().startsWith(accountProvider.toLower())) {
+                    isTarget = true;
+                    break;
+                }
+            }
+        }
+
+        // in the future, we should inspect the sync profile for deltasync flag
+        if (!profileId.toLower().startsWith(QStringLiteral("google"))
+                && !profileId.toLower().startsWith(QStringLiteral("carddav"))) {
+            isTarget = false; // we currently only support automatic sync with Google and CardDAV
+        }
+
+        if (isTarget
+                && (profile.upsync || directionPolicy == SyncTrigger::AnyDirection)
+                && (profile.alwaysUpToDate || syncPolicy == SyncTrigger::ForceSync)) {
+            if (syncPolicy == SyncTrigger::AdaptiveSync) {
+                scheduleSync(profileId);
+            } else {
+                qCDebug(lcContactsd) << "SyncTrigger: profile meets criteria, triggering:" << profileId;
+                startSync(profileId);
+            }
+        }
+    }
+}
+
+const QList<SyncTrigger::SyncProfileInfo> &SyncTrigger::syncProfiles()
+{
+    if (mProfilesValid) {
+        return mProfiles;
+    }
+
+    mProfiles.clear();
+
     Buteo::ProfileManager profileManager;
     QList<Buteo::SyncProfile*> syncProfiles = profileManager.allSyncProfiles();
     Q_FOREACH (Buteo::SyncProfile *profile, syncProfiles) {
@@ -91,37 +188,146 @@ void SyncTrigger::triggerSync(const QStringList &accountProviders, int syncPolic
         // "accountProvider.dataType" -- eg, "google.Contacts"
         // And per-account profiles should be suffixed with "-accountId"
         bool isContacts = profileId.toLower().contains(QStringLiteral("contacts"));
-        bool isTarget = accountProviders.isEmpty();
-        if (!isTarget) {
-            Q_FOREACH (const QString &accountProvider, accountProviders) {
-                if (profileId.toLower().startsWith(accountProvider.toLower())) {
-                    isTarget = true;
-                    break;
-                }
+
+        delete profile;
+
+        if (notTemplate && isEnabled && isContacts) {
+            SyncProfileInfo info;
+            info.id = profileId;
+            info.upsync = isUpsync;
+            info.alwaysUpToDate = alwaysUpToDate;
+            mProfiles.append(info);
+        }
+    }
+
+    // Keep the parsed profiles until msyncd adds, removes or rewrites a profile.
+    // Without a profile directory to watch the profiles are loaded on every trigger.
+    QStringList directories;
+    QStringList files;
+    bool watchable = !mProfileDirectories.isEmpty();
+    Q_FOREACH (const QString &path, mProfileDirectories) {
+        const QString watched = watchableDirectory(path);
+        if (watched.isEmpty()) {
+            watchable = false;
+            continue;
+        }
+        if (!directories.contains(watched)) {
+            directories.append(watched);
+        }
+        if (watched == QDir(path).absolutePath()) {
+            QDir directory(watched);
+            Q_FOREACH (const QString &fileName, directory.entryList(QStringList() << QStringLiteral("*.xml"), QDir::Files)) {
+                files.append(directory.absoluteFilePath(fileName));
             }
         }
+    }
 
-        // in the future, we should inspect the sync profile for deltasync flag
-        if (!profileId.toLower().startsWith(QStringLiteral("google"))
-                && !profileId.toLower().startsWith(QStringLiteral("carddav"))) {
-            isTarget = false; // we currently only support automatic sync with Google and CardDAV
+    if (!mProfileWatcher.files().isEmpty()) {
+        mProfileWatcher.removePaths(mProfileWatcher.files());
+    }
+    Q_FOREACH (const QString &path, mProfileWatcher.directories()) {
+        if (!directories.contains(path)) {
+            mProfileWatcher.removePath(path);
+        }
+    }
+    Q_FOREACH (const QString &path, directories) {
+        if (!mProfileWatcher.directories().contains(path)) {
+            mProfileWatcher.addPath(path);
         }
+    }
+    if (!files.isEmpty()) {
+        mProfileWatcher.addPaths(files);
+    }
+    mProfilesValid = watchable;
 
-        delete profile;
+    qCDebug(lcContactsd) << "SyncTrigger: loaded" << mProfiles.count() << "contacts sync profiles";
+    return mProfiles;
+}
+
+void SyncTrigger::invalidateProfiles()
+{
+    mProfilesValid = false;
+}
+
+void SyncTrigger::scheduleSync(const QString &profileId)
+{
+    if (mPendingSyncs.contains(profileId)) {
+        qCDebug(lcContactsd) << "SyncTrigger: merging into pending sync:" << profileId;
+        return;
+    }
+
+    // Start the segment's sync as soon as the minimum interval since the previous sync of
+    // this profile has passed, but never hold the request back for more than the maximum delay.
+    const qint64 now = mClock.elapsed();
+    qint64 due = now;
+    QHash<QString, qint64>::const_iterator it = mLastSync.constFind(profileId);
+    if (it != mLastSync.constEnd()) {
+        due = qMax(now, *it + mMinimumInterval);
+    }
+    due = qMin(due, now + mMaximumDelay);
+
+    if (due <= now) {
+        qCDebug(lcContactsd) << "SyncTrigger: profile meets criteria, triggering:" << profileId;
+        startSync(profileId);
+        return;
+    }
+
+    qCDebug(lcContactsd) << "SyncTrigger: profile meets criteria, deferring by" << (due - now) << "ms:" << profileId;
+    mPendingSyncs.insert(profileId, due);
+    startSegmentTimer();
+}
 
-        if (notTemplate && isEnabled && isTarget && isContacts
-                && (isUpsync || directionPolicy == SyncTrigger::AnyDirection)
-                && (alwaysUpToDate || syncPolicy == SyncTrigger::ForceSync)) {
-            qCDebug(lcContactsd) << "SyncTrigger: profile meets criteria, triggering:" << profileId;
-            QDBusMessage message = QDBusMessage::createMethodCall(
-                    QStringLiteral("com.meego.msyncd"),
-                    QStringLiteral("/synchronizer"),
-                    QStringLiteral("com.meego.msyncd"),
-                    QStringLiteral("startSync"));
-            message.setArguments(QVariantList() << profileId);
-            QDBusConnection::sessionBus().asyncCall(message);
+void SyncTrigger::startSync(const QString &profileId)
+{
+    // An explicit sync also satisfies any coalesced request for the same profile
+    if (mPendingSyncs.remove(profileId) > 0) {
+        startSegmentTimer();
+    }
+    mLastSync.insert(profileId, mClock.elapsed());
+
+    QDBusMessage message = QDBusMessage::createMethodCall(
+            QStringLiteral("com.meego.msyncd"),
+            QStringLiteral("/synchronizer"),
+            QStringLiteral("com.meego.msyncd"),
+            QStringLiteral("startSync"));
+    message.setArguments(QVariantList() << profileId);
+    QDBusConnection::sessionBus().asyncCall(message);
+}
+
+void SyncTrigger::startSegmentTimer()
+{
+    if (mPendingSyncs.isEmpty()) {
+        mSegmentTimer.stop();
+        return;
+    }
+
+    qint64 next = -1;
+    for (QHash<QString, qint64>::const_iterator it = mPendingSyncs.constBegin(); it != mPendingSyncs.constEnd(); ++it) {
+        if (next < 0 || *it < next) {
+            next = *it;
+        }
+    }
+
+    mSegmentTimer.start(qMax<qint64>(0, next - mClock.elapsed()));
+}
+
+void SyncTrigger::onSegmentTimeout()
+{
+    const qint64 now = mClock.elapsed();
+
+    QStringList dueProfiles;
+    for (QHash<QString, qint64>::const_iterator it = mPendingSyncs.constBegin(); it != mPendingSyncs.constEnd(); ++it) {
+        if (*it <= now) {
+            dueProfiles.append(it.key());
         }
     }
+
+    Q_FOREACH (const QString &profileId, dueProfiles) {
+        qCDebug(lcContactsd) << "SyncTrigger: triggering coalesced sync:" << profileId;
+        startSync(profileId);
+    }
+
+    startSegmentTimer();
 }
 
 }
@@ -21,8 +21,14 @@
 
 #include <QDBusContext>
 #include <QDBusConnection>
+#include <QElapsedTimer>
+#include <QFileSystemWatcher>
+#include <QHash>
 #include <QObject>
 #include <QStringList>
+#include <QTimer>
+
+#include "base-plugin.h"
 
 namespace Contactsd {
 
@@ -36,25 +42,57 @@ public:
     ~SyncTrigger();
 
     bool registerTriggerService();
+    bool hasPendingSyncs() const { return !mPendingSyncs.isEmpty(); }
 
+    // The values of BasePlugin::SyncPolicy and BasePlugin::DirectionPolicy
     enum SyncPolicy {
-        ForceSync = 0,
-        UpToDateSync,
-        AdaptiveSync
+        ForceSync = BasePlugin::ForceSync,
+        UpToDateSync = BasePlugin::UpToDateSync,
+        AdaptiveSync = BasePlugin::AdaptiveSync
     };
 
     enum DirectionPolicy {
-        AnyDirection = 0,
-        UpsyncDirection
+        AnyDirection = BasePlugin::AnyDirection,
+        UpsyncDirection = BasePlugin::UpsyncDirection
     };
 
 public Q_SLOTS:
     Q_NOREPLY void triggerSync(const QStringList &accountProviders = QStringList(), int syncPolicy = ForceSync,
                                int directionPolicy = AnyDirection);
 
+private Q_SLOTS:
+    void onSegmentTimeout();
+    void invalidateProfiles();
+
 private:
+    struct SyncProfileInfo {
+        QString id;
+        bool upsync;
+        bool alwaysUpToDate;
+    };
+
+    const QList<SyncProfileInfo> &syncProfiles();
+    void scheduleSync(const QString &profileId);
+    void startSync(const QString &profileId);
+    void startSegmentTimer();
+
     QDBusConnection *mDBusConnection;
     bool mHaveRegisteredDBus;
+
+    // Enabled per-account contacts profiles, parsed once until a profile directory changes
+    QList<SyncProfileInfo> mProfiles;
+    bool mProfilesValid;
+    QStringList mProfileDirectories;
+    QFileSystemWatcher mProfileWatcher;
+
+    // Adaptive syncs are coalesced per profile: a profile is synced at most once per
+    // minimum interval, and no request is held back for longer than the maximum delay.
+    int mMinimumInterval;
+    int mMaximumDelay;
+    QElapsedTimer mClock;
+    QHash<QString, qint64> mLastSync;
+    QHash<QString, qint64> mPendingSyncs;
+    QTimer mSegmentTimer;
 };
 
 }
@@ -0,0 +1,350 @@
+/** This file is part of Contacts daemon
+ **
+ ** Copyright (c) 2026 Jolla Ltd.
+ **
+ ** GNU Lesser General Public License Usage
+ ** This file may be used under the terms of the GNU Lesser General Public License
+ ** version 2.1 as published by the Free Software Foundation and appearing in the
+ ** file LICENSE.LGPL included in the packaging of this file.  Please review the
+ ** following information to ensure the GNU Lesser General Public License version
+ ** 2.1 requirements will be met:
+ ** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+ **/
+
+#include "bench-sim-plugin.h"
+
+#include <test-common.h>
+
+#include <QContactCollectionFilter>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QVersitContactImporter>
+
+#include "statistics.h"
+
+QTCONTACTS_USE_NAMESPACE
+
+// This benchmark bypasses the contacts daemon and ofono entirely, like
+// ut_simplugin. Synthetic USIM phonebook exports are handed to the modem
+// through FakePhonebook, and the time spent parsing the VCard data, diffing
+// it against the stored SIM contacts and storing the changes is reported.
+//
+// Environment:
+//   CONTACTSD_BENCH_SIM_SIZES  comma separated phonebook sizes (default 100,500,1000,2500)
+//   CONTACTSD_BENCH_OUTPUT     JSON result file (default bench_simplugin.json)
+//
+// The contacts are stored through the throttled test engine, which simulates
+// slow storage and counts the write transactions of each phase; the bench is
+// skipped if the engine cannot be loaded.
+
+namespace {
+
+const QString DummyModemPath = QStringLiteral("dummy-cardId");
+
+QList<int> phonebookSizes()
+{
+    QList<int> sizes;
+
+    const QString env = QString::fromLocal8Bit(qgetenv("CONTACTSD_BENCH_SIM_SIZES"));
+    foreach (const QString &size, env.split(QLatin1Char(','), QString::SkipEmptyParts)) {
+        bool ok = false;
+        const int value = size.trimmed().toInt(&ok);
+        if (ok && value > 0) {
+            sizes.append(value);
+        }
+    }
+
+    if (sizes.isEmpty()) {
+        sizes << 100 << 500 << 1000 << 2500;
+    }
+
+    std::sort(sizes.begin(), sizes.end());
+    return sizes;
+}
+
+QString outputFileName()
+{
+    const QString env = QString::fromLocal8Bit(qgetenv("CONTACTSD_BENCH_OUTPUT"));
+    return env.isEmpty() ? QStringLiteral("bench_simplugin.json") : env;
+}
+
+qint64 engineTransactions()
+{
+    // Only counted by the throttled test engine
+    const QVariantMap counters = Contactsd::Statistics::instance()->snapshot().value(QStringLiteral("counters")).toMap();
+    return counters.value(QStringLiteral("contactsEngine.transactions")).toLongLong();
+}
+
+const QString ThrottledManagerName = QStringLiteral("org.nemomobile.contacts.throttled");
+
+QStringList enginePluginDirs()
+{
+    // Installed next to the tests, or built in the sibling directory
+    const QDir appDir(QCoreApplication::applicationDirPath());
+    return QStringList() << appDir.absoluteFilePath(QStringLiteral("../plugins"))
+                         << appDir.absoluteFilePath(QStringLiteral("../throttledengine/plugins"));
+}
+
+bool throttledEngineActive()
+{
+    // The engine publishes its latencies when created
+    const QVariantMap gauges = Contactsd::Statistics::instance()->snapshot().value(QStringLiteral("gauges")).toMap();
+    return gauges.contains(QStringLiteral("contactsEngine.readLatencyMs"));
+}
+
+qint64 peakRssKb()
+{
+    // VmHWM is the high water mark of the resident set for the process
+    QFile status(QStringLiteral("/proc/self/status"));
+    if (!status.open(QIODevice::ReadOnly)) {
+        return -1;
+    }
+
+    foreach (const QByteArray &line, status.readAll().split('\n')) {
+        if (line.startsWith("VmHWM:")) {
+            return line.mid(6).trimmed().split(' ').first().toLongLong();
+        }
+    }
+
+    return -1;
+}
+
+QString phonebookName(int index)
+{
+    // Mix scripts as found on real SIMs; every tenth entry repeats the
+    // previous name, which the plugin must coalesce into one contact
+    const int nameIndex = (index % 10 == 9) ? index - 1 : index;
+
+    switch (nameIndex % 5) {
+    case 0:
+        return QStringLiteral("Forrest Gump %1").arg(nameIndex);
+    case 1:
+        return QStringLiteral("Форрест Гамп %1").arg(nameIndex);
+    case 2:
+        return QStringLiteral("阿甘 正传 %1").arg(nameIndex);
+    case 3:
+        return QStringLiteral("فورست غامب %1").arg(nameIndex);
+    default:
+        return QStringLiteral("Φόρεστ Γκαμπ %1").arg(nameIndex);
+    }
+}
+
+QString generatePhonebook(int size, int revision)
+{
+    static const char *const types[] = { "HOME,VOICE", "CELL,VOICE", "WORK,VOICE", "FAX" };
+
+    QString data;
+    data.reserve(size * 96);
+
+    for (int i = 0; i < size; ++i) {
+        data += QStringLiteral("BEGIN:VCARD\nVERSION:3.0\n");
+        data += QStringLiteral("FN:%1\n").arg(phonebookName(i));
+
+        // Every fifth entry has several numbers; one in twenty changes between revisions
+        const int numbers = (i % 5 == 0) ? 3 : 1;
+        for (int n = 0; n < numbers; ++n) {
+            const int suffix = (i % 20 == 0) ? (i + revision) : i;
+            data += QStringLiteral("TEL;TYPE=%1:+358 40 %2%3\n")
+                    .arg(QLatin1String(types[(i + n) % 4]))
+                    .arg(n)
+                    .arg(suffix, 6, 10, QLatin1Char('0'));
+        }
+
+        data += QStringLiteral("END:VCARD\n");
+    }
+
+    return data;
+}
+
+}
+
+FakePhonebook::FakePhonebook(QObject *parent)
+    : QObject(parent)
+{
+}
+
+void FakePhonebook::setVCardData(const QString &data)
+{
+    m_vcardData = data;
+}
+
+void FakePhonebook::beginImport()
+{
+    QMetaObject::invokeMethod(this, "importReady", Qt::QueuedConnection, Q_ARG(QString, m_vcardData));
+}
+
+BenchSimPlugin::BenchSimPlugin(QObject *parent)
+    : QObject(parent)
+    , m_controller(0)
+    , m_modem(0)
+    , m_phonebook(0)
+    , m_finished(false)
+{
+}
+
+void BenchSimPlugin::initTestCase()
+{
+    foreach (const QString &dir, enginePluginDirs()) {
+        QCoreApplication::addLibraryPath(dir);
+    }
+    // Must be set before the controller asks for its contact manager
+    qputenv("CONTACTSD_CONTACT_MANAGER", ThrottledManagerName.toLocal8Bit());
+
+    m_controller = new CDSimController(this, false);
+    if (!throttledEngineActive()) {
+        // The transaction counts would all be zero
+        QSKIP("The throttled contacts engine is not available");
+    }
+
+    m_controller->setModemPaths(QStringList() << DummyModemPath);
+
+    m_modem = m_controller->m_modems.first();
+    m_modem->setReady(true);
+
+    // Take over the tail of the import, so that each phase can be timed separately
+    disconnect(m_modem->m_contactReader, &QVersitReader::stateChanged,
+               m_modem, &CDSimModemData::readerStateChanged);
+    connect(m_modem->m_contactReader, &QVersitReader::stateChanged,
+            this, &BenchSimPlugin::onReaderStateChanged);
+
+    m_phonebook = new FakePhonebook(this);
+    connect(m_phonebook, &FakePhonebook::importReady,
+            m_modem, &CDSimModemData::vcardDataAvailable);
+}
+
+void BenchSimPlugin::onReaderStateChanged(QVersitReader::State state)
+{
+    if (state != QVersitReader::FinishedState)
+        return;
+
+    QVersitContactImporter importer;
+    importer.importDocuments(m_modem->m_contactReader->results());
+    m_modem->m_simContacts = importer.contacts();
+    m_times.parse = m_phaseTimer.restart();
+
+    QList<QContact> importContacts;
+    QList<QContactId> obsoleteIds;
+    m_modem->prepareSimContactChanges(&importContacts, &obsoleteIds);
+    m_times.diff = m_phaseTimer.restart();
+
+    m_times.saved = importContacts.count();
+    m_times.removed = obsoleteIds.count();
+
+    // In the batches of the plugin's store task, without returning to the event loop
+    m_times.batches = 0;
+    bool stored = false;
+    while (!stored) {
+        stored = m_modem->storeSimContactChanges(&importContacts, &obsoleteIds, CDSimModemData::StoreBatchSize);
+        ++m_times.batches;
+    }
+    m_times.store = m_phaseTimer.restart();
+    m_finished = true;
+
+    m_modem->updateBusy();
+}
+
+void BenchSimPlugin::runImport(const QString &vcardData)
+{
+    m_times = PhaseTimes();
+    m_finished = false;
+
+    m_phonebook->setVCardData(vcardData);
+    m_phonebook->beginImport();
+    Contactsd::Statistics::instance()->reset();
+
+    m_phaseTimer.start();
+    QTRY_VERIFY_WITH_TIMEOUT(m_finished, 10 * 60 * 1000);
+    QTRY_VERIFY(!m_controller->busy());
+    m_times.transactions = engineTransactions();
+}
+
+void BenchSimPlugin::recordResult(const QString &phase, int size, const PhaseTimes &times, qint64 total)
+{
+    QJsonObject result;
+    result.insert(QStringLiteral("benchmark"), QStringLiteral("sim-import"));
+    result.insert(QStringLiteral("phase"), phase);
+    result.insert(QStringLiteral("size"), size);
+    result.insert(QStringLiteral("parseMs"), times.parse);
+    result.insert(QStringLiteral("diffMs"), times.diff);
+    result.insert(QStringLiteral("storeMs"), times.store);
+    result.insert(QStringLiteral("totalMs"), total);
+    result.insert(QStringLiteral("contactsSaved"), times.saved);
+    result.insert(QStringLiteral("contactsRemoved"), times.removed);
+    result.insert(QStringLiteral("storeBatches"), times.batches);
+    result.insert(QStringLiteral("transactions"), times.transactions);
+    result.insert(QStringLiteral("peakRssKb"), peakRssKb());
+    m_results.append(result);
+
+    qDebug() << phase << size << "parse:" << times.parse << "diff:" << times.diff
+             << "store:" << times.store << "total:" << total << "ms"
+             << "transactions:" << times.transactions;
+}
+
+void BenchSimPlugin::benchImport_data()
+{
+    QTest::addColumn<int>("size");
+
+    foreach (int size, phonebookSizes()) {
+        QTest::newRow(QByteArray::number(size).constData()) << size;
+    }
+}
+
+void BenchSimPlugin::benchImport()
+{
+    QFETCH(int, size);
+
+    QElapsedTimer timer;
+
+    // Initial import into an empty collection
+    timer.start();
+    runImport(generatePhonebook(size, 0));
+    if (QTest::currentTestFailed())
+        return;
+    recordResult(QStringLiteral("initial"), size, m_times, timer.elapsed());
+    QVERIFY(m_times.saved > 0);
+    QVERIFY(m_times.transactions <= m_times.batches);
+
+    // Re-read of the same SIM with a few changed numbers
+    timer.start();
+    runImport(generatePhonebook(size, 1));
+    if (QTest::currentTestFailed())
+        return;
+    recordResult(QStringLiteral("resync"), size, m_times, timer.elapsed());
+    QVERIFY(m_times.saved < size);
+    QVERIFY(m_times.transactions <= m_times.batches);
+
+    // Re-read of an unchanged SIM should not store anything
+    timer.start();
+    runImport(generatePhonebook(size, 1));
+    if (QTest::currentTestFailed())
+        return;
+    recordResult(QStringLiteral("unchanged"), size, m_times, timer.elapsed());
+    QCOMPARE(m_times.saved, 0);
+    QCOMPARE(m_times.removed, 0);
+    QCOMPARE(m_times.transactions, Q_INT64_C(0));
+}
+
+void BenchSimPlugin::cleanupTestCase()
+{
+    QFile output(outputFileName());
+    if (output.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        QJsonObject root;
+        root.insert(QStringLiteral("results"), m_results);
+        output.write(QJsonDocument(root).toJson());
+        qDebug() << "Wrote benchmark results to" << output.fileName();
+    } else {
+        qWarning() << "Unable to write benchmark results to" << output.fileName();
+    }
+
+    if (m_modem && CDSimModemData::removeCollections(&m_controller->contactManager(),
+                                                     QList<QContactCollectionId>() << m_modem->contactCollection().id())) {
+        qDebug() << "Remove benchmark collection";
+    }
+}
+
+void BenchSimPlugin::cleanup()
+{
+    m_modem->removeAllSimContacts();
+}
+
+CONTACTSD_TEST_MAIN(BenchSimPlugin)
@@ -0,0 +1,87 @@
+/** This file is part of Contacts daemon
+ **
+ ** Copyright (c) 2026 Jolla Ltd.
+ **
+ ** GNU Lesser General Public License Usage
+ ** This file may be used under the terms of the GNU Lesser General Public License
+ ** version 2.1 as published by the Free Software Foundation and appearing in the
+ ** file LICENSE.LGPL included in the packaging of this file.  Please review the
+ ** following information to ensure the GNU Lesser General Public License version
+ ** 2.1 requirements will be met:
+ ** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+ **/
+
+#ifndef BENCH_SIM_PLUGIN_H
+#define BENCH_SIM_PLUGIN_H
+
+#include <QObject>
+#include <QJsonArray>
+#include <QtTest/QtTest>
+
+// "unprotect" the modem data internals, as in ut_simplugin
+#define private public
+#define protected public
+#include "cdsimcontroller.h"
+#undef private
+#undef protected
+
+// Stands in for the ofono phonebook: hands out a pre-generated VCard
+// export asynchronously, as QOfonoPhonebook::importReady would.
+class FakePhonebook : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit FakePhonebook(QObject *parent = 0);
+
+    void setVCardData(const QString &data);
+    void beginImport();
+
+Q_SIGNALS:
+    void importReady(const QString &vcardData);
+
+private:
+    QString m_vcardData;
+};
+
+class BenchSimPlugin : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit BenchSimPlugin(QObject *parent = 0);
+
+private Q_SLOTS:
+    void initTestCase();
+
+    void benchImport_data();
+    void benchImport();
+
+    void cleanupTestCase();
+    void cleanup();
+
+private:
+    struct PhaseTimes {
+        qint64 parse;
+        qint64 diff;
+        qint64 store;
+        int batches;
+        int saved;
+        int removed;
+        qint64 transactions;
+    };
+
+    void onReaderStateChanged(QVersitReader::State state);
+    void runImport(const QString &vcardData);
+    void recordResult(const QString &phase, int size, const PhaseTimes &times, qint64 total);
+
+    CDSimController *m_controller;
+    CDSimModemData *m_modem;
+    FakePhonebook *m_phonebook;
+    QElapsedTimer m_phaseTimer;
+    PhaseTimes m_times;
+    bool m_finished;
+    QJsonArray m_results;
+};
+
+#endif // BENCH_SIM_PLUGIN_H
@@ -0,0 +1,26 @@
+include(../common/test-common.pri)
+
+TARGET = bench_simplugin
+target.path = /opt/tests/$${PACKAGENAME}/$$TARGET
+
+CONFIG += test link_pkgconfig
+
+QT -= gui
+QT += dbus testlib
+
+PKGCONFIG += mlite5 Qt5Contacts Qt5Versit qofono-qt5
+PKGCONFIG += qtcontacts-sqlite-qt5-extensions qofonoext
+
+INCLUDEPATH += \
+    ../../plugins/sim \
+    ../../src
+
+HEADERS += \
+    bench-sim-plugin.h \
+    ../../plugins/sim/cdsimcontroller.h
+
+SOURCES += \
+    bench-sim-plugin.cpp \
+    ../../plugins/sim/cdsimcontroller.cpp
+
+INSTALLS += target
@@ -0,0 +1,370 @@
+/** This file is part of Contacts daemon
+ **
+ ** Copyright (c) 2026 Jolla Ltd.
+ **
+ ** GNU Lesser General Public License Usage
+ ** This file may be used under the terms of the GNU Lesser General Public License
+ ** version 2.1 as published by the Free Software Foundation and appearing in the
+ ** file LICENSE.LGPL included in the packaging of this file.  Please review the
+ ** following information to ensure the GNU Lesser General Public License version
+ ** 2.1 requirements will be met:
+ ** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+ **/
+
+#include "bench-telepathy.h"
+
+#include "cdtpcontact.h"
+#include "cdtpstoragehelpers.h"
+
+#include <TelepathyQt/Presence>
+#include <TelepathyQt/RequestableChannelClassSpec>
+
+#include <QCoreApplication>
+#include <QDataStream>
+
+// Micro benchmarks for the CPU bound helpers of the telepathy plugin. They
+// need neither a telepathy connection nor a contacts database, so results
+// are stable enough to be compared between builds.
+//
+// Environment:
+//   CONTACTSD_BENCH_OUTPUT  QtTest XML result file; results go to stdout when unset
+
+Q_DECLARE_METATYPE(CDTpStorage::DisplayLabelOrder)
+
+namespace {
+
+Tp::ContactInfoField infoField(const QString &name, const QStringList &parameters, const QStringList &values)
+{
+    Tp::ContactInfoField field;
+    field.fieldName = name;
+    field.parameters = parameters;
+    field.fieldValue = values;
+    return field;
+}
+
+// A vCard of roughly fieldCount fields, in the proportions seen on XMPP and
+// SIP rosters: mostly phone numbers, emails and addresses
+Tp::ContactInfoFieldList contactInfoFields(int fieldCount, int seed = 0)
+{
+    Tp::ContactInfoFieldList fields;
+
+    const QString n(QString::number(seed));
+    fields << infoField(QStringLiteral("n"), QStringList(),
+                        QStringList() << QStringLiteral("Virtanen") << QStringLiteral("Matti")
+                                      << QString() << QStringLiteral("Dr.") << QString());
+    fields << infoField(QStringLiteral("fn"), QStringList(), QStringList() << QStringLiteral("Matti Virtanen"));
+    fields << infoField(QStringLiteral("nickname"), QStringList(), QStringList() << QStringLiteral("mattiv") + n);
+    fields << infoField(QStringLiteral("bday"), QStringList(), QStringList() << QStringLiteral("1984-06-21"));
+    fields << infoField(QStringLiteral("x-gender"), QStringList(), QStringList() << QStringLiteral("male"));
+
+    for (int i = 0; fields.count() < fieldCount; ++i) {
+        const QString index(QString::number(i));
+        switch (i % 8) {
+        case 0:
+        case 1:
+        case 2:
+            fields << infoField(QStringLiteral("tel"),
+                                QStringList() << QStringLiteral("type=cell") << (i % 2 ? QStringLiteral("type=home") : QStringLiteral("type=work")),
+                                QStringList() << QStringLiteral("+35840%1%2").arg(seed).arg(i, 6, 10, QLatin1Char('0')));
+            break;
+        case 3:
+        case 4:
+            fields << infoField(QStringLiteral("email"),
+                                QStringList() << QStringLiteral("type=internet"),
+                                QStringList() << QStringLiteral("matti.virtanen%1.%2@example.com").arg(index, n));
+            break;
+        case 5:
+            fields << infoField(QStringLiteral("adr"),
+                                QStringList() << QStringLiteral("type=home") << QStringLiteral("type=postal"),
+                                QStringList() << QString() << QStringLiteral("Apartment ") + index
+                                              << QStringLiteral("Mannerheimintie ") + index << QStringLiteral("Helsinki")
+                                              << QStringLiteral("Uusimaa") << QStringLiteral("00100") << QStringLiteral("Finland"));
+            break;
+        case 6:
+            fields << infoField(QStringLiteral("url"), QStringList(),
+                                QStringList() << QStringLiteral("https://example.com/~matti/%1/%2").arg(n, index));
+            break;
+        default:
+            fields << infoField(QStringLiteral("org"), QStringList() << QStringLiteral("type=work"),
+                                QStringList() << QStringLiteral("Example Oy ") + index << QStringLiteral("Engineering"));
+            fields << infoField(QStringLiteral("note"), QStringList(),
+                                QStringList() << QStringLiteral("Met at conference %1, follow up about project %2").arg(index, n));
+            break;
+        }
+    }
+
+    return fields;
+}
+
+CDTpContact::Info contactInfo(const QString &alias, const Tp::Presence &presence, const Tp::ContactInfoFieldList &fields)
+{
+    return CDTpContact::Info(alias, presence,
+                             CDTpContact::Info::TextChats | CDTpContact::Info::StreamedMediaAudioCalls,
+                             QStringLiteral("/home/nemo/.local/share/data/avatars/%1.jpg").arg(alias),
+                             fields);
+}
+
+class BenchCapabilities : public Tp::CapabilitiesBase
+{
+public:
+    BenchCapabilities(const Tp::RequestableChannelClassSpecList &specs)
+        : Tp::CapabilitiesBase(specs, true)
+    {
+    }
+};
+
+// The common channel classes followed by tubes, which the capability
+// queries have to scan past
+Tp::RequestableChannelClassSpecList channelClassSpecs(int tubeCount)
+{
+    Tp::RequestableChannelClassSpecList specs;
+    for (int i = 0; i < tubeCount; ++i) {
+        specs << Tp::RequestableChannelClassSpec::streamTube(QStringLiteral("x-bench-service-%1").arg(i));
+    }
+    specs << Tp::RequestableChannelClassSpec::textChat();
+    specs << Tp::RequestableChannelClassSpec::streamedMediaCall();
+    specs << Tp::RequestableChannelClassSpec::streamedMediaAudioCall();
+    specs << Tp::RequestableChannelClassSpec::streamedMediaVideoCall();
+    specs << Tp::RequestableChannelClassSpec::streamedMediaVideoCallWithAudio();
+    specs << Tp::RequestableChannelClassSpec::fileTransfer();
+    return specs;
+}
+
+void addNameRows()
+{
+    QTest::addColumn<QString>("firstName");
+    QTest::addColumn<QString>("lastName");
+    QTest::addColumn<CDTpStorage::DisplayLabelOrder>("order");
+
+    QTest::newRow("latin") << QStringLiteral("Matti") << QStringLiteral("Virtanen") << CDTpStorage::FirstNameFirst;
+    QTest::newRow("latin-lastfirst") << QStringLiteral("Matti") << QStringLiteral("Virtanen") << CDTpStorage::LastNameFirst;
+    QTest::newRow("cyrillic") << QString::fromUtf8("Александр") << QString::fromUtf8("Константинопольский") << CDTpStorage::FirstNameFirst;
+    QTest::newRow("han") << QString::fromUtf8("小明") << QString::fromUtf8("欧阳") << CDTpStorage::FirstNameFirst;
+    QTest::newRow("hangul") << QString::fromUtf8("민준") << QString::fromUtf8("김") << CDTpStorage::FirstNameFirst;
+    QTest::newRow("mixed") << QStringLiteral("Matti") << QString::fromUtf8("欧阳") << CDTpStorage::FirstNameFirst;
+    QTest::newRow("long-latin") << QStringLiteral("Maria-Magdalena Johanna Wilhelmina")
+                                << QStringLiteral("von Hohenzollern-Sigmaringen") << CDTpStorage::FirstNameFirst;
+}
+
+}
+
+BenchTelepathy::BenchTelepathy(QObject *parent)
+    : QObject(parent)
+{
+}
+
+void BenchTelepathy::benchInfoDiff_data()
+{
+    QTest::addColumn<Tp::ContactInfoFieldList>("fields");
+    QTest::addColumn<Tp::ContactInfoFieldList>("otherFields");
+    QTest::addColumn<QString>("otherAlias");
+
+    const Tp::ContactInfoFieldList small(contactInfoFields(10));
+    const Tp::ContactInfoFieldList large(contactInfoFields(200));
+
+    Tp::ContactInfoFieldList largeChangedLast(large);
+    largeChangedLast.last().fieldValue[0].append(QLatin1Char('x'));
+
+    QTest::newRow("small-equal") << small << small << QStringLiteral("Matti");
+    QTest::newRow("large-equal") << large << large << QStringLiteral("Matti");
+    QTest::newRow("large-changed-last") << large << largeChangedLast << QStringLiteral("Matti");
+    QTest::newRow("large-changed-alias") << large << large << QStringLiteral("Matti V");
+    QTest::newRow("large-distinct") << large << contactInfoFields(200, 1) << QStringLiteral("Matti");
+}
+
+void BenchTelepathy::benchInfoDiff()
+{
+    QFETCH(Tp::ContactInfoFieldList, fields);
+    QFETCH(Tp::ContactInfoFieldList, otherFields);
+    QFETCH(QString, otherAlias);
+
+    // Separately deserialized, so the field lists do not share data
+    const CDTpContact::Info info(contactInfo(QStringLiteral("Matti"), Tp::Presence::available(), fields));
+    const CDTpContact::Info other(contactInfo(otherAlias, Tp::Presence::available(), otherFields));
+
+    CDTpContact::Changes changes = 0;
+    QBENCHMARK {
+        changes = info.diff(other);
+    }
+    QCOMPARE(bool(changes & CDTpContact::Information), fields != otherFields);
+}
+
+void BenchTelepathy::benchInfoSerialize_data()
+{
+    QTest::addColumn<Tp::ContactInfoFieldList>("fields");
+
+    QTest::newRow("no-info") << Tp::ContactInfoFieldList();
+    QTest::newRow("small") << contactInfoFields(10);
+    QTest::newRow("large") << contactInfoFields(200);
+}
+
+void BenchTelepathy::benchInfoSerialize()
+{
+    QFETCH(Tp::ContactInfoFieldList, fields);
+
+    const CDTpContact::Info info(contactInfo(QStringLiteral("Matti"), Tp::Presence::available(), fields));
+
+    QBENCHMARK {
+        QByteArray data;
+        QDataStream out(&data, QIODevice::WriteOnly);
+        out << info;
+    }
+}
+
+void BenchTelepathy::benchInfoDeserialize_data()
+{
+    benchInfoSerialize_data();
+}
+
+void BenchTelepathy::benchInfoDeserialize()
+{
+    QFETCH(Tp::ContactInfoFieldList, fields);
+
+    QByteArray data;
+    {
+        QDataStream out(&data, QIODevice::WriteOnly);
+        out << contactInfo(QStringLiteral("Matti"), Tp::Presence::available(), fields);
+    }
+
+    QBENCHMARK {
+        CDTpContact::Info info;
+        QDataStream in(data);
+        in >> info;
+    }
+}
+
+void BenchTelepathy::benchInfoFieldSerialize_data()
+{
+    QTest::addColumn<Tp::ContactInfoField>("field");
+
+    const Tp::ContactInfoFieldList fields(contactInfoFields(20));
+    QTest::newRow("tel") << fields.at(5);
+    QTest::newRow("adr") << fields.at(10);
+    QTest::newRow("n") << fields.at(0);
+}
+
+void BenchTelepathy::benchInfoFieldSerialize()
+{
+    QFETCH(Tp::ContactInfoField, field);
+
+    QBENCHMARK {
+        QByteArray data;
+        {
+            QDataStream out(&data, QIODevice::WriteOnly);
+            out << field;
+        }
+        Tp::ContactInfoField copy;
+        QDataStream in(data);
+        in >> copy;
+    }
+}
+
+void BenchTelepathy::benchDisplayLabel_data()
+{
+    addNameRows();
+}
+
+void BenchTelepathy::benchDisplayLabel()
+{
+    QFETCH(QString, firstName);
+    QFETCH(QString, lastName);
+    QFETCH(CDTpStorage::DisplayLabelOrder, order);
+
+    QContactName name;
+    name.setFirstName(firstName);
+    name.setLastName(lastName);
+
+    QString label;
+    QBENCHMARK {
+        label = generateDisplayLabel(name, order);
+    }
+    QVERIFY(label.contains(firstName) && label.contains(lastName));
+}
+
+void BenchTelepathy::benchNameScript_data()
+{
+    addNameRows();
+}
+
+void BenchTelepathy::benchNameScript()
+{
+    QFETCH(QString, firstName);
+    QFETCH(QString, lastName);
+
+    QBENCHMARK {
+        nameScript(firstName, lastName);
+    }
+}
+
+void BenchTelepathy::benchCapabilities_data()
+{
+    QTest::addColumn<int>("tubeCount");
+    QTest::addColumn<int>("presenceType");
+
+    QTest::newRow("basic-available") << 0 << int(Tp::ConnectionPresenceTypeAvailable);
+    QTest::newRow("basic-unknown") << 0 << int(Tp::ConnectionPresenceTypeUnknown);
+    QTest::newRow("many-available") << 50 << int(Tp::ConnectionPresenceTypeAvailable);
+}
+
+void BenchTelepathy::benchCapabilities()
+{
+    QFETCH(int, tubeCount);
+    QFETCH(int, presenceType);
+
+    const BenchCapabilities capabilities(channelClassSpecs(tubeCount));
+
+    // The account is only consulted for offline presences
+    const Tp::AccountPtr account;
+
+    QStringList current;
+    QBENCHMARK {
+        current = currentCapabilites(capabilities, Tp::ConnectionPresenceType(presenceType), account);
+    }
+    QVERIFY(current.contains(asString(CDTpContact::Info::TextChats)));
+}
+
+void BenchTelepathy::benchImAddress()
+{
+    const QString accountPath(QStringLiteral("/org/freedesktop/Telepathy/Account/gabble/jabber/matti_40example_2ecom0"));
+    const QString contactId(QStringLiteral("teppo.testaaja@example.com"));
+
+    QString address;
+    QBENCHMARK {
+        address = imAddress(accountPath, contactId);
+    }
+    QCOMPARE(address, accountPath + QLatin1Char('!') + contactId);
+}
+
+void BenchTelepathy::benchContactInfoDetails_data()
+{
+    QTest::addColumn<Tp::ContactInfoFieldList>("fields");
+
+    QTest::newRow("small") << contactInfoFields(10);
+    QTest::newRow("large") << contactInfoFields(200);
+}
+
+void BenchTelepathy::benchContactInfoDetails()
+{
+    QFETCH(Tp::ContactInfoFieldList, fields);
+
+    ContactInfoDetails details;
+    QBENCHMARK {
+        details = contactInfoDetails(fields);
+    }
+    QVERIFY(!details.phoneNumbers.isEmpty());
+    QCOMPARE(details.name.firstName(), QStringLiteral("Matti"));
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QStringList args(app.arguments());
+    const QString output = QString::fromLocal8Bit(qgetenv("CONTACTSD_BENCH_OUTPUT"));
+    if (!output.isEmpty()) {
+        args << QStringLiteral("-o") << output + QStringLiteral(",xml");
+    }
+
+    BenchTelepathy bench;
+    return QTest::qExec(&bench, args);
+}
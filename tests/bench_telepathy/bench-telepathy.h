@@ -0,0 +1,52 @@
+/** This file is part of Contacts daemon
+ **
+ ** Copyright (c) 2026 Jolla Ltd.
+ **
+ ** GNU Lesser General Public License Usage
+ ** This file may be used under the terms of the GNU Lesser General Public License
+ ** version 2.1 as published by the Free Software Foundation and appearing in the
+ ** file LICENSE.LGPL included in the packaging of this file.  Please review the
+ ** following information to ensure the GNU Lesser General Public License version
+ ** 2.1 requirements will be met:
+ ** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+ **/
+
+#ifndef BENCH_TELEPATHY_H
+#define BENCH_TELEPATHY_H
+
+#include <QObject>
+#include <QtTest/QtTest>
+
+class BenchTelepathy : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit BenchTelepathy(QObject *parent = 0);
+
+private Q_SLOTS:
+    void benchInfoDiff_data();
+    void benchInfoDiff();
+
+    void benchInfoSerialize_data();
+    void benchInfoSerialize();
+    void benchInfoDeserialize_data();
+    void benchInfoDeserialize();
+    void benchInfoFieldSerialize_data();
+    void benchInfoFieldSerialize();
+
+    void benchDisplayLabel_data();
+    void benchDisplayLabel();
+    void benchNameScript_data();
+    void benchNameScript();
+
+    void benchCapabilities_data();
+    void benchCapabilities();
+
+    void benchImAddress();
+
+    void benchContactInfoDetails_data();
+    void benchContactInfoDetails();
+};
+
+#endif // BENCH_TELEPATHY_H
@@ -0,0 +1,31 @@
+include(../common/test-common.pri)
+include(../../plugins/contacts-extensions.pri)
+
+TARGET = bench_telepathy
+target.path = /opt/tests/$${PACKAGENAME}/$$TARGET
+
+CONFIG += test link_pkgconfig
+
+QT -= gui
+QT += dbus network testlib
+
+PKGCONFIG += Qt5Contacts TelepathyQt5 mlite5 contactcache-qt5
+
+DEFINES += QT_NO_CAST_TO_ASCII QT_NO_CAST_FROM_ASCII
+
+TELEPATHY_PLUGIN_DIR = $$PWD/../../plugins/telepathy
+
+INCLUDEPATH += $$TELEPATHY_PLUGIN_DIR
+VPATH += $$TELEPATHY_PLUGIN_DIR
+
+HEADERS += \
+    bench-telepathy.h \
+    cdtpcontact.h \
+    cdtpstoragehelpers.h
+
+SOURCES += \
+    bench-telepathy.cpp \
+    cdtpcontact.cpp \
+    cdtpstoragehelpers.cpp
+
+INSTALLS += target
@@ -0,0 +1,340 @@
+/** This file is part of Contacts daemon
+ **
+ ** Copyright (c) 2026 Jolla Ltd.
+ **
+ ** GNU Lesser General Public License Usage
+ ** This file may be used under the terms of the GNU Lesser General Public License
+ ** version 2.1 as published by the Free Software Foundation and appearing in the
+ ** file LICENSE.LGPL included in the packaging of this file.  Please review the
+ ** following information to ensure the GNU Lesser General Public License version
+ ** 2.1 requirements will be met:
+ ** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+ **/
+
+#include "bench-telepathy-accounts.h"
+
+#include <test-common.h>
+
+#include <QDBusInterface>
+#include <QDBusReply>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include <qtcontacts-extensions.h>
+#include <qtcontacts-extensions_manager_impl.h>
+#include <contactmanagerengine.h>
+
+#include "libtelepathy/util.h"
+
+// This benchmark measures the account synchronisation done by the telepathy
+// plugin when the daemon starts. A fake AccountManager is registered with 1,
+// 5 and 10 accounts, each with a connected roster, and a contactsd process is
+// started against it; the duration of the "syncAccounts" scope is read from
+// the daemon's /StartupTimeline. Each size is measured on a cold start, where
+// the account collections must be created, and on a warm restart.
+//
+// It needs a session bus of its own, so it should be run under
+// with-session-bus.sh as ut_telepathyplugin is.
+//
+// Environment:
+//   CONTACTSD_BENCH_ACCOUNT_COUNTS  comma separated account counts (default 1,5,10)
+//   CONTACTSD_BENCH_ROSTER_SIZE     roster contacts per account (default 20)
+//   CONTACTSD_BENCH_OUTPUT          JSON result file (default bench_telepathyaccounts.json)
+//   CONTACTSD_BINARY                contactsd executable to start
+//   CONTACTSD_PLUGINS_DIRS          directory of the telepathy plugin
+
+namespace {
+
+const int DaemonTimeout = 60 * 1000;
+
+QList<int> accountCounts()
+{
+    QList<int> counts;
+
+    const QString env = QString::fromLocal8Bit(qgetenv("CONTACTSD_BENCH_ACCOUNT_COUNTS"));
+    Q_FOREACH (const QString &count, env.split(QLatin1Char(','), QString::SkipEmptyParts)) {
+        bool ok = false;
+        const int value = count.trimmed().toInt(&ok);
+        if (ok && value > 0) {
+            counts.append(value);
+        }
+    }
+
+    if (counts.isEmpty()) {
+        counts << 1 << 5 << 10;
+    }
+
+    std::sort(counts.begin(), counts.end());
+    return counts;
+}
+
+int rosterSize()
+{
+    bool ok = false;
+    const int value = qgetenv("CONTACTSD_BENCH_ROSTER_SIZE").toInt(&ok);
+    return (ok && value >= 0) ? value : 20;
+}
+
+QString outputFileName()
+{
+    const QString env = QString::fromLocal8Bit(qgetenv("CONTACTSD_BENCH_OUTPUT"));
+    return env.isEmpty() ? QStringLiteral("bench_telepathyaccounts.json") : env;
+}
+
+QString daemonBinary()
+{
+    const QString env = QString::fromLocal8Bit(qgetenv("CONTACTSD_BINARY"));
+    return env.isEmpty() ? QStringLiteral(CONTACTSD_BINARY) : env;
+}
+
+QString pluginsDir()
+{
+    const QString env = QString::fromLocal8Bit(qgetenv("CONTACTSD_PLUGINS_DIRS"));
+    return env.isEmpty() ? QStringLiteral(CONTACTSD_PLUGINS_DIR) : env;
+}
+
+}
+
+BenchTelepathyAccounts::BenchTelepathyAccounts(QObject *parent)
+    : QObject(parent)
+    , mContactManager(0)
+    , mAccountManager(0)
+{
+}
+
+void BenchTelepathyAccounts::initTestCase()
+{
+    g_set_prgname("bench-telepathy-accounts");
+
+    dbus_g_bus_get(DBUS_BUS_STARTER, 0);
+
+    mContactManager = new QContactManager(QStringLiteral("org.nemomobile.contacts.sqlite"));
+
+    /* Create a fake AccountManager, as ut_telepathyplugin does */
+    TpDBusDaemon *dbus = tp_dbus_daemon_dup(NULL);
+    mAccountManager = (TpTestsSimpleAccountManager *) tp_tests_object_new_static_class(
+            TP_TESTS_TYPE_SIMPLE_ACCOUNT_MANAGER, NULL);
+    tp_dbus_daemon_register_object(dbus, TP_ACCOUNT_MANAGER_OBJECT_PATH, mAccountManager);
+    tp_dbus_daemon_request_name(dbus, TP_ACCOUNT_MANAGER_BUS_NAME, FALSE, NULL);
+    g_object_unref(dbus);
+
+    mDaemon.setProcessChannelMode(QProcess::ForwardedChannels);
+
+    QProcessEnvironment environment = QProcessEnvironment::systemEnvironment();
+    environment.insert(QStringLiteral("CONTACTSD_PLUGINS_DIRS"), pluginsDir());
+    environment.insert(QStringLiteral("CONTACTSD_DIRECT_GC"), QStringLiteral("1"));
+    mDaemon.setProcessEnvironment(environment);
+
+    removeCollections();
+}
+
+void BenchTelepathyAccounts::addAccount(int index)
+{
+    FakeAccount fake;
+    fake.path = QByteArray(TP_ACCOUNT_OBJECT_PATH_BASE "fakecm/fakeproto/benchaccount_")
+            + QByteArray::number(index + 1);
+
+    const QByteArray name = "benchaccount" + QByteArray::number(index + 1);
+    tp_tests_create_and_connect_conn(TP_TESTS_TYPE_CONTACTS_CONNECTION,
+            name.constData(), &fake.connService, &fake.connection);
+    QVERIFY(fake.connService);
+    QVERIFY(fake.connection);
+
+    const gchar *alias = name.constData();
+    tp_tests_contacts_connection_change_aliases(
+        TP_TESTS_CONTACTS_CONNECTION(fake.connService),
+        1, &fake.connService->self_handle, &alias);
+
+    /* Fill the roster */
+    TestContactListManager *listManager = tp_tests_contacts_connection_get_contact_list_manager(
+        TP_TESTS_CONTACTS_CONNECTION(fake.connService));
+    TpHandleRepoIface *serviceRepo =
+        tp_base_connection_get_handles(fake.connService, TP_HANDLE_TYPE_CONTACT);
+
+    const int contacts = rosterSize();
+    for (int i = 0; i < contacts; ++i) {
+        const QByteArray id = name + "-contact" + QByteArray::number(i);
+        TpHandle handle = tp_handle_ensure(serviceRepo, id.constData(), NULL, NULL);
+        test_contact_list_manager_request_subscription(listManager, 1, &handle, "wait");
+    }
+
+    TpDBusDaemon *dbus = tp_dbus_daemon_dup(NULL);
+    fake.account = (TpTestsSimpleAccount *) tp_tests_object_new_static_class(
+            TP_TESTS_TYPE_SIMPLE_ACCOUNT, NULL);
+    tp_dbus_daemon_register_object(dbus, fake.path.constData(), fake.account);
+    tp_tests_simple_account_manager_add_account(mAccountManager, fake.path.constData(), TRUE);
+    tp_tests_simple_account_set_connection(fake.account, fake.connService->object_path);
+    g_object_unref(dbus);
+
+    mAccounts.append(fake);
+}
+
+void BenchTelepathyAccounts::removeAccounts()
+{
+    TpDBusDaemon *dbus = tp_dbus_daemon_dup(NULL);
+
+    Q_FOREACH (const FakeAccount &fake, mAccounts) {
+        tp_cli_connection_call_disconnect(fake.connection, -1, NULL, NULL, NULL, NULL);
+        tp_tests_simple_account_manager_remove_account(mAccountManager, fake.path.constData());
+        tp_tests_simple_account_removed(fake.account);
+        tp_dbus_daemon_unregister_object(dbus, fake.account);
+
+        g_object_unref(fake.connService);
+        g_object_unref(fake.connection);
+        g_object_unref(fake.account);
+    }
+
+    g_object_unref(dbus);
+    mAccounts.clear();
+}
+
+bool BenchTelepathyAccounts::startDaemon()
+{
+    // We load only the needed plugins, as the with-daemon.sh script does
+    mDaemon.start(daemonBinary(), QStringList() << QStringLiteral("--plugins") << QStringLiteral("telepathy"));
+    if (!mDaemon.waitForStarted()) {
+        qWarning() << "Unable to start" << daemonBinary() << mDaemon.errorString();
+        return false;
+    }
+
+    return true;
+}
+
+void BenchTelepathyAccounts::stopDaemon()
+{
+    if (mDaemon.state() == QProcess::NotRunning)
+        return;
+
+    mDaemon.terminate();
+    if (!mDaemon.waitForFinished(DaemonTimeout)) {
+        mDaemon.kill();
+        mDaemon.waitForFinished();
+    }
+}
+
+qint64 BenchTelepathyAccounts::syncAccountsDuration()
+{
+    // The trace holds the complete "X" event once the scope has been left
+    QDBusInterface timeline(QStringLiteral("com.nokia.contactsd"), QStringLiteral("/StartupTimeline"),
+                            QStringLiteral("com.nokia.contactsd"));
+    if (!timeline.isValid())
+        return -1;
+
+    QDBusReply<QString> reply = timeline.call(QStringLiteral("traceEvents"));
+    if (!reply.isValid())
+        return -1;
+
+    const QJsonObject trace = QJsonDocument::fromJson(reply.value().toUtf8()).object();
+    Q_FOREACH (const QJsonValue &value, trace.value(QStringLiteral("traceEvents")).toArray()) {
+        const QJsonObject event = value.toObject();
+        if (event.value(QStringLiteral("name")).toString() == QLatin1String("syncAccounts")
+                && event.value(QStringLiteral("ph")).toString() == QLatin1String("X")) {
+            return static_cast<qint64>(event.value(QStringLiteral("dur")).toDouble());
+        }
+    }
+
+    return -1;
+}
+
+void BenchTelepathyAccounts::removeCollections()
+{
+    // The plugin keys its collections on the trailing number of the account path
+    const int maxAccountId = accountCounts().last();
+
+    QList<QContactCollectionId> collectionIds;
+    Q_FOREACH (const QContactCollection &collection, mContactManager->collections()) {
+        const QString name = collection.metaData(QContactCollection::KeyName).toString();
+        const int accountId = collection.extendedMetaData(COLLECTION_EXTENDEDMETADATA_KEY_ACCOUNTID).toInt();
+        if (name == QLatin1String("telepathy") && accountId > 0 && accountId <= maxAccountId) {
+            collectionIds.append(collection.id());
+        }
+    }
+
+    if (collectionIds.isEmpty())
+        return;
+
+    QtContactsSqliteExtensions::ContactManagerEngine *cme = QtContactsSqliteExtensions::contactManagerEngine(*mContactManager);
+    QContactManager::Error error = QContactManager::NoError;
+    if (!cme->storeChanges(nullptr, nullptr, collectionIds,
+                           QtContactsSqliteExtensions::ContactManagerEngine::PreserveLocalChanges,
+                           true, &error)) {
+        qWarning() << "Unable to remove benchmark collections:" << error;
+    }
+}
+
+void BenchTelepathyAccounts::recordResult(const QString &phase, int accounts, qint64 syncUs, qint64 totalMs)
+{
+    QJsonObject result;
+    result.insert(QStringLiteral("benchmark"), QStringLiteral("telepathy-account-sync"));
+    result.insert(QStringLiteral("phase"), phase);
+    result.insert(QStringLiteral("accounts"), accounts);
+    result.insert(QStringLiteral("rosterSize"), rosterSize());
+    result.insert(QStringLiteral("syncAccountsUs"), syncUs);
+    result.insert(QStringLiteral("totalMs"), totalMs);
+    mResults.append(result);
+
+    qDebug() << phase << accounts << "accounts, syncAccounts:" << syncUs << "us, total:" << totalMs << "ms";
+}
+
+void BenchTelepathyAccounts::benchStartup_data()
+{
+    QTest::addColumn<int>("accounts");
+
+    Q_FOREACH (int count, accountCounts()) {
+        QTest::newRow(QByteArray::number(count).constData()) << count;
+    }
+}
+
+void BenchTelepathyAccounts::benchStartup()
+{
+    QFETCH(int, accounts);
+
+    for (int i = 0; i < accounts; ++i) {
+        addAccount(i);
+        if (QTest::currentTestFailed())
+            return;
+    }
+
+    QElapsedTimer timer;
+    qint64 duration = -1;
+
+    // Cold start: every account collection and self contact is created
+    timer.start();
+    QVERIFY(startDaemon());
+    QTRY_VERIFY_WITH_TIMEOUT((duration = syncAccountsDuration()) >= 0, DaemonTimeout);
+    recordResult(QStringLiteral("cold"), accounts, duration, timer.elapsed());
+    stopDaemon();
+
+    // Warm restart: the stored accounts only need to be reconciled
+    duration = -1;
+    timer.start();
+    QVERIFY(startDaemon());
+    QTRY_VERIFY_WITH_TIMEOUT((duration = syncAccountsDuration()) >= 0, DaemonTimeout);
+    recordResult(QStringLiteral("warm"), accounts, duration, timer.elapsed());
+    stopDaemon();
+}
+
+void BenchTelepathyAccounts::cleanupTestCase()
+{
+    QFile output(outputFileName());
+    if (output.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        QJsonObject root;
+        root.insert(QStringLiteral("results"), mResults);
+        output.write(QJsonDocument(root).toJson());
+        qDebug() << "Wrote benchmark results to" << output.fileName();
+    } else {
+        qWarning() << "Unable to write benchmark results to" << output.fileName();
+    }
+
+    delete mContactManager;
+    g_object_unref(mAccountManager);
+}
+
+void BenchTelepathyAccounts::cleanup()
+{
+    stopDaemon();
+    removeAccounts();
+    removeCollections();
+}
+
+CONTACTSD_TEST_MAIN(BenchTelepathyAccounts)
@@ -0,0 +1,72 @@
+/** This file is part of Contacts daemon
+ **
+ ** Copyright (c) 2026 Jolla Ltd.
+ **
+ ** GNU Lesser General Public License Usage
+ ** This file may be used under the terms of the GNU Lesser General Public License
+ ** version 2.1 as published by the Free Software Foundation and appearing in the
+ ** file LICENSE.LGPL included in the packaging of this file.  Please review the
+ ** following information to ensure the GNU Lesser General Public License version
+ ** 2.1 requirements will be met:
+ ** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+ **/
+
+#ifndef BENCH_TELEPATHY_ACCOUNTS_H
+#define BENCH_TELEPATHY_ACCOUNTS_H
+
+#include <QObject>
+#include <QJsonArray>
+#include <QProcess>
+#include <QtTest/QtTest>
+
+#include <QContactManager>
+
+#include <telepathy-glib/telepathy-glib.h>
+
+#include "libtelepathy/contacts-conn.h"
+#include "libtelepathy/contact-list-manager.h"
+#include "libtelepathy/simple-account-manager.h"
+#include "libtelepathy/simple-account.h"
+
+QTCONTACTS_USE_NAMESPACE
+
+class BenchTelepathyAccounts : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit BenchTelepathyAccounts(QObject *parent = 0);
+
+private Q_SLOTS:
+    void initTestCase();
+
+    void benchStartup_data();
+    void benchStartup();
+
+    void cleanupTestCase();
+    void cleanup();
+
+private:
+    struct FakeAccount {
+        QByteArray path;
+        TpTestsSimpleAccount *account;
+        TpBaseConnection *connService;
+        TpConnection *connection;
+    };
+
+    void addAccount(int index);
+    void removeAccounts();
+    bool startDaemon();
+    void stopDaemon();
+    qint64 syncAccountsDuration();
+    void removeCollections();
+    void recordResult(const QString &phase, int accounts, qint64 syncUs, qint64 totalMs);
+
+    QContactManager *mContactManager;
+    TpTestsSimpleAccountManager *mAccountManager;
+    QList<FakeAccount> mAccounts;
+    QProcess mDaemon;
+    QJsonArray mResults;
+};
+
+#endif // BENCH_TELEPATHY_ACCOUNTS_H
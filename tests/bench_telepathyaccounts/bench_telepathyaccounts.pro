@@ -0,0 +1,31 @@
+include(../common/test-common.pri)
+
+PRE_TARGETDEPS += ../libtelepathy/libtelepathy.a
+
+TARGET = bench_telepathyaccounts
+target.path = /opt/tests/$${PACKAGENAME}/$$TARGET
+
+CONFIG += test link_pkgconfig
+
+QT -= gui
+QT += dbus testlib
+
+DEFINES += QT_NO_KEYWORDS
+
+PKGCONFIG += Qt5Contacts qtcontacts-sqlite-qt5-extensions TelepathyQt5 telepathy-glib dbus-glib-1 gio-2.0
+
+INCLUDEPATH += ..
+QMAKE_LIBDIR += ../libtelepathy
+LIBS += -ltelepathy
+
+# The daemon under test; both can be overridden from the environment
+DEFINES += CONTACTSD_BINARY=\\\"$$OUT_PWD/../../src/contactsd\\\"
+DEFINES += CONTACTSD_PLUGINS_DIR=\\\"$$OUT_PWD/../../plugins/telepathy\\\"
+
+HEADERS += \
+    bench-telepathy-accounts.h
+
+SOURCES += \
+    bench-telepathy-accounts.cpp
+
+INSTALLS += target
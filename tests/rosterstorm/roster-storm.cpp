@@ -0,0 +1,766 @@
+/** This file is part of Contacts daemon
+ **
+ ** Copyright (c) 2026 Jolla Ltd.
+ **
+ ** GNU Lesser General Public License Usage
+ ** This file may be used under the terms of the GNU Lesser General Public License
+ ** version 2.1 as published by the Free Software Foundation and appearing in the
+ ** file LICENSE.LGPL included in the packaging of this file.  Please review the
+ ** following information to ensure the GNU Lesser General Public License version
+ ** 2.1 requirements will be met:
+ ** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+ **/
+
+#include "roster-storm.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QtDebug>
+
+#include <QContactAvatar>
+#include <QContactCollection>
+#include <QContactFetchHint>
+#include <QContactNickname>
+#include <QContactNote>
+#include <QContactOnlineAccount>
+#include <QContactPresence>
+
+#include <algorithm>
+
+#include "libtelepathy/util.h"
+
+namespace {
+
+const int TickInterval = 10;
+const int RosterTimeout = 5 * 60 * 1000;
+
+const char *kindName(RosterStorm::EventKind kind)
+{
+    switch (kind) {
+    case RosterStorm::PresenceEvent:
+        return "presence";
+    case RosterStorm::AliasEvent:
+        return "alias";
+    case RosterStorm::AvatarEvent:
+        return "avatar";
+    case RosterStorm::InfoEvent:
+        return "info";
+    case RosterStorm::DisconnectEvent:
+        return "disconnect";
+    case RosterStorm::ReconnectEvent:
+        return "reconnect";
+    default:
+        return "unknown";
+    }
+}
+
+// Whether the stored contact carries the update identified by token. Tokens
+// are alphanumeric so that they survive the avatar cache file naming.
+bool isStored(RosterStorm::EventKind kind, const QString &token, const QContact &stored)
+{
+    switch (kind) {
+    case RosterStorm::PresenceEvent:
+        return stored.detail<QContactPresence>().customMessage() == token;
+    case RosterStorm::AliasEvent:
+        return stored.detail<QContactNickname>().nickname() == token;
+    case RosterStorm::AvatarEvent:
+        return stored.detail<QContactAvatar>().imageUrl().path().contains(token);
+    case RosterStorm::InfoEvent:
+        Q_FOREACH (const QContactNote &note, stored.details<QContactNote>()) {
+            if (note.note() == token) {
+                return true;
+            }
+        }
+        return false;
+    default:
+        return false;
+    }
+}
+
+qint64 percentile(const QVector<qint64> &sorted, int percent)
+{
+    const int index = qMin(sorted.count() - 1, (sorted.count() * percent) / 100);
+    return sorted.at(index);
+}
+
+}
+
+RosterStorm::Config::Config()
+    : accounts(2)
+    , rosterSize(200)
+    , duration(60)
+    , drain(15)
+    , reconnectInterval(0)
+    , offlineTime(2)
+    , avatarSize(8192)
+    , seed(1)
+    , output(QStringLiteral("roster-storm.json"))
+{
+    rates[PresenceEvent] = 20;
+    rates[AliasEvent] = 2;
+    rates[AvatarEvent] = 1;
+    rates[InfoEvent] = 2;
+}
+
+RosterStorm::RosterStorm(const Config &config, QObject *parent)
+    : QObject(parent)
+    , mConfig(config)
+    , mContactManager(0)
+    , mAccountManager(0)
+    , mLastTickUs(0)
+    , mRosterStartUs(0)
+    , mRosterStoredUs(0)
+    , mUnstored(0)
+    , mLoadRunning(false)
+    , mSequence(0)
+    , mNextCycle(0)
+{
+    for (int i = 0; i < RatedKindCount; ++i) {
+        mBudget[i] = 0;
+    }
+
+    mTicker.setInterval(TickInterval);
+    connect(&mTicker, &QTimer::timeout, this, &RosterStorm::onTick);
+    connect(&mReconnectTimer, &QTimer::timeout, this, &RosterStorm::onCycleTimer);
+
+    qsrand(mConfig.seed);
+    mClock.start();
+}
+
+RosterStorm::~RosterStorm()
+{
+    delete mContactManager;
+    if (mAccountManager) {
+        g_object_unref(mAccountManager);
+    }
+}
+
+qint64 RosterStorm::nowUs() const
+{
+    return mClock.nsecsElapsed() / 1000;
+}
+
+bool RosterStorm::start()
+{
+    dbus_g_bus_get(DBUS_BUS_STARTER, 0);
+
+    mContactManager = new QContactManager(QStringLiteral("org.nemomobile.contacts.sqlite"));
+    connect(mContactManager, &QContactManager::contactsAdded, this, &RosterStorm::onContactsChanged);
+    connect(mContactManager, &QContactManager::contactsChanged, this, &RosterStorm::onContactsChanged);
+
+    /* Create a fake AccountManager, as ut_telepathyplugin does */
+    TpDBusDaemon *dbus = tp_dbus_daemon_dup(NULL);
+    mAccountManager = (TpTestsSimpleAccountManager *) tp_tests_object_new_static_class(
+            TP_TESTS_TYPE_SIMPLE_ACCOUNT_MANAGER, NULL);
+    tp_dbus_daemon_register_object(dbus, TP_ACCOUNT_MANAGER_OBJECT_PATH, mAccountManager);
+    const bool registered = tp_dbus_daemon_request_name(dbus, TP_ACCOUNT_MANAGER_BUS_NAME, FALSE, NULL);
+    g_object_unref(dbus);
+
+    if (!registered) {
+        qWarning() << "Unable to register the fake AccountManager; run on a session bus of its own";
+        return false;
+    }
+
+    mRosterStartUs = nowUs();
+
+    mAccounts.resize(mConfig.accounts);
+    mContacts.resize(mConfig.accounts * mConfig.rosterSize);
+    for (int a = 0; a < mConfig.accounts; ++a) {
+        Account &account = mAccounts[a];
+        account.name = "storm" + QByteArray::number(a + 1);
+        account.path = QByteArray(TP_ACCOUNT_OBJECT_PATH_BASE "fakecm/fakeproto/stormaccount_")
+                + QByteArray::number(a + 1);
+        account.account = 0;
+        account.connService = 0;
+        account.connection = 0;
+        account.online = false;
+        account.firstContact = a * mConfig.rosterSize;
+        account.cycle = EventKindCount;
+        account.cycleStartUs = 0;
+
+        for (int i = 0; i < mConfig.rosterSize; ++i) {
+            const int index = account.firstContact + i;
+            Contact &contact = mContacts[index];
+            contact.id = account.name + "-contact" + QByteArray::number(i);
+            contact.account = a;
+            contact.handle = 0;
+            contact.stored = false;
+            mContactIndex.insert(QString::fromLatin1(contact.id), index);
+        }
+
+        connectAccount(a);
+    }
+
+    mUnstored = mContacts.count();
+    qDebug() << "Registered" << mConfig.accounts << "accounts with" << mConfig.rosterSize
+             << "contacts each, waiting for contactsd to store them";
+
+    QTimer::singleShot(RosterTimeout, this, SLOT(onRosterTimeout()));
+    if (mUnstored == 0) {
+        startLoad();
+    }
+    return true;
+}
+
+void RosterStorm::connectAccount(int index)
+{
+    Account &account = mAccounts[index];
+
+    tp_tests_create_and_connect_conn(TP_TESTS_TYPE_CONTACTS_CONNECTION,
+            account.name.constData(), &account.connService, &account.connection);
+
+    TpTestsContactsConnection *conn = TP_TESTS_CONTACTS_CONNECTION(account.connService);
+
+    TpTestsContactsConnectionPresenceStatusIndex available = TP_TESTS_CONTACTS_CONNECTION_STATUS_AVAILABLE;
+    const gchar *message = "Storming";
+    tp_tests_contacts_connection_change_presences(conn, 1, &account.connService->self_handle, &available, &message);
+    const gchar *alias = account.name.constData();
+    tp_tests_contacts_connection_change_aliases(conn, 1, &account.connService->self_handle, &alias);
+
+    /* Fill the roster */
+    TestContactListManager *listManager = tp_tests_contacts_connection_get_contact_list_manager(conn);
+    TpHandleRepoIface *serviceRepo = tp_base_connection_get_handles(account.connService, TP_HANDLE_TYPE_CONTACT);
+
+    QVector<TpHandle> handles;
+    for (int i = 0; i < mConfig.rosterSize; ++i) {
+        Contact &contact = mContacts[account.firstContact + i];
+        contact.handle = tp_handle_ensure(serviceRepo, contact.id.constData(), NULL, NULL);
+        handles.append(contact.handle);
+    }
+    if (!handles.isEmpty()) {
+        test_contact_list_manager_request_subscription(listManager, handles.count(), handles.data(), "storm");
+    }
+
+    if (account.cycle == ReconnectEvent && !handles.isEmpty()) {
+        // The whole roster comes online at once, as after a network change
+        const QByteArray token = account.cycleToken.toUtf8();
+        const QVector<TpTestsContactsConnectionPresenceStatusIndex> statuses(
+                handles.count(), TP_TESTS_CONTACTS_CONNECTION_STATUS_AVAILABLE);
+        const QVector<const gchar *> messages(handles.count(), token.constData());
+        tp_tests_contacts_connection_change_presences(conn, handles.count(), handles.constData(),
+                                                      statuses.constData(), messages.constData());
+    }
+
+    if (!account.account) {
+        TpDBusDaemon *dbus = tp_dbus_daemon_dup(NULL);
+        account.account = (TpTestsSimpleAccount *) tp_tests_object_new_static_class(
+                TP_TESTS_TYPE_SIMPLE_ACCOUNT, NULL);
+        tp_dbus_daemon_register_object(dbus, account.path.constData(), account.account);
+        tp_tests_simple_account_manager_add_account(mAccountManager, account.path.constData(), TRUE);
+        g_object_unref(dbus);
+    }
+    tp_tests_simple_account_set_connection(account.account, account.connService->object_path);
+
+    account.online = true;
+}
+
+void RosterStorm::disconnectAccount(int index)
+{
+    Account &account = mAccounts[index];
+
+    // Updates in flight may never be stored once the connection is gone
+    for (int i = 0; i < mConfig.rosterSize; ++i) {
+        Contact &contact = mContacts[account.firstContact + i];
+        Q_FOREACH (const Pending &pending, contact.pending) {
+            ++mStats[pending.kind].interrupted;
+        }
+        contact.pending.clear();
+        account.cycleWaiting.insert(account.firstContact + i);
+    }
+
+    account.cycle = DisconnectEvent;
+    account.cycleStartUs = nowUs();
+    ++mStats[DisconnectEvent].sent;
+
+    account.online = false;
+    tp_cli_connection_call_disconnect(account.connection, -1, NULL, NULL, NULL, NULL);
+
+    QTimer::singleShot(mConfig.offlineTime * 1000, this, [this, index]() {
+        reconnectAccount(index);
+    });
+}
+
+void RosterStorm::reconnectAccount(int index)
+{
+    Account &account = mAccounts[index];
+
+    if (!account.cycleWaiting.isEmpty()) {
+        qDebug() << account.name << "reconnecting before" << account.cycleWaiting.count()
+                 << "contacts were stored offline";
+    }
+
+    g_object_unref(account.connService);
+    g_object_unref(account.connection);
+    account.connService = 0;
+    account.connection = 0;
+
+    account.cycle = ReconnectEvent;
+    account.cycleToken = QStringLiteral("stormr%1").arg(++mSequence);
+    account.cycleStartUs = nowUs();
+    account.cycleWaiting.clear();
+    for (int i = 0; i < mConfig.rosterSize; ++i) {
+        account.cycleWaiting.insert(account.firstContact + i);
+    }
+    ++mStats[ReconnectEvent].sent;
+
+    connectAccount(index);
+}
+
+void RosterStorm::removeAccounts()
+{
+    TpDBusDaemon *dbus = tp_dbus_daemon_dup(NULL);
+
+    for (int i = 0; i < mAccounts.count(); ++i) {
+        Account &account = mAccounts[i];
+        if (account.connection) {
+            tp_cli_connection_call_disconnect(account.connection, -1, NULL, NULL, NULL, NULL);
+        }
+        if (account.account) {
+            tp_tests_simple_account_manager_remove_account(mAccountManager, account.path.constData());
+            tp_tests_simple_account_removed(account.account);
+            tp_dbus_daemon_unregister_object(dbus, account.account);
+            g_object_unref(account.account);
+        }
+        if (account.connService) {
+            g_object_unref(account.connService);
+        }
+        if (account.connection) {
+            g_object_unref(account.connection);
+        }
+    }
+
+    g_object_unref(dbus);
+    mAccounts.clear();
+}
+
+void RosterStorm::sendEvent(EventKind kind, Contact &contact)
+{
+    static const char kindLetters[] = "pavi";
+    static const TpTestsContactsConnectionPresenceStatusIndex presenceStatuses[] = {
+        TP_TESTS_CONTACTS_CONNECTION_STATUS_AVAILABLE,
+        TP_TESTS_CONTACTS_CONNECTION_STATUS_BUSY,
+        TP_TESTS_CONTACTS_CONNECTION_STATUS_AWAY
+    };
+
+    Account &account = mAccounts[contact.account];
+    TpTestsContactsConnection *conn = TP_TESTS_CONTACTS_CONNECTION(account.connService);
+
+    ++mSequence;
+    const QString token = QStringLiteral("storm%1%2").arg(QLatin1Char(kindLetters[kind])).arg(mSequence);
+    const QByteArray tokenData = token.toUtf8();
+
+    switch (kind) {
+    case PresenceEvent: {
+        TpTestsContactsConnectionPresenceStatusIndex status = presenceStatuses[mSequence % 3];
+        const gchar *message = tokenData.constData();
+        tp_tests_contacts_connection_change_presences(conn, 1, &contact.handle, &status, &message);
+        break;
+    }
+    case AliasEvent: {
+        const gchar *alias = tokenData.constData();
+        tp_tests_contacts_connection_change_aliases(conn, 1, &contact.handle, &alias);
+        break;
+    }
+    case AvatarEvent: {
+        QByteArray data;
+        data.reserve(mConfig.avatarSize);
+        while (data.size() < mConfig.avatarSize) {
+            data.append(tokenData);
+        }
+        data.truncate(mConfig.avatarSize);
+
+        GArray *array = g_array_new(FALSE, FALSE, sizeof(gchar));
+        g_array_append_vals(array, data.constData(), data.size());
+        tp_tests_contacts_connection_change_avatar_data(conn, contact.handle, array, "image/jpeg",
+                                                        tokenData.constData());
+        g_array_unref(array);
+        break;
+    }
+    case InfoEvent: {
+        const QByteArray number = "+35840" + QByteArray::number(mSequence);
+        const gchar *telValues[] = { number.constData(), NULL };
+        const gchar *noteValues[] = { tokenData.constData(), NULL };
+
+        GPtrArray *info = g_ptr_array_new_with_free_func((GDestroyNotify) g_value_array_free);
+        g_ptr_array_add(info, tp_value_array_build(3,
+            G_TYPE_STRING, "tel",
+            G_TYPE_STRV, NULL,
+            G_TYPE_STRV, telValues,
+            G_TYPE_INVALID));
+        g_ptr_array_add(info, tp_value_array_build(3,
+            G_TYPE_STRING, "note",
+            G_TYPE_STRV, NULL,
+            G_TYPE_STRV, noteValues,
+            G_TYPE_INVALID));
+        tp_tests_contacts_connection_change_contact_info(conn, contact.handle, info);
+        g_ptr_array_unref(info);
+        break;
+    }
+    default:
+        return;
+    }
+
+    Pending pending;
+    pending.kind = kind;
+    pending.token = token;
+    pending.emittedUs = nowUs();
+    contact.pending.append(pending);
+    ++mStats[kind].sent;
+}
+
+bool RosterStorm::isTelepathyCollection(const QContactCollectionId &collectionId)
+{
+    QHash<QContactCollectionId, bool>::const_iterator it = mTelepathyCollections.constFind(collectionId);
+    if (it == mTelepathyCollections.constEnd()) {
+        const QContactCollection collection = mContactManager->collection(collectionId);
+        const bool telepathy = collection.metaData(QContactCollection::KeyName).toString() == QLatin1String("telepathy");
+        it = mTelepathyCollections.insert(collectionId, telepathy);
+    }
+    return *it;
+}
+
+void RosterStorm::onContactsChanged(const QList<QContactId> &contactIds)
+{
+    QContactFetchHint hint;
+    hint.setDetailTypesHint(QList<QContactDetail::DetailType>()
+                            << QContactOnlineAccount::Type
+                            << QContactNickname::Type
+                            << QContactPresence::Type
+                            << QContactAvatar::Type
+                            << QContactNote::Type);
+    hint.setOptimizationHints(QContactFetchHint::NoRelationships);
+
+    Q_FOREACH (const QContact &stored, mContactManager->contacts(contactIds, hint)) {
+        // Aggregates carry copies of the same details, with some delay
+        if (!isTelepathyCollection(stored.collectionId())) {
+            continue;
+        }
+
+        const QString id = stored.detail<QContactOnlineAccount>().accountUri();
+        QHash<QString, int>::const_iterator it = mContactIndex.constFind(id);
+        if (it == mContactIndex.constEnd()) {
+            continue;
+        }
+
+        Contact &contact = mContacts[*it];
+        checkContact(contact, stored);
+        checkCycle(mAccounts[contact.account], *it, stored);
+    }
+}
+
+void RosterStorm::checkContact(Contact &contact, const QContact &stored)
+{
+    if (!contact.stored) {
+        contact.stored = true;
+        if (--mUnstored == 0 && !mLoadRunning) {
+            mRosterStoredUs = nowUs();
+            startLoad();
+        }
+    }
+
+    if (contact.pending.isEmpty()) {
+        return;
+    }
+
+    const qint64 now = nowUs();
+    for (int kind = 0; kind < RatedKindCount; ++kind) {
+        int matched = -1;
+        for (int i = 0; i < contact.pending.count(); ++i) {
+            const Pending &pending = contact.pending.at(i);
+            if (pending.kind == kind && isStored(pending.kind, pending.token, stored)) {
+                matched = i;
+            }
+        }
+        if (matched < 0) {
+            continue;
+        }
+
+        mStats[kind].latenciesUs.append(now - contact.pending.at(matched).emittedUs);
+
+        // Earlier updates of the same kind were superseded before being stored
+        QList<Pending> remaining;
+        for (int i = 0; i < contact.pending.count(); ++i) {
+            const Pending &pending = contact.pending.at(i);
+            if (pending.kind != kind || i > matched) {
+                remaining.append(pending);
+            } else if (i < matched) {
+                ++mStats[kind].coalesced;
+            }
+        }
+        contact.pending = remaining;
+    }
+}
+
+void RosterStorm::checkCycle(Account &account, int contactIndex, const QContact &stored)
+{
+    if (account.cycle == EventKindCount || !account.cycleWaiting.contains(contactIndex)) {
+        return;
+    }
+
+    const QContactPresence presence = stored.detail<QContactPresence>();
+    if (account.cycle == DisconnectEvent) {
+        if (presence.presenceState() != QContactPresence::PresenceUnknown
+                && presence.presenceState() != QContactPresence::PresenceOffline) {
+            return;
+        }
+    } else if (presence.customMessage() != account.cycleToken) {
+        return;
+    }
+
+    account.cycleWaiting.remove(contactIndex);
+    if (account.cycleWaiting.isEmpty()) {
+        mStats[account.cycle].latenciesUs.append(nowUs() - account.cycleStartUs);
+        qDebug() << account.name << kindName(account.cycle) << "stored in"
+                 << (nowUs() - account.cycleStartUs) / 1000 << "ms";
+        if (account.cycle == ReconnectEvent) {
+            account.cycle = EventKindCount;
+        }
+    }
+}
+
+void RosterStorm::onRosterTimeout()
+{
+    if (mLoadRunning || mUnstored == 0) {
+        return;
+    }
+
+    qWarning() << "Timed out waiting for contactsd to store the rosters," << mUnstored << "contacts missing";
+    removeAccounts();
+    Q_EMIT finished(1);
+}
+
+void RosterStorm::startLoad()
+{
+    qDebug() << "Rosters stored in" << (mRosterStoredUs - mRosterStartUs) / 1000 << "ms, starting load for"
+             << mConfig.duration << "s";
+
+    mLoadRunning = true;
+    mLastTickUs = nowUs();
+    mTicker.start();
+    if (mConfig.reconnectInterval > 0) {
+        mReconnectTimer.start(mConfig.reconnectInterval * 1000);
+    }
+    QTimer::singleShot(mConfig.duration * 1000, this, SLOT(onLoadFinished()));
+}
+
+void RosterStorm::onTick()
+{
+    const qint64 now = nowUs();
+    const double elapsed = (now - mLastTickUs) / 1000000.0;
+    mLastTickUs = now;
+
+    for (int kind = 0; kind < RatedKindCount; ++kind) {
+        mBudget[kind] += mConfig.rates[kind] * elapsed;
+
+        while (mBudget[kind] >= 1) {
+            mBudget[kind] -= 1;
+
+            // Contacts of accounts in a connection cycle are left alone
+            int index = -1;
+            for (int attempt = 0; attempt < 8 && index < 0; ++attempt) {
+                const int candidate = qrand() % mContacts.count();
+                const Account &account = mAccounts.at(mContacts.at(candidate).account);
+                if (account.online && account.cycle == EventKindCount) {
+                    index = candidate;
+                }
+            }
+            if (index < 0) {
+                mBudget[kind] = 0;
+                break;
+            }
+
+            sendEvent(static_cast<EventKind>(kind), mContacts[index]);
+        }
+    }
+}
+
+void RosterStorm::onCycleTimer()
+{
+    // Accounts take turns, one cycle at a time
+    Account &account = mAccounts[mNextCycle];
+    if (!account.online || account.cycle != EventKindCount) {
+        return;
+    }
+
+    qDebug() << "Disconnecting" << account.name;
+    disconnectAccount(mNextCycle);
+    mNextCycle = (mNextCycle + 1) % mAccounts.count();
+}
+
+void RosterStorm::onLoadFinished()
+{
+    mTicker.stop();
+    mReconnectTimer.stop();
+
+    qDebug() << "Load finished, waiting" << mConfig.drain << "s for outstanding updates";
+    QTimer::singleShot(mConfig.drain * 1000, this, SLOT(onDrainFinished()));
+}
+
+void RosterStorm::onDrainFinished()
+{
+    writeResults();
+    removeAccounts();
+    Q_EMIT finished(0);
+}
+
+QJsonObject RosterStorm::kindResult(const KindStats &stats) const
+{
+    QVector<qint64> latencies(stats.latenciesUs);
+    std::sort(latencies.begin(), latencies.end());
+
+    QJsonObject result;
+    result.insert(QStringLiteral("sent"), stats.sent);
+    result.insert(QStringLiteral("stored"), latencies.count());
+    result.insert(QStringLiteral("coalesced"), stats.coalesced);
+    result.insert(QStringLiteral("interrupted"), stats.interrupted);
+
+    if (!latencies.isEmpty()) {
+        qint64 sum = 0;
+        Q_FOREACH (qint64 latency, latencies) {
+            sum += latency;
+        }
+
+        QJsonObject latency;
+        latency.insert(QStringLiteral("minUs"), latencies.first());
+        latency.insert(QStringLiteral("p50Us"), percentile(latencies, 50));
+        latency.insert(QStringLiteral("p90Us"), percentile(latencies, 90));
+        latency.insert(QStringLiteral("p99Us"), percentile(latencies, 99));
+        latency.insert(QStringLiteral("maxUs"), latencies.last());
+        latency.insert(QStringLiteral("meanUs"), sum / latencies.count());
+        result.insert(QStringLiteral("latency"), latency);
+    }
+
+    return result;
+}
+
+void RosterStorm::writeResults()
+{
+    // Whatever is still outstanding after the drain period was never stored
+    int lost[EventKindCount] = { 0 };
+    Q_FOREACH (const Contact &contact, mContacts) {
+        Q_FOREACH (const Pending &pending, contact.pending) {
+            ++lost[pending.kind];
+        }
+    }
+
+    QJsonObject config;
+    config.insert(QStringLiteral("accounts"), mConfig.accounts);
+    config.insert(QStringLiteral("rosterSize"), mConfig.rosterSize);
+    config.insert(QStringLiteral("duration"), mConfig.duration);
+    config.insert(QStringLiteral("reconnectInterval"), mConfig.reconnectInterval);
+    config.insert(QStringLiteral("offlineTime"), mConfig.offlineTime);
+    config.insert(QStringLiteral("avatarSize"), mConfig.avatarSize);
+    config.insert(QStringLiteral("seed"), static_cast<int>(mConfig.seed));
+
+    QJsonObject rates;
+    QJsonObject events;
+    for (int kind = 0; kind < EventKindCount; ++kind) {
+        const QString name = QString::fromLatin1(kindName(static_cast<EventKind>(kind)));
+        if (kind < RatedKindCount) {
+            rates.insert(name, mConfig.rates[kind]);
+        }
+
+        QJsonObject result = kindResult(mStats[kind]);
+        if (kind < RatedKindCount) {
+            result.insert(QStringLiteral("lost"), lost[kind]);
+        }
+        events.insert(name, result);
+
+        qDebug() << name << result;
+    }
+    config.insert(QStringLiteral("rates"), rates);
+
+    QJsonObject root;
+    root.insert(QStringLiteral("config"), config);
+    root.insert(QStringLiteral("rosterImportMs"), (mRosterStoredUs - mRosterStartUs) / 1000);
+    root.insert(QStringLiteral("events"), events);
+
+    QFile output(mConfig.output);
+    if (output.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        output.write(QJsonDocument(root).toJson());
+        qDebug() << "Wrote results to" << output.fileName();
+    } else {
+        qWarning() << "Unable to write results to" << output.fileName();
+    }
+}
+
+int main(int argc, char **argv)
+{
+    QCoreApplication app(argc, argv);
+    app.setApplicationName(QStringLiteral("rosterstorm"));
+
+    g_set_prgname("rosterstorm");
+    if (!qgetenv("TP_DEBUG").isEmpty()) {
+        tp_debug_set_flags("all");
+    }
+
+    RosterStorm::Config config;
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Roster update load generator for the contactsd telepathy plugin"));
+    parser.addHelpOption();
+
+    QCommandLineOption accountsOption(QStringLiteral("accounts"), QStringLiteral("Number of accounts"),
+                                      QStringLiteral("count"), QString::number(config.accounts));
+    QCommandLineOption rosterOption(QStringLiteral("roster-size"), QStringLiteral("Contacts per account"),
+                                    QStringLiteral("count"), QString::number(config.rosterSize));
+    QCommandLineOption durationOption(QStringLiteral("duration"), QStringLiteral("Seconds of load"),
+                                      QStringLiteral("seconds"), QString::number(config.duration));
+    QCommandLineOption drainOption(QStringLiteral("drain"), QStringLiteral("Seconds to wait for outstanding updates"),
+                                   QStringLiteral("seconds"), QString::number(config.drain));
+    QCommandLineOption presenceOption(QStringLiteral("presence-rate"), QStringLiteral("Presence changes per second"),
+                                      QStringLiteral("rate"), QString::number(config.rates[RosterStorm::PresenceEvent]));
+    QCommandLineOption aliasOption(QStringLiteral("alias-rate"), QStringLiteral("Alias changes per second"),
+                                   QStringLiteral("rate"), QString::number(config.rates[RosterStorm::AliasEvent]));
+    QCommandLineOption avatarOption(QStringLiteral("avatar-rate"), QStringLiteral("Avatar changes per second"),
+                                    QStringLiteral("rate"), QString::number(config.rates[RosterStorm::AvatarEvent]));
+    QCommandLineOption infoOption(QStringLiteral("info-rate"), QStringLiteral("Contact info changes per second"),
+                                  QStringLiteral("rate"), QString::number(config.rates[RosterStorm::InfoEvent]));
+    QCommandLineOption reconnectOption(QStringLiteral("reconnect-interval"),
+                                       QStringLiteral("Seconds between account reconnections, 0 for none"),
+                                       QStringLiteral("seconds"), QString::number(config.reconnectInterval));
+    QCommandLineOption offlineOption(QStringLiteral("offline-time"),
+                                     QStringLiteral("Seconds an account stays disconnected"),
+                                     QStringLiteral("seconds"), QString::number(config.offlineTime));
+    QCommandLineOption avatarSizeOption(QStringLiteral("avatar-size"), QStringLiteral("Bytes of avatar data"),
+                                        QStringLiteral("bytes"), QString::number(config.avatarSize));
+    QCommandLineOption seedOption(QStringLiteral("seed"), QStringLiteral("Random seed"),
+                                  QStringLiteral("seed"), QString::number(config.seed));
+    QCommandLineOption outputOption(QStringLiteral("output"), QStringLiteral("JSON results file"),
+                                    QStringLiteral("file"),
+                                    qEnvironmentVariableIsSet("CONTACTSD_BENCH_OUTPUT")
+                                        ? QString::fromLocal8Bit(qgetenv("CONTACTSD_BENCH_OUTPUT"))
+                                        : config.output);
+
+    parser.addOptions(QList<QCommandLineOption>()
+                      << accountsOption << rosterOption << durationOption << drainOption
+                      << presenceOption << aliasOption << avatarOption << infoOption
+                      << reconnectOption << offlineOption << avatarSizeOption << seedOption
+                      << outputOption);
+    parser.process(app);
+
+    config.accounts = qMax(1, parser.value(accountsOption).toInt());
+    config.rosterSize = qMax(1, parser.value(rosterOption).toInt());
+    config.duration = qMax(0, parser.value(durationOption).toInt());
+    config.drain = qMax(0, parser.value(drainOption).toInt());
+    config.rates[RosterStorm::PresenceEvent] = qMax(0.0, parser.value(presenceOption).toDouble());
+    config.rates[RosterStorm::AliasEvent] = qMax(0.0, parser.value(aliasOption).toDouble());
+    config.rates[RosterStorm::AvatarEvent] = qMax(0.0, parser.value(avatarOption).toDouble());
+    config.rates[RosterStorm::InfoEvent] = qMax(0.0, parser.value(infoOption).toDouble());
+    config.reconnectInterval = qMax(0, parser.value(reconnectOption).toInt());
+    config.offlineTime = qMax(0, parser.value(offlineOption).toInt());
+    config.avatarSize = qMax(1, parser.value(avatarSizeOption).toInt());
+    config.seed = parser.value(seedOption).toUInt();
+    config.output = parser.value(outputOption);
+
+    RosterStorm storm(config);
+    QObject::connect(&storm, &RosterStorm::finished, &app, &QCoreApplication::exit);
+    if (!storm.start()) {
+        return 1;
+    }
+
+    return app.exec();
+}
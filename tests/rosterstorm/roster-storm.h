@@ -0,0 +1,171 @@
+/** This file is part of Contacts daemon
+ **
+ ** Copyright (c) 2026 Jolla Ltd.
+ **
+ ** GNU Lesser General Public License Usage
+ ** This file may be used under the terms of the GNU Lesser General Public License
+ ** version 2.1 as published by the Free Software Foundation and appearing in the
+ ** file LICENSE.LGPL included in the packaging of this file.  Please review the
+ ** following information to ensure the GNU Lesser General Public License version
+ ** 2.1 requirements will be met:
+ ** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+ **/
+
+#ifndef ROSTER_STORM_H
+#define ROSTER_STORM_H
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QJsonObject>
+#include <QObject>
+#include <QSet>
+#include <QTimer>
+#include <QVector>
+
+#include <QContactManager>
+
+#include <telepathy-glib/telepathy-glib.h>
+
+#include "libtelepathy/contacts-conn.h"
+#include "libtelepathy/contact-list-manager.h"
+#include "libtelepathy/simple-account-manager.h"
+#include "libtelepathy/simple-account.h"
+
+QTCONTACTS_USE_NAMESPACE
+
+// Load generator for the telepathy plugin. It registers a fake AccountManager
+// with accounts whose rosters are filled on fake connections, waits until
+// contactsd has stored every roster contact, and then sends presence, alias,
+// avatar and contact info changes at the configured rates. Each update is
+// tagged with a token so that the time from the Telepathy signal until the
+// change is visible in the contacts database can be measured. Accounts may
+// also be disconnected and reconnected periodically.
+//
+// contactsd must start after the AccountManager name is registered, so run
+// the generator through with-daemon.sh on a private bus:
+//
+//   with-session-bus.sh with-daemon.sh rosterstorm --roster-size 1000
+class RosterStorm : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum EventKind {
+        PresenceEvent,
+        AliasEvent,
+        AvatarEvent,
+        InfoEvent,
+        DisconnectEvent,
+        ReconnectEvent,
+        EventKindCount
+    };
+    // Only the roster updates are sent at a steady rate
+    static const int RatedKindCount = DisconnectEvent;
+
+    struct Config {
+        Config();
+
+        int accounts;
+        int rosterSize;
+        int duration;           // seconds of load after the rosters are stored
+        int drain;              // seconds to wait for outstanding updates afterwards
+        double rates[RatedKindCount];   // per second, across all contacts
+        int reconnectInterval;  // seconds between connection cycles, 0 for none
+        int offlineTime;        // seconds an account stays disconnected in a cycle
+        int avatarSize;
+        uint seed;
+        QString output;
+    };
+
+    explicit RosterStorm(const Config &config, QObject *parent = 0);
+    ~RosterStorm();
+
+    bool start();
+
+Q_SIGNALS:
+    void finished(int exitCode);
+
+private Q_SLOTS:
+    void onContactsChanged(const QList<QContactId> &contactIds);
+    void onRosterTimeout();
+    void onTick();
+    void onCycleTimer();
+    void onLoadFinished();
+    void onDrainFinished();
+
+private:
+    struct Pending {
+        EventKind kind;
+        QString token;
+        qint64 emittedUs;
+    };
+
+    struct Contact {
+        QByteArray id;
+        int account;
+        TpHandle handle;
+        bool stored;
+        QList<Pending> pending;
+    };
+
+    struct Account {
+        QByteArray name;
+        QByteArray path;
+        TpTestsSimpleAccount *account;
+        TpBaseConnection *connService;
+        TpConnection *connection;
+        bool online;
+        int firstContact;
+        // A connection cycle in progress waits for each contact of the account to
+        // be stored offline, and then with the presence set on reconnection.
+        // The cycle is EventKindCount while the account is left alone.
+        EventKind cycle;
+        QString cycleToken;
+        qint64 cycleStartUs;
+        QSet<int> cycleWaiting;
+    };
+
+    struct KindStats {
+        KindStats() : sent(0), coalesced(0), interrupted(0) {}
+
+        int sent;
+        int coalesced;      // superseded by a later update before being stored
+        int interrupted;    // outstanding when the account was disconnected
+        QVector<qint64> latenciesUs;
+    };
+
+    qint64 nowUs() const;
+    void connectAccount(int index);
+    void disconnectAccount(int index);
+    void reconnectAccount(int index);
+    void removeAccounts();
+    void sendEvent(EventKind kind, Contact &contact);
+    void checkContact(Contact &contact, const QContact &stored);
+    void checkCycle(Account &account, int contactIndex, const QContact &stored);
+    bool isTelepathyCollection(const QContactCollectionId &collectionId);
+    void startLoad();
+    QJsonObject kindResult(const KindStats &stats) const;
+    void writeResults();
+
+    Config mConfig;
+    QContactManager *mContactManager;
+    TpTestsSimpleAccountManager *mAccountManager;
+    QVector<Account> mAccounts;
+    QVector<Contact> mContacts;
+    QHash<QString, int> mContactIndex;
+    QHash<QContactCollectionId, bool> mTelepathyCollections;
+    KindStats mStats[EventKindCount];
+    QElapsedTimer mClock;
+    QTimer mTicker;
+    QTimer mReconnectTimer;
+    qint64 mLastTickUs;
+    double mBudget[RatedKindCount];
+    qint64 mRosterStartUs;
+    qint64 mRosterStoredUs;
+    int mUnstored;
+    bool mLoadRunning;
+    quint64 mSequence;
+    int mNextCycle;
+};
+
+#endif // ROSTER_STORM_H
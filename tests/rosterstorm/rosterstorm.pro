@@ -0,0 +1,27 @@
+include(../common/test-common.pri)
+
+PRE_TARGETDEPS += ../libtelepathy/libtelepathy.a
+
+TARGET = rosterstorm
+target.path = /opt/tests/$${PACKAGENAME}/$$TARGET
+
+CONFIG += link_pkgconfig
+
+QT -= gui
+QT += dbus
+
+DEFINES += QT_NO_KEYWORDS
+
+PKGCONFIG += Qt5Contacts qtcontacts-sqlite-qt5-extensions TelepathyQt5 telepathy-glib dbus-glib-1 gio-2.0
+
+INCLUDEPATH += ..
+QMAKE_LIBDIR += ../libtelepathy
+LIBS += -ltelepathy
+
+HEADERS += \
+    roster-storm.h
+
+SOURCES += \
+    roster-storm.cpp
+
+INSTALLS += target
@@ -23,11 +23,14 @@
 PACKAGENAME = contactsd
 
 TEMPLATE = subdirs
-SUBDIRS += libtelepathy ut_birthdayplugin ut_telepathyplugin ut_simplugin
+SUBDIRS += libtelepathy throttledengine ut_birthdayplugin ut_telepathyplugin ut_simplugin ut_synctrigger ut_avatarfetcher bench_simplugin bench_telepathy bench_telepathyaccounts rosterstorm
 
 ut_telepathyplugin.depends = libtelepathy
+bench_telepathyaccounts.depends = libtelepathy
+rosterstorm.depends = libtelepathy
+bench_simplugin.depends = throttledengine
 
-UNIT_TESTS += ut_birthdayplugin ut_telepathyplugin ut_simplugin
+UNIT_TESTS += ut_birthdayplugin ut_telepathyplugin ut_simplugin ut_synctrigger ut_avatarfetcher
 
 testxml.target = tests.xml
 testxml.commands = sh $$PWD/mktests.sh $$UNIT_TESTS >$@ || rm -f $@
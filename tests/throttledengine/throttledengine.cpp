@@ -0,0 +1,538 @@
+/** This file is part of Contacts daemon
+ **
+ ** Copyright (c) 2026 Jolla Ltd.
+ **
+ ** GNU Lesser General Public License Usage
+ ** This file may be used under the terms of the GNU Lesser General Public License
+ ** version 2.1 as published by the Free Software Foundation and appearing in the
+ ** file LICENSE.LGPL included in the packaging of this file.  Please review the
+ ** following information to ensure the GNU Lesser General Public License version
+ ** 2.1 requirements will be met:
+ ** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+ **/
+
+#include "throttledengine.h"
+
+#include <QContactCollectionRemoveRequest>
+#include <QContactCollectionSaveRequest>
+#include <QContactRelationshipRemoveRequest>
+#include <QContactRelationshipSaveRequest>
+#include <QContactRemoveRequest>
+#include <QContactSaveRequest>
+
+#include <QThread>
+#include <QTimer>
+#include <QtDebug>
+
+#include <qtcontacts-extensions.h>
+#include <qtcontacts-extensions_manager_impl.h>
+
+#include "statistics.h"
+
+using namespace Contactsd;
+
+namespace {
+
+const QString backendManagerName = QStringLiteral("org.nemomobile.contacts.sqlite");
+
+int latencySetting(const char *name)
+{
+    bool ok = false;
+    const int value = qgetenv(name).toInt(&ok);
+    return ok && value > 0 ? value : 0;
+}
+
+// The number of items an asynchronous request writes, or -1 for reads
+int requestWriteItems(QContactAbstractRequest *req)
+{
+    switch (req->type()) {
+    case QContactAbstractRequest::ContactSaveRequest:
+        return static_cast<QContactSaveRequest *>(req)->contacts().count();
+    case QContactAbstractRequest::ContactRemoveRequest:
+        return static_cast<QContactRemoveRequest *>(req)->contactIds().count();
+    case QContactAbstractRequest::RelationshipSaveRequest:
+        return static_cast<QContactRelationshipSaveRequest *>(req)->relationships().count();
+    case QContactAbstractRequest::RelationshipRemoveRequest:
+        return static_cast<QContactRelationshipRemoveRequest *>(req)->relationships().count();
+    case QContactAbstractRequest::CollectionSaveRequest:
+        return static_cast<QContactCollectionSaveRequest *>(req)->collections().count();
+    case QContactAbstractRequest::CollectionRemoveRequest:
+        return static_cast<QContactCollectionRemoveRequest *>(req)->collectionIds().count();
+    default:
+        return -1;
+    }
+}
+
+int changeSetItems(QHash<QContactCollection*, QList<QContact>* > *changes)
+{
+    int items = 0;
+    if (changes) {
+        for (QHash<QContactCollection*, QList<QContact>* >::const_iterator it = changes->constBegin();
+                it != changes->constEnd(); ++it) {
+            items += 1 + (it.value() ? it.value()->count() : 0);
+        }
+    }
+    return items;
+}
+
+}
+
+ThrottledEngine::ThrottledEngine(QContactManager *backend)
+    : mBackend(backend)
+    , mEngine(QtContactsSqliteExtensions::contactManagerEngine(*backend))
+    , mReadLatency(latencySetting("CONTACTSD_ENGINE_READ_MS"))
+    , mWriteLatency(latencySetting("CONTACTSD_ENGINE_WRITE_MS"))
+    , mFsyncLatency(latencySetting("CONTACTSD_ENGINE_FSYNC_MS"))
+{
+    connect(mEngine, &QContactManagerEngine::dataChanged,
+            this, &QContactManagerEngine::dataChanged);
+    connect(mEngine, &QContactManagerEngine::contactsAdded,
+            this, &QContactManagerEngine::contactsAdded);
+    connect(mEngine, &QContactManagerEngine::contactsChanged,
+            this, &QContactManagerEngine::contactsChanged);
+    connect(mEngine, &QContactManagerEngine::contactsRemoved,
+            this, &QContactManagerEngine::contactsRemoved);
+    connect(mEngine, &QContactManagerEngine::relationshipsAdded,
+            this, &QContactManagerEngine::relationshipsAdded);
+    connect(mEngine, &QContactManagerEngine::relationshipsRemoved,
+            this, &QContactManagerEngine::relationshipsRemoved);
+    connect(mEngine, &QContactManagerEngine::selfContactIdChanged,
+            this, &QContactManagerEngine::selfContactIdChanged);
+    connect(mEngine, &QContactManagerEngine::collectionsAdded,
+            this, &QContactManagerEngine::collectionsAdded);
+    connect(mEngine, &QContactManagerEngine::collectionsChanged,
+            this, &QContactManagerEngine::collectionsChanged);
+    connect(mEngine, &QContactManagerEngine::collectionsRemoved,
+            this, &QContactManagerEngine::collectionsRemoved);
+    connect(mEngine, &QtContactsSqliteExtensions::ContactManagerEngine::contactsPresenceChanged,
+            this, &QtContactsSqliteExtensions::ContactManagerEngine::contactsPresenceChanged);
+    connect(mEngine, &QtContactsSqliteExtensions::ContactManagerEngine::collectionContactsChanged,
+            this, &QtContactsSqliteExtensions::ContactManagerEngine::collectionContactsChanged);
+    connect(mEngine, &QtContactsSqliteExtensions::ContactManagerEngine::displayLabelGroupsChanged,
+            this, &QtContactsSqliteExtensions::ContactManagerEngine::displayLabelGroupsChanged);
+
+    Statistics::setGauge(QStringLiteral("contactsEngine.readLatencyMs"), mReadLatency);
+    Statistics::setGauge(QStringLiteral("contactsEngine.writeLatencyMs"), mWriteLatency);
+    Statistics::setGauge(QStringLiteral("contactsEngine.fsyncLatencyMs"), mFsyncLatency);
+
+    qDebug() << "Throttled contacts engine, read:" << mReadLatency << "write:" << mWriteLatency
+             << "fsync:" << mFsyncLatency << "ms";
+}
+
+ThrottledEngine::~ThrottledEngine()
+{
+    delete mBackend;
+}
+
+void ThrottledEngine::read() const
+{
+    Statistics::increment(QStringLiteral("contactsEngine.reads"));
+    if (mReadLatency > 0) {
+        QThread::msleep(mReadLatency);
+    }
+}
+
+void ThrottledEngine::write(int items) const
+{
+    Statistics::increment(QStringLiteral("contactsEngine.transactions"));
+    Statistics::increment(QStringLiteral("contactsEngine.itemsWritten"), items);
+    Statistics::record(QStringLiteral("contactsEngine.transactionSize"), items);
+
+    const int delay = writeDelay(items);
+    if (delay > 0) {
+        QThread::msleep(delay);
+    }
+}
+
+int ThrottledEngine::writeDelay(int items) const
+{
+    return items * mWriteLatency + mFsyncLatency;
+}
+
+QString ThrottledEngine::managerName() const
+{
+    // Report the backend identity, so that ids and collection ids built for
+    // either manager are accepted by both
+    return mEngine->managerName();
+}
+
+QMap<QString, QString> ThrottledEngine::managerParameters() const
+{
+    return mEngine->managerParameters();
+}
+
+QMap<QString, QString> ThrottledEngine::idInterpretationParameters() const
+{
+    return mEngine->idInterpretationParameters();
+}
+
+int ThrottledEngine::managerVersion() const
+{
+    return mEngine->managerVersion();
+}
+
+QList<QContactId> ThrottledEngine::contactIds(const QContactFilter &filter, const QList<QContactSortOrder> &sortOrders,
+                                              QContactManager::Error *error) const
+{
+    read();
+    return mEngine->contactIds(filter, sortOrders, error);
+}
+
+QList<QContact> ThrottledEngine::contacts(const QContactFilter &filter, const QList<QContactSortOrder> &sortOrders,
+                                          const QContactFetchHint &fetchHint, QContactManager::Error *error) const
+{
+    read();
+    return mEngine->contacts(filter, sortOrders, fetchHint, error);
+}
+
+QList<QContact> ThrottledEngine::contacts(const QList<QContactId> &contactIds, const QContactFetchHint &fetchHint,
+                                          QMap<int, QContactManager::Error> *errorMap, QContactManager::Error *error) const
+{
+    read();
+    return mEngine->contacts(contactIds, fetchHint, errorMap, error);
+}
+
+QContact ThrottledEngine::contact(const QContactId &contactId, const QContactFetchHint &fetchHint,
+                                  QContactManager::Error *error) const
+{
+    read();
+    return mEngine->contact(contactId, fetchHint, error);
+}
+
+bool ThrottledEngine::saveContact(QContact *contact, QContactManager::Error *error)
+{
+    write(1);
+    return mEngine->saveContact(contact, error);
+}
+
+bool ThrottledEngine::removeContact(const QContactId &contactId, QContactManager::Error *error)
+{
+    write(1);
+    return mEngine->removeContact(contactId, error);
+}
+
+bool ThrottledEngine::saveContacts(QList<QContact> *contacts, QMap<int, QContactManager::Error> *errorMap,
+                                   QContactManager::Error *error)
+{
+    write(contacts ? contacts->count() : 0);
+    return mEngine->saveContacts(contacts, errorMap, error);
+}
+
+bool ThrottledEngine::saveContacts(QList<QContact> *contacts, const QList<QContactDetail::DetailType> &typeMask,
+                                   QMap<int, QContactManager::Error> *errorMap, QContactManager::Error *error)
+{
+    write(contacts ? contacts->count() : 0);
+    return mEngine->saveContacts(contacts, typeMask, errorMap, error);
+}
+
+bool ThrottledEngine::removeContacts(const QList<QContactId> &contactIds, QMap<int, QContactManager::Error> *errorMap,
+                                     QContactManager::Error *error)
+{
+    write(contactIds.count());
+    return mEngine->removeContacts(contactIds, errorMap, error);
+}
+
+bool ThrottledEngine::setSelfContactId(const QContactId &contactId, QContactManager::Error *error)
+{
+    write(1);
+    return mEngine->setSelfContactId(contactId, error);
+}
+
+QContactId ThrottledEngine::selfContactId(QContactManager::Error *error) const
+{
+    read();
+    return mEngine->selfContactId(error);
+}
+
+QList<QContactRelationship> ThrottledEngine::relationships(const QString &relationshipType, const QContactId &participantId,
+                                                           QContactRelationship::Role role, QContactManager::Error *error) const
+{
+    read();
+    return mEngine->relationships(relationshipType, participantId, role, error);
+}
+
+bool ThrottledEngine::saveRelationship(QContactRelationship *relationship, QContactManager::Error *error)
+{
+    write(1);
+    return mEngine->saveRelationship(relationship, error);
+}
+
+bool ThrottledEngine::removeRelationship(const QContactRelationship &relationship, QContactManager::Error *error)
+{
+    write(1);
+    return mEngine->removeRelationship(relationship, error);
+}
+
+bool ThrottledEngine::saveRelationships(QList<QContactRelationship> *relationships,
+                                        QMap<int, QContactManager::Error> *errorMap, QContactManager::Error *error)
+{
+    write(relationships ? relationships->count() : 0);
+    return mEngine->saveRelationships(relationships, errorMap, error);
+}
+
+bool ThrottledEngine::removeRelationships(const QList<QContactRelationship> &relationships,
+                                          QMap<int, QContactManager::Error> *errorMap, QContactManager::Error *error)
+{
+    write(relationships.count());
+    return mEngine->removeRelationships(relationships, errorMap, error);
+}
+
+QContactCollectionId ThrottledEngine::defaultCollectionId() const
+{
+    return mEngine->defaultCollectionId();
+}
+
+QContactCollection ThrottledEngine::collection(const QContactCollectionId &collectionId, QContactManager::Error *error)
+{
+    read();
+    return mEngine->collection(collectionId, error);
+}
+
+QList<QContactCollection> ThrottledEngine::collections(QContactManager::Error *error)
+{
+    read();
+    return mEngine->collections(error);
+}
+
+bool ThrottledEngine::saveCollection(QContactCollection *collection, QContactManager::Error *error)
+{
+    write(1);
+    return mEngine->saveCollection(collection, error);
+}
+
+bool ThrottledEngine::removeCollection(const QContactCollectionId &collectionId, QContactManager::Error *error)
+{
+    write(1);
+    return mEngine->removeCollection(collectionId, error);
+}
+
+bool ThrottledEngine::validateContact(const QContact &contact, QContactManager::Error *error) const
+{
+    return mEngine->validateContact(contact, error);
+}
+
+void ThrottledEngine::forwardRequest(QContactAbstractRequest *req)
+{
+    // The delay has already passed, only count the access
+    const int items = requestWriteItems(req);
+    if (items < 0) {
+        Statistics::increment(QStringLiteral("contactsEngine.reads"));
+    } else {
+        Statistics::increment(QStringLiteral("contactsEngine.transactions"));
+        Statistics::increment(QStringLiteral("contactsEngine.itemsWritten"), items);
+        Statistics::record(QStringLiteral("contactsEngine.transactionSize"), items);
+    }
+
+    mEngine->startRequest(req);
+}
+
+void ThrottledEngine::requestDestroyed(QContactAbstractRequest *req)
+{
+    mPendingRequests.remove(req);
+    mEngine->requestDestroyed(req);
+}
+
+bool ThrottledEngine::startRequest(QContactAbstractRequest *req)
+{
+    // Asynchronous requests are held back rather than slept on, as the
+    // backend runs them off the caller's thread
+    const int items = requestWriteItems(req);
+    const int delay = items < 0 ? mReadLatency : writeDelay(items);
+    if (delay == 0) {
+        forwardRequest(req);
+        return true;
+    }
+
+    PendingRequest pending;
+    pending.held.start();
+    pending.delay = delay;
+    mPendingRequests.insert(req, pending);
+    updateRequestState(req, QContactAbstractRequest::ActiveState);
+
+    QTimer::singleShot(delay, this, [this, req]() {
+        if (mPendingRequests.remove(req)) {
+            forwardRequest(req);
+        }
+    });
+    return true;
+}
+
+bool ThrottledEngine::cancelRequest(QContactAbstractRequest *req)
+{
+    if (mPendingRequests.remove(req)) {
+        updateRequestState(req, QContactAbstractRequest::CanceledState);
+        return true;
+    }
+    return mEngine->cancelRequest(req);
+}
+
+bool ThrottledEngine::waitForRequestFinished(QContactAbstractRequest *req, int msecs)
+{
+    QHash<QContactAbstractRequest *, PendingRequest>::iterator it = mPendingRequests.find(req);
+    if (it != mPendingRequests.end()) {
+        const qint64 remaining = it->delay - it->held.elapsed();
+        mPendingRequests.erase(it);
+        if (remaining > 0) {
+            QThread::msleep(remaining);
+        }
+        forwardRequest(req);
+    }
+    return mEngine->waitForRequestFinished(req, msecs);
+}
+
+bool ThrottledEngine::isRelationshipTypeSupported(const QString &relationshipType,
+                                                  QContactType::TypeValues contactType) const
+{
+    return mEngine->isRelationshipTypeSupported(relationshipType, contactType);
+}
+
+bool ThrottledEngine::isFilterSupported(const QContactFilter &filter) const
+{
+    return mEngine->isFilterSupported(filter);
+}
+
+QList<QVariant::Type> ThrottledEngine::supportedDataTypes() const
+{
+    return mEngine->supportedDataTypes();
+}
+
+QList<QContactType::TypeValues> ThrottledEngine::supportedContactTypes() const
+{
+    return mEngine->supportedContactTypes();
+}
+
+QList<QContactDetail::DetailType> ThrottledEngine::supportedContactDetailTypes() const
+{
+    return mEngine->supportedContactDetailTypes();
+}
+
+QString ThrottledEngine::databaseUuid()
+{
+    return mEngine->databaseUuid();
+}
+
+bool ThrottledEngine::fetchCollectionChanges(int accountId, const QString &applicationName,
+                                             QList<QContactCollection> *addedCollections,
+                                             QList<QContactCollection> *modifiedCollections,
+                                             QList<QContactCollection> *deletedCollections,
+                                             QList<QContactCollection> *unmodifiedCollections,
+                                             QContactManager::Error *error)
+{
+    read();
+    return mEngine->fetchCollectionChanges(accountId, applicationName, addedCollections, modifiedCollections,
+                                           deletedCollections, unmodifiedCollections, error);
+}
+
+bool ThrottledEngine::fetchContactChanges(const QContactCollectionId &collectionId,
+                                          QList<QContact> *addedContacts,
+                                          QList<QContact> *modifiedContacts,
+                                          QList<QContact> *deletedContacts,
+                                          QList<QContact> *unmodifiedContacts,
+                                          QContactManager::Error *error)
+{
+    read();
+    return mEngine->fetchContactChanges(collectionId, addedContacts, modifiedContacts,
+                                        deletedContacts, unmodifiedContacts, error);
+}
+
+bool ThrottledEngine::storeChanges(QHash<QContactCollection*, QList<QContact>* > *addedCollections,
+                                   QHash<QContactCollection*, QList<QContact>* > *modifiedCollections,
+                                   const QList<QContactCollectionId> &deletedCollections,
+                                   ConflictResolutionPolicy conflictResolutionPolicy,
+                                   bool clearChangeFlags,
+                                   QContactManager::Error *error)
+{
+    write(changeSetItems(addedCollections) + changeSetItems(modifiedCollections) + deletedCollections.count());
+    return mEngine->storeChanges(addedCollections, modifiedCollections, deletedCollections,
+                                 conflictResolutionPolicy, clearChangeFlags, error);
+}
+
+bool ThrottledEngine::clearChangeFlags(const QList<QContactId> &contactIds, QContactManager::Error *error)
+{
+    write(contactIds.count());
+    return mEngine->clearChangeFlags(contactIds, error);
+}
+
+bool ThrottledEngine::clearChangeFlags(const QContactCollectionId &collectionId, QContactManager::Error *error)
+{
+    write(1);
+    return mEngine->clearChangeFlags(collectionId, error);
+}
+
+bool ThrottledEngine::fetchOOB(const QString &scope, const QString &key, QVariant *value)
+{
+    read();
+    return mEngine->fetchOOB(scope, key, value);
+}
+
+bool ThrottledEngine::fetchOOB(const QString &scope, const QStringList &keys, QMap<QString, QVariant> *values)
+{
+    read();
+    return mEngine->fetchOOB(scope, keys, values);
+}
+
+bool ThrottledEngine::fetchOOB(const QString &scope, QMap<QString, QVariant> *values)
+{
+    read();
+    return mEngine->fetchOOB(scope, values);
+}
+
+bool ThrottledEngine::fetchOOBKeys(const QString &scope, QStringList *keys)
+{
+    read();
+    return mEngine->fetchOOBKeys(scope, keys);
+}
+
+bool ThrottledEngine::storeOOB(const QString &scope, const QString &key, const QVariant &value)
+{
+    write(1);
+    return mEngine->storeOOB(scope, key, value);
+}
+
+bool ThrottledEngine::storeOOB(const QString &scope, const QMap<QString, QVariant> &values)
+{
+    write(values.count());
+    return mEngine->storeOOB(scope, values);
+}
+
+bool ThrottledEngine::removeOOB(const QString &scope, const QString &key)
+{
+    write(1);
+    return mEngine->removeOOB(scope, key);
+}
+
+bool ThrottledEngine::removeOOB(const QString &scope, const QStringList &keys)
+{
+    write(keys.count());
+    return mEngine->removeOOB(scope, keys);
+}
+
+bool ThrottledEngine::removeOOB(const QString &scope)
+{
+    write(1);
+    return mEngine->removeOOB(scope);
+}
+
+QStringList ThrottledEngine::displayLabelGroups()
+{
+    return mEngine->displayLabelGroups();
+}
+
+QContactManagerEngine *ThrottledEngineFactory::engine(const QMap<QString, QString> &parameters,
+                                                      QContactManager::Error *error)
+{
+    QContactManager *backend = new QContactManager(backendManagerName, parameters);
+    if (backend->managerName() != backendManagerName) {
+        qWarning() << "Unable to open the backend contacts engine" << backendManagerName;
+        *error = QContactManager::NotSupportedError;
+        delete backend;
+        return 0;
+    }
+
+    return new ThrottledEngine(backend);
+}
+
+QString ThrottledEngineFactory::managerName() const
+{
+    return QStringLiteral("org.nemomobile.contacts.throttled");
+}
@@ -0,0 +1,166 @@
+/** This file is part of Contacts daemon
+ **
+ ** Copyright (c) 2026 Jolla Ltd.
+ **
+ ** GNU Lesser General Public License Usage
+ ** This file may be used under the terms of the GNU Lesser General Public License
+ ** version 2.1 as published by the Free Software Foundation and appearing in the
+ ** file LICENSE.LGPL included in the packaging of this file.  Please review the
+ ** following information to ensure the GNU Lesser General Public License version
+ ** 2.1 requirements will be met:
+ ** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+ **/
+
+#ifndef THROTTLEDENGINE_H
+#define THROTTLEDENGINE_H
+
+#include <QContactManager>
+#include <QContactManagerEngine>
+#include <QContactManagerEngineFactory>
+#include <QElapsedTimer>
+#include <QHash>
+
+#include <contactmanagerengine.h>
+
+QTCONTACTS_USE_NAMESPACE
+
+// Contacts engine for tests and benchmarks. It forwards everything to the
+// sqlite engine, reporting the same manager name and parameters so that ids
+// remain interchangeable, but delays each operation to simulate slow storage:
+//
+//   CONTACTSD_ENGINE_READ_MS   delay of each read
+//   CONTACTSD_ENGINE_WRITE_MS  delay of each contact, relationship or collection written
+//   CONTACTSD_ENGINE_FSYNC_MS  delay of each write transaction
+//
+// Reads, write transactions and written items are counted in the daemon
+// statistics under "contactsEngine.". The daemon plugins use the engine when
+// CONTACTSD_CONTACT_MANAGER is set to org.nemomobile.contacts.throttled.
+class ThrottledEngine : public QtContactsSqliteExtensions::ContactManagerEngine
+{
+    Q_OBJECT
+
+public:
+    // Takes ownership of the backend manager
+    explicit ThrottledEngine(QContactManager *backend);
+    ~ThrottledEngine();
+
+    QString managerName() const;
+    QMap<QString, QString> managerParameters() const;
+    QMap<QString, QString> idInterpretationParameters() const;
+    int managerVersion() const;
+
+    QList<QContactId> contactIds(const QContactFilter &filter, const QList<QContactSortOrder> &sortOrders,
+                                 QContactManager::Error *error) const;
+    QList<QContact> contacts(const QContactFilter &filter, const QList<QContactSortOrder> &sortOrders,
+                             const QContactFetchHint &fetchHint, QContactManager::Error *error) const;
+    QList<QContact> contacts(const QList<QContactId> &contactIds, const QContactFetchHint &fetchHint,
+                             QMap<int, QContactManager::Error> *errorMap, QContactManager::Error *error) const;
+    QContact contact(const QContactId &contactId, const QContactFetchHint &fetchHint,
+                     QContactManager::Error *error) const;
+
+    bool saveContact(QContact *contact, QContactManager::Error *error);
+    bool removeContact(const QContactId &contactId, QContactManager::Error *error);
+    bool saveContacts(QList<QContact> *contacts, QMap<int, QContactManager::Error> *errorMap,
+                      QContactManager::Error *error);
+    bool saveContacts(QList<QContact> *contacts, const QList<QContactDetail::DetailType> &typeMask,
+                      QMap<int, QContactManager::Error> *errorMap, QContactManager::Error *error);
+    bool removeContacts(const QList<QContactId> &contactIds, QMap<int, QContactManager::Error> *errorMap,
+                        QContactManager::Error *error);
+
+    bool setSelfContactId(const QContactId &contactId, QContactManager::Error *error);
+    QContactId selfContactId(QContactManager::Error *error) const;
+
+    QList<QContactRelationship> relationships(const QString &relationshipType, const QContactId &participantId,
+                                              QContactRelationship::Role role, QContactManager::Error *error) const;
+    bool saveRelationship(QContactRelationship *relationship, QContactManager::Error *error);
+    bool removeRelationship(const QContactRelationship &relationship, QContactManager::Error *error);
+    bool saveRelationships(QList<QContactRelationship> *relationships, QMap<int, QContactManager::Error> *errorMap,
+                           QContactManager::Error *error);
+    bool removeRelationships(const QList<QContactRelationship> &relationships,
+                             QMap<int, QContactManager::Error> *errorMap, QContactManager::Error *error);
+
+    QContactCollectionId defaultCollectionId() const;
+    QContactCollection collection(const QContactCollectionId &collectionId, QContactManager::Error *error);
+    QList<QContactCollection> collections(QContactManager::Error *error);
+    bool saveCollection(QContactCollection *collection, QContactManager::Error *error);
+    bool removeCollection(const QContactCollectionId &collectionId, QContactManager::Error *error);
+
+    bool validateContact(const QContact &contact, QContactManager::Error *error) const;
+
+    void requestDestroyed(QContactAbstractRequest *req);
+    bool startRequest(QContactAbstractRequest *req);
+    bool cancelRequest(QContactAbstractRequest *req);
+    bool waitForRequestFinished(QContactAbstractRequest *req, int msecs);
+
+    bool isRelationshipTypeSupported(const QString &relationshipType, QContactType::TypeValues contactType) const;
+    bool isFilterSupported(const QContactFilter &filter) const;
+    QList<QVariant::Type> supportedDataTypes() const;
+    QList<QContactType::TypeValues> supportedContactTypes() const;
+    QList<QContactDetail::DetailType> supportedContactDetailTypes() const;
+
+    // qtcontacts-sqlite extensions
+    QString databaseUuid();
+
+    bool fetchCollectionChanges(int accountId, const QString &applicationName,
+                                QList<QContactCollection> *addedCollections,
+                                QList<QContactCollection> *modifiedCollections,
+                                QList<QContactCollection> *deletedCollections,
+                                QList<QContactCollection> *unmodifiedCollections,
+                                QContactManager::Error *error);
+    bool fetchContactChanges(const QContactCollectionId &collectionId,
+                             QList<QContact> *addedContacts,
+                             QList<QContact> *modifiedContacts,
+                             QList<QContact> *deletedContacts,
+                             QList<QContact> *unmodifiedContacts,
+                             QContactManager::Error *error);
+    bool storeChanges(QHash<QContactCollection*, QList<QContact>* > *addedCollections,
+                      QHash<QContactCollection*, QList<QContact>* > *modifiedCollections,
+                      const QList<QContactCollectionId> &deletedCollections,
+                      ConflictResolutionPolicy conflictResolutionPolicy,
+                      bool clearChangeFlags,
+                      QContactManager::Error *error);
+    bool clearChangeFlags(const QList<QContactId> &contactIds, QContactManager::Error *error);
+    bool clearChangeFlags(const QContactCollectionId &collectionId, QContactManager::Error *error);
+
+    bool fetchOOB(const QString &scope, const QString &key, QVariant *value);
+    bool fetchOOB(const QString &scope, const QStringList &keys, QMap<QString, QVariant> *values);
+    bool fetchOOB(const QString &scope, QMap<QString, QVariant> *values);
+    bool fetchOOBKeys(const QString &scope, QStringList *keys);
+    bool storeOOB(const QString &scope, const QString &key, const QVariant &value);
+    bool storeOOB(const QString &scope, const QMap<QString, QVariant> &values);
+    bool removeOOB(const QString &scope, const QString &key);
+    bool removeOOB(const QString &scope, const QStringList &keys);
+    bool removeOOB(const QString &scope);
+
+    QStringList displayLabelGroups();
+
+private:
+    void read() const;
+    void write(int items) const;
+    int writeDelay(int items) const;
+    void forwardRequest(QContactAbstractRequest *req);
+
+    struct PendingRequest {
+        QElapsedTimer held;
+        int delay;
+    };
+
+    QContactManager *mBackend;
+    QtContactsSqliteExtensions::ContactManagerEngine *mEngine;
+    QHash<QContactAbstractRequest *, PendingRequest> mPendingRequests;
+    int mReadLatency;
+    int mWriteLatency;
+    int mFsyncLatency;
+};
+
+class ThrottledEngineFactory : public QContactManagerEngineFactory
+{
+    Q_OBJECT
+    Q_PLUGIN_METADATA(IID QT_CONTACT_MANAGER_ENGINE_FACTORY_INTERFACE FILE "throttledengine.json")
+
+public:
+    QContactManagerEngine *engine(const QMap<QString, QString> &parameters, QContactManager::Error *error);
+    QString managerName() const;
+};
+
+#endif // THROTTLEDENGINE_H
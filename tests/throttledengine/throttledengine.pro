@@ -0,0 +1,27 @@
+include(../common/test-common.pri)
+include(../../plugins/contacts-extensions.pri)
+
+TEMPLATE = lib
+TARGET = qtcontacts_throttled
+
+CONFIG += plugin link_pkgconfig
+
+QT -= gui
+QT += contacts
+
+PKGCONFIG += Qt5Contacts
+
+# Built into a plugin tree of its own, so that QT_PLUGIN_PATH can point at it
+DESTDIR = plugins/contacts
+target.path = /opt/tests/$${PACKAGENAME}/plugins/contacts
+
+HEADERS += \
+    throttledengine.h
+
+SOURCES += \
+    throttledengine.cpp
+
+OTHER_FILES += \
+    throttledengine.json
+
+INSTALLS += target
@@ -0,0 +1,372 @@
+/** This file is part of Contacts daemon
+ **
+ ** Copyright (c) 2026 Jolla Ltd.
+ **
+ ** GNU Lesser General Public License Usage
+ ** This file may be used under the terms of the GNU Lesser General Public License
+ ** version 2.1 as published by the Free Software Foundation and appearing in the
+ ** file LICENSE.LGPL included in the packaging of this file.  Please review the
+ ** following information to ensure the GNU Lesser General Public License version
+ ** 2.1 requirements will be met:
+ ** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+ **/
+
+#include "test-avatarfetcher.h"
+
+#include <test-common.h>
+
+#include <QDir>
+#include <QFile>
+
+namespace {
+
+const QByteArray ImageA = QByteArray("\x89PNG image a", 12);
+const QByteArray ImageB = QByteArray("\x89PNG image b", 12);
+
+}
+
+FakeHttpServer::FakeHttpServer(QObject *parent)
+    : QTcpServer(parent)
+    , downloads(0)
+    , maxConcurrent(0)
+    , mHolding(false)
+    , mConcurrent(0)
+{
+    connect(this, SIGNAL(newConnection()), SLOT(onNewConnection()));
+}
+
+void FakeHttpServer::addImage(const QString &path, const QByteArray &data, const QByteArray &eTag)
+{
+    Image image;
+    image.data = data;
+    image.eTag = eTag;
+    mImages.insert(path, image);
+}
+
+QUrl FakeHttpServer::url(const QString &path, const QString &hostName) const
+{
+    return QUrl(QStringLiteral("http://%1:%2%3").arg(hostName).arg(serverPort()).arg(path));
+}
+
+void FakeHttpServer::setHolding(bool holding)
+{
+    mHolding = holding;
+    while (!mHolding && !mHeld.isEmpty()) {
+        releaseOne();
+    }
+}
+
+void FakeHttpServer::releaseOne()
+{
+    if (!mHeld.isEmpty()) {
+        const Held held = mHeld.takeFirst();
+        respond(held.socket, held.path, held.ifNoneMatch);
+    }
+}
+
+void FakeHttpServer::onNewConnection()
+{
+    while (QTcpSocket *socket = nextPendingConnection()) {
+        connect(socket, SIGNAL(readyRead()), SLOT(onReadyRead()));
+        connect(socket, SIGNAL(disconnected()), socket, SLOT(deleteLater()));
+    }
+}
+
+void FakeHttpServer::onReadyRead()
+{
+    QTcpSocket *socket = static_cast<QTcpSocket *>(sender());
+
+    QByteArray &buffer = mBuffers[socket];
+    buffer += socket->readAll();
+
+    const int end = buffer.indexOf("\r\n\r\n");
+    if (end < 0) {
+        return;
+    }
+
+    const QList<QByteArray> lines = buffer.left(end).split('\n');
+    mBuffers.remove(socket);
+
+    const QString path = QString::fromLatin1(lines.first().split(' ').value(1));
+    QByteArray ifNoneMatch;
+    Q_FOREACH (const QByteArray &line, lines.mid(1)) {
+        const int colon = line.indexOf(':');
+        if (line.left(colon).trimmed().toLower() == "if-none-match") {
+            ifNoneMatch = line.mid(colon + 1).trimmed();
+        }
+    }
+
+    requests.append(path);
+    if (!ifNoneMatch.isEmpty()) {
+        conditionalRequests.append(path);
+    }
+
+    maxConcurrent = qMax(maxConcurrent, ++mConcurrent);
+
+    if (mHolding) {
+        Held held;
+        held.socket = socket;
+        held.path = path;
+        held.ifNoneMatch = ifNoneMatch;
+        mHeld.append(held);
+    } else {
+        respond(socket, path, ifNoneMatch);
+    }
+}
+
+void FakeHttpServer::respond(QTcpSocket *socket, const QString &path, const QByteArray &ifNoneMatch)
+{
+    --mConcurrent;
+
+    QByteArray status("404 Not Found");
+    QByteArray headers;
+    QByteArray body;
+
+    if (mImages.contains(path)) {
+        const Image &image = mImages[path];
+        headers = "ETag: " + image.eTag + "\r\n";
+        if (image.eTag == ifNoneMatch) {
+            status = "304 Not Modified";
+        } else {
+            ++downloads;
+            status = "200 OK";
+            headers += "Content-Type: image/png\r\n";
+            body = image.data;
+        }
+    }
+
+    socket->write("HTTP/1.1 " + status + "\r\n" + headers
+                  + "Content-Length: " + QByteArray::number(body.size()) + "\r\n"
+                  + "Connection: close\r\n\r\n" + body);
+    socket->disconnectFromHost();
+}
+
+TestAvatarFetcher::TestAvatarFetcher(QObject *parent)
+    : QObject(parent)
+    , mServer(0)
+    , mStore(0)
+    , mFetcher(0)
+{
+}
+
+void TestAvatarFetcher::initTestCase()
+{
+    QVERIFY(mHome.isValid());
+
+    // The avatars are stored in the plugin cache directory under $HOME
+    qputenv("HOME", mHome.path().toLocal8Bit());
+
+    mServer = new FakeHttpServer(this);
+
+    // Listen on both loopback addresses, localhost may resolve to either
+    QVERIFY(mServer->listen(QHostAddress::Any));
+}
+
+void TestAvatarFetcher::init()
+{
+    mServer->requests.clear();
+    mServer->conditionalRequests.clear();
+    mServer->downloads = 0;
+    mServer->maxConcurrent = 0;
+    mServer->setHolding(false);
+    mNetwork.setNetworkAccessible(QNetworkAccessManager::Accessible);
+
+    mFetched.clear();
+    mFetchOrder.clear();
+
+    mStore = new CDTpAvatarStore;
+    mFetcher = new CDTpAvatarFetcher(&mNetwork, mStore);
+}
+
+void TestAvatarFetcher::fetch(const QString &key, const QUrl &url, bool priority)
+{
+    mFetcher->fetch(key, url, priority, this, [this, key](const QString &path) {
+        mFetched.insert(key, path);
+        mFetchOrder.append(key);
+    });
+}
+
+void TestAvatarFetcher::download()
+{
+    mServer->addImage(QStringLiteral("/a.png"), ImageA, "\"a1\"");
+
+    fetch(QStringLiteral("a"), mServer->url(QStringLiteral("/a.png")));
+    QTRY_VERIFY(mFetched.contains(QStringLiteral("a")));
+
+    const QString path = mFetched.value(QStringLiteral("a"));
+    QVERIFY(path.startsWith(mStore->directory()));
+
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    QCOMPARE(file.readAll(), ImageA);
+
+    const CDTpAvatarFetcher::Validators validators =
+            mFetcher->mValidators.value(mServer->url(QStringLiteral("/a.png")).toString());
+    QCOMPARE(validators.eTag, QByteArray("\"a1\""));
+    QCOMPARE(validators.path, path);
+}
+
+void TestAvatarFetcher::revalidate()
+{
+    const QUrl url(mServer->url(QStringLiteral("/a.png")));
+    mServer->addImage(QStringLiteral("/a.png"), ImageA, "\"a1\"");
+
+    fetch(QStringLiteral("a"), url);
+    QTRY_VERIFY(mFetched.contains(QStringLiteral("a")));
+    const QString path = mFetched.take(QStringLiteral("a"));
+    QCOMPARE(mServer->downloads, 1);
+
+    // Unchanged, the image is revalidated rather than downloaded
+    mFetcher->mValidators[url.toString()].validated = QDateTime::currentDateTimeUtc().addSecs(-3600);
+    fetch(QStringLiteral("a"), url);
+    QTRY_VERIFY(mFetched.contains(QStringLiteral("a")));
+    QCOMPARE(mFetched.take(QStringLiteral("a")), path);
+    QCOMPARE(mServer->conditionalRequests, QStringList() << QStringLiteral("/a.png"));
+    QCOMPARE(mServer->downloads, 1);
+
+    // Changed, it is downloaded again
+    mServer->addImage(QStringLiteral("/a.png"), ImageB, "\"b1\"");
+    mFetcher->mValidators[url.toString()].validated = QDateTime::currentDateTimeUtc().addSecs(-3600);
+    fetch(QStringLiteral("a"), url);
+    QTRY_VERIFY(mFetched.contains(QStringLiteral("a")));
+    QVERIFY(mFetched.value(QStringLiteral("a")) != path);
+    QCOMPARE(mServer->downloads, 2);
+    QCOMPARE(mFetcher->mValidators.value(url.toString()).eTag, QByteArray("\"b1\""));
+
+    // The validators are kept across restarts
+    delete mFetcher;
+    mFetcher = new CDTpAvatarFetcher(&mNetwork, mStore);
+    QCOMPARE(mFetcher->mValidators.value(url.toString()).eTag, QByteArray("\"b1\""));
+}
+
+void TestAvatarFetcher::freshImage()
+{
+    mServer->addImage(QStringLiteral("/a.png"), ImageA, "\"a1\"");
+
+    fetch(QStringLiteral("a"), mServer->url(QStringLiteral("/a.png")));
+    QTRY_VERIFY(mFetched.contains(QStringLiteral("a")));
+
+    // Another contact showing the same image does not hit the server again
+    fetch(QStringLiteral("b"), mServer->url(QStringLiteral("/a.png")));
+    QTRY_VERIFY(mFetched.contains(QStringLiteral("b")));
+    QCOMPARE(mFetched.value(QStringLiteral("b")), mFetched.value(QStringLiteral("a")));
+    QCOMPARE(mServer->requests.count(), 1);
+}
+
+void TestAvatarFetcher::missingImage()
+{
+    fetch(QStringLiteral("a"), mServer->url(QStringLiteral("/missing.png")));
+    QTRY_VERIFY(mFetched.contains(QStringLiteral("a")));
+    QVERIFY(mFetched.value(QStringLiteral("a")).isEmpty());
+    QVERIFY(mFetcher->mValidators.isEmpty());
+}
+
+void TestAvatarFetcher::networkUnavailable()
+{
+    mServer->addImage(QStringLiteral("/a.png"), ImageA, "\"a1\"");
+
+    // Offline, the replies have finished before the fetcher sees them
+    mNetwork.setNetworkAccessible(QNetworkAccessManager::NotAccessible);
+    for (int i = 0; i < 3; ++i) {
+        fetch(QString::number(i), mServer->url(QStringLiteral("/a.png")));
+    }
+    QTRY_COMPARE(mFetched.count(), 3);
+    Q_FOREACH (const QString &path, mFetched) {
+        QVERIFY(path.isEmpty());
+    }
+    QVERIFY(mFetcher->mActive.isEmpty());
+    QVERIFY(mFetcher->mHosts.isEmpty());
+
+    // The host is not left blocked once back online
+    mNetwork.setNetworkAccessible(QNetworkAccessManager::Accessible);
+    fetch(QStringLiteral("a"), mServer->url(QStringLiteral("/a.png")));
+    QTRY_VERIFY(mFetched.contains(QStringLiteral("a")));
+    QVERIFY(!mFetched.value(QStringLiteral("a")).isEmpty());
+    QCOMPARE(mServer->requests.count(), 1);
+}
+
+void TestAvatarFetcher::replaceRequest()
+{
+    mServer->addImage(QStringLiteral("/a.png"), ImageA, "\"a1\"");
+    mServer->addImage(QStringLiteral("/b.png"), ImageB, "\"b1\"");
+    mServer->addImage(QStringLiteral("/c.png"), ImageB, "\"c1\"");
+    mServer->setHolding(true);
+    mFetcher->setMaxRequestsPerHost(1);
+
+    fetch(QStringLiteral("x"), mServer->url(QStringLiteral("/a.png")));
+    QTRY_COMPARE(mServer->heldCount(), 1);
+
+    // Waiting requests for the same key are replaced by the latest
+    fetch(QStringLiteral("y"), mServer->url(QStringLiteral("/b.png")));
+    fetch(QStringLiteral("y"), mServer->url(QStringLiteral("/c.png")));
+
+    mServer->setHolding(false);
+    QTRY_COMPARE(mFetched.count(), 2);
+    QCOMPARE(mServer->requests, QStringList() << QStringLiteral("/a.png") << QStringLiteral("/c.png"));
+    QCOMPARE(mFetchOrder, QStringList() << QStringLiteral("x") << QStringLiteral("y"));
+}
+
+void TestAvatarFetcher::concurrencyPerHost()
+{
+    const QStringList hosts = QStringList() << QStringLiteral("127.0.0.1") << QStringLiteral("localhost");
+
+    mServer->setHolding(true);
+    for (int i = 0; i < 6; ++i) {
+        const QString path = QStringLiteral("/%1.png").arg(i);
+        mServer->addImage(path, ImageA + QByteArray::number(i), QByteArray::number(i));
+        Q_FOREACH (const QString &host, hosts) {
+            fetch(host + path, mServer->url(path, host));
+        }
+    }
+
+    // Two requests run against each host
+    QTRY_COMPARE(mServer->heldCount(), 4);
+    QTest::qWait(200);
+    QCOMPARE(mServer->heldCount(), 4);
+
+    mServer->setHolding(false);
+    QTRY_COMPARE(mFetched.count(), 12);
+    QCOMPARE(mServer->maxConcurrent, 4);
+    QCOMPARE(mServer->downloads, 12);
+}
+
+void TestAvatarFetcher::priority()
+{
+    const QStringList keys = QStringList() << QStringLiteral("a") << QStringLiteral("b")
+                                           << QStringLiteral("c") << QStringLiteral("d");
+    Q_FOREACH (const QString &key, keys) {
+        mServer->addImage(QLatin1Char('/') + key, key.toLatin1(), key.toLatin1());
+    }
+
+    mServer->setHolding(true);
+    mFetcher->setMaxRequestsPerHost(1);
+
+    fetch(QStringLiteral("a"), mServer->url(QStringLiteral("/a")));
+    QTRY_COMPARE(mServer->heldCount(), 1);
+    fetch(QStringLiteral("b"), mServer->url(QStringLiteral("/b")));
+    fetch(QStringLiteral("c"), mServer->url(QStringLiteral("/c")));
+    // A favourite, say, goes ahead of the waiting background requests
+    fetch(QStringLiteral("d"), mServer->url(QStringLiteral("/d")), true);
+
+    for (int i = 1; i <= keys.count(); ++i) {
+        QTRY_COMPARE(mServer->heldCount(), 1);
+        mServer->releaseOne();
+        QTRY_COMPARE(mFetched.count(), i);
+    }
+
+    QCOMPARE(mServer->requests, QStringList() << QStringLiteral("/a") << QStringLiteral("/d")
+                                              << QStringLiteral("/b") << QStringLiteral("/c"));
+}
+
+void TestAvatarFetcher::cleanup()
+{
+    delete mFetcher;
+    mFetcher = 0;
+    delete mStore;
+    mStore = 0;
+
+    // Start each test without stored images or validators
+    QVERIFY(QDir(mHome.path() + QStringLiteral("/.local")).removeRecursively());
+}
+
+CONTACTSD_TEST_MAIN(TestAvatarFetcher)
@@ -0,0 +1,114 @@
+/** This file is part of Contacts daemon
+ **
+ ** Copyright (c) 2026 Jolla Ltd.
+ **
+ ** GNU Lesser General Public License Usage
+ ** This file may be used under the terms of the GNU Lesser General Public License
+ ** version 2.1 as published by the Free Software Foundation and appearing in the
+ ** file LICENSE.LGPL included in the packaging of this file.  Please review the
+ ** following information to ensure the GNU Lesser General Public License version
+ ** 2.1 requirements will be met:
+ ** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+ **/
+
+#ifndef TEST_AVATARFETCHER_H
+#define TEST_AVATARFETCHER_H
+
+#include <QHash>
+#include <QList>
+#include <QNetworkAccessManager>
+#include <QObject>
+#include <QStringList>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTemporaryDir>
+#include <QtTest/QtTest>
+
+#include "cdtpavatarstore.h"
+
+// "unprotect" the validators
+#define private public
+#include "cdtpavatarfetcher.h"
+#undef private
+
+// Stands in for a web server publishing avatar images. Requests are answered
+// in the order they arrive, unless held until released by the test.
+class FakeHttpServer : public QTcpServer
+{
+    Q_OBJECT
+
+public:
+    explicit FakeHttpServer(QObject *parent = 0);
+
+    void addImage(const QString &path, const QByteArray &data, const QByteArray &eTag);
+    QUrl url(const QString &path, const QString &hostName = QStringLiteral("127.0.0.1")) const;
+
+    void setHolding(bool holding);
+    int heldCount() const { return mHeld.count(); }
+    void releaseOne();
+
+    QStringList requests;           // paths, in the order received
+    QStringList conditionalRequests;
+    int downloads;
+    int maxConcurrent;
+
+private Q_SLOTS:
+    void onNewConnection();
+    void onReadyRead();
+
+private:
+    struct Image {
+        QByteArray data;
+        QByteArray eTag;
+    };
+
+    struct Held {
+        QTcpSocket *socket;
+        QString path;
+        QByteArray ifNoneMatch;
+    };
+
+    void respond(QTcpSocket *socket, const QString &path, const QByteArray &ifNoneMatch);
+
+    QHash<QString, Image> mImages;
+    QHash<QTcpSocket *, QByteArray> mBuffers;
+    QList<Held> mHeld;
+    bool mHolding;
+    int mConcurrent;
+};
+
+class TestAvatarFetcher : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit TestAvatarFetcher(QObject *parent = 0);
+
+private Q_SLOTS:
+    void initTestCase();
+    void init();
+
+    void download();
+    void revalidate();
+    void freshImage();
+    void missingImage();
+    void networkUnavailable();
+    void replaceRequest();
+    void concurrencyPerHost();
+    void priority();
+
+    void cleanup();
+
+private:
+    void fetch(const QString &key, const QUrl &url, bool priority = false);
+
+    QTemporaryDir mHome;
+    QNetworkAccessManager mNetwork;
+    FakeHttpServer *mServer;
+    CDTpAvatarStore *mStore;
+    CDTpAvatarFetcher *mFetcher;
+    QHash<QString, QString> mFetched;   // key -> delivered path
+    QStringList mFetchOrder;
+};
+
+#endif // TEST_AVATARFETCHER_H
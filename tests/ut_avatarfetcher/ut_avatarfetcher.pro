@@ -0,0 +1,34 @@
+include(../common/test-common.pri)
+
+TARGET = ut_avatarfetcher
+target.path = /opt/tests/$${PACKAGENAME}/$$TARGET
+
+CONFIG += test link_pkgconfig
+
+QT -= gui
+QT += network testlib
+
+PKGCONFIG += Qt5Contacts
+
+DEFINES += QT_NO_CAST_TO_ASCII QT_NO_CAST_FROM_ASCII
+
+TELEPATHY_PLUGIN_DIR = $$PWD/../../plugins/telepathy
+
+INCLUDEPATH += $$TELEPATHY_PLUGIN_DIR
+VPATH += $$TELEPATHY_PLUGIN_DIR
+
+HEADERS += \
+    test-avatarfetcher.h \
+    cdtpavatarfetcher.h \
+    cdtpavatarstore.h \
+    cdtpavatarupdate.h \
+    cdtpavatarwriter.h
+
+SOURCES += \
+    test-avatarfetcher.cpp \
+    cdtpavatarfetcher.cpp \
+    cdtpavatarstore.cpp \
+    cdtpavatarupdate.cpp \
+    cdtpavatarwriter.cpp
+
+INSTALLS += target
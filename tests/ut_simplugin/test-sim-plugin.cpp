@@ -597,6 +597,34 @@ void TestSimPlugin::testClear()
     QCOMPARE(simContacts.count(), 0);
 }
 
+void TestSimPlugin::testBatchedStore()
+{
+    QContactManager &m(m_controller->contactManager());
+
+    QCOMPARE(getAllSimContacts(m).count(), 0);
+    QCOMPARE(m_controller->busy(), false);
+
+    // More contacts than are stored in one step of the store task
+    const int count = CDSimModemData::StoreBatchSize * 2 + 5;
+    QString vcardData;
+    for (int i = 0; i < count; ++i) {
+        vcardData += QStringLiteral("BEGIN:VCARD\n"
+                                    "VERSION:3.0\n"
+                                    "FN:Forrest Gump %1\n"
+                                    "TEL;TYPE=HOME,VOICE:(404) 555-%2\n"
+                                    "END:VCARD\n").arg(i).arg(i, 4, 10, QLatin1Char('0'));
+    }
+
+    m_controller->m_modems.first()->setReady(true);
+    m_controller->m_modems.first()->vcardDataAvailable(vcardData);
+    QCOMPARE(m_controller->busy(), true);
+
+    // The controller is busy until the last batch has been stored
+    QTRY_VERIFY(m_controller->busy() == false);
+    QCOMPARE(m_controller->m_modems.first()->m_storeTaskId, 0);
+    QCOMPARE(getAllSimContacts(m).count(), count);
+}
+
 void TestSimPlugin::cleanupTestCase()
 {
     if (CDSimModemData::removeCollections(&m_controller->contactManager(),
@@ -49,6 +49,7 @@ private Q_SLOTS:
     void testCoalescing();
     void testEmpty();
     void testClear();
+    void testBatchedStore();
 
     void cleanupTestCase();
     void cleanup();
@@ -0,0 +1,274 @@
+/** This file is part of Contacts daemon
+ **
+ ** Copyright (c) 2026 Jolla Ltd.
+ **
+ ** GNU Lesser General Public License Usage
+ ** This file may be used under the terms of the GNU Lesser General Public License
+ ** version 2.1 as published by the Free Software Foundation and appearing in the
+ ** file LICENSE.LGPL included in the packaging of this file.  Please review the
+ ** following information to ensure the GNU Lesser General Public License version
+ ** 2.1 requirements will be met:
+ ** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+ **/
+
+#include "test-synctrigger.h"
+
+#include <test-common.h>
+
+#include <QDBusConnectionInterface>
+#include <QDir>
+#include <QStandardPaths>
+#include <QTemporaryDir>
+
+using namespace Contactsd;
+
+namespace {
+
+const QString GoogleProfile = QStringLiteral("google.Contacts-1");
+const QString CardDavProfile = QStringLiteral("carddav.Contacts-2");
+
+}
+
+FakeSynchronizer::FakeSynchronizer(QObject *parent)
+    : QObject(parent)
+{
+}
+
+bool FakeSynchronizer::startSync(const QString &profileId)
+{
+    startedProfiles.append(profileId);
+    return true;
+}
+
+TestSyncTrigger::TestSyncTrigger(QObject *parent)
+    : QObject(parent)
+    , m_connection(QDBusConnection::sessionBus())
+    , m_synchronizer(0)
+    , m_trigger(0)
+{
+}
+
+void TestSyncTrigger::initTestCase()
+{
+    QVERIFY(m_connection.isConnected());
+
+    m_synchronizer = new FakeSynchronizer(this);
+    QVERIFY(m_connection.registerObject(QStringLiteral("/synchronizer"), m_synchronizer,
+                                        QDBusConnection::ExportAllSlots));
+    QVERIFY(m_connection.registerService(QStringLiteral("com.meego.msyncd")));
+}
+
+void TestSyncTrigger::init()
+{
+    m_synchronizer->startedProfiles.clear();
+
+    // Bypass the Buteo profile manager, the tests provide the parsed profiles
+    m_trigger = new SyncTrigger(&m_connection);
+    m_trigger->mProfileDirectories.clear();
+    m_trigger->mProfilesValid = true;
+    m_trigger->mMinimumInterval = 500;
+    m_trigger->mMaximumDelay = 2000;
+}
+
+void TestSyncTrigger::addProfile(const QString &profileId, bool upsync, bool alwaysUpToDate)
+{
+    SyncTrigger::SyncProfileInfo info;
+    info.id = profileId;
+    info.upsync = upsync;
+    info.alwaysUpToDate = alwaysUpToDate;
+    m_trigger->mProfiles.append(info);
+}
+
+void TestSyncTrigger::burst(const QStringList &providers, int count)
+{
+    for (int i = 0; i < count; ++i) {
+        m_trigger->triggerSync(providers, SyncTrigger::AdaptiveSync, SyncTrigger::UpsyncDirection);
+    }
+}
+
+void TestSyncTrigger::forceSync()
+{
+    addProfile(GoogleProfile);
+
+    for (int i = 0; i < 5; ++i) {
+        m_trigger->triggerSync(QStringList() << QStringLiteral("google"), SyncTrigger::ForceSync,
+                               SyncTrigger::AnyDirection);
+    }
+
+    // Forced syncs are not coalesced
+    QTRY_COMPARE(m_synchronizer->startedProfiles.count(), 5);
+    QVERIFY(!m_trigger->mSegmentTimer.isActive());
+}
+
+void TestSyncTrigger::nonTargetProfile()
+{
+    addProfile(GoogleProfile);
+    addProfile(QStringLiteral("carddav.Contacts-3"), false, true);
+    addProfile(QStringLiteral("carddav.Contacts-4"), true, false);
+    addProfile(QStringLiteral("facebook.Contacts-5"));
+
+    burst(QStringList() << QStringLiteral("carddav") << QStringLiteral("facebook"), 10);
+
+    QTest::qWait(m_trigger->mMaximumDelay / 2);
+    QCOMPARE(m_synchronizer->startedProfiles.count(), 0);
+    QVERIFY(m_trigger->mPendingSyncs.isEmpty());
+}
+
+void TestSyncTrigger::adaptiveBurst()
+{
+    addProfile(GoogleProfile);
+
+    // The first request of an idle profile is started right away, the rest of the
+    // burst is merged into one sync once the minimum interval has passed
+    burst(QStringList() << QStringLiteral("google"), 100);
+    QTRY_COMPARE(m_synchronizer->startedProfiles.count(), 1);
+    QCOMPARE(m_trigger->mPendingSyncs.count(), 1);
+
+    QTRY_COMPARE(m_synchronizer->startedProfiles.count(), 2);
+    QTest::qWait(m_trigger->mMinimumInterval * 2);
+    QCOMPARE(m_synchronizer->startedProfiles.count(), 2);
+    QCOMPARE(m_synchronizer->startedProfiles, QStringList() << GoogleProfile << GoogleProfile);
+
+    // A second burst within the interval is delayed as a whole
+    burst(QStringList() << QStringLiteral("google"), 100);
+    QTRY_COMPARE(m_synchronizer->startedProfiles.count(), 3);
+    burst(QStringList() << QStringLiteral("google"), 100);
+    QTRY_COMPARE(m_synchronizer->startedProfiles.count(), 4);
+    QTest::qWait(m_trigger->mMinimumInterval * 2);
+    QCOMPARE(m_synchronizer->startedProfiles.count(), 4);
+}
+
+void TestSyncTrigger::adaptiveMaximumDelay()
+{
+    addProfile(GoogleProfile);
+    m_trigger->mMinimumInterval = 60 * 1000;
+    m_trigger->mMaximumDelay = 300;
+
+    burst(QStringList() << QStringLiteral("google"), 10);
+    QTRY_COMPARE(m_synchronizer->startedProfiles.count(), 1);
+
+    // The minimum interval is not honoured at the cost of exceeding the maximum delay
+    QElapsedTimer timer;
+    timer.start();
+    burst(QStringList() << QStringLiteral("google"), 10);
+    QTRY_COMPARE_WITH_TIMEOUT(m_synchronizer->startedProfiles.count(), 2, 2000);
+    QVERIFY(timer.elapsed() < 2000);
+}
+
+void TestSyncTrigger::adaptivePerProfile()
+{
+    addProfile(GoogleProfile);
+    addProfile(CardDavProfile);
+
+    burst(QStringList() << QStringLiteral("google"), 50);
+    burst(QStringList() << QStringLiteral("carddav"), 50);
+    burst(QStringList() << QStringLiteral("google") << QStringLiteral("carddav"), 50);
+
+    // Each profile has its own segments
+    QTRY_COMPARE(m_synchronizer->startedProfiles.count(), 4);
+    QTest::qWait(m_trigger->mMinimumInterval * 2);
+    QCOMPARE(m_synchronizer->startedProfiles.count(), 4);
+    QCOMPARE(m_synchronizer->startedProfiles.count(GoogleProfile), 2);
+    QCOMPARE(m_synchronizer->startedProfiles.count(CardDavProfile), 2);
+}
+
+void TestSyncTrigger::forceSyncSatisfiesPending()
+{
+    addProfile(GoogleProfile);
+
+    burst(QStringList() << QStringLiteral("google"), 10);
+    QCOMPARE(m_trigger->mPendingSyncs.count(), 1);
+
+    m_trigger->triggerSync(QStringList() << QStringLiteral("google"), SyncTrigger::ForceSync,
+                           SyncTrigger::AnyDirection);
+    QVERIFY(m_trigger->mPendingSyncs.isEmpty());
+
+    QTRY_COMPARE(m_synchronizer->startedProfiles.count(), 2);
+    QTest::qWait(m_trigger->mMinimumInterval * 2);
+    QCOMPARE(m_synchronizer->startedProfiles.count(), 2);
+}
+
+void TestSyncTrigger::profileCacheInvalidation()
+{
+    QTemporaryDir profileDir;
+    QVERIFY(profileDir.isValid());
+
+    m_trigger->mProfileDirectories = QStringList() << profileDir.path();
+    m_trigger->mProfilesValid = false;
+    m_trigger->syncProfiles();
+    QVERIFY(m_trigger->mProfilesValid);
+    QVERIFY(m_trigger->mProfileWatcher.directories().contains(profileDir.path()));
+
+    // Repeated triggers use the cached profiles
+    addProfile(GoogleProfile);
+    m_trigger->triggerSync(QStringList() << QStringLiteral("google"), SyncTrigger::ForceSync,
+                           SyncTrigger::AnyDirection);
+    QVERIFY(m_trigger->mProfilesValid);
+    QTRY_COMPARE(m_synchronizer->startedProfiles.count(), 1);
+
+    // Adding a profile invalidates the cache
+    QFile profile(profileDir.filePath(QStringLiteral("google.Contacts-6.xml")));
+    QVERIFY(profile.open(QIODevice::WriteOnly));
+    profile.write("<profile name=\"google.Contacts-6\" type=\"sync\"/>\n");
+    profile.close();
+    QTRY_VERIFY(!m_trigger->mProfilesValid);
+
+    // ... as does rewriting it
+    m_trigger->syncProfiles();
+    QVERIFY(m_trigger->mProfilesValid);
+    QVERIFY(profile.open(QIODevice::Append));
+    profile.write("\n");
+    profile.close();
+    QTRY_VERIFY(!m_trigger->mProfilesValid);
+}
+
+void TestSyncTrigger::defaultProfileDirectories()
+{
+    SyncTrigger trigger(&m_connection);
+    const QStringList expected = QStringList()
+            << QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation) + QStringLiteral("/msyncd/sync")
+            << QStringLiteral("/etc/buteo/profiles/sync");
+    QCOMPARE(trigger.mProfileDirectories, expected);
+
+    // The default directories resolve to something watchable, so the profiles are cached
+    // even before msyncd has created its profile directory
+    trigger.syncProfiles();
+    QVERIFY(trigger.mProfilesValid);
+    QVERIFY(!trigger.mProfileWatcher.directories().isEmpty());
+}
+
+void TestSyncTrigger::missingProfileDirectory()
+{
+    QTemporaryDir cacheDir;
+    QVERIFY(cacheDir.isValid());
+    const QString profileDir = cacheDir.path() + QStringLiteral("/sync");
+
+    m_trigger->mProfileDirectories = QStringList() << profileDir;
+    m_trigger->mProfilesValid = false;
+    m_trigger->syncProfiles();
+    QVERIFY(m_trigger->mProfilesValid);
+    QCOMPARE(m_trigger->mProfileWatcher.directories(), QStringList() << cacheDir.path());
+
+    // Creating the profile directory invalidates the cache, which then watches it directly
+    QVERIFY(QDir(cacheDir.path()).mkdir(QStringLiteral("sync")));
+    QTRY_VERIFY(!m_trigger->mProfilesValid);
+    m_trigger->syncProfiles();
+    QVERIFY(m_trigger->mProfilesValid);
+    QCOMPARE(m_trigger->mProfileWatcher.directories(), QStringList() << profileDir);
+}
+
+void TestSyncTrigger::cleanup()
+{
+    // Pending syncs are flushed on destruction
+    m_trigger->mPendingSyncs.clear();
+    delete m_trigger;
+    m_trigger = 0;
+}
+
+void TestSyncTrigger::cleanupTestCase()
+{
+    m_connection.unregisterService(QStringLiteral("com.meego.msyncd"));
+    m_connection.unregisterObject(QStringLiteral("/synchronizer"));
+}
+
+CONTACTSD_TEST_MAIN(TestSyncTrigger)
@@ -0,0 +1,74 @@
+/** This file is part of Contacts daemon
+ **
+ ** Copyright (c) 2026 Jolla Ltd.
+ **
+ ** GNU Lesser General Public License Usage
+ ** This file may be used under the terms of the GNU Lesser General Public License
+ ** version 2.1 as published by the Free Software Foundation and appearing in the
+ ** file LICENSE.LGPL included in the packaging of this file.  Please review the
+ ** following information to ensure the GNU Lesser General Public License version
+ ** 2.1 requirements will be met:
+ ** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+ **/
+
+#ifndef TEST_SYNCTRIGGER_H
+#define TEST_SYNCTRIGGER_H
+
+#include <QObject>
+#include <QStringList>
+#include <QtTest/QtTest>
+
+// "unprotect" the profile cache and coalescing state
+#define private public
+#include "synctrigger.h"
+#undef private
+
+// Stands in for msyncd, counting the syncs started through it
+class FakeSynchronizer : public QObject
+{
+    Q_OBJECT
+    Q_CLASSINFO("D-Bus Interface", "com.meego.msyncd")
+
+public:
+    explicit FakeSynchronizer(QObject *parent = 0);
+
+    QStringList startedProfiles;
+
+public Q_SLOTS:
+    bool startSync(const QString &profileId);
+};
+
+class TestSyncTrigger : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit TestSyncTrigger(QObject *parent = 0);
+
+private Q_SLOTS:
+    void initTestCase();
+    void init();
+
+    void forceSync();
+    void nonTargetProfile();
+    void adaptiveBurst();
+    void adaptiveMaximumDelay();
+    void adaptivePerProfile();
+    void forceSyncSatisfiesPending();
+    void profileCacheInvalidation();
+    void defaultProfileDirectories();
+    void missingProfileDirectory();
+
+    void cleanup();
+    void cleanupTestCase();
+
+private:
+    void addProfile(const QString &profileId, bool upsync = true, bool alwaysUpToDate = true);
+    void burst(const QStringList &providers, int count);
+
+    QDBusConnection m_connection;
+    FakeSynchronizer *m_synchronizer;
+    Contactsd::SyncTrigger *m_trigger;
+};
+
+#endif // TEST_SYNCTRIGGER_H
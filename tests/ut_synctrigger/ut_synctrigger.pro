@@ -0,0 +1,24 @@
+include(../common/test-common.pri)
+
+TARGET = ut_synctrigger
+target.path = /opt/tests/$${PACKAGENAME}/$$TARGET
+
+CONFIG += test link_pkgconfig
+
+QT -= gui
+QT += dbus testlib
+
+PKGCONFIG += buteosyncfw5
+
+INCLUDEPATH += \
+    ../../src
+
+HEADERS += \
+    test-synctrigger.h \
+    ../../src/synctrigger.h
+
+SOURCES += \
+    test-synctrigger.cpp \
+    ../../src/synctrigger.cpp
+
+INSTALLS += target
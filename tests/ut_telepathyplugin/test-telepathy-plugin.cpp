@@ -31,6 +31,11 @@
 #include <QContactIdFetchRequest>
 #include <QContactCollection>
 
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include <algorithm>
+
 #include <TelepathyQt/Debug>
 
 #include "libtelepathy/util.h"
@@ -46,6 +51,94 @@ namespace {
 
 const int QContactOnlineAccount__FieldAccountPath = (QContactOnlineAccount::FieldSubTypes+1);
 
+// testBenchmark() measures how the telepathy plugin scales with the roster size.
+//
+// Environment:
+//   CONTACTSD_BENCH_TELEPATHY_SIZES  comma separated roster sizes, e.g. 100,1000,5000,10000 (default 100)
+//   CONTACTSD_BENCH_OUTPUT           JSON result file (default ut_telepathyplugin-benchmark.json)
+//   CONTACTSD_BENCH_BASELINE         JSON results of an earlier run to compare against
+//   CONTACTSD_BENCH_TOLERANCE        allowed regression over the baseline in percent (default 25)
+
+QList<int> benchmarkSizes()
+{
+    QList<int> sizes;
+
+    const QString env = QString::fromLocal8Bit(qgetenv("CONTACTSD_BENCH_TELEPATHY_SIZES"));
+    Q_FOREACH (const QString &size, env.split(QLatin1Char(','), QString::SkipEmptyParts)) {
+        bool ok = false;
+        const int value = size.trimmed().toInt(&ok);
+        if (ok && value > 0) {
+            sizes.append(value);
+        }
+    }
+
+    // The scalability curve is opt-in, a plain unit test run must fit in the suite timeout
+    if (sizes.isEmpty()) {
+        sizes << 100;
+    }
+
+    std::sort(sizes.begin(), sizes.end());
+    return sizes;
+}
+
+QString benchmarkOutputFileName()
+{
+    const QString env = QString::fromLocal8Bit(qgetenv("CONTACTSD_BENCH_OUTPUT"));
+    return env.isEmpty() ? QStringLiteral("ut_telepathyplugin-benchmark.json") : env;
+}
+
+QJsonObject benchmarkBaseline(int size)
+{
+    static QJsonArray baseline;
+    static bool loaded = false;
+
+    if (!loaded) {
+        loaded = true;
+
+        const QString fileName = QString::fromLocal8Bit(qgetenv("CONTACTSD_BENCH_BASELINE"));
+        if (!fileName.isEmpty()) {
+            QFile file(fileName);
+            if (file.open(QIODevice::ReadOnly)) {
+                baseline = QJsonDocument::fromJson(file.readAll()).object().value(QStringLiteral("results")).toArray();
+            } else {
+                qWarning() << "Unable to read benchmark baseline" << fileName;
+            }
+        }
+    }
+
+    Q_FOREACH (const QJsonValue &value, baseline) {
+        const QJsonObject result = value.toObject();
+        if (result.value(QStringLiteral("contacts")).toInt() == size) {
+            return result;
+        }
+    }
+
+    return QJsonObject();
+}
+
+qint64 contactsdPeakRssKb()
+{
+    // The daemon runs in its own process, started by with-daemon.sh
+    const QDBusReply<uint> pid = QDBusConnection::sessionBus().interface()->servicePid(QStringLiteral("com.nokia.contactsd"));
+    if (!pid.isValid()) {
+        return -1;
+    }
+
+    // VmHWM is the high water mark of the resident set for the process
+    QFile status(QStringLiteral("/proc/%1/status").arg(pid.value()));
+    if (!status.open(QIODevice::ReadOnly)) {
+        return -1;
+    }
+
+    Q_FOREACH (const QByteArray &line, status.readAll().split('\n')) {
+        if (line.startsWith("VmHWM:")) {
+            return line.mid(6).trimmed().split(' ').first().toLongLong();
+        }
+    }
+
+    return -1;
+}
+
 }
 
 TestTelepathyPlugin::TestTelepathyPlugin(QObject *parent) : Test(parent),
@@ -95,6 +188,18 @@ void TestTelepathyPlugin::cleanupTestCase()
 {
     cleanupTestCaseImpl();
 
+    if (!mBenchmarkResults.isEmpty()) {
+        QFile output(benchmarkOutputFileName());
+        if (output.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            QJsonObject root;
+            root.insert(QStringLiteral("results"), mBenchmarkResults);
+            output.write(QJsonDocument(root).toJson());
+            qDebug() << "Wrote benchmark results to" << output.fileName();
+        } else {
+            qWarning() << "Unable to write benchmark results to" << output.fileName();
+        }
+    }
+
     delete mContactManager;
     g_object_unref(mAccountManager);
 }
@@ -774,29 +879,98 @@ static gchar *randomString(int len, const gchar *chars = LETTERS)
     return result;
 }
 
-#define N_CONTACTS 100
+void TestTelepathyPlugin::testBenchmark_data()
+{
+    QTest::addColumn<int>("contacts");
+
+    Q_FOREACH (int size, benchmarkSizes()) {
+        QTest::newRow(QByteArray::number(size).constData()) << size;
+    }
+}
 
 void TestTelepathyPlugin::testBenchmark()
 {
+    QFETCH(int, contacts);
+
+    QElapsedTimer timer;
+
     /* create lots of new contacts */
     GArray *handles = g_array_new(FALSE, FALSE, sizeof(TpHandle));
-    for (int i = 0; i < N_CONTACTS; i++) {
-        TpHandle handle = ensureHandle(randomString(20));
+    for (int i = 0; i < contacts; i++) {
+        gchar *id = randomString(20);
+        TpHandle handle = ensureHandle(id);
         g_array_append_val(handles, handle);
+        g_free(id);
     }
-    test_contact_list_manager_request_subscription(mListManager,
-            handles->len, (TpHandle *) handles->data, "wait");
 
-    int added = N_CONTACTS;
+    qint64 importMs = -1;
+    int added = contacts;
     added *= 2; // Two contacts for each logical entity
-    runExpectation(TestExpectationMassPtr(new TestExpectationMass(added, 0, 0)));
+    TestExpectationMassPtr importExpectation(new TestExpectationMass(added, 0, 0));
+    connect(importExpectation.data(), &TestExpectation::finished, [&timer, &importMs]() {
+        importMs = timer.elapsed();
+    });
 
-    /* Set account offline */
-    tp_cli_connection_call_disconnect(mConnection, -1, NULL, NULL, NULL, NULL);
+    timer.start();
+    test_contact_list_manager_request_subscription(mListManager,
+            handles->len, (TpHandle *) handles->data, "wait");
+    g_array_free(handles, TRUE);
+    runExpectation(importExpectation);
+    if (QTest::currentTestFailed())
+        return;
 
+    /* Set account offline */
+    qint64 disconnectMs = -1;
     int count = mContactIds.count();
     count *= 2; // Two contacts for each logical entity
-    runExpectation(TestExpectationDisconnectPtr(new TestExpectationDisconnect(count)));
+    TestExpectationDisconnectPtr disconnectExpectation(new TestExpectationDisconnect(count));
+    connect(disconnectExpectation.data(), &TestExpectation::finished, [&timer, &disconnectMs]() {
+        disconnectMs = timer.elapsed();
+    });
+
+    timer.start();
+    tp_cli_connection_call_disconnect(mConnection, -1, NULL, NULL, NULL, NULL);
+    runExpectation(disconnectExpectation);
+    if (QTest::currentTestFailed())
+        return;
+
+    const qint64 peakRssKb = contactsdPeakRssKb();
+
+    QJsonObject result;
+    result.insert(QStringLiteral("benchmark"), QStringLiteral("telepathy-roster"));
+    result.insert(QStringLiteral("contacts"), contacts);
+    result.insert(QStringLiteral("importMs"), importMs);
+    result.insert(QStringLiteral("disconnectMs"), disconnectMs);
+    result.insert(QStringLiteral("peakRssKb"), peakRssKb);
+    mBenchmarkResults.append(result);
+
+    qDebug() << contacts << "contacts" << "import:" << importMs << "ms"
+             << "disconnect:" << disconnectMs << "ms" << "contactsd peak RSS:" << peakRssKb << "kB";
+
+    /* Compare with the baseline, if one was given */
+    const QJsonObject baseline = benchmarkBaseline(contacts);
+    if (baseline.isEmpty())
+        return;
+
+    bool ok = false;
+    int tolerance = qgetenv("CONTACTSD_BENCH_TOLERANCE").toInt(&ok);
+    if (!ok || tolerance < 0) {
+        tolerance = 25;
+    }
+
+    Q_FOREACH (const QString &key, QStringList() << QStringLiteral("importMs")
+                                                 << QStringLiteral("disconnectMs")
+                                                 << QStringLiteral("peakRssKb")) {
+        const qint64 expected = static_cast<qint64>(baseline.value(key).toDouble());
+        const qint64 actual = static_cast<qint64>(result.value(key).toDouble());
+        if (expected <= 0 || actual < 0) {
+            continue;
+        }
+
+        const qint64 limit = expected + (expected * tolerance) / 100;
+        QVERIFY2(actual <= limit, qPrintable(QStringLiteral("%1 regressed: %2, baseline %3, limit %4 (+%5%)")
+                                             .arg(key).arg(actual).arg(expected).arg(limit).arg(tolerance)));
+    }
 }
 
 TpHandle TestTelepathyPlugin::ensureHandle(const gchar *id)
@@ -24,6 +24,7 @@
 #ifndef TEST_TELEPATHY_PLUGIN_H
 #define TEST_TELEPATHY_PLUGIN_H
 
+#include <QJsonArray>
 #include <QObject>
 #include <QTest>
 #include <QString>
@@ -86,6 +87,7 @@ private Q_SLOTS:
     void testIRIEncode();
 
     /* Benchmark */
+    void testBenchmark_data();
     void testBenchmark();
 
     void cleanup();
@@ -116,6 +118,8 @@ private:
     TestExpectationPtr mExpectation;
 
     bool mCheckLeakedResources;
+
+    QJsonArray mBenchmarkResults;
 };
 
 #endif
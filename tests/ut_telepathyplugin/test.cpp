@@ -16,9 +16,12 @@ using Tp::PendingVoid;
 using Tp::Client::DBus::PeerInterface;
 
 Test::Test(QObject *parent)
-    : QObject(parent), mLoop(new QEventLoop(this))
+    : QObject(parent), mLoop(new QEventLoop(this)), mWatchdog(new QTimer(this))
 {
-    QTimer::singleShot(10 * 60 * 1000, this, SLOT(onWatchdog()));
+    mWatchdog->setSingleShot(true);
+    mWatchdog->setInterval(10 * 60 * 1000);
+    connect(mWatchdog, SIGNAL(timeout()), SLOT(onWatchdog()));
+    mWatchdog->start();
 }
 
 Test::~Test()
@@ -37,6 +40,8 @@ void Test::initTestCaseImpl()
 
 void Test::initImpl()
 {
+    // Each test function, or row of a data driven one, gets its own time limit
+    mWatchdog->start();
 }
 
 void Test::cleanupImpl()
@@ -120,6 +125,6 @@ void Test::onWatchdog()
 {
     // We can't use QFAIL because the test would then go to cleanup() and/or cleanupTestCase(),
     // which would often hang too - so let's just use abort
-    qWarning() << "Test took over 10 minutes to finish, it's probably hung up - aborting";
+    qWarning() << "Test function took over 10 minutes to finish, it's probably hung up - aborting";
     std::abort();
 }
@@ -22,6 +22,7 @@ public:
     virtual ~Test();
 
     QEventLoop *mLoop;
+    QTimer *mWatchdog;
     void processDBusQueue(Tp::DBusProxy *proxy);
 
 protected:
@@ -72,6 +72,7 @@ HEADERS += $$TOP_SOURCEDIR/plugins/telepathy/cdtpaccount.h \
     $$TOP_SOURCEDIR/plugins/telepathy/cdtpcontroller.h \
     $$TOP_SOURCEDIR/plugins/telepathy/cdtpplugin.h \
     $$TOP_SOURCEDIR/plugins/telepathy/cdtpstorage.h \
+    $$TOP_SOURCEDIR/plugins/telepathy/cdtpstoragehelpers.h \
     $$TOP_SOURCEDIR/plugins/telepathy/buddymanagementadaptor.h \
     $$TOP_SOURCEDIR/plugins/telepathy/redliststorage.h
 
@@ -81,6 +82,7 @@ SOURCES += $$TOP_SOURCEDIR/plugins/telepathy/cdtpaccount.cpp \
     $$TOP_SOURCEDIR/plugins/telepathy/cdtpcontroller.cpp \
     $$TOP_SOURCEDIR/plugins/telepathy/cdtpplugin.cpp \
     $$TOP_SOURCEDIR/plugins/telepathy/cdtpstorage.cpp \
+    $$TOP_SOURCEDIR/plugins/telepathy/cdtpstoragehelpers.cpp \
     $$TOP_SOURCEDIR/plugins/telepathy/redliststorage.cpp \
     $$TOP_SOURCEDIR/plugins/telepathy/buddymanagementadaptor.cpp \
     $$TOP_SOURCEDIR/plugins/telepathy/redliststorage.cpp